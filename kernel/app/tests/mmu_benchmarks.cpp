@@ -0,0 +1,66 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include "tests.h"
+
+#include <arch/mmu.h>
+#include <arch/ops.h>
+#include <err.h>
+#include <inttypes.h>
+#include <kernel/vm/vm_aspace.h>
+#include <stdio.h>
+
+// Measures the latency of unmapping committed ranges of the kernel address
+// space. Kernel mappings are global, so every unmap has to be shot down on
+// all CPUs; this mostly measures the cost of TLB invalidation.
+
+static const uint kUnmapIterations = 16;
+
+__NO_INLINE static status_t bench_unmap(size_t pages) {
+    VmAspace* aspace = VmAspace::kernel_aspace();
+    const uint arch_rw_flags = ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE;
+
+    uint64_t total = 0;
+    uint64_t max = 0;
+    for (uint i = 0; i < kUnmapIterations; i++) {
+        void* ptr;
+        status_t status = aspace->Alloc("unmap bench", pages * PAGE_SIZE, &ptr, 0,
+                                        VmAspace::VMM_FLAG_COMMIT, arch_rw_flags);
+        if (status != MX_OK) {
+            printf("failed to allocate %zu pages: %d\n", pages, status);
+            return status;
+        }
+
+        uint64_t count = arch_cycle_count();
+        status = aspace->FreeRegion(reinterpret_cast<vaddr_t>(ptr));
+        count = arch_cycle_count() - count;
+        if (status != MX_OK) {
+            printf("failed to free %zu pages: %d\n", pages, status);
+            return status;
+        }
+
+        total += count;
+        if (count > max) {
+            max = count;
+        }
+    }
+
+    printf("unmap %5zu pages: avg %10" PRIu64 " cycles (%8" PRIu64 " per page), max %10" PRIu64
+           " cycles\n",
+           pages, total / kUnmapIterations, total / kUnmapIterations / pages, max);
+    return MX_OK;
+}
+
+int mmu_bench(int argc, const cmd_args* argv) {
+    static const size_t kPageCounts[] = {1, 4, 16, 32, 64, 256, 1024};
+
+    for (size_t pages : kPageCounts) {
+        if (bench_unmap(pages) != MX_OK) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -15,6 +15,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/clock_tests.c \
     $(LOCAL_DIR)/fibo.c \
     $(LOCAL_DIR)/mem_tests.cpp \
+    $(LOCAL_DIR)/mmu_benchmarks.cpp \
     $(LOCAL_DIR)/printf_tests.c \
     $(LOCAL_DIR)/sync_ipi_tests.c \
     $(LOCAL_DIR)/sleep_tests.c \
@@ -22,6 +23,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/thread_tests.c \
     $(LOCAL_DIR)/alloc_checker_tests.cpp \
     $(LOCAL_DIR)/timer_tests.c \
+    $(LOCAL_DIR)/vm_benchmarks.cpp \
 
 
 MODULE_DEPS += \
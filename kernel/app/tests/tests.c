@@ -25,6 +25,8 @@ STATIC_COMMAND("thread_tests", "test the scheduler", (console_cmd)&thread_tests)
 STATIC_COMMAND("clock_tests", "test clocks", (console_cmd)&clock_tests)
 STATIC_COMMAND("sleep_tests", "tests sleep", (console_cmd)&sleep_tests)
 STATIC_COMMAND("bench", "miscellaneous benchmarks", (console_cmd)&benchmarks)
+STATIC_COMMAND("mmu_bench", "time unmapping committed kernel memory", (console_cmd)&mmu_bench)
+STATIC_COMMAND("vm_fault_bench", "time page faults with and without pre-zeroed pages", (console_cmd)&vm_fault_bench)
 STATIC_COMMAND("fibo", "threaded fibonacci", (console_cmd)&fibo)
 STATIC_COMMAND("spinner", "create a spinning thread", (console_cmd)&spinner)
 STATIC_COMMAND("sync_ipi_tests", "test synchronous IPIs", (console_cmd)&sync_ipi_tests)
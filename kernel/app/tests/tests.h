@@ -19,6 +19,8 @@ void printf_tests(void);
 void clock_tests(void);
 void timer_tests(void);
 void benchmarks(void);
+int mmu_bench(int argc, const cmd_args *argv);
+int vm_fault_bench(int argc, const cmd_args *argv);
 int fibo(int argc, const cmd_args *argv);
 int spinner(int argc, const cmd_args *argv);
 int ref_counted_tests(int argc, const cmd_args *argv);
@@ -0,0 +1,83 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include "tests.h"
+
+#include <arch/mmu.h>
+#include <arch/ops.h>
+#include <err.h>
+#include <inttypes.h>
+#include <kernel/thread.h>
+#include <kernel/vm/fault.h>
+#include <kernel/vm/pmm.h>
+#include <kernel/vm/vm_aspace.h>
+#include <stdio.h>
+
+// Measures the latency of write faults on demand-paged kernel memory, which
+// allocate a zeroed page per fault, with and without the PMM's pool of
+// pre-zeroed pages.
+
+static const size_t kFaultPages = 1024;
+
+__NO_INLINE static status_t bench_faults(const char* label) {
+    VmAspace* aspace = VmAspace::kernel_aspace();
+    const uint arch_rw_flags = ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE;
+
+    void* ptr;
+    status_t status = aspace->Alloc("fault bench", kFaultPages * PAGE_SIZE, &ptr, 0, 0,
+                                    arch_rw_flags);
+    if (status != MX_OK) {
+        printf("failed to allocate %zu pages: %d\n", kFaultPages, status);
+        return status;
+    }
+
+    size_t zeroed = pmm_count_zeroed_pages();
+    uint64_t total = 0;
+    uint64_t max = 0;
+    vaddr_t va = reinterpret_cast<vaddr_t>(ptr);
+    for (size_t i = 0; i < kFaultPages; i++, va += PAGE_SIZE) {
+        uint64_t count = arch_cycle_count();
+        status = vmm_page_fault_handler(va, VMM_PF_FLAG_SW_FAULT | VMM_PF_FLAG_WRITE);
+        count = arch_cycle_count() - count;
+        if (status != MX_OK) {
+            printf("failed to fault page %zu: %d\n", i, status);
+            break;
+        }
+
+        total += count;
+        if (count > max) {
+            max = count;
+        }
+    }
+    aspace->FreeRegion(reinterpret_cast<vaddr_t>(ptr));
+    if (status != MX_OK) {
+        return status;
+    }
+
+    printf("%-16s %5zu faults: avg %8" PRIu64 " cycles, max %10" PRIu64
+           " cycles (%zu pages pre-zeroed)\n",
+           label, kFaultPages, total / kFaultPages, max, zeroed);
+    return MX_OK;
+}
+
+int vm_fault_bench(int argc, const cmd_args* argv) {
+    // Every fault zeroes its page, as before the zero pool existed.
+    pmm_set_zero_pool_enabled(false);
+    status_t status = bench_faults("zero on fault");
+    pmm_set_zero_pool_enabled(true);
+    if (status != MX_OK) {
+        return -1;
+    }
+
+    // Give the zeroing thread up to a second to fill the pool.
+    for (int i = 0; i < 100 && pmm_count_zeroed_pages() < kFaultPages; i++) {
+        thread_sleep_relative(LK_MSEC(10));
+    }
+    if (bench_faults("pre-zeroed pool") != MX_OK) {
+        return -1;
+    }
+    return 0;
+}
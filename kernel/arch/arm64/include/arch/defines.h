@@ -24,6 +24,10 @@
 #define PAGE_SIZE (1L << PAGE_SIZE_SHIFT)
 #define USER_PAGE_SIZE (1L << USER_PAGE_SIZE_SHIFT)
 
+/* the smallest block the mmu can map, one level above a page */
+#define LARGE_PAGE_SIZE_SHIFT (2 * PAGE_SIZE_SHIFT - 3)
+#define LARGE_PAGE_SIZE (1L << LARGE_PAGE_SIZE_SHIFT)
+
 #if ARM64_CPU_CORTEX_A53
 #define CACHE_LINE 64
 #elif ARM64_CPU_CORTEX_A57
@@ -883,6 +883,11 @@ void arch_zero_page(void* _ptr) {
     } while (ptr != end_ptr);
 }
 
+void arch_zero_page_nontemporal(void* ptr) {
+    // dc zva already zeroes without reading the lines in.
+    arch_zero_page(ptr);
+}
+
 ArmArchVmAspace::~ArmArchVmAspace() {
     // TODO: check that we've destroyed the aspace
 }
@@ -122,7 +122,8 @@ status_t x86_bootstrap16_prep(
     ASSERT(long_mode_entry <= UINT32_MAX);
 
     uint64_t phys_bootstrap_pml4 = bootstrap_aspace->arch_aspace().pt_phys();
-    uint64_t phys_kernel_pml4 = x86_get_cr3();
+    // CR3 also holds the current PCID, which the APs must not inherit.
+    uint64_t phys_kernel_pml4 = x86_get_cr3() & X86_PG_FRAME;
     if (phys_bootstrap_pml4 > UINT32_MAX) {
         // TODO(teisenbe): Once the pmm supports it, we should request that this
         // VmAspace is backed by a low mem PML4, so we can avoid this issue.
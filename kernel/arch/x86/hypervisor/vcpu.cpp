@@ -656,6 +656,9 @@ status_t Vcpu::Resume(mx_guest_packet_t* packet) {
             vmx_state_.host_state.xcr0 = x86_xgetbv(0);
             x86_xsetbv(0, vmx_state_.guest_state.xcr0);
         }
+        // The PCID of this thread's address space may have changed since it
+        // was last scheduled, so refresh the CR3 loaded on VM exit.
+        vmcs.Write(VmcsFieldXX::HOST_CR3, x86_get_cr3());
         status = vmx_enter(&vmx_state_);
         if (x86_feature_test(X86_FEATURE_XSAVE)) {
             // Save the guest XCR0, and load the host XCR0.
@@ -15,11 +15,13 @@
 #include <mxtl/canary.h>
 
 struct MappingCursor;
+struct PendingTlbInvalidation;
 
 class X86ArchVmAspace final : public ArchVmAspaceInterface {
 public:
     template <typename PageTable>
-    static void UnmapEntry(X86ArchVmAspace* aspace, vaddr_t vaddr, volatile pt_entry_t* pte);
+    static void UnmapEntry(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                           volatile pt_entry_t* pte);
 
     X86ArchVmAspace() {}
     virtual ~X86ArchVmAspace();
@@ -48,8 +50,15 @@ public:
 
     size_t pt_pages() const { return pt_pages_; }
 
+    size_t tlb_shootdowns() const { return tlb_shootdowns_; }
+
     int active_cpus() { return atomic_load(&active_cpus_); }
 
+    // Record that the given CPUs may hold TLB entries for this aspace that
+    // are out of date with its page tables, or that they no longer do.
+    void MarkTlbStale(int cpus) { atomic_or(&tlb_stale_cpus_, cpus); }
+    void ClearTlbStale(int cpus) { atomic_and(&tlb_stale_cpus_, ~cpus); }
+
     IoBitmap& io_bitmap() { return io_bitmap_; }
 
     static void ContextSwitch(X86ArchVmAspace* from, X86ArchVmAspace* to);
@@ -63,6 +72,9 @@ private:
     template <template <int> class PageTable>
     status_t DestroyAspace();
 
+    uint64_t AcquirePcid();
+    ulong SwitchCr3(uint cpu);
+
     template <template <int> class PageTable>
     status_t MapPages(vaddr_t vaddr, paddr_t paddr, const size_t count,
                       uint mmu_flags, size_t* mapped);
@@ -80,32 +92,38 @@ private:
     template <typename PageTable>
     status_t AddMapping(volatile pt_entry_t* table, uint mmu_flags,
                         const MappingCursor& start_cursor,
-                        MappingCursor* new_cursor);
+                        MappingCursor* new_cursor,
+                        PendingTlbInvalidation* pending);
 
     template <typename PageTable>
     status_t AddMappingL0(volatile pt_entry_t* table, uint mmu_flags,
                           const MappingCursor& start_cursor,
-                          MappingCursor* new_cursor);
+                          MappingCursor* new_cursor,
+                          PendingTlbInvalidation* pending);
 
     template <typename PageTable>
     bool RemoveMapping(volatile pt_entry_t* table,
                        const MappingCursor& start_cursor,
-                       MappingCursor* new_cursor);
+                       MappingCursor* new_cursor,
+                       PendingTlbInvalidation* pending);
 
     template <typename PageTable>
     bool RemoveMappingL0(volatile pt_entry_t* table,
                          const MappingCursor& start_cursor,
-                         MappingCursor* new_cursor);
+                         MappingCursor* new_cursor,
+                         PendingTlbInvalidation* pending);
 
     template <typename PageTable>
     status_t UpdateMapping(volatile pt_entry_t* table, uint mmu_flags,
                            const MappingCursor& start_cursor,
-                           MappingCursor* new_cursor);
+                           MappingCursor* new_cursor,
+                           PendingTlbInvalidation* pending);
 
     template <typename PageTable>
     status_t UpdateMappingL0(volatile pt_entry_t* table, uint mmu_flags,
                              const MappingCursor& start_cursor,
-                             MappingCursor* new_cursor);
+                             MappingCursor* new_cursor,
+                             PendingTlbInvalidation* pending);
 
     template <typename PageTable>
     status_t GetMapping(volatile pt_entry_t* table, vaddr_t vaddr,
@@ -118,11 +136,12 @@ private:
                           volatile pt_entry_t** mapping);
 
     template <typename PageTable>
-    void UpdateEntry(vaddr_t vaddr, volatile pt_entry_t* pte, paddr_t paddr,
-                     arch_flags_t flags);
+    void UpdateEntry(PendingTlbInvalidation* pending, vaddr_t vaddr, volatile pt_entry_t* pte,
+                     paddr_t paddr, arch_flags_t flags);
 
     template <typename PageTable>
-    status_t SplitLargePage(vaddr_t vaddr, volatile pt_entry_t* pte);
+    status_t SplitLargePage(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                            volatile pt_entry_t* pte);
 
     mxtl::Canary<mxtl::magic("VAAS")> canary_;
     IoBitmap io_bitmap_;
@@ -134,6 +153,9 @@ private:
     // Counter of pages allocated to back the translation table.
     size_t pt_pages_ = 0;
 
+    // Counter of cross-CPU TLB shootdowns issued by operations on this aspace.
+    size_t tlb_shootdowns_ = 0;
+
     uint flags_ = 0;
 
     // Range of address space.
@@ -143,6 +165,15 @@ private:
     // CPUs that are currently executing in this aspace.
     // Actually an mp_cpu_mask_t, but header dependencies.
     volatile int active_cpus_ = 0;
+
+    // CPUs that must flush this aspace's PCID the next time they switch to
+    // it. Also an mp_cpu_mask_t.
+    volatile int tlb_stale_cpus_ = 0;
+
+    // The PCID assigned to this aspace in its low kPcidShift bits, and the
+    // generation it was allocated from above them. See AcquirePcid().
+    static constexpr uint kPcidShift = 12;
+    volatile uint64_t pcid_ = 0;
 };
 
 using ArchVmAspace = X86ArchVmAspace;
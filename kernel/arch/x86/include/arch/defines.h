@@ -11,6 +11,10 @@
 #define PAGE_SIZE 4096
 #define PAGE_SIZE_SHIFT 12
 
+/* the smallest page size above PAGE_SIZE the mmu can map */
+#define LARGE_PAGE_SIZE_SHIFT 21
+#define LARGE_PAGE_SIZE (1L << LARGE_PAGE_SIZE_SHIFT)
+
 #define CACHE_LINE 64
 #define MAX_CACHE_LINE 64
 
@@ -22,9 +22,12 @@
 #define X86_CR4_OSXMMEXPT               0x00000400 /* os supports xmm exception */
 #define X86_CR4_VMXE                    0x00002000 /* enable vmx */
 #define X86_CR4_FSGSBASE                0x00010000 /* enable {rd,wr}{fs,gs}base */
+#define X86_CR4_PCIDE                   0x00020000 /* process-context identifiers */
 #define X86_CR4_OSXSAVE                 0x00040000 /* os supports xsave */
 #define X86_CR4_SMEP                    0x00100000 /* SMEP protection enabling */
 #define X86_CR4_SMAP                    0x00200000 /* SMAP protection enabling */
+#define X86_CR3_PCID_MASK               0x00000fff /* process-context identifier */
+#define X86_CR3_NOFLUSH                 (1UL << 63) /* keep TLB entries of the new PCID */
 #define X86_EFER_SCE                    0x00000001 /* enable SYSCALL */
 #define X86_EFER_LME                    0x00000100 /* long mode enable */
 #define X86_EFER_LMA                    0x00000400 /* long mode active */
@@ -53,6 +56,9 @@
 #define X86_MSR_IA32_MTRR_FIX4K_C0000   0x00000268 /* MTRR FIX4K_C0000 */
 #define X86_MSR_IA32_MTRR_FIX4K_F8000   0x0000026f /* MTRR FIX4K_F8000 */
 #define X86_MSR_IA32_PAT                0x00000277 /* PAT */
+#define X86_MSR_IA32_PMC0               0x000000c1 /* general purpose performance counter 0 */
+#define X86_MSR_IA32_PERFEVTSEL0        0x00000186 /* performance event select 0 */
+#define X86_MSR_IA32_PERF_GLOBAL_CTRL   0x0000038f /* enable/disable performance counters */
 #define X86_MSR_IA32_RAPL_POWER_UNIT    0x00000606 /* unit multipliers in RAPL interfaces */
 #define X86_MSR_IA32_TSC_DEADLINE       0x000006e0 /* TSC deadline */
 #define X86_MSR_IA32_EFER               0xc0000080 /* EFER */
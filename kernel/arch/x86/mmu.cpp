@@ -6,6 +6,7 @@
 
 #include <assert.h>
 #include <err.h>
+#include <list.h>
 #include <string.h>
 #include <trace.h>
 
@@ -31,6 +32,25 @@ uint8_t g_paddr_width = 32;
 /* True if the system supports 1GB pages */
 static bool supports_huge_pages = false;
 
+/* True if the system supports process-context identifiers, in which case
+ * they are enabled on every CPU */
+static bool supports_pcid = false;
+
+/* True if the system supports the INVPCID instruction */
+static bool supports_invpcid = false;
+
+/* Process-context identifiers are handed out to user aspaces in generations.
+ * Within a generation an aspace is given a distinct PCID the first time it is
+ * switched to. When they run out a new generation begins, and every CPU
+ * flushes its non-global TLB entries before using a PCID from it. PCID 0 is
+ * used by the kernel aspace. */
+static const uint kPcidCount = 1u << 12;
+static spin_lock_t pcid_lock = SPIN_LOCK_INITIAL_VALUE;
+static volatile uint64_t pcid_generation = 1;
+static uint pcid_next = 1; /* guarded by pcid_lock */
+/* The generation of PCIDs each CPU's TLB may hold entries for */
+static uint64_t cpu_pcid_generation[SMP_MAX_CPUS];
+
 /* top level kernel page tables, initialized in start.S */
 volatile pt_entry_t pml4[NO_OF_PT_ENTRIES] __ALIGNED(PAGE_SIZE);
 volatile pt_entry_t pdp[NO_OF_PT_ENTRIES] __ALIGNED(PAGE_SIZE); /* temporary */
@@ -103,82 +123,185 @@ static bool x86_mmu_check_paddr(paddr_t paddr) {
     return paddr <= max_paddr;
 }
 
+/* INVPCID invalidation types, see Intel 3A section 4.10.4.1 */
+enum invpcid_type : uint64_t {
+    INVPCID_ADDRESS = 0,
+    INVPCID_SINGLE_CONTEXT = 1,
+    INVPCID_ALL_INCLUDING_GLOBAL = 2,
+    INVPCID_ALL_EXCLUDING_GLOBAL = 3,
+};
+
+static void x86_invpcid(invpcid_type type, uint16_t pcid, vaddr_t vaddr) {
+    struct {
+        uint64_t pcid;
+        uint64_t vaddr;
+    } desc = {pcid, vaddr};
+    __asm__ volatile("invpcid %0, %1" ::"m"(desc), "r"(static_cast<uint64_t>(type))
+                     : "memory");
+}
+
 /**
  * @brief  invalidate all TLB entries, including global entries
  */
 static void x86_tlb_global_invalidate() {
-    /* See Intel 3A section 4.10.4.1 */
-    ulong cr4 = x86_get_cr4();
-    if (likely(cr4 & X86_CR4_PGE)) {
-        x86_set_cr4(cr4 & ~X86_CR4_PGE);
-        x86_set_cr4(cr4);
-    } else {
-        x86_set_cr3(x86_get_cr3());
+    if (supports_invpcid) {
+        x86_invpcid(INVPCID_ALL_INCLUDING_GLOBAL, 0, 0);
+        return;
     }
+
+    /* See Intel 3A section 4.10.4.1: changing CR4.PGE flushes every PCID,
+     * whereas reloading CR3 would flush only the current one. */
+    ulong cr4 = x86_get_cr4();
+    x86_set_cr4(cr4 ^ X86_CR4_PGE);
+    x86_set_cr4(cr4);
 }
 
-/* Task used for invalidating a TLB entry on each CPU */
-struct tlb_invalidate_page_context {
+/**
+ * @brief A set of TLB invalidations accumulated over a single page table
+ * operation (map, unmap or protect), to be issued to other CPUs at once.
+ *
+ * Page table pages that are unlinked while the invalidations are pending
+ * may still be cached by other CPUs' paging-structure caches, so they are
+ * also held here and only returned to the PMM after the shootdown.
+ */
+struct PendingTlbInvalidation {
+    /* Above this many pages it is cheaper to flush the whole TLB */
+    static constexpr size_t kMaxPages = 32;
+
+    PendingTlbInvalidation() {
+        list_initialize(&freed_pages);
+    }
+    ~PendingTlbInvalidation() {
+        DEBUG_ASSERT(count == 0 && !full_shootdown);
+        DEBUG_ASSERT(list_is_empty(&freed_pages));
+    }
+
+    void enqueue(vaddr_t vaddr, enum page_table_levels level, bool is_global) {
+        if (is_global) {
+            contains_global = true;
+        }
+        /* A PML4 entry covers far too much to invalidate page by page */
+        if (level == PML4_L || count == kMaxPages) {
+            full_shootdown = true;
+            return;
+        }
+        vaddrs[count++] = vaddr;
+    }
+
+    void free_page_table(volatile pt_entry_t* table) {
+        vm_page_t* page = paddr_to_vm_page(X86_VIRT_TO_PHYS(table));
+        list_add_tail(&freed_pages, &page->free.node);
+    }
+
+    bool empty() const {
+        return count == 0 && !full_shootdown;
+    }
+
+    void clear() {
+        count = 0;
+        full_shootdown = false;
+        contains_global = false;
+    }
+
+    vaddr_t vaddrs[kMaxPages];
+    size_t count = 0;
+    bool full_shootdown = false;
+    bool contains_global = false;
+    struct list_node freed_pages;
+};
+
+/* Task used for invalidating a set of TLB entries on each CPU */
+struct tlb_invalidate_context {
     ulong target_cr3;
-    vaddr_t vaddr;
-    enum page_table_levels level;
-    bool global_page;
+    X86ArchVmAspace* aspace;
+    const PendingTlbInvalidation* pending;
 };
-static void tlb_invalidate_page_task(void* raw_context) {
+static void tlb_invalidate_task(void* raw_context) {
     DEBUG_ASSERT(arch_ints_disabled());
-    tlb_invalidate_page_context* context = (tlb_invalidate_page_context*)raw_context;
+    tlb_invalidate_context* context = (tlb_invalidate_context*)raw_context;
+    const PendingTlbInvalidation* pending = context->pending;
 
     ulong cr3 = x86_get_cr3();
-    if (context->target_cr3 != cr3 && !context->global_page) {
+    if (context->target_cr3 != (cr3 & X86_PG_FRAME) && !pending->contains_global) {
         /* This invalidation doesn't apply to this CPU, ignore it */
         return;
     }
 
-    switch (context->level) {
-    case PML4_L:
-        x86_tlb_global_invalidate();
-        break;
-    case PDP_L:
-    case PD_L:
-    case PT_L:
-        __asm__ volatile("invlpg %0" ::"m"(*(uint8_t*)context->vaddr));
-        break;
+    /* This CPU's TLB is brought up to date for the aspace below, so it need
+     * not flush it the next time it switches to the aspace. */
+    if (context->aspace != nullptr) {
+        context->aspace->ClearTlbStale(1U << arch_curr_cpu_num());
+    }
+
+    if (pending->full_shootdown) {
+        if (pending->contains_global) {
+            x86_tlb_global_invalidate();
+        } else if (supports_invpcid) {
+            x86_invpcid(INVPCID_SINGLE_CONTEXT, cr3 & X86_CR3_PCID_MASK, 0);
+        } else {
+            /* Without the no-flush bit this flushes the current PCID */
+            x86_set_cr3(cr3);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < pending->count; i++) {
+        __asm__ volatile("invlpg %0" ::"m"(*(uint8_t*)pending->vaddrs[i]));
     }
 }
 
 /**
- * @brief Invalidate a single page at a given page table level
+ * @brief Execute a batch of pending TLB invalidations on every CPU that may
+ * have the translations cached, and then release any page tables that were
+ * unlinked along the way.
  *
  * @param aspace The aspace we're invalidating for (if NULL, assume for current one)
- * @param vaddr The virtual address we are invalidating the TLB entry for
- * @param level The page table level that maps this vaddr
- * @param global_page True if we are invalidating a global mapping
+ * @param pending The invalidations to perform; emptied on return
  *
- * TODO(teisenbe): Optimize this.  This is horribly inefficient.
- * We should also change this to pool invalidations from a single
- * "transaction" and then only execute a single mp_sync_exec for that
- * transaction, rather than one per page.
+ * @return true if a shootdown was issued
  */
-static void x86_tlb_invalidate_page(X86ArchVmAspace* aspace, vaddr_t vaddr,
-                                    enum page_table_levels level, bool global_page) {
-    ulong cr3 = aspace ? aspace->pt_phys() : x86_get_cr3();
-    struct tlb_invalidate_page_context task_context = {
-        .target_cr3 = cr3, .vaddr = vaddr, .level = level, .global_page = global_page,
-    };
+static bool x86_tlb_invalidate(X86ArchVmAspace* aspace, PendingTlbInvalidation* pending) {
+    /* Intermediate tables of the kernel half are shared by every PCID, and
+     * invlpg only drops paging-structure cache entries for the current one. */
+    if (pending->contains_global && !list_is_empty(&pending->freed_pages)) {
+        pending->full_shootdown = true;
+    }
 
-    /* Target only CPUs this aspace is active on.  It may be the case that some
-     * other CPU will become active in it after this load, or will have left it
-     * just before this load.  In the former case, it is becoming active after
-     * the write to the page table, so it will see the change.  In the latter
-     * case, it will get a spurious request to flush. */
-    mp_cpu_mask_t targets;
-    if (global_page || aspace == nullptr) {
-        targets = MP_CPU_ALL;
-    } else {
-        targets = aspace->active_cpus();
+    bool issued = !pending->empty();
+    if (issued) {
+        ulong cr3 = aspace ? aspace->pt_phys() : (x86_get_cr3() & X86_PG_FRAME);
+        struct tlb_invalidate_context task_context = {
+            .target_cr3 = cr3, .aspace = aspace, .pending = pending,
+        };
+
+        /* With PCIDs, CPUs that ran this aspace earlier may still hold TLB
+         * entries for it. Have them flush it when they next switch to it.
+         * This must be done before active_cpus is sampled below, see
+         * ContextSwitch. */
+        if (supports_pcid && aspace != nullptr && !pending->contains_global) {
+            aspace->MarkTlbStale(mp_get_online_mask());
+        }
+
+        /* Target only CPUs this aspace is active on.  It may be the case that some
+         * other CPU will become active in it after this load, or will have left it
+         * just before this load.  In the former case, it is becoming active after
+         * the write to the page table, so it will see the change.  In the latter
+         * case, it will get a spurious request to flush. */
+        mp_cpu_mask_t targets;
+        if (pending->contains_global || aspace == nullptr) {
+            targets = MP_CPU_ALL;
+        } else {
+            targets = aspace->active_cpus();
+        }
+
+        mp_sync_exec(targets, tlb_invalidate_task, &task_context);
+        pending->clear();
     }
 
-    mp_sync_exec(targets, tlb_invalidate_page_task, &task_context);
+    if (!list_is_empty(&pending->freed_pages)) {
+        pmm_free(&pending->freed_pages);
+    }
+    return issued;
 }
 
 template <int Level>
@@ -366,10 +489,11 @@ struct PageTable : PageTableBase<Level> {
     }
 
     /**
-     * @brief Invalidate a single page at a given page table level
+     * @brief Queue invalidation of a single page at this page table level
      */
-    static void tlb_invalidate_page(X86ArchVmAspace* aspace, vaddr_t vaddr, bool global_page) {
-        x86_tlb_invalidate_page(aspace, vaddr, Base::level, global_page);
+    static void tlb_invalidate_page(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                                    bool global_page) {
+        pending->enqueue(vaddr, Base::level, global_page);
     }
 };
 
@@ -417,9 +541,10 @@ struct ExtendedPageTable : PageTableBase<Level> {
     }
 
     /**
-     * @brief Invalidate a single page at a given page table level
+     * @brief Queue invalidation of a single page at this page table level
      */
-    static void tlb_invalidate_page(X86ArchVmAspace* aspace, vaddr_t vaddr, bool global_page) {
+    static void tlb_invalidate_page(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                                    bool global_page) {
         // TODO(abdulla): Implement this.
     }
 };
@@ -515,8 +640,8 @@ public:
 };
 
 template <typename PageTable>
-void X86ArchVmAspace::UpdateEntry(vaddr_t vaddr, volatile pt_entry_t* pte, paddr_t paddr,
-                                  arch_flags_t flags) {
+void X86ArchVmAspace::UpdateEntry(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                                  volatile pt_entry_t* pte, paddr_t paddr, arch_flags_t flags) {
     DEBUG_ASSERT(pte);
     DEBUG_ASSERT(IS_PAGE_ALIGNED(paddr));
 
@@ -527,12 +652,13 @@ void X86ArchVmAspace::UpdateEntry(vaddr_t vaddr, volatile pt_entry_t* pte, paddr
 
     /* attempt to invalidate the page */
     if (IS_PAGE_PRESENT(olde)) {
-        PageTable::tlb_invalidate_page(this, vaddr, is_kernel_address(vaddr));
+        PageTable::tlb_invalidate_page(pending, vaddr, is_kernel_address(vaddr));
     }
 }
 
 template <typename PageTable>
-void X86ArchVmAspace::UnmapEntry(X86ArchVmAspace* aspace, vaddr_t vaddr, volatile pt_entry_t* pte) {
+void X86ArchVmAspace::UnmapEntry(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                                 volatile pt_entry_t* pte) {
     DEBUG_ASSERT(pte);
 
     pt_entry_t olde = *pte;
@@ -541,7 +667,7 @@ void X86ArchVmAspace::UnmapEntry(X86ArchVmAspace* aspace, vaddr_t vaddr, volatil
 
     /* attempt to invalidate the page */
     if (IS_PAGE_PRESENT(olde)) {
-        PageTable::tlb_invalidate_page(aspace, vaddr, is_kernel_address(vaddr));
+        PageTable::tlb_invalidate_page(pending, vaddr, is_kernel_address(vaddr));
     }
 }
 
@@ -565,7 +691,8 @@ static volatile pt_entry_t* _map_alloc_page(void) {
  * @brief Split the given large page into smaller pages
  */
 template <typename PageTable>
-status_t X86ArchVmAspace::SplitLargePage(vaddr_t vaddr, volatile pt_entry_t* pte) {
+status_t X86ArchVmAspace::SplitLargePage(PendingTlbInvalidation* pending, vaddr_t vaddr,
+                                         volatile pt_entry_t* pte) {
     static_assert(PageTable::level != PT_L, "tried splitting PT_L");
     LTRACEF_LEVEL(2, "splitting table %p at level %d\n", pte, PageTable::level);
 
@@ -586,14 +713,14 @@ status_t X86ArchVmAspace::SplitLargePage(vaddr_t vaddr, volatile pt_entry_t* pte
         volatile pt_entry_t* e = m + i;
         // If this is a PDP_L (i.e. huge page), flags will include the
         // PS bit still, so the new PD entries will be large pages.
-        UpdateEntry<typename PageTable::LowerTable>(new_vaddr, e, new_paddr, flags);
+        UpdateEntry<typename PageTable::LowerTable>(pending, new_vaddr, e, new_paddr, flags);
         new_vaddr += ps;
         new_paddr += ps;
     }
     DEBUG_ASSERT(new_vaddr == vaddr + PageTable::page_size());
 
     flags = PageTable::intermediate_arch_flags();
-    UpdateEntry<PageTable>(vaddr, pte, X86_VIRT_TO_PHYS(m), flags);
+    UpdateEntry<PageTable>(pending, vaddr, pte, X86_VIRT_TO_PHYS(m), flags);
     pt_pages_++;
     return MX_OK;
 }
@@ -690,13 +817,16 @@ status_t X86ArchVmAspace::GetMappingL0(volatile pt_entry_t* table, vaddr_t vaddr
  * unmap within table
  * @param new_cursor A returned cursor describing how much work was not
  * completed.  Must be non-null.
+ * @param pending TLB invalidations and page table frees to perform once the
+ * whole range has been unmapped.
  *
  * @return true if at least one page was unmapped at this level
  */
 template <typename PageTable>
 bool X86ArchVmAspace::RemoveMapping(volatile pt_entry_t* table,
                                     const MappingCursor& start_cursor,
-                                    MappingCursor* new_cursor) {
+                                    MappingCursor* new_cursor,
+                                    PendingTlbInvalidation* pending) {
     DEBUG_ASSERT(table);
     LTRACEF("L: %d, %016" PRIxPTR " %016zx\n", PageTable::level, start_cursor.vaddr,
             start_cursor.size);
@@ -721,7 +851,7 @@ bool X86ArchVmAspace::RemoveMapping(volatile pt_entry_t* table,
             bool vaddr_level_aligned = PageTable::page_aligned(new_cursor->vaddr);
             // If the request covers the entire large page, just unmap it
             if (vaddr_level_aligned && new_cursor->size >= ps) {
-                UnmapEntry<PageTable>(this, new_cursor->vaddr, e);
+                UnmapEntry<PageTable>(pending, new_cursor->vaddr, e);
                 unmapped = true;
 
                 new_cursor->vaddr += ps;
@@ -731,11 +861,11 @@ bool X86ArchVmAspace::RemoveMapping(volatile pt_entry_t* table,
             }
             // Otherwise, we need to split it
             vaddr_t page_vaddr = new_cursor->vaddr & ~(ps - 1);
-            status_t status = SplitLargePage<PageTable>(page_vaddr, e);
+            status_t status = SplitLargePage<PageTable>(pending, page_vaddr, e);
             if (status != MX_OK) {
                 // If split fails, just unmap the whole thing, and let a
                 // subsequent page fault clean it up.
-                UnmapEntry<PageTable>(this, new_cursor->vaddr, e);
+                UnmapEntry<PageTable>(pending, new_cursor->vaddr, e);
                 unmapped = true;
 
                 new_cursor->SkipEntry<PageTable>();
@@ -747,7 +877,7 @@ bool X86ArchVmAspace::RemoveMapping(volatile pt_entry_t* table,
         MappingCursor cursor;
         volatile pt_entry_t* next_table = get_next_table_from_entry(pt_val);
         bool lower_unmapped = RemoveMapping<typename PageTable::LowerTable>(
-            next_table, *new_cursor, &cursor);
+            next_table, *new_cursor, &cursor, pending);
 
         // If we were requesting to unmap everything in the lower page table,
         // we know we can unmap the lower level page table.  Otherwise, if
@@ -767,8 +897,8 @@ bool X86ArchVmAspace::RemoveMapping(volatile pt_entry_t* table,
             }
         }
         if (unmap_page_table) {
-            UnmapEntry<PageTable>(this, new_cursor->vaddr, e);
-            pmm_free_page(paddr_to_vm_page(X86_VIRT_TO_PHYS(next_table)));
+            UnmapEntry<PageTable>(pending, new_cursor->vaddr, e);
+            pending->free_page_table(next_table);
             pt_pages_--;
             unmapped = true;
         }
@@ -784,22 +914,25 @@ bool X86ArchVmAspace::RemoveMapping(volatile pt_entry_t* table,
 template <>
 bool X86ArchVmAspace::RemoveMapping<PageTable<PT_L>>(volatile pt_entry_t* table,
                                                      const MappingCursor& start_cursor,
-                                                     MappingCursor* new_cursor) {
-    return RemoveMappingL0<PageTable<PT_L>>(table, start_cursor, new_cursor);
+                                                     MappingCursor* new_cursor,
+                                                     PendingTlbInvalidation* pending) {
+    return RemoveMappingL0<PageTable<PT_L>>(table, start_cursor, new_cursor, pending);
 }
 
 template <>
 bool X86ArchVmAspace::RemoveMapping<ExtendedPageTable<PT_L>>(volatile pt_entry_t* table,
                                                              const MappingCursor& start_cursor,
-                                                             MappingCursor* new_cursor) {
-    return RemoveMappingL0<ExtendedPageTable<PT_L>>(table, start_cursor, new_cursor);
+                                                             MappingCursor* new_cursor,
+                                                             PendingTlbInvalidation* pending) {
+    return RemoveMappingL0<ExtendedPageTable<PT_L>>(table, start_cursor, new_cursor, pending);
 }
 
 // Base case of RemoveMapping for smallest page size.
 template <typename PageTable>
 bool X86ArchVmAspace::RemoveMappingL0(volatile pt_entry_t* table,
                                       const MappingCursor& start_cursor,
-                                      MappingCursor* new_cursor) {
+                                      MappingCursor* new_cursor,
+                                      PendingTlbInvalidation* pending) {
     static_assert(PageTable::level == PT_L, "RemoveMappingL0 used with wrong level");
     LTRACEF("%016" PRIxPTR " %016zx\n", start_cursor.vaddr, start_cursor.size);
     DEBUG_ASSERT(IS_PAGE_ALIGNED(start_cursor.size));
@@ -811,7 +944,7 @@ bool X86ArchVmAspace::RemoveMappingL0(volatile pt_entry_t* table,
     for (; index != NO_OF_PT_ENTRIES && new_cursor->size != 0; ++index) {
         volatile pt_entry_t* e = table + index;
         if (IS_PAGE_PRESENT(*e)) {
-            UnmapEntry<PageTable>(this, new_cursor->vaddr, e);
+            UnmapEntry<PageTable>(pending, new_cursor->vaddr, e);
             unmapped = true;
         }
 
@@ -832,6 +965,7 @@ bool X86ArchVmAspace::RemoveMappingL0(volatile pt_entry_t* table,
  * act on within table
  * @param new_cursor A returned cursor describing how much work was not
  * completed.  Must be non-null.
+ * @param pending TLB invalidations to perform once the operation completes.
  *
  * @return MX_OK if successful
  * @return MX_ERR_ALREADY_EXISTS if the range overlaps an existing mapping
@@ -840,7 +974,8 @@ bool X86ArchVmAspace::RemoveMappingL0(volatile pt_entry_t* table,
 template <typename PageTable>
 status_t X86ArchVmAspace::AddMapping(volatile pt_entry_t* table, uint mmu_flags,
                                      const MappingCursor& start_cursor,
-                                     MappingCursor* new_cursor) {
+                                     MappingCursor* new_cursor,
+                                     PendingTlbInvalidation* pending) {
     DEBUG_ASSERT(table);
     DEBUG_ASSERT(x86_mmu_check_vaddr(start_cursor.vaddr));
     DEBUG_ASSERT(x86_mmu_check_paddr(start_cursor.paddr));
@@ -869,7 +1004,7 @@ status_t X86ArchVmAspace::AddMapping(volatile pt_entry_t* table, uint mmu_flags,
         if (level_supports_large_pages && !IS_PAGE_PRESENT(pt_val) && level_valigned &&
             level_paligned && new_cursor->size >= ps) {
 
-            UpdateEntry<PageTable>(new_cursor->vaddr, table + index,
+            UpdateEntry<PageTable>(pending, new_cursor->vaddr, table + index,
                                    new_cursor->paddr,
                                    arch_flags | X86_MMU_PG_PS);
 
@@ -888,7 +1023,7 @@ status_t X86ArchVmAspace::AddMapping(volatile pt_entry_t* table, uint mmu_flags,
 
                 LTRACEF_LEVEL(2, "new table %p at level %d\n", m, PageTable::level);
 
-                UpdateEntry<PageTable>(new_cursor->vaddr, e,
+                UpdateEntry<PageTable>(pending, new_cursor->vaddr, e,
                                        X86_VIRT_TO_PHYS(m), interm_arch_flags);
                 pt_val = *e;
                 pt_pages_++;
@@ -896,7 +1031,8 @@ status_t X86ArchVmAspace::AddMapping(volatile pt_entry_t* table, uint mmu_flags,
 
             MappingCursor cursor;
             ret = AddMapping<typename PageTable::LowerTable>(
-                get_next_table_from_entry(pt_val), mmu_flags, *new_cursor, &cursor);
+                get_next_table_from_entry(pt_val), mmu_flags, *new_cursor, &cursor,
+                pending);
             *new_cursor = cursor;
             DEBUG_ASSERT(new_cursor->size <= start_cursor.size);
             if (ret != MX_OK) {
@@ -912,7 +1048,7 @@ err:
         // new_cursor->size should be how much is left to be mapped still
         cursor.size -= new_cursor->size;
         if (cursor.size > 0) {
-            RemoveMapping<typename PageTable::TopTable>(table, cursor, &result);
+            RemoveMapping<typename PageTable::TopTable>(table, cursor, &result, pending);
             DEBUG_ASSERT(result.size == 0);
         }
     }
@@ -922,24 +1058,27 @@ err:
 template <>
 status_t X86ArchVmAspace::AddMapping<PageTable<PT_L>>(
     volatile pt_entry_t* table, uint mmu_flags,
-    const MappingCursor& start_cursor, MappingCursor* new_cursor) {
+    const MappingCursor& start_cursor, MappingCursor* new_cursor,
+    PendingTlbInvalidation* pending) {
     return AddMappingL0<PageTable<PT_L>>(table, mmu_flags, start_cursor,
-                                         new_cursor);
+                                         new_cursor, pending);
 }
 
 template <>
 status_t X86ArchVmAspace::AddMapping<ExtendedPageTable<PT_L>>(
     volatile pt_entry_t* table, uint mmu_flags,
-    const MappingCursor& start_cursor, MappingCursor* new_cursor) {
+    const MappingCursor& start_cursor, MappingCursor* new_cursor,
+    PendingTlbInvalidation* pending) {
     return AddMappingL0<ExtendedPageTable<PT_L>>(table, mmu_flags, start_cursor,
-                                                 new_cursor);
+                                                 new_cursor, pending);
 }
 
 // Base case of AddMapping for smallest page size.
 template <typename PageTable>
 status_t X86ArchVmAspace::AddMappingL0(volatile pt_entry_t* table, uint mmu_flags,
                                        const MappingCursor& start_cursor,
-                                       MappingCursor* new_cursor) {
+                                       MappingCursor* new_cursor,
+                                       PendingTlbInvalidation* pending) {
     static_assert(PageTable::level == PT_L, "AddMappingL0 used with wrong level");
     DEBUG_ASSERT(IS_PAGE_ALIGNED(start_cursor.size));
 
@@ -954,7 +1093,7 @@ status_t X86ArchVmAspace::AddMappingL0(volatile pt_entry_t* table, uint mmu_flag
             return MX_ERR_ALREADY_EXISTS;
         }
 
-        UpdateEntry<PageTable>(new_cursor->vaddr, e, new_cursor->paddr, arch_flags);
+        UpdateEntry<PageTable>(pending, new_cursor->vaddr, e, new_cursor->paddr, arch_flags);
 
         new_cursor->paddr += PAGE_SIZE;
         new_cursor->vaddr += PAGE_SIZE;
@@ -975,12 +1114,14 @@ status_t X86ArchVmAspace::AddMappingL0(volatile pt_entry_t* table, uint mmu_flag
  * act on within table
  * @param new_cursor A returned cursor describing how much work was not
  * completed.  Must be non-null.
+ * @param pending TLB invalidations to perform once the operation completes.
  */
 template <typename PageTable>
 status_t X86ArchVmAspace::UpdateMapping(volatile pt_entry_t* table,
                                         uint mmu_flags,
                                         const MappingCursor& start_cursor,
-                                        MappingCursor* new_cursor) {
+                                        MappingCursor* new_cursor,
+                                        PendingTlbInvalidation* pending) {
     DEBUG_ASSERT(table);
     LTRACEF("L: %d, %016" PRIxPTR " %016zx\n", PageTable::level, start_cursor.vaddr,
             start_cursor.size);
@@ -1007,7 +1148,7 @@ status_t X86ArchVmAspace::UpdateMapping(volatile pt_entry_t* table,
             // If the request covers the entire large page, just change the
             // permissions
             if (vaddr_level_aligned && new_cursor->size >= ps) {
-                UpdateEntry<PageTable>(new_cursor->vaddr, e,
+                UpdateEntry<PageTable>(pending, new_cursor->vaddr, e,
                                        PageTable::paddr_from_pte(pt_val),
                                        arch_flags | X86_MMU_PG_PS);
 
@@ -1018,7 +1159,7 @@ status_t X86ArchVmAspace::UpdateMapping(volatile pt_entry_t* table,
             }
             // Otherwise, we need to split it
             vaddr_t page_vaddr = new_cursor->vaddr & ~(ps - 1);
-            ret = SplitLargePage<PageTable>(page_vaddr, e);
+            ret = SplitLargePage<PageTable>(pending, page_vaddr, e);
             if (ret != MX_OK) {
                 // If we failed to split the table, just unmap it.  Subsequent
                 // page faults will bring it back in.
@@ -1027,7 +1168,7 @@ status_t X86ArchVmAspace::UpdateMapping(volatile pt_entry_t* table,
                 cursor.size = ps;
 
                 MappingCursor tmp_cursor;
-                RemoveMapping<PageTable>(table, cursor, &tmp_cursor);
+                RemoveMapping<PageTable>(table, cursor, &tmp_cursor, pending);
 
                 new_cursor->SkipEntry<PageTable>();
             }
@@ -1037,7 +1178,7 @@ status_t X86ArchVmAspace::UpdateMapping(volatile pt_entry_t* table,
         MappingCursor cursor;
         volatile pt_entry_t* next_table = get_next_table_from_entry(pt_val);
         ret = UpdateMapping<typename PageTable::LowerTable>(next_table, mmu_flags,
-                                                            *new_cursor, &cursor);
+                                                            *new_cursor, &cursor, pending);
         *new_cursor = cursor;
         if (ret != MX_OK) {
             // Currently this can't happen
@@ -1057,17 +1198,19 @@ err:
 template <>
 status_t X86ArchVmAspace::UpdateMapping<PageTable<PT_L>>(
     volatile pt_entry_t* table, uint mmu_flags,
-    const MappingCursor& start_cursor, MappingCursor* new_cursor) {
+    const MappingCursor& start_cursor, MappingCursor* new_cursor,
+    PendingTlbInvalidation* pending) {
     return UpdateMappingL0<PageTable<PT_L>>(table, mmu_flags,
-                                            start_cursor, new_cursor);
+                                            start_cursor, new_cursor, pending);
 }
 
 template <>
 status_t X86ArchVmAspace::UpdateMapping<ExtendedPageTable<PT_L>>(
     volatile pt_entry_t* table, uint mmu_flags,
-    const MappingCursor& start_cursor, MappingCursor* new_cursor) {
+    const MappingCursor& start_cursor, MappingCursor* new_cursor,
+    PendingTlbInvalidation* pending) {
     return UpdateMappingL0<ExtendedPageTable<PT_L>>(table, mmu_flags,
-                                                    start_cursor, new_cursor);
+                                                    start_cursor, new_cursor, pending);
 }
 
 // Base case of UpdateMapping for smallest page size.
@@ -1075,7 +1218,8 @@ template <typename PageTable>
 status_t X86ArchVmAspace::UpdateMappingL0(volatile pt_entry_t* table,
                                           uint mmu_flags,
                                           const MappingCursor& start_cursor,
-                                          MappingCursor* new_cursor) {
+                                          MappingCursor* new_cursor,
+                                          PendingTlbInvalidation* pending) {
     static_assert(PageTable::level == PT_L, "UpdateMappingL0 used with wrong level");
     LTRACEF("%016" PRIxPTR " %016zx\n", start_cursor.vaddr, start_cursor.size);
     DEBUG_ASSERT(IS_PAGE_ALIGNED(start_cursor.size));
@@ -1090,7 +1234,7 @@ status_t X86ArchVmAspace::UpdateMappingL0(volatile pt_entry_t* table,
         pt_entry_t pt_val = *e;
         // Skip unmapped pages (we may encounter these due to demand paging)
         if (IS_PAGE_PRESENT(pt_val)) {
-            UpdateEntry<PageTable>(new_cursor->vaddr, e,
+            UpdateEntry<PageTable>(pending, new_cursor->vaddr, e,
                                    PageTable::paddr_from_pte(pt_val),
                                    arch_flags);
         }
@@ -1124,7 +1268,11 @@ status_t X86ArchVmAspace::UnmapPages(vaddr_t vaddr, const size_t count,
     };
 
     MappingCursor result;
-    RemoveMapping<PageTable<MAX_PAGING_LEVEL>>(pt_virt_, start, &result);
+    PendingTlbInvalidation pending;
+    RemoveMapping<PageTable<MAX_PAGING_LEVEL>>(pt_virt_, start, &result, &pending);
+    if (x86_tlb_invalidate(this, &pending)) {
+        tlb_shootdowns_++;
+    }
     DEBUG_ASSERT(result.size == 0);
 
     if (unmapped)
@@ -1168,8 +1316,12 @@ status_t X86ArchVmAspace::MapPages(vaddr_t vaddr, paddr_t paddr,
         .paddr = paddr, .vaddr = vaddr, .size = count * PAGE_SIZE,
     };
     MappingCursor result;
+    PendingTlbInvalidation pending;
     status_t status = AddMapping<PageTable<MAX_PAGING_LEVEL>>(pt_virt_, mmu_flags,
-                                                              start, &result);
+                                                              start, &result, &pending);
+    if (x86_tlb_invalidate(this, &pending)) {
+        tlb_shootdowns_++;
+    }
     if (status != MX_OK) {
         dprintf(SPEW, "Add mapping failed with err=%d\n", status);
         return status;
@@ -1214,8 +1366,12 @@ status_t X86ArchVmAspace::ProtectPages(vaddr_t vaddr, size_t count, uint mmu_fla
         .paddr = 0, .vaddr = vaddr, .size = count * PAGE_SIZE,
     };
     MappingCursor result;
+    PendingTlbInvalidation pending;
     status_t status = UpdateMapping<PageTable<MAX_PAGING_LEVEL>>(
-        pt_virt_, mmu_flags, start, &result);
+        pt_virt_, mmu_flags, start, &result, &pending);
+    if (x86_tlb_invalidate(this, &pending)) {
+        tlb_shootdowns_++;
+    }
     if (status != MX_OK) {
         return status;
     }
@@ -1238,7 +1394,9 @@ void x86_mmu_early_init() {
     x86_mmu_percpu_init();
 
     // Unmap the lower identity mapping.
-    X86ArchVmAspace::UnmapEntry<PageTable<PML4_L>>(nullptr, 0, &pml4[0]);
+    PendingTlbInvalidation tlb;
+    X86ArchVmAspace::UnmapEntry<PageTable<PML4_L>>(&tlb, 0, &pml4[0]);
+    x86_tlb_invalidate(nullptr, &tlb);
 
     /* get the address width from the CPU */
     uint8_t vaddr_width = x86_linear_address_width();
@@ -1351,20 +1509,89 @@ status_t X86ArchVmAspace::Destroy() {
         return DestroyAspace<PageTable>();
 }
 
+/**
+ * @brief Return this aspace's PCID, allocating one from the current
+ * generation if it does not have one.
+ *
+ * @return The PCID in the low bits, and its generation above them.
+ */
+uint64_t X86ArchVmAspace::AcquirePcid() {
+    uint64_t generation = atomic_load_u64(&pcid_generation);
+    uint64_t tag = atomic_load_u64(&pcid_);
+    if ((tag >> kPcidShift) == generation) {
+        return tag;
+    }
+
+    spin_lock(&pcid_lock);
+    generation = atomic_load_u64(&pcid_generation);
+    tag = atomic_load_u64(&pcid_);
+    if ((tag >> kPcidShift) != generation) {
+        if (pcid_next == kPcidCount) {
+            generation++;
+            atomic_store_u64(&pcid_generation, generation);
+            pcid_next = 1;
+        }
+        tag = (generation << kPcidShift) | pcid_next++;
+        atomic_store_u64(&pcid_, tag);
+    }
+    spin_unlock(&pcid_lock);
+    return tag;
+}
+
+/**
+ * @brief Return the value to load into CR3 to switch this CPU to an aspace,
+ * performing any TLB maintenance needed first.
+ */
+ulong X86ArchVmAspace::SwitchCr3(uint cpu) {
+    if (!supports_pcid) {
+        return pt_phys_;
+    }
+
+    uint64_t tag = AcquirePcid();
+    uint64_t generation = tag >> kPcidShift;
+    if (cpu_pcid_generation[cpu] != generation) {
+        /* PCIDs from the generation this CPU last used may since have been
+         * handed out to other aspaces. */
+        if (supports_invpcid) {
+            x86_invpcid(INVPCID_ALL_EXCLUDING_GLOBAL, 0, 0);
+        } else {
+            x86_tlb_global_invalidate();
+        }
+        cpu_pcid_generation[cpu] = generation;
+    }
+
+    /* Mappings may have changed since this CPU last ran in the aspace. This
+     * follows setting our bit in active_cpus_, so a concurrent shootdown
+     * either marks us stale before the check below or sends us an IPI. */
+    mp_cpu_mask_t cpu_bit = 1U << cpu;
+    bool stale = atomic_and(&tlb_stale_cpus_, ~cpu_bit) & cpu_bit;
+
+    ulong cr3 = pt_phys_ | (tag & X86_CR3_PCID_MASK);
+    if (!stale) {
+        cr3 |= X86_CR3_NOFLUSH;
+    }
+    return cr3;
+}
+
 void X86ArchVmAspace::ContextSwitch(X86ArchVmAspace* old_aspace, X86ArchVmAspace* aspace) {
-    mp_cpu_mask_t cpu_bit = 1U << arch_curr_cpu_num();
+    DEBUG_ASSERT(arch_ints_disabled());
+
+    uint cpu = arch_curr_cpu_num();
+    mp_cpu_mask_t cpu_bit = 1U << cpu;
     if (aspace != nullptr) {
         aspace->canary_.Assert();
         LTRACEF_LEVEL(3, "switching to aspace %p, pt %#" PRIXPTR "\n", aspace, aspace->pt_phys_);
-        x86_set_cr3(aspace->pt_phys_);
+        atomic_or(&aspace->active_cpus_, cpu_bit);
+        x86_set_cr3(aspace->SwitchCr3(cpu));
 
         if (old_aspace != nullptr) {
             atomic_and(&old_aspace->active_cpus_, ~cpu_bit);
         }
-        atomic_or(&aspace->active_cpus_, cpu_bit);
     } else {
         LTRACEF_LEVEL(3, "switching to kernel aspace, pt %#" PRIxPTR "\n", kernel_pt_phys);
-        x86_set_cr3(kernel_pt_phys);
+        /* The kernel aspace only has global mappings, which are invalidated
+         * regardless of PCID. */
+        x86_set_cr3(supports_pcid ? (kernel_pt_phys | X86_CR3_NOFLUSH) : kernel_pt_phys);
         if (old_aspace != nullptr) {
             atomic_and(&old_aspace->active_cpus_, ~cpu_bit);
         }
@@ -1456,6 +1683,14 @@ void x86_mmu_percpu_init(void) {
         cr4 |= X86_CR4_SMEP;
     if (x86_feature_test(X86_FEATURE_SMAP))
         cr4 |= X86_CR4_SMAP;
+    /* Tag TLB entries with the PCID of their aspace, so that they survive
+     * switching between aspaces. CR3 must hold PCID 0 while enabling it. */
+    supports_pcid = x86_feature_test(X86_FEATURE_PCID);
+    supports_invpcid = supports_pcid && x86_feature_test(X86_FEATURE_INVPCID);
+    if (supports_pcid) {
+        DEBUG_ASSERT((x86_get_cr3() & X86_CR3_PCID_MASK) == 0);
+        cr4 |= X86_CR4_PCIDE;
+    }
     x86_set_cr4(cr4);
 
     // Set NXE bit in X86_MSR_IA32_EFER.
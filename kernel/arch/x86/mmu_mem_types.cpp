@@ -77,6 +77,16 @@ static struct mtrrs *target_mtrrs = &THE_MTRRS;
 
 /* Function called by all CPUs to setup their PAT */
 static void x86_pat_sync_task(void *context);
+
+/* Flush the TLB entries of every PCID.  Reloading CR3 would flush only the
+ * current PCID, but changing CR4.PGE flushes them all (Intel 3A 4.10.4.1). */
+static void x86_tlb_flush_all_pcids(void)
+{
+    ulong cr4 = x86_get_cr4();
+    x86_set_cr4(cr4 ^ X86_CR4_PGE);
+    x86_set_cr4(cr4);
+}
+
 struct pat_sync_task_context {
     /* Barrier counters for the two barriers described in Intel's algorithm */
     volatile int barrier1;
@@ -162,9 +172,9 @@ static void x86_pat_sync_task(void *raw_context)
     cr4 &= ~X86_CR4_PGE;
     x86_set_cr4(cr4);
 
-    /* Step 7: If the PGE flag wasn't set, flush the TLB via CR3 */
+    /* Step 7: If the PGE flag wasn't set, flush the TLB */
     if (!pge_was_set) {
-        x86_set_cr3(x86_get_cr3());
+        x86_tlb_flush_all_pcids();
     }
 
     /* Step 8: Disable MTRRs */
@@ -209,7 +219,7 @@ static void x86_pat_sync_task(void *raw_context)
 
     /* Step 11: Flush all cache and the TLB again */
     __asm volatile ("wbinvd" ::: "memory");
-    x86_set_cr3(x86_get_cr3());
+    x86_tlb_flush_all_pcids();
 
     /* Step 12: Enter the normal cache mode */
     cr0 = x86_get_cr0();
@@ -148,6 +148,55 @@ static bool mmu_tests(void* context) {
         EXPECT_EQ(err, MX_OK, "destroy aspace");
     }
 
+    unittest_printf("changing and removing a range of pages issues a single TLB shootdown\n");
+    {
+        ArchVmAspace aspace;
+        vaddr_t base = 1UL << 20;
+        size_t size = (1UL << 47) - base - (1UL << 20);
+        status_t err = aspace.Init(1UL << 20, size, 0);
+        EXPECT_EQ(err, MX_OK, "init aspace");
+
+        const uint arch_rw_flags = ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE;
+
+        // Misalign the region by a page so that it is mapped with small pages.
+        vaddr_t va = (1UL << PDP_SHIFT) + PAGE_SIZE;
+        // Large enough that invalidating page by page is abandoned in favor
+        // of a full flush.
+        static const size_t large_count = 256;
+        // Small enough to be invalidated page by page.
+        static const size_t small_count = 4;
+
+        size_t mapped;
+        err = aspace.Map(va, 0, large_count, arch_rw_flags, &mapped);
+        EXPECT_EQ(err, MX_OK, "map pages");
+        EXPECT_EQ(mapped, large_count, "map pages");
+        EXPECT_EQ(aspace.tlb_shootdowns(), 0u, "map pages, no shootdown");
+
+        err = aspace.Protect(va, large_count, ARCH_MMU_FLAG_PERM_READ);
+        EXPECT_EQ(err, MX_OK, "protect pages");
+        EXPECT_EQ(aspace.tlb_shootdowns(), 1u, "protect pages, single shootdown");
+
+        size_t unmapped;
+        err = aspace.Unmap(va, small_count, &unmapped);
+        EXPECT_EQ(err, MX_OK, "unmap few pages");
+        EXPECT_EQ(unmapped, small_count, "unmap few pages");
+        EXPECT_EQ(aspace.tlb_shootdowns(), 2u, "unmap few pages, single shootdown");
+
+        err = aspace.Unmap(va + small_count * PAGE_SIZE, large_count - small_count, &unmapped);
+        EXPECT_EQ(err, MX_OK, "unmap remaining pages");
+        EXPECT_EQ(unmapped, large_count - small_count, "unmap remaining pages");
+        EXPECT_EQ(aspace.tlb_shootdowns(), 3u, "unmap remaining pages, single shootdown");
+        EXPECT_EQ(aspace.pt_pages(), 1u, "unmap remaining pages, tables freed");
+
+        // Nothing is mapped, so nothing needs to be invalidated.
+        err = aspace.Unmap(va, large_count, &unmapped);
+        EXPECT_EQ(err, MX_OK, "unmap unmapped pages");
+        EXPECT_EQ(aspace.tlb_shootdowns(), 3u, "unmap unmapped pages, no shootdown");
+
+        err = aspace.Destroy();
+        EXPECT_EQ(err, MX_OK, "destroy aspace");
+    }
+
     unittest_printf("done with mmu tests\n");
     END_TEST;
 }
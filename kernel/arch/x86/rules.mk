@@ -75,6 +75,7 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/proc_trace.cpp \
 	$(LOCAL_DIR)/registers.cpp \
 	$(LOCAL_DIR)/thread.cpp \
+	$(LOCAL_DIR)/tlb_stats.cpp \
 	$(LOCAL_DIR)/tsc.cpp \
 	$(LOCAL_DIR)/user_copy.cpp \
 	$(LOCAL_DIR)/hypervisor/guest.cpp \
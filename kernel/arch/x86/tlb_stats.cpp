@@ -0,0 +1,185 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+// Counts TLB misses in kernel mode with the general purpose performance
+// counters, to measure how well kernel memory is covered by large pages.
+// Under QEMU the counters only exist with KVM and a host cpu model
+// (-enable-kvm -cpu host).
+
+#include <magenta/compiler.h>
+#include <err.h>
+#include <inttypes.h>
+#include <string.h>
+#include <arch/x86.h>
+#include <arch/x86/feature.h>
+#include <kernel/auto_lock.h>
+#include <kernel/mp.h>
+#include <kernel/mutex.h>
+#include <lib/console.h>
+
+// Events which count misses that cause a page walk, on Sandy Bridge through
+// Kaby Lake.
+static const struct {
+    const char* name;
+    uint8_t event;
+    uint8_t umask;
+} tlb_events[] = {
+    { "dtlb load", 0x08, 0x01 },
+    { "dtlb store", 0x49, 0x01 },
+    { "itlb", 0x85, 0x01 },
+};
+static const uint kNumEvents = countof(tlb_events);
+
+#define PERFEVTSEL_OS (1u << 17)
+#define PERFEVTSEL_EN (1u << 22)
+
+// only taken from console commands, which run in thread context
+static Mutex lock;
+
+static bool tlb_stats_running TA_GUARDED(lock) = false;
+static uint64_t tlb_stats_counts[SMP_MAX_CPUS][kNumEvents];
+
+static bool tlb_stats_supported(void)
+{
+    // the event encodings differ on other microarchitectures
+    switch (x86_microarch) {
+    case X86_MICROARCH_INTEL_SANDY_BRIDGE:
+    case X86_MICROARCH_INTEL_IVY_BRIDGE:
+    case X86_MICROARCH_INTEL_HASWELL:
+    case X86_MICROARCH_INTEL_BROADWELL:
+    case X86_MICROARCH_INTEL_SKYLAKE:
+    case X86_MICROARCH_INTEL_KABYLAKE:
+        break;
+    default:
+        return false;
+    }
+
+    const struct cpuid_leaf* leaf = x86_get_cpuid_leaf(X86_CPUID_PERFORMANCE_MONITORING);
+    if (!leaf)
+        return false;
+
+    uint version = leaf->a & 0xff;
+    uint num_counters = (leaf->a >> 8) & 0xff;
+    return version >= 1 && num_counters >= kNumEvents;
+}
+
+static void tlb_stats_start_sync_task(void* ctx)
+{
+    for (uint i = 0; i < kNumEvents; i++) {
+        write_msr(X86_MSR_IA32_PERFEVTSEL0 + i, 0);
+        write_msr(X86_MSR_IA32_PMC0 + i, 0);
+        write_msr(X86_MSR_IA32_PERFEVTSEL0 + i,
+                  tlb_events[i].event | (tlb_events[i].umask << 8) |
+                  PERFEVTSEL_OS | PERFEVTSEL_EN);
+    }
+
+    // from version 2 the counters must also be enabled globally
+    const struct cpuid_leaf* leaf = x86_get_cpuid_leaf(X86_CPUID_PERFORMANCE_MONITORING);
+    if ((leaf->a & 0xff) >= 2) {
+        write_msr(X86_MSR_IA32_PERF_GLOBAL_CTRL,
+                  read_msr(X86_MSR_IA32_PERF_GLOBAL_CTRL) | ((1u << kNumEvents) - 1));
+    }
+}
+
+static void tlb_stats_stop_sync_task(void* ctx)
+{
+    uint cpu = arch_curr_cpu_num();
+    for (uint i = 0; i < kNumEvents; i++) {
+        write_msr(X86_MSR_IA32_PERFEVTSEL0 + i, 0);
+        tlb_stats_counts[cpu][i] = read_msr(X86_MSR_IA32_PMC0 + i);
+    }
+}
+
+static void tlb_stats_read_sync_task(void* ctx)
+{
+    uint cpu = arch_curr_cpu_num();
+    for (uint i = 0; i < kNumEvents; i++) {
+        tlb_stats_counts[cpu][i] = read_msr(X86_MSR_IA32_PMC0 + i);
+    }
+}
+
+static void tlb_stats_start(void)
+{
+    AutoLock guard(&lock);
+
+    if (!tlb_stats_supported()) {
+        printf("TLB miss counters not supported\n");
+        return;
+    }
+
+    memset(tlb_stats_counts, 0, sizeof(tlb_stats_counts));
+    mp_sync_exec(MP_CPU_ALL, tlb_stats_start_sync_task, NULL);
+    tlb_stats_running = true;
+}
+
+static void tlb_stats_stop(void)
+{
+    AutoLock guard(&lock);
+
+    if (!tlb_stats_running) {
+        printf("TLB miss counting not started\n");
+        return;
+    }
+
+    mp_sync_exec(MP_CPU_ALL, tlb_stats_stop_sync_task, NULL);
+    tlb_stats_running = false;
+}
+
+static void tlb_stats_show(void)
+{
+    AutoLock guard(&lock);
+
+    // refresh the counts if still counting; otherwise they're from the stop
+    if (tlb_stats_running) {
+        mp_sync_exec(MP_CPU_ALL, tlb_stats_read_sync_task, NULL);
+    }
+
+    printf("kernel mode TLB misses causing page walks:\n");
+    printf("%-4s", "cpu");
+    for (uint i = 0; i < kNumEvents; i++) {
+        printf(" %16s", tlb_events[i].name);
+    }
+    printf("\n");
+    for (uint cpu = 0; cpu < arch_max_num_cpus(); cpu++) {
+        if (!mp_is_cpu_online(cpu))
+            continue;
+        printf("%-4u", cpu);
+        for (uint i = 0; i < kNumEvents; i++) {
+            printf(" %16" PRIu64, tlb_stats_counts[cpu][i]);
+        }
+        printf("\n");
+    }
+}
+
+static int cmd_tlbstat(int argc, const cmd_args *argv, uint32_t flags)
+{
+    if (argc < 2) {
+        printf("not enough arguments\n");
+usage:
+        printf("usage:\n");
+        printf("%s start : zero and start the counters on every cpu\n", argv[0].str);
+        printf("%s stop  : stop the counters\n", argv[0].str);
+        printf("%s show  : show the counts\n", argv[0].str);
+        return MX_ERR_INTERNAL;
+    }
+
+    if (!strcmp(argv[1].str, "start")) {
+        tlb_stats_start();
+    } else if (!strcmp(argv[1].str, "stop")) {
+        tlb_stats_stop();
+    } else if (!strcmp(argv[1].str, "show")) {
+        tlb_stats_show();
+    } else {
+        printf("unknown command\n");
+        goto usage;
+    }
+
+    return MX_OK;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("tlbstat", "kernel TLB miss counters", &cmd_tlbstat)
+STATIC_COMMAND_END(tlbstat);
@@ -243,6 +243,16 @@ uint64_t ticks_per_second(void)
     return u64_mul_u32_fp32_64(1000 * 1000 * 1000, cntpct_per_ns);
 }
 
+bool current_time_from_user_counter(struct fp_32_64 *ns_per_tick)
+{
+    // Of the counters, only the virtual one is readable from EL0.
+    if (reg_procs != &cntv_procs)
+        return false;
+
+    *ns_per_tick = ns_per_cntpct;
+    return true;
+}
+
 static uint32_t abs_int32(int32_t a)
 {
     return (a > 0) ? a : -a;
@@ -65,6 +65,10 @@ static void arch_spinloop_signal(void);
 /* arch optimized version of a page zero routine against a page aligned buffer */
 void arch_zero_page(void *);
 
+/* as above, but avoiding the cache where the arch supports it, for pages
+ * which are not about to be used */
+void arch_zero_page_nontemporal(void *);
+
 /* give the specific arch a chance to override some routines */
 #include <arch/arch_ops.h>
 
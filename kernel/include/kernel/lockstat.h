@@ -0,0 +1,111 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <arch/defines.h>
+#include <arch/spinlock.h>
+#include <magenta/compiler.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS
+
+/* Lock contention statistics.
+ *
+ * When the kernel is built with ENABLE_LOCK_STATS=true (which defines
+ * WITH_LOCK_STATS), every acquisition of an instrumented mutex or spin lock
+ * is accounted to the lock's class: a named group of locks, such as all of
+ * the channel dispatcher locks. Each class counts acquisitions and contended
+ * acquisitions, and keeps histograms of how long locks were waited for and
+ * held, all in per cpu counters. Contention is also logged to ktrace, in the
+ * LOCK group.
+ *
+ * Mutexes without a class are accounted to the "mutex" class. Spin locks are
+ * only accounted if they are acquired with the *_class variants in
+ * kernel/spinlock.h.
+ *
+ * Without WITH_LOCK_STATS, the macros below compile away, and the class of a
+ * lock is ignored.
+ */
+
+typedef struct lockstat_class lockstat_class_t;
+
+/* Histogram bucket N counts times below 256ns << (2 * N); the last bucket
+ * counts everything longer. */
+#define LOCKSTAT_HISTOGRAM_BUCKETS 12
+
+typedef struct lockstat_counters {
+    uint64_t acquisitions;
+    uint64_t contentions;
+    /* total and longest time spent waiting for contended acquisitions, in ns */
+    uint64_t wait_time;
+    uint64_t max_wait_time;
+    /* total and longest time held, in ns */
+    uint64_t hold_time;
+    uint64_t max_hold_time;
+    uint64_t wait_histogram[LOCKSTAT_HISTOGRAM_BUCKETS];
+    uint64_t hold_histogram[LOCKSTAT_HISTOGRAM_BUCKETS];
+} lockstat_counters_t;
+
+#if WITH_LOCK_STATS
+
+typedef struct lockstat_cpu {
+    lockstat_counters_t counters;
+    /* when this cpu last acquired a spin lock of the class */
+    uint64_t spin_acquire_time;
+} __ALIGNED(CACHE_LINE) lockstat_cpu_t;
+
+struct lockstat_class {
+    const char* name;
+    lockstat_cpu_t cpu[SMP_MAX_CPUS];
+} __ALIGNED(CACHE_LINE); // match the linker packing of the lockstat_class section
+
+/* Define a lock class at file scope, and declare it for use elsewhere. */
+#define LOCKSTAT_CLASS_DEFINE(_name, _str) \
+    __USED __SECTION("lockstat_class") lockstat_class_t lockstat_class_##_name = { .name = _str, .cpu = {} }
+#define LOCKSTAT_CLASS_DECLARE(_name) extern lockstat_class_t lockstat_class_##_name
+
+/* The class to pass to a lock's constructor or initializer. */
+#define LOCKSTAT_CLASS(_name) (&lockstat_class_##_name)
+
+/* The class of mutexes given none. */
+LOCKSTAT_CLASS_DECLARE(mutex);
+
+/* Hooks for the lock implementations. */
+struct mutex;
+struct thread;
+void lockstat_mutex_acquired(struct mutex* m);
+void lockstat_mutex_contended(struct mutex* m, struct thread* holder);
+void lockstat_mutex_acquired_after_wait(struct mutex* m, uint64_t wait_time);
+void lockstat_mutex_releasing(struct mutex* m);
+void lockstat_spin_lock(spin_lock_t* lock, lockstat_class_t* cls);
+void lockstat_spin_unlock(spin_lock_t* lock, lockstat_class_t* cls);
+
+#else
+
+/* Expand to forward declarations, to consume the trailing semicolon. */
+#define LOCKSTAT_CLASS_DEFINE(_name, _str) struct lockstat_class
+#define LOCKSTAT_CLASS_DECLARE(_name) struct lockstat_class
+#define LOCKSTAT_CLASS(_name) ((lockstat_class_t*)NULL)
+
+#endif
+
+/* Returns the number of lock classes; zero without WITH_LOCK_STATS. */
+size_t lockstat_class_count(void);
+
+/* Returns the name of the class numbered |index|, or NULL if there is no such
+ * class. Classes are numbered the same way in ktrace records. */
+const char* lockstat_class_name(size_t index);
+
+/* Sums the per cpu counters of the class numbered |index|, returning its name,
+ * or NULL if there is no such class. */
+const char* lockstat_read_class(size_t index, lockstat_counters_t* counters);
+
+/* Zeroes the counters of every class. */
+void lockstat_reset(void);
+
+__END_CDECLS
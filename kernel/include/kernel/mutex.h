@@ -15,6 +15,7 @@
 #include <debug.h>
 #include <stdint.h>
 #include <kernel/atomic.h>
+#include <kernel/lockstat.h>
 #include <kernel/thread.h>
 
 __BEGIN_CDECLS
@@ -30,6 +31,10 @@ typedef struct TA_CAP("mutex") mutex {
     uint32_t magic;
     uintptr_t val;
     wait_queue_t wait;
+#if WITH_LOCK_STATS
+    lockstat_class_t *lockstat_class;
+    uint64_t lockstat_acquire_time;
+#endif
 } mutex_t;
 
 #define MUTEX_FLAG_QUEUED ((uintptr_t)1)
@@ -45,18 +50,33 @@ static inline thread_t *mutex_holder(const mutex_t *m) {
     return (thread_t *)(mutex_val(m) & ~MUTEX_FLAG_QUEUED);
 }
 
-#define MUTEX_INITIAL_VALUE(m) \
+/* initializer for a mutex accounted to lock class |cls| (see kernel/lockstat.h) */
+#if WITH_LOCK_STATS
+#define MUTEX_INITIAL_VALUE_CLASS(m, cls) \
+{ \
+    .magic = MUTEX_MAGIC, \
+    .val = 0, \
+    .wait = WAIT_QUEUE_INITIAL_VALUE((m).wait), \
+    .lockstat_class = (cls), \
+    .lockstat_acquire_time = 0, \
+}
+#else
+#define MUTEX_INITIAL_VALUE_CLASS(m, cls) \
 { \
     .magic = MUTEX_MAGIC, \
     .val = 0, \
     .wait = WAIT_QUEUE_INITIAL_VALUE((m).wait), \
 }
+#endif
+
+#define MUTEX_INITIAL_VALUE(m) MUTEX_INITIAL_VALUE_CLASS(m, NULL)
 
 /* Rules for Mutexes:
  * - Mutexes are only safe to use from thread context.
  * - Mutexes are non-recursive.
 */
 void mutex_init(mutex_t *m);
+void mutex_init_class(mutex_t *m, lockstat_class_t *cls);
 void mutex_destroy(mutex_t *m);
 void mutex_acquire(mutex_t *m) TA_ACQ(m);
 void mutex_release(mutex_t *m) TA_REL(m);
@@ -21,6 +21,9 @@ void sched_yield(void);
 void sched_preempt(void);
 void sched_reschedule(void);
 
+/* recompute the priority t inherits from the wait queues it owns */
+void sched_update_inherited_priority(thread_t *t);
+
 /* the low level reschedule routine, called from the scheduler */
 void _thread_resched_internal(void);
 
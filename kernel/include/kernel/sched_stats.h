@@ -0,0 +1,53 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+#pragma once
+
+#include <magenta/compiler.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS
+
+/* Scheduler latency histograms.
+ *
+ * Kept per cpu as part of struct cpu_stats, and per thread in thread_t. They
+ * are only updated with the thread lock held.
+ */
+
+/* Time histogram bucket N counts times below 256ns << (2 * N); the last
+ * bucket counts everything longer. */
+#define SCHED_STATS_TIME_BUCKETS 12
+
+/* Run queue depth histogram bucket 0 counts an empty run queue, and bucket N
+ * counts depths below 1 << N; the last bucket counts everything deeper. */
+#define SCHED_STATS_DEPTH_BUCKETS 12
+
+struct sched_stats {
+    /* time from being woken up to running */
+    ulong wakeup_latency[SCHED_STATS_TIME_BUCKETS];
+    /* time run before switching away */
+    ulong run_slice[SCHED_STATS_TIME_BUCKETS];
+    /* number of threads waiting in the run queue: for a cpu, whenever it
+     * picks a thread to run; for a thread, whenever it is woken up */
+    ulong run_queue_depth[SCHED_STATS_DEPTH_BUCKETS];
+};
+
+static inline uint sched_stats_time_bucket(lk_time_t time)
+{
+    if (time < 256)
+        return 0;
+    uint bucket = (uint)((63 - __builtin_clzll(time) - 8) / 2 + 1);
+    return bucket < SCHED_STATS_TIME_BUCKETS ? bucket : SCHED_STATS_TIME_BUCKETS - 1;
+}
+
+static inline uint sched_stats_depth_bucket(uint depth)
+{
+    if (depth == 0)
+        return 0;
+    uint bucket = (uint)(32 - __builtin_clz(depth));
+    return bucket < SCHED_STATS_DEPTH_BUCKETS ? bucket : SCHED_STATS_DEPTH_BUCKETS - 1;
+}
+
+__END_CDECLS
@@ -10,6 +10,7 @@
 #include <magenta/compiler.h>
 #include <magenta/thread_annotations.h>
 #include <arch/spinlock.h>
+#include <kernel/lockstat.h>
 
 __BEGIN_CDECLS
 
@@ -83,6 +84,41 @@ static inline void spin_unlock_restore(
 #define spin_lock_irqsave(lock, statep) spin_lock_save(lock, &(statep), SPIN_LOCK_FLAG_INTERRUPTS)
 #define spin_unlock_irqrestore(lock, statep) spin_unlock_restore(lock, statep, SPIN_LOCK_FLAG_INTERRUPTS)
 
+/* same as spin_lock_save, but account the acquisition to lock class |cls| if
+ * lock statistics are enabled (see kernel/lockstat.h) */
+static inline void spin_lock_save_class(
+    spin_lock_t *lock,
+    spin_lock_saved_state_t *statep,
+    spin_lock_save_flags_t flags,
+    lockstat_class_t *cls)
+{
+    arch_interrupt_save(statep, flags);
+#if WITH_LOCK_STATS
+    lockstat_spin_lock(lock, cls);
+#else
+    spin_lock(lock);
+#endif
+}
+
+static inline void spin_unlock_restore_class(
+    spin_lock_t *lock,
+    spin_lock_saved_state_t old_state,
+    spin_lock_save_flags_t flags,
+    lockstat_class_t *cls)
+{
+#if WITH_LOCK_STATS
+    lockstat_spin_unlock(lock, cls);
+#else
+    spin_unlock(lock);
+#endif
+    arch_interrupt_restore(old_state, flags);
+}
+
+#define spin_lock_irqsave_class(lock, statep, cls) \
+    spin_lock_save_class(lock, &(statep), SPIN_LOCK_FLAG_INTERRUPTS, cls)
+#define spin_unlock_irqrestore_class(lock, statep, cls) \
+    spin_unlock_restore_class(lock, statep, SPIN_LOCK_FLAG_INTERRUPTS, cls)
+
 __END_CDECLS
 
 #ifdef __cplusplus
@@ -5,6 +5,7 @@
 // https://opensource.org/licenses/MIT
 #pragma once
 
+#include <kernel/sched_stats.h>
 #include <magenta/compiler.h>
 #include <sys/types.h>
 
@@ -30,6 +31,9 @@ struct cpu_stats {
     /* inter-processor interrupts */
     ulong reschedule_ipis;
     ulong generic_ipis;
+
+    /* scheduler latency histograms */
+    struct sched_stats sched;
 };
 
 __END_CDECLS
@@ -14,6 +14,7 @@
 #include <arch/defines.h>
 #include <arch/ops.h>
 #include <arch/thread.h>
+#include <kernel/sched_stats.h>
 #include <kernel/wait.h>
 #include <kernel/spinlock.h>
 #include <debug.h>
@@ -84,6 +85,11 @@ typedef struct thread {
 
     int base_priority;
     int priority_boost;
+    /* highest priority of any thread blocked on a wait queue this thread owns,
+     * or -1 if none */
+    int inherited_priority;
+    /* wait queues which this thread is the owner of */
+    struct list_node owned_wait_queues;
 
     uint last_cpu; /* last/current cpu the thread is running on */
     int pinned_cpu; /* only run on pinned_cpu if >= 0 */
@@ -104,6 +110,12 @@ typedef struct thread {
      * left the scheduler. */
     lk_time_t runtime_ns;
 
+    /* when the thread was last woken up, or 0 once it has run since */
+    lk_time_t wakeup_time;
+
+    /* scheduler latency histograms */
+    struct sched_stats sched_stats;
+
     /* if blocked, a pointer to the wait queue */
     struct wait_queue *blocking_wait_queue;
 
@@ -228,6 +240,7 @@ status_t thread_sleep_relative(lk_time_t delay);
 
 /* return the number of nanoseconds a thread has been running for */
 lk_time_t thread_runtime(const thread_t *t);
+void thread_get_sched_stats(const thread_t *t, struct sched_stats *stats);
 
 /* deliver a kill signal to a thread */
 void thread_kill(thread_t *t, bool block);
@@ -267,9 +280,12 @@ void set_current_thread(thread_t *);
 
 /* scheduler lock */
 extern spin_lock_t thread_lock;
+LOCKSTAT_CLASS_DECLARE(thread_lock);
 
-#define THREAD_LOCK(state) spin_lock_saved_state_t state; spin_lock_irqsave(&thread_lock, state)
-#define THREAD_UNLOCK(state) spin_unlock_irqrestore(&thread_lock, state)
+#define THREAD_LOCK(state) spin_lock_saved_state_t state; \
+    spin_lock_irqsave_class(&thread_lock, state, LOCKSTAT_CLASS(thread_lock))
+#define THREAD_UNLOCK(state) \
+    spin_unlock_irqrestore_class(&thread_lock, state, LOCKSTAT_CLASS(thread_lock))
 
 static inline bool thread_lock_held(void)
 {
@@ -17,6 +17,9 @@ class VmObject;
 #define VM_PAGE_OBJECT_PIN_COUNT_BITS 5
 #define VM_PAGE_OBJECT_MAX_PIN_COUNT ((1ul << VM_PAGE_OBJECT_PIN_COUNT_BITS) - 1)
 
+// vm_page_t::flags
+#define VM_PAGE_FLAG_ZEROED (1u << 0) // free page which is known to be filled with zeros
+
 // core per page structure
 typedef struct vm_page {
     struct {
@@ -39,6 +42,9 @@ typedef struct vm_page {
             // If true, one pin slot is used by the VmObject to keep a run
             // contiguous.
             bool contiguous_pin : 1;
+            // Number of reclaim scans since the page was last looked up,
+            // saturating; see VmObjectPaged::ReclaimPages().
+            uint8_t age : 2;
         } object;
 
         uint8_t pad[24]; // pad out to 32 bytes
@@ -0,0 +1,67 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <kernel/vm.h>
+#include <mxtl/intrusive_wavl_tree.h>
+#include <mxtl/macros.h>
+#include <mxtl/unique_ptr.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// In-memory compressed swap.
+//
+// When free memory drops below a low watermark, the page compressor thread
+// scans every VMO once per interval until free memory is back above a high
+// watermark. Each scan ages the pages of user VMOs (see
+// VmObjectPaged::ReclaimPages()); pages which stay unused for long enough are
+// compressed with LZ4 and their memory returned to the PMM. A compressed page
+// is decompressed into a newly allocated page when it is next looked up.
+
+// A page of a VmObjectPaged, held compressed.
+class VmCompressedPage final
+    : public mxtl::WAVLTreeContainable<mxtl::unique_ptr<VmCompressedPage>> {
+public:
+    // Compresses the page at |pa|, which belongs at |offset| in its VMO.
+    // Returns null if the page does not compress well enough to be worth
+    // keeping compressed, or on allocation failure.
+    static mxtl::unique_ptr<VmCompressedPage> Create(paddr_t pa, uint64_t offset);
+
+    ~VmCompressedPage();
+
+    // Decompresses the page into the page at |pa|.
+    void Decompress(paddr_t pa) const;
+
+    uint64_t GetKey() const { return offset_; }
+    uint64_t offset() const { return offset_; }
+    // May only be called while the page is not in a tree.
+    void set_offset(uint64_t offset) { offset_ = offset; }
+
+private:
+    VmCompressedPage(uint64_t offset, mxtl::unique_ptr<uint8_t[]> data, size_t size);
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(VmCompressedPage);
+
+    uint64_t offset_;
+    const size_t size_;
+    const mxtl::unique_ptr<uint8_t[]> data_;
+};
+
+using VmCompressedPageTree = mxtl::WAVLTree<uint64_t, mxtl::unique_ptr<VmCompressedPage>>;
+
+// Ages the pages of every VMO once, compressing up to |max_pages| pages which
+// have gone unused for long enough. Returns the number of pages compressed.
+size_t page_compressor_scan(size_t max_pages);
+
+// Runs one scan if free memory is below the low watermark, or has not yet
+// recovered to the high watermark since it was. Returns the number of pages
+// compressed.
+size_t page_compressor_reclaim_step(void);
+
+// Makes the compressor act as if the system had only |bytes| of memory, for
+// testing. Zero removes the limit.
+void page_compressor_set_memory_limit(size_t bytes);
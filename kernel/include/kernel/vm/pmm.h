@@ -30,6 +30,7 @@ status_t pmm_add_arena(const pmm_arena_info_t* arena) __NONNULL((1));
 // flags for allocation routines below
 #define PMM_ALLOC_FLAG_ANY (0x0)  // no restrictions on which arena to allocate from
 #define PMM_ALLOC_FLAG_KMAP (0x1) // allocate only from arenas marked KMAP
+#define PMM_ALLOC_FLAG_ZEROED (0x2) // return pages filled with zeros
 
 // Allocate count pages of physical memory, adding to the tail of the passed list.
 // The list must be initialized.
@@ -39,6 +40,10 @@ size_t pmm_alloc_pages(size_t count, uint alloc_flags, struct list_node* list) _
 // Allocate a single page of physical memory.
 vm_page_t* pmm_alloc_page(uint alloc_flags, paddr_t* pa);
 
+// PMM_ALLOC_FLAG_ZEROED is honored by pmm_alloc_pages and pmm_alloc_page only.
+// Such pages are taken from a pool of free pages zeroed in the background
+// when possible, and otherwise zeroed before returning.
+
 // Allocate a specific range of physical pages, adding to the tail of the passed list.
 // Returns the number of pages allocated.
 size_t pmm_alloc_range(paddr_t address, size_t count, struct list_node* list);
@@ -59,6 +64,13 @@ size_t pmm_free_page(vm_page_t* page) __NONNULL((1));
 // Return count of unallocated physical pages in system
 size_t pmm_count_free_pages(void);
 
+// Return count of unallocated physical pages which are already zeroed
+size_t pmm_count_zeroed_pages(void);
+
+// Enable or disable zeroing free pages in the background. While disabled,
+// PMM_ALLOC_FLAG_ZEROED allocations zero every page they return.
+void pmm_set_zero_pool_enabled(bool enabled);
+
 // Return amount of physical memory in system, in bytes.
 size_t pmm_count_total_bytes(void);
 
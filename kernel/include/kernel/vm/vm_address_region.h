@@ -41,6 +41,10 @@
 // with execute permissions.  When on a VmMapping, controls whether or not the
 // mapping can gain this permission.
 #define VMAR_FLAG_CAN_MAP_EXECUTE (1 << 6)
+// On a VmMapping, map physically contiguous runs of pages with a single arch
+// call, so that suitably aligned runs are mapped with large pages. Only for
+// kernel mappings whose ranges are decommitted in whole large pages, if at all.
+#define VMAR_FLAG_LARGE_PAGES (1 << 7)
 
 #define VMAR_CAN_RWX_FLAGS (VMAR_FLAG_CAN_MAP_READ |  \
                             VMAR_FLAG_CAN_MAP_WRITE | \
@@ -167,6 +167,13 @@ public:
     // returns an enum rather than adding a new method for each clone type.
     bool is_cow_clone() const;
 
+    // Returns the number of copy-on-write ancestors of this VMO; i.e. how
+    // many objects a lookup of a page it does not have may have to search.
+    virtual uint32_t CowChainDepth()
+        // Reads the parents' members under the lock they share, which
+        // confuses analysis.
+        TA_NO_THREAD_SAFETY_ANALYSIS;
+
     // get a pointer to the page structure and/or physical address at the specified offset.
     // valid flags are VMM_PF_FLAG_*
     virtual status_t GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
@@ -208,6 +215,20 @@ public:
         return MX_OK;
     }
 
+    // Stores references to up to |max| VMOs which follow |after| in the global
+    // VMO list (or start it, if |after| is null) in |refs|, returning how many
+    // were stored. Unlike ForEach(), this lets the caller operate on the VMOs
+    // without holding the global VMO list lock.
+    static size_t GetVmoRefs(VmObject* after, mxtl::RefPtr<VmObject>* refs, size_t max);
+
+    // Compresses up to |max_pages| of this VMO's pages which have not been
+    // looked up for a while, returning the number compressed. Each call also
+    // ages the pages which were not compressed; see page_compressor.h.
+    virtual size_t ReclaimPages(size_t max_pages) { return 0; }
+
+    // Returns the number of this VMO's pages which are held compressed.
+    virtual size_t CompressedPages() const { return 0; }
+
 protected:
     // private constructor (use Create())
     explicit VmObject(mxtl::RefPtr<VmObject> parent);
@@ -220,6 +241,15 @@ protected:
 
     DISALLOW_COPY_ASSIGN_AND_MOVE(VmObject);
 
+    // Adds this VMO to the global VMO list; called by Create() once the VMO
+    // has been adopted, so that GetVmoRefs() never sees a half-built one.
+    void AddToGlobalList();
+
+    // If the caller holds the only reference to this VMO, takes it off the
+    // global VMO list, so that GetVmoRefs() cannot hand out another, and
+    // returns true. Anything else making a reference needs one already.
+    bool RemoveFromGlobalListIfUnshared();
+
     // inform all mappings and children that a range of this vmo's pages were added or removed.
     void RangeChangeUpdateLocked(uint64_t offset, uint64_t len) TA_REQ(lock_);
 
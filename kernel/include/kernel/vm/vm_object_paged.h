@@ -9,6 +9,7 @@
 #include <assert.h>
 #include <kernel/mutex.h>
 #include <kernel/vm.h>
+#include <kernel/vm/page_compressor.h>
 #include <kernel/vm/pmm.h>
 #include <kernel/vm/vm_object.h>
 #include <kernel/vm/vm_page_list.h>
@@ -82,6 +83,11 @@ public:
         // Called under the parent's lock, which confuses analysis.
         TA_NO_THREAD_SAFETY_ANALYSIS;
 
+    uint32_t CowChainDepth() override;
+
+    size_t ReclaimPages(size_t max_pages) override;
+    size_t CompressedPages() const override;
+
 private:
     // private constructor (use Create())
     explicit VmObjectPaged(uint32_t pmm_alloc_flags, mxtl::RefPtr<VmObject> parent);
@@ -120,14 +126,43 @@ private:
     // set our offset within our parent
     status_t SetParentOffsetLocked(uint64_t o) TA_REQ(lock_);
 
+    // merge ancestors which nothing but this object can observe into it
+    void CollapseParentsLocked() TA_REQ(lock_);
+    bool CollapseParentLocked()
+        // Modifies the parent and grandparent under the lock they share with
+        // us, which confuses analysis.
+        TA_NO_THREAD_SAFETY_ANALYSIS;
+
+    // whether nothing but user mappings can observe our pages being reclaimed
+    bool ReclaimableLocked() const TA_REQ(lock_);
+
+    // decompress the page at |offset| into a new page, allocated from
+    // |free_list| if possible, and add it to the object. returns
+    // MX_ERR_NOT_FOUND if the page at |offset| is not compressed.
+    status_t DecompressPageLocked(uint64_t offset, list_node* free_list,
+                                  vm_page_t** page, paddr_t* pa) TA_REQ(lock_);
+    status_t DecompressRangeLocked(uint64_t start, uint64_t end) TA_REQ(lock_);
+
+    // drop the compressed pages in a range, returning how many there were
+    size_t FreeCompressedRangeLocked(uint64_t start, uint64_t end) TA_REQ(lock_);
+
     // maximum size of a VMO is one page less than the full 64bit range
     static const uint64_t MAX_SIZE = ROUNDDOWN(UINT64_MAX, PAGE_SIZE);
 
     // members
     uint64_t size_ TA_GUARDED(lock_) = 0;
     uint64_t parent_offset_ TA_GUARDED(lock_) = 0;
+    // lookups at or beyond this offset are not passed on to the parent
+    uint64_t parent_limit_ TA_GUARDED(lock_) = MAX_SIZE;
     uint32_t pmm_alloc_flags_ TA_GUARDED(lock_) = PMM_ALLOC_FLAG_ANY;
+    // physical addresses of our pages have been looked up, so they are never
+    // reclaimed
+    bool physical_lookup_ TA_GUARDED(lock_) = false;
 
     // a tree of pages
     VmPageList page_list_ TA_GUARDED(lock_);
+
+    // pages reclaimed by the page compressor; no offset is in both this and
+    // page_list_
+    VmCompressedPageTree compressed_pages_ TA_GUARDED(lock_);
 };
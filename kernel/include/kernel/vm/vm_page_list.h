@@ -189,6 +189,8 @@ public:
     status_t AddPage(vm_page*, uint64_t offset);
     vm_page* GetPage(uint64_t offset);
     status_t FreePage(uint64_t offset);
+    // Removes the page at |offset| without freeing it, returning it if there was one.
+    vm_page* RemovePage(uint64_t offset);
     size_t FreeAllPages();
 
 private:
@@ -24,13 +24,20 @@ typedef struct wait_queue {
     int magic;
     struct list_node list;
     int count;
+
+    /* if non-NULL, threads blocked on this queue lend their priority to owner */
+    struct thread *owner;
+    /* node in the owner's list of owned wait queues */
+    struct list_node owner_node;
 } wait_queue_t;
 
 #define WAIT_QUEUE_INITIAL_VALUE(q) \
 { \
     .magic = WAIT_QUEUE_MAGIC, \
     .list = LIST_INITIAL_VALUE((q).list), \
-    .count = 0 \
+    .count = 0, \
+    .owner = NULL, \
+    .owner_node = LIST_INITIAL_CLEARED_VALUE \
 }
 
 /* wait queue primitive */
@@ -65,6 +72,14 @@ status_t thread_unblock_from_wait_queue(struct thread *t, status_t wait_queue_er
 /* is the wait queue currently empty */
 bool wait_queue_is_empty(wait_queue_t *);
 
+/*
+ * set the thread which holds the resource the queue's waiters are blocked on.
+ * until the owner is changed or cleared, the owner runs at no lower a priority
+ * than the highest priority waiter, transitively through chains of owners.
+ * an owner that exits is cleared automatically.
+ */
+void wait_queue_set_owner(wait_queue_t *, struct thread *owner);
+
 __END_CDECLS;
 
 #endif
@@ -8,6 +8,7 @@
 #ifndef __PLATFORM_H
 #define __PLATFORM_H
 
+#include <stdbool.h>
 #include <sys/types.h>
 #include <magenta/compiler.h>
 
@@ -39,6 +40,12 @@ lk_time_t current_time(void);
 /* high-precision timer ticks per second */
 uint64_t ticks_per_second(void);
 
+/* If current_time() is a hardware counter that user mode can read (the TSC on
+ * x86, the virtual counter on arm64) times a fixed factor, stores the factor
+ * and returns true.  This lets the vDSO compute the time by itself. */
+struct fp_32_64;
+bool current_time_from_user_counter(struct fp_32_64 *ns_per_tick);
+
 /* super early platform initialization, before almost everything */
 void platform_early_init(void);
 
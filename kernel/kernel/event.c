@@ -124,7 +124,7 @@ static int event_signal_internal(event_t *e, bool reschedule, status_t wait_resu
     // the state variable needs to exit in either path.
     spin_lock_saved_state_t state = 0;
     if (!thread_lock_held)
-        spin_lock_irqsave(&thread_lock, state);
+        spin_lock_irqsave_class(&thread_lock, state, LOCKSTAT_CLASS(thread_lock));
 
     int wake_count = 0;
 
@@ -148,7 +148,7 @@ static int event_signal_internal(event_t *e, bool reschedule, status_t wait_resu
 
     // conditionally THREAD_UNLOCK
     if (!thread_lock_held)
-        spin_unlock_irqrestore(&thread_lock, state);
+        spin_unlock_irqrestore_class(&thread_lock, state, LOCKSTAT_CLASS(thread_lock));
 
     return wake_count;
 }
@@ -0,0 +1,313 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <kernel/lockstat.h>
+
+#include <arch/ops.h>
+#include <debug.h>
+#include <err.h>
+#include <inttypes.h>
+#include <kernel/mutex.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <lib/ktrace.h>
+#include <platform.h>
+#include <stdio.h>
+#include <string.h>
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+#endif
+
+#if WITH_LOCK_STATS
+
+LOCKSTAT_CLASS_DEFINE(mutex, "mutex");
+
+extern lockstat_class_t __start_lockstat_class[] __WEAK;
+extern lockstat_class_t __stop_lockstat_class[] __WEAK;
+
+// The counters of a class may be updated by a thread which has migrated away
+// from the cpu they belong to, so are updated atomically; they are only
+// contended when that happens.
+static inline void counter_add(uint64_t *counter, uint64_t val)
+{
+    __atomic_fetch_add(counter, val, __ATOMIC_RELAXED);
+}
+
+static inline void counter_max(uint64_t *counter, uint64_t val)
+{
+    uint64_t old = __atomic_load_n(counter, __ATOMIC_RELAXED);
+    while (val > old &&
+           !__atomic_compare_exchange_n(counter, &old, val, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static inline uint histogram_bucket(uint64_t time)
+{
+    if (time < 256)
+        return 0;
+    uint bucket = (uint)((63 - __builtin_clzll(time) - 8) / 2 + 1);
+    return MIN(bucket, LOCKSTAT_HISTOGRAM_BUCKETS - 1);
+}
+
+static inline uint32_t class_index(const lockstat_class_t *cls)
+{
+    return (uint32_t)(cls - __start_lockstat_class);
+}
+
+static inline lockstat_class_t *mutex_class(const mutex_t *m)
+{
+    return m->lockstat_class ? m->lockstat_class : LOCKSTAT_CLASS(mutex);
+}
+
+static inline lockstat_counters_t *local_counters(lockstat_class_t *cls)
+{
+    return &cls->cpu[arch_curr_cpu_num()].counters;
+}
+
+static void record_acquisition(lockstat_class_t *cls)
+{
+    counter_add(&local_counters(cls)->acquisitions, 1);
+}
+
+static void record_contention(lockstat_class_t *cls)
+{
+    counter_add(&local_counters(cls)->contentions, 1);
+}
+
+static void record_wait(lockstat_class_t *cls, const void *lock, uint64_t wait_time)
+{
+    lockstat_counters_t *c = local_counters(cls);
+    counter_add(&c->acquisitions, 1);
+    counter_add(&c->wait_time, wait_time);
+    counter_max(&c->max_wait_time, wait_time);
+    counter_add(&c->wait_histogram[histogram_bucket(wait_time)], 1);
+
+    ktrace(TAG_LOCK_WAIT_DONE, class_index(cls), (uint32_t)wait_time,
+           (uint32_t)(wait_time >> 32), (uint32_t)(uintptr_t)lock);
+}
+
+static void record_hold(lockstat_class_t *cls, uint64_t hold_time)
+{
+    lockstat_counters_t *c = local_counters(cls);
+    counter_add(&c->hold_time, hold_time);
+    counter_max(&c->max_hold_time, hold_time);
+    counter_add(&c->hold_histogram[histogram_bucket(hold_time)], 1);
+}
+
+void lockstat_mutex_acquired(mutex_t *m)
+{
+    record_acquisition(mutex_class(m));
+    m->lockstat_acquire_time = current_time();
+}
+
+void lockstat_mutex_contended(mutex_t *m, thread_t *holder)
+{
+    lockstat_class_t *cls = mutex_class(m);
+    record_contention(cls);
+
+    ktrace(TAG_MUTEX_CONTEND, class_index(cls), holder ? (uint32_t)holder->user_tid : 0,
+           (uint32_t)(uintptr_t)holder, (uint32_t)(uintptr_t)m);
+}
+
+void lockstat_mutex_acquired_after_wait(mutex_t *m, uint64_t wait_time)
+{
+    record_wait(mutex_class(m), m, wait_time);
+    m->lockstat_acquire_time = current_time();
+}
+
+void lockstat_mutex_releasing(mutex_t *m)
+{
+    record_hold(mutex_class(m), current_time() - m->lockstat_acquire_time);
+}
+
+// Spin locks are held with interrupts disabled, so the acquisition time can be
+// kept per cpu rather than in the lock.
+void lockstat_spin_lock(spin_lock_t *lock, lockstat_class_t *cls)
+{
+    lockstat_cpu_t *cpu = &cls->cpu[arch_curr_cpu_num()];
+
+    if (likely(arch_spin_trylock(lock) == 0)) {
+        counter_add(&cpu->counters.acquisitions, 1);
+        cpu->spin_acquire_time = current_time();
+        return;
+    }
+
+    counter_add(&cpu->counters.contentions, 1);
+    ktrace(TAG_SPINLOCK_CONTEND, class_index(cls), arch_spin_lock_holder_cpu(lock),
+           arch_curr_cpu_num(), (uint32_t)(uintptr_t)lock);
+
+    lk_time_t wait_start = current_time();
+    arch_spin_lock(lock);
+    lk_time_t now = current_time();
+
+    record_wait(cls, lock, now - wait_start);
+    cpu->spin_acquire_time = now;
+}
+
+void lockstat_spin_unlock(spin_lock_t *lock, lockstat_class_t *cls)
+{
+    lockstat_cpu_t *cpu = &cls->cpu[arch_curr_cpu_num()];
+
+    // A lock handed across a context switch is released by a different
+    // thread, possibly having been acquired with a plain spin_lock(); the
+    // hold time is then measured from the last accounted acquisition on this
+    // cpu.
+    record_hold(cls, current_time() - cpu->spin_acquire_time);
+    arch_spin_unlock(lock);
+}
+
+size_t lockstat_class_count(void)
+{
+    return (size_t)(__stop_lockstat_class - __start_lockstat_class);
+}
+
+const char *lockstat_class_name(size_t index)
+{
+    if (index >= lockstat_class_count())
+        return NULL;
+    return __start_lockstat_class[index].name;
+}
+
+const char *lockstat_read_class(size_t index, lockstat_counters_t *counters)
+{
+    if (index >= lockstat_class_count())
+        return NULL;
+
+    // NOTE: it's racy to read the counters while they are being updated, but
+    // each one is read whole.
+    const lockstat_class_t *cls = &__start_lockstat_class[index];
+    memset(counters, 0, sizeof(*counters));
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        const lockstat_counters_t *c = &cls->cpu[i].counters;
+        counters->acquisitions += c->acquisitions;
+        counters->contentions += c->contentions;
+        counters->wait_time += c->wait_time;
+        counters->max_wait_time = MAX(counters->max_wait_time, c->max_wait_time);
+        counters->hold_time += c->hold_time;
+        counters->max_hold_time = MAX(counters->max_hold_time, c->max_hold_time);
+        for (uint b = 0; b < LOCKSTAT_HISTOGRAM_BUCKETS; b++) {
+            counters->wait_histogram[b] += c->wait_histogram[b];
+            counters->hold_histogram[b] += c->hold_histogram[b];
+        }
+    }
+    return cls->name;
+}
+
+void lockstat_reset(void)
+{
+    // Racing updates may survive the reset; that's harmless.
+    for (lockstat_class_t *cls = __start_lockstat_class; cls != __stop_lockstat_class; cls++) {
+        for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+            memset(&cls->cpu[i].counters, 0, sizeof(cls->cpu[i].counters));
+        }
+    }
+}
+
+#else // !WITH_LOCK_STATS
+
+size_t lockstat_class_count(void)
+{
+    return 0;
+}
+
+const char *lockstat_class_name(size_t index)
+{
+    return NULL;
+}
+
+const char *lockstat_read_class(size_t index, lockstat_counters_t *counters)
+{
+    return NULL;
+}
+
+void lockstat_reset(void)
+{
+}
+
+#endif // WITH_LOCK_STATS
+
+#if WITH_LIB_CONSOLE
+
+static uint64_t average(uint64_t total, uint64_t count)
+{
+    return count ? total / count : 0;
+}
+
+static void dump_histogram(const char *what, const uint64_t *histogram)
+{
+    printf("  %s:\n", what);
+    for (uint b = 0; b < LOCKSTAT_HISTOGRAM_BUCKETS; b++) {
+        if (b < LOCKSTAT_HISTOGRAM_BUCKETS - 1) {
+            printf("    < %10" PRIu64 " ns: %" PRIu64 "\n", (uint64_t)256 << (2 * b), histogram[b]);
+        } else {
+            printf("    >= %9" PRIu64 " ns: %" PRIu64 "\n", (uint64_t)256 << (2 * (b - 1)), histogram[b]);
+        }
+    }
+}
+
+static int cmd_lockstat(int argc, const cmd_args *argv, uint32_t flags)
+{
+    if (lockstat_class_count() == 0) {
+        printf("lock statistics are not enabled, build with ENABLE_LOCK_STATS=true\n");
+        return MX_ERR_NOT_SUPPORTED;
+    }
+
+    if (argc < 2) {
+        printf("not enough arguments\n");
+usage:
+        printf("usage:\n");
+        printf("%s show          : dump the counters of every lock class\n", argv[0].str);
+        printf("%s hist <class>  : dump the wait and hold time histograms of a class\n",
+               argv[0].str);
+        printf("%s reset         : zero all counters\n", argv[0].str);
+        return MX_ERR_INTERNAL;
+    }
+
+    lockstat_counters_t c;
+    if (!strcmp(argv[1].str, "show")) {
+        printf("%-24s %12s %10s %10s %12s %10s %12s\n", "class", "acquired", "contended",
+               "avg wait", "max wait", "avg hold", "max hold");
+        for (size_t i = 0; i < lockstat_class_count(); i++) {
+            const char *name = lockstat_read_class(i, &c);
+            printf("%-24s %12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %12" PRIu64
+                   " %10" PRIu64 " %12" PRIu64 "\n",
+                   name, c.acquisitions, c.contentions, average(c.wait_time, c.contentions),
+                   c.max_wait_time, average(c.hold_time, c.acquisitions), c.max_hold_time);
+        }
+        printf("times in ns\n");
+    } else if (!strcmp(argv[1].str, "hist")) {
+        if (argc < 3) {
+            printf("not enough arguments\n");
+            goto usage;
+        }
+        for (size_t i = 0; i < lockstat_class_count(); i++) {
+            const char *name = lockstat_read_class(i, &c);
+            if (!strcmp(name, argv[2].str)) {
+                printf("%s:\n", name);
+                dump_histogram("wait time", c.wait_histogram);
+                dump_histogram("hold time", c.hold_histogram);
+                return MX_OK;
+            }
+        }
+        printf("no lock class named %s\n", argv[2].str);
+        return MX_ERR_NOT_FOUND;
+    } else if (!strcmp(argv[1].str, "reset")) {
+        lockstat_reset();
+    } else {
+        printf("unknown command\n");
+        goto usage;
+    }
+
+    return MX_OK;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("lockstat", "lock contention statistics", &cmd_lockstat)
+STATIC_COMMAND_END(lockstat);
+
+#endif // WITH_LIB_CONSOLE
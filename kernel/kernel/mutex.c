@@ -21,8 +21,10 @@
 #include <assert.h>
 #include <err.h>
 #include <inttypes.h>
+#include <kernel/lockstat.h>
 #include <kernel/thread.h>
 #include <kernel/sched.h>
+#include <platform.h>
 #include <trace.h>
 
 #define LOCAL_TRACE 0
@@ -35,6 +37,14 @@ void mutex_init(mutex_t *m)
     *m = (mutex_t)MUTEX_INITIAL_VALUE(*m);
 }
 
+/**
+ * @brief  Initialize a mutex_t accounted to lock class |cls|
+ */
+void mutex_init_class(mutex_t *m, lockstat_class_t *cls)
+{
+    *m = (mutex_t)MUTEX_INITIAL_VALUE_CLASS(*m, cls);
+}
+
 /**
  * @brief  Destroy a mutex_t
  *
@@ -78,6 +88,9 @@ retry:
     oldval = 0;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct))) {
         // acquired it cleanly
+#if WITH_LOCK_STATS
+        lockstat_mutex_acquired(m);
+#endif
         return;
     }
 
@@ -104,6 +117,15 @@ retry:
         goto retry;
     }
 
+    // lend our priority to the holder until it releases the mutex. the holder
+    // can't release it without the thread lock now that the queued flag is set.
+    wait_queue_set_owner(&m->wait, (thread_t *)(oldval & ~MUTEX_FLAG_QUEUED));
+
+#if WITH_LOCK_STATS
+    lockstat_mutex_contended(m, (thread_t *)(oldval & ~MUTEX_FLAG_QUEUED));
+    lk_time_t wait_start = current_time();
+#endif
+
     // we have signalled that we're blocking, so drop into the wait queue
     status_t ret = wait_queue_block(&m->wait, INFINITE_TIME);
     if (unlikely(ret < MX_OK)) {
@@ -116,6 +138,10 @@ retry:
     // someone must have woken us up, we should own the mutex now
     DEBUG_ASSERT(ct == mutex_holder(m));
 
+#if WITH_LOCK_STATS
+    lockstat_mutex_acquired_after_wait(m, current_time() - wait_start);
+#endif
+
     THREAD_UNLOCK(state);
 }
 
@@ -126,6 +152,10 @@ static inline void mutex_release_internal(mutex_t *m, bool reschedule, bool thre
     thread_t *ct = get_current_thread();
     uintptr_t oldval;
 
+#if WITH_LOCK_STATS
+    lockstat_mutex_releasing(m);
+#endif
+
     // in case there's no contention, try the fast path
     oldval = (uintptr_t)ct;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, 0))) {
@@ -148,14 +178,18 @@ static inline void mutex_release_internal(mutex_t *m, bool reschedule, bool thre
     // the state variable needs to exit in either path.
     spin_lock_saved_state_t state;
     if (!thread_lock_held)
-        spin_lock_irqsave(&thread_lock, state);
+        spin_lock_irqsave_class(&thread_lock, state, LOCKSTAT_CLASS(thread_lock));
 
     // release a thread in the wait queue
     thread_t *t = wait_queue_dequeue_one(&m->wait, MX_OK);
     DEBUG_ASSERT_MSG(t, "mutex_release: wait queue didn't have anything, but m->val = %#" PRIxPTR "\n", mutex_val(m));
 
     // we woke up a thread, mark the mutex owned by that thread
-    uintptr_t newval = (uintptr_t)t | (wait_queue_is_empty(&m->wait) ? 0 : MUTEX_FLAG_QUEUED);
+    bool still_queued = !wait_queue_is_empty(&m->wait);
+    uintptr_t newval = (uintptr_t)t | (still_queued ? MUTEX_FLAG_QUEUED : 0);
+
+    // our inherited priority passes to the new holder along with the mutex
+    wait_queue_set_owner(&m->wait, still_queued ? t : NULL);
 
     oldval = (uintptr_t)ct | MUTEX_FLAG_QUEUED;
     if (!atomic_cmpxchg_u64(&m->val, &oldval, newval)) {
@@ -169,7 +203,7 @@ static inline void mutex_release_internal(mutex_t *m, bool reschedule, bool thre
 
     // conditionally THREAD_UNLOCK
     if (!thread_lock_held)
-        spin_unlock_irqrestore(&thread_lock, state);
+        spin_unlock_irqrestore_class(&thread_lock, state, LOCKSTAT_CLASS(thread_lock));
 }
 
 void mutex_release(mutex_t *m) TA_NO_THREAD_SAFETY_ANALYSIS
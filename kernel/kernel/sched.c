@@ -16,7 +16,9 @@
 #include <lib/ktrace.h>
 #include <kernel/mp.h>
 #include <kernel/percpu.h>
+#include <kernel/stats.h>
 #include <kernel/thread.h>
+#include <platform.h>
 
 /* legacy implementation that just broadcast ipis for every reschedule */
 #define BROADCAST_RESCHEDULE 0
@@ -26,6 +28,11 @@
 
 #define MAX_PRIORITY_ADJ 4 /* +/- priority levels from the base priority */
 
+/* longest chain of owners a priority change is passed along. bounds the
+ * work done under the thread lock, and breaks cycles (which can only be
+ * created by userspace naming the wrong futex owner). */
+#define MAX_INHERITANCE_DEPTH 16
+
 /* ktraces just local to this file */
 #define LOCAL_KTRACE 0
 
@@ -41,6 +48,9 @@
 static struct list_node run_queue[NUM_PRIORITIES];
 static uint32_t run_queue_bitmap;
 
+/* number of threads in the run queue */
+static uint run_queue_depth;
+
 /* make sure the bitmap is large enough to cover our number of priorities */
 static_assert(NUM_PRIORITIES <= sizeof(run_queue_bitmap) * CHAR_BIT, "");
 
@@ -48,6 +58,8 @@ static_assert(NUM_PRIORITIES <= sizeof(run_queue_bitmap) * CHAR_BIT, "");
 static int effec_priority(const thread_t *t)
 {
     int ep = t->base_priority + t->priority_boost;
+    if (t->inherited_priority > ep)
+        ep = t->inherited_priority;
     DEBUG_ASSERT(ep >= LOWEST_PRIORITY && ep <= HIGHEST_PRIORITY);
     return ep;
 }
@@ -177,6 +189,7 @@ static void insert_in_run_queue_head(thread_t *t)
 
     list_add_head(&run_queue[ep], &t->queue_node);
     run_queue_bitmap |= (1u << ep);
+    run_queue_depth++;
 }
 
 static void insert_in_run_queue_tail(thread_t *t)
@@ -187,6 +200,33 @@ static void insert_in_run_queue_tail(thread_t *t)
 
     list_add_tail(&run_queue[ep], &t->queue_node);
     run_queue_bitmap |= (1u << ep);
+    run_queue_depth++;
+}
+
+static void remove_from_run_queue(thread_t *t)
+{
+    DEBUG_ASSERT(list_in_list(&t->queue_node));
+
+    int ep = effec_priority(t);
+
+    list_delete(&t->queue_node);
+    if (list_is_empty(&run_queue[ep]))
+        run_queue_bitmap &= ~(1u << ep);
+    run_queue_depth--;
+}
+
+/* wake up a thread, putting it at the head of the run queue */
+static void wake_thread(thread_t *t, lk_time_t now)
+{
+    /* thread is being woken up, boost its priority */
+    boost_thread(t);
+
+    t->wakeup_time = now;
+    t->sched_stats.run_queue_depth[sched_stats_depth_bucket(run_queue_depth)]++;
+
+    /* stuff the new thread in the run queue */
+    t->state = THREAD_READY;
+    insert_in_run_queue_head(t);
 }
 
 thread_t *sched_get_top_thread(uint cpu)
@@ -194,6 +234,8 @@ thread_t *sched_get_top_thread(uint cpu)
     thread_t *newthread;
     uint32_t local_run_queue_bitmap = run_queue_bitmap;
 
+    percpu[cpu].stats.sched.run_queue_depth[sched_stats_depth_bucket(run_queue_depth)]++;
+
     while (local_run_queue_bitmap) {
         /* find the first (remaining) queue with a thread in it */
         uint next_queue = HIGHEST_PRIORITY - __builtin_clz(local_run_queue_bitmap)
@@ -205,6 +247,7 @@ thread_t *sched_get_top_thread(uint cpu)
 
                 if (list_is_empty(&run_queue[next_queue]))
                     run_queue_bitmap &= ~(1<<next_queue);
+                run_queue_depth--;
 
                 LOCAL_KTRACE2("sched_get_top", newthread->priority_boost, newthread->base_priority);
 
@@ -241,12 +284,7 @@ void sched_unblock(thread_t *t)
 
     LOCAL_KTRACE0("sched_unblock");
 
-    /* thread is being woken up, boost its priority */
-    boost_thread(t);
-
-    /* stuff the new thread in the run queue */
-    t->state = THREAD_READY;
-    insert_in_run_queue_head(t);
+    wake_thread(t, current_time());
 
     mp_reschedule(find_cpu(t), 0);
 }
@@ -258,18 +296,15 @@ void sched_unblock_list(struct list_node *list)
 
     LOCAL_KTRACE0("sched_unblock_list");
 
+    lk_time_t now = current_time();
+
     /* pop the list of threads and shove into the scheduler */
     thread_t *t;
     while ((t = list_remove_tail_type(list, thread_t, queue_node))) {
         DEBUG_ASSERT(t->magic == THREAD_MAGIC);
         DEBUG_ASSERT(!thread_is_idle(t));
 
-        /* thread is being woken up, boost its priority */
-        boost_thread(t);
-
-        /* stuff the new thread in the run queue */
-        t->state = THREAD_READY;
-        insert_in_run_queue_head(t);
+        wake_thread(t, now);
 
         mp_reschedule(find_cpu(t), 0);
     }
@@ -346,6 +381,48 @@ void sched_reschedule(void)
     _thread_resched_internal();
 }
 
+/* Recompute the priority t inherits from the threads blocked on the wait
+ * queues it owns. If it changed and t is itself blocked on an owned wait
+ * queue, the change is passed on to that queue's owner, and so on.
+ */
+void sched_update_inherited_priority(thread_t *t)
+{
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    for (uint depth = 0; t && depth < MAX_INHERITANCE_DEPTH; depth++) {
+        DEBUG_ASSERT(t->magic == THREAD_MAGIC);
+
+        int inherited = -1;
+        wait_queue_t *wait;
+        list_for_every_entry(&t->owned_wait_queues, wait, wait_queue_t, owner_node) {
+            thread_t *waiter;
+            list_for_every_entry(&wait->list, waiter, thread_t, queue_node) {
+                int ep = effec_priority(waiter);
+                if (ep > inherited)
+                    inherited = ep;
+            }
+        }
+
+        if (inherited == t->inherited_priority)
+            return;
+
+        LOCAL_KTRACE2("sched_inherit", t->inherited_priority, inherited);
+
+        /* a ready thread has to move to the run queue for its new priority */
+        if (t->state == THREAD_READY && list_in_list(&t->queue_node)) {
+            remove_from_run_queue(t);
+            t->inherited_priority = inherited;
+            insert_in_run_queue_head(t);
+            mp_reschedule(find_cpu(t), 0);
+        } else {
+            t->inherited_priority = inherited;
+        }
+
+        t = (t->state == THREAD_BLOCKED && t->blocking_wait_queue) ?
+            t->blocking_wait_queue->owner : NULL;
+    }
+}
+
 void sched_init_early(void)
 {
     /* initialize the run queues */
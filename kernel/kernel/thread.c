@@ -57,6 +57,7 @@ static struct list_node thread_list = LIST_INITIAL_VALUE(thread_list);
 
 /* master thread spinlock */
 spin_lock_t thread_lock = SPIN_LOCK_INITIAL_VALUE;
+LOCKSTAT_CLASS_DEFINE(thread_lock, "thread_lock");
 
 /* local routines */
 static int idle_thread_routine(void *) __NO_RETURN;
@@ -71,6 +72,8 @@ static void init_thread_struct(thread_t *t, const char *name)
     thread_set_pinned_cpu(t, -1);
     strlcpy(t->name, name, sizeof(t->name));
     wait_queue_init(&t->retcode_wait_queue);
+    t->inherited_priority = -1;
+    list_initialize(&t->owned_wait_queues);
 }
 
 static void initial_thread_func(void) __NO_RETURN;
@@ -477,6 +480,13 @@ __NO_RETURN static void thread_exit_locked(thread_t *current_thread, int retcode
     current_thread->state = THREAD_DEATH;
     current_thread->retcode = retcode;
 
+    /* stop lending waiters' priority to a thread which will never release them */
+    wait_queue_t *owned;
+    while ((owned = list_peek_head_type(&current_thread->owned_wait_queues,
+                                        wait_queue_t, owner_node))) {
+        wait_queue_set_owner(owned, NULL);
+    }
+
     /* if we're detached, then do our teardown here */
     if (current_thread->flags & THREAD_FLAG_DETACHED) {
         /* remove it from the master thread list */
@@ -766,13 +776,29 @@ void _thread_resched_internal(void)
     thread_t *oldthread = current_thread;
 
     /* if it's the same thread as we're already running, exit */
-    if (newthread == oldthread)
+    if (newthread == oldthread) {
+        /* woken up before it got to switch away, so it never waited */
+        newthread->wakeup_time = 0;
         return;
+    }
 
     lk_time_t now = current_time();
     oldthread->runtime_ns += now - oldthread->last_started_running;
     newthread->last_started_running = now;
 
+    struct sched_stats *cpu_sched_stats = &percpu[cpu].stats.sched;
+    if (!thread_is_idle(oldthread)) {
+        uint bucket = sched_stats_time_bucket(now - oldthread->last_started_running);
+        oldthread->sched_stats.run_slice[bucket]++;
+        cpu_sched_stats->run_slice[bucket]++;
+    }
+    if (newthread->wakeup_time != 0) {
+        uint bucket = sched_stats_time_bucket(now - newthread->wakeup_time);
+        newthread->sched_stats.wakeup_latency[bucket]++;
+        cpu_sched_stats->wakeup_latency[bucket]++;
+        newthread->wakeup_time = 0;
+    }
+
     /* set up quantum for the new thread if it was consumed */
     if (newthread->remaining_time_slice == 0) {
         newthread->remaining_time_slice = THREAD_INITIAL_TIME_SLICE;
@@ -1073,6 +1099,20 @@ lk_time_t thread_runtime(const thread_t *t)
     return runtime;
 }
 
+/**
+ * @brief Copy the scheduler latency histograms of a thread.
+ *
+ * This takes the thread_lock to read them whole.
+ */
+void thread_get_sched_stats(const thread_t *t, struct sched_stats *stats)
+{
+    THREAD_LOCK(state);
+
+    *stats = t->sched_stats;
+
+    THREAD_UNLOCK(state);
+}
+
 /**
  * @brief Construct a thread t around the current running state
  *
@@ -1314,10 +1354,10 @@ void dump_thread(thread_t *t, bool full_dump)
 
     if (full_dump) {
         dprintf(INFO, "dump_thread: t %p (%s:%s)\n", t, oname, t->name);
-        dprintf(INFO, "\tstate %s, last_cpu %u, pinned_cpu %d, priority %d:%d, "
+        dprintf(INFO, "\tstate %s, last_cpu %u, pinned_cpu %d, priority %d:%d:%d, "
                 "remaining time slice %" PRIu64 "\n",
                 thread_state_to_str(t->state), t->last_cpu, t->pinned_cpu, t->base_priority,
-                t->priority_boost, t->remaining_time_slice);
+                t->priority_boost, t->inherited_priority, t->remaining_time_slice);
         dprintf(INFO, "\truntime_ns %" PRIu64 ", runtime_s %" PRIu64 "\n",
                 runtime, runtime / 1000000000);
         dprintf(INFO, "\tstack %p, stack_size %zu\n", t->stack, t->stack_size);
@@ -1459,6 +1499,10 @@ status_t wait_queue_block(wait_queue_t *wait, lk_time_t deadline)
     current_thread->blocking_wait_queue = wait;
     current_thread->blocked_status = MX_OK;
 
+    /* lend our priority to whoever we are waiting on */
+    if (wait->owner)
+        sched_update_inherited_priority(wait->owner);
+
     /* if the deadline is nonzero or noninfinite, set a callback to yank us out of the queue */
     if (deadline != INFINITE_TIME) {
         timer_init(&timer);
@@ -1505,6 +1549,9 @@ int wait_queue_wake_one(wait_queue_t *wait, bool reschedule, status_t wait_queue
         t->blocked_status = wait_queue_error;
         t->blocking_wait_queue = NULL;
 
+        if (wait->owner)
+            sched_update_inherited_priority(wait->owner);
+
         sched_unblock(t);
         if (reschedule)
             sched_reschedule();
@@ -1529,6 +1576,9 @@ thread_t *wait_queue_dequeue_one(wait_queue_t *wait, status_t wait_queue_error)
         DEBUG_ASSERT(t->state == THREAD_BLOCKED);
         t->blocked_status = wait_queue_error;
         t->blocking_wait_queue = NULL;
+
+        if (wait->owner)
+            sched_update_inherited_priority(wait->owner);
     }
 
     return t;
@@ -1578,6 +1628,9 @@ int wait_queue_wake_all(wait_queue_t *wait, bool reschedule, status_t wait_queue
     DEBUG_ASSERT(ret > 0);
     DEBUG_ASSERT(wait->count == 0);
 
+    if (wait->owner)
+        sched_update_inherited_priority(wait->owner);
+
     sched_unblock_list(&list);
     if (reschedule)
         sched_reschedule();
@@ -1613,9 +1666,45 @@ void wait_queue_destroy(wait_queue_t *wait)
         panic("wait_queue_destroy() called on non-empty wait_queue_t\n");
     }
 
+    wait_queue_set_owner(wait, NULL);
     wait->magic = 0;
 }
 
+/**
+ * @brief  Set the owner of a wait queue
+ *
+ * While a wait queue has an owner, the owner runs at no lower a priority
+ * than the highest priority thread blocked on the queue.  If the owner is
+ * itself blocked on an owned wait queue, the priority is passed along to
+ * that queue's owner too.
+ *
+ * @param wait   The wait queue
+ * @param owner  The thread holding what the waiters are blocked on, or NULL
+ */
+void wait_queue_set_owner(wait_queue_t *wait, thread_t *owner)
+{
+    DEBUG_ASSERT(wait->magic == WAIT_QUEUE_MAGIC);
+    DEBUG_ASSERT(arch_ints_disabled());
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    thread_t *old_owner = wait->owner;
+    if (old_owner == owner)
+        return;
+
+    if (old_owner) {
+        list_delete(&wait->owner_node);
+        wait->owner = NULL;
+        sched_update_inherited_priority(old_owner);
+    }
+
+    if (owner) {
+        DEBUG_ASSERT(owner->magic == THREAD_MAGIC);
+        list_add_tail(&owner->owned_wait_queues, &wait->owner_node);
+        wait->owner = owner;
+        sched_update_inherited_priority(owner);
+    }
+}
+
 /**
  * @brief  Wake a specific thread in a wait queue
  *
@@ -1641,11 +1730,15 @@ status_t thread_unblock_from_wait_queue(thread_t *t, status_t wait_queue_error)
     DEBUG_ASSERT(t->blocking_wait_queue->magic == WAIT_QUEUE_MAGIC);
     DEBUG_ASSERT(list_in_list(&t->queue_node));
 
+    wait_queue_t *wait = t->blocking_wait_queue;
     list_delete(&t->queue_node);
-    t->blocking_wait_queue->count--;
+    wait->count--;
     t->blocking_wait_queue = NULL;
     t->blocked_status = wait_queue_error;
 
+    if (wait->owner)
+        sched_update_inherited_priority(wait->owner);
+
     sched_unblock(t);
 
     return MX_OK;
@@ -0,0 +1,270 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <kernel/vm/page_compressor.h>
+
+#include "vm_priv.h"
+
+#include <assert.h>
+#include <err.h>
+#include <inttypes.h>
+#include <kernel/auto_lock.h>
+#include <kernel/cmdline.h>
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
+#include <kernel/vm/pmm.h>
+#include <kernel/vm/vm_object.h>
+#include <lib/console.h>
+#include <lk/init.h>
+#include <lz4/lz4.h>
+#include <mxalloc/new.h>
+#include <mxtl/algorithm.h>
+#include <mxtl/atomic.h>
+#include <pretty/sizes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <trace.h>
+
+#define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
+
+namespace {
+
+// Pages which do not compress to at most this size are left alone.
+constexpr size_t kMaxCompressedSize = PAGE_SIZE * 3 / 4;
+
+// Number of VMOs to hold references to at once while scanning.
+constexpr size_t kScanBatch = 16;
+
+// Guards the compression state, which is too large for the stack.
+Mutex compress_lock;
+LZ4_stream_t compress_state TA_GUARDED(compress_lock);
+char compress_buffer[kMaxCompressedSize] TA_GUARDED(compress_lock);
+
+// Serializes scans, so that each ages pages once.
+Mutex scan_lock;
+
+// Guards the reclaim parameters below.
+Mutex reclaim_lock;
+size_t low_watermark_pages TA_GUARDED(reclaim_lock);
+size_t high_watermark_pages TA_GUARDED(reclaim_lock);
+size_t memory_limit_pages TA_GUARDED(reclaim_lock);
+// True from when free memory drops below the low watermark until it is back
+// above the high watermark.
+bool reclaiming TA_GUARDED(reclaim_lock);
+
+// Statistics.
+mxtl::atomic<size_t> compressed_pages(0);
+mxtl::atomic<size_t> compressed_bytes(0);
+mxtl::atomic<uint64_t> compression_count(0);
+mxtl::atomic<uint64_t> decompression_count(0);
+mxtl::atomic<uint64_t> incompressible_count(0);
+
+} // namespace
+
+VmCompressedPage::VmCompressedPage(uint64_t offset, mxtl::unique_ptr<uint8_t[]> data, size_t size)
+    : offset_(offset), size_(size), data_(mxtl::move(data)) {
+    compressed_pages.fetch_add(1);
+    compressed_bytes.fetch_add(size_);
+    compression_count.fetch_add(1);
+}
+
+VmCompressedPage::~VmCompressedPage() {
+    compressed_pages.fetch_sub(1);
+    compressed_bytes.fetch_sub(size_);
+}
+
+mxtl::unique_ptr<VmCompressedPage> VmCompressedPage::Create(paddr_t pa, uint64_t offset) {
+    const char* src = static_cast<const char*>(paddr_to_kvaddr(pa));
+    DEBUG_ASSERT(src);
+
+    AllocChecker ac;
+    mxtl::unique_ptr<uint8_t[]> data;
+    size_t size;
+    {
+        AutoLock a(&compress_lock);
+
+        int ret = LZ4_compress_fast_extState(&compress_state, src, compress_buffer,
+                                             PAGE_SIZE, sizeof(compress_buffer), 1);
+        if (ret <= 0) {
+            incompressible_count.fetch_add(1);
+            return nullptr;
+        }
+        size = ret;
+
+        data.reset(new (&ac) uint8_t[size]);
+        if (!ac.check())
+            return nullptr;
+        memcpy(data.get(), compress_buffer, size);
+    }
+
+    mxtl::unique_ptr<VmCompressedPage> page(
+        new (&ac) VmCompressedPage(offset, mxtl::move(data), size));
+    if (!ac.check())
+        return nullptr;
+
+    LTRACEF("compressed pa %#" PRIxPTR " to %zu bytes\n", pa, size);
+    return page;
+}
+
+void VmCompressedPage::Decompress(paddr_t pa) const {
+    char* dst = static_cast<char*>(paddr_to_kvaddr(pa));
+    DEBUG_ASSERT(dst);
+
+    int ret = LZ4_decompress_safe(reinterpret_cast<const char*>(data_.get()), dst,
+                                  static_cast<int>(size_), PAGE_SIZE);
+    // The data never leaves the kernel, so this can only fail if it has been
+    // corrupted.
+    ASSERT_MSG(ret == PAGE_SIZE, "failed to decompress page at offset %#" PRIx64 ": %d\n",
+               offset_, ret);
+    decompression_count.fetch_add(1);
+}
+
+size_t page_compressor_scan(size_t max_pages) {
+    AutoLock a(&scan_lock);
+
+    // Operate on the VMOs without holding the global VMO list lock, holding
+    // a reference to the last one to continue from.
+    mxtl::RefPtr<VmObject> last;
+    mxtl::RefPtr<VmObject> batch[kScanBatch];
+    size_t compressed = 0;
+    for (;;) {
+        size_t count = VmObject::GetVmoRefs(last.get(), batch, kScanBatch);
+        if (count == 0)
+            break;
+
+        for (size_t i = 0; i < count; i++) {
+            // Keep going once max_pages are compressed, so that every page is
+            // aged by every scan.
+            compressed += batch[i]->ReclaimPages(max_pages - compressed);
+        }
+
+        // Release these references before taking the list lock again: if the
+        // last one is dropped, the destructor takes the list lock.
+        last = batch[count - 1];
+        for (size_t i = 0; i < count; i++) {
+            batch[i].reset();
+        }
+    }
+
+    LTRACEF("compressed %zu pages\n", compressed);
+    return compressed;
+}
+
+static size_t free_pages_locked() TA_REQ(reclaim_lock) {
+    size_t free_pages = pmm_count_free_pages();
+    if (memory_limit_pages == 0)
+        return free_pages;
+
+    size_t used_pages = pmm_count_total_bytes() / PAGE_SIZE - free_pages;
+    if (used_pages >= memory_limit_pages)
+        return 0;
+    return mxtl::min(free_pages, memory_limit_pages - used_pages);
+}
+
+size_t page_compressor_reclaim_step() {
+    size_t target;
+    {
+        AutoLock a(&reclaim_lock);
+
+        size_t free_pages = free_pages_locked();
+        if (free_pages < low_watermark_pages) {
+            reclaiming = true;
+        } else if (free_pages >= high_watermark_pages) {
+            reclaiming = false;
+        }
+        if (!reclaiming)
+            return 0;
+        target = high_watermark_pages - free_pages;
+    }
+
+    return page_compressor_scan(target);
+}
+
+void page_compressor_set_memory_limit(size_t bytes) {
+    AutoLock a(&reclaim_lock);
+    memory_limit_pages = bytes / PAGE_SIZE;
+}
+
+static int page_compressor_thread(void* arg) {
+    const lk_time_t interval = *static_cast<lk_time_t*>(arg);
+    for (;;) {
+        page_compressor_reclaim_step();
+        // Pages in use are looked up again between scans, so that only the
+        // ones left alone for several intervals are compressed.
+        thread_sleep_relative(interval);
+    }
+    return 0;
+}
+
+static void page_compressor_init(uint level) {
+    {
+        AutoLock a(&reclaim_lock);
+        // Be sure to update kernel_cmdline.md if any of these defaults change.
+        low_watermark_pages = cmdline_get_uint64("kernel.compressor.low-mb", 64) * MB / PAGE_SIZE;
+        high_watermark_pages = cmdline_get_uint64("kernel.compressor.high-mb", 96) * MB / PAGE_SIZE;
+        high_watermark_pages = mxtl::max(high_watermark_pages, low_watermark_pages);
+        memory_limit_pages =
+            cmdline_get_uint64("kernel.compressor.memory-limit-mb", 0) * MB / PAGE_SIZE;
+    }
+
+    if (!cmdline_get_bool("kernel.compressor.enable", false))
+        return;
+
+    static lk_time_t interval;
+    interval = LK_MSEC(cmdline_get_uint64("kernel.compressor.interval-ms", 500));
+    thread_t* t = thread_create("page compressor", &page_compressor_thread, &interval,
+                                LOW_PRIORITY, DEFAULT_STACK_SIZE);
+    if (t)
+        thread_detach_and_resume(t);
+}
+
+LK_INIT_HOOK(page_compressor, &page_compressor_init, LK_INIT_LEVEL_THREADING);
+
+static int cmd_compressor(int argc, const cmd_args* argv, uint32_t flags) {
+    if (argc < 2) {
+        printf("not enough arguments\n");
+    usage:
+        printf("usage:\n");
+        printf("%s info         : dump compressor state and statistics\n", argv[0].str);
+        printf("%s scan         : age every page and compress the cold ones, once\n", argv[0].str);
+        printf("%s limit <MB>   : act as if there were only this much memory (0 for all)\n",
+               argv[0].str);
+        return MX_ERR_INTERNAL;
+    }
+
+    if (!strcmp(argv[1].str, "info")) {
+        char buf[MAX_FORMAT_SIZE_LEN];
+        {
+            AutoLock a(&reclaim_lock);
+            printf("free pages %zu, watermarks low %zu high %zu, limit %zu pages%s\n",
+                   free_pages_locked(), low_watermark_pages, high_watermark_pages,
+                   memory_limit_pages, reclaiming ? ", reclaiming" : "");
+        }
+        format_size(buf, sizeof(buf), compressed_bytes.load());
+        printf("%zu pages compressed into %s\n", compressed_pages.load(), buf);
+        printf("%" PRIu64 " compressions, %" PRIu64 " decompressions, %" PRIu64 " incompressible\n",
+               compression_count.load(), decompression_count.load(), incompressible_count.load());
+    } else if (!strcmp(argv[1].str, "scan")) {
+        printf("compressed %zu pages\n", page_compressor_scan(SIZE_MAX));
+    } else if (!strcmp(argv[1].str, "limit")) {
+        if (argc < 3) {
+            printf("not enough arguments\n");
+            goto usage;
+        }
+        page_compressor_set_memory_limit(argv[2].u * MB);
+    } else {
+        printf("unknown command\n");
+        goto usage;
+    }
+
+    return MX_OK;
+}
+
+STATIC_COMMAND_START
+#if LK_DEBUGLEVEL > 0
+STATIC_COMMAND("compressor", "compressed memory debug commands", &cmd_compressor)
+#endif
+STATIC_COMMAND_END(compressor);
@@ -10,9 +10,12 @@
 #include <assert.h>
 #include <err.h>
 #include <inttypes.h>
+#include <arch/ops.h>
 #include <kernel/auto_lock.h>
+#include <kernel/event.h>
 #include <kernel/mp.h>
 #include <kernel/mutex.h>
+#include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <kernel/vm.h>
 #include <lib/console.h>
@@ -33,11 +36,23 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+LOCKSTAT_CLASS_DEFINE(pmm, "pmm");
+
 // the main arena list
-static Mutex arena_lock;
+static Mutex arena_lock(LOCKSTAT_CLASS(pmm));
 static mxtl::DoublyLinkedList<PmmArena*> arena_list TA_GUARDED(arena_lock);
 static size_t arena_cumulative_size TA_GUARDED(arena_lock);
 
+// Free pages are zeroed in the background by a low priority thread, so that
+// PMM_ALLOC_FLAG_ZEROED allocations (such as for page faults) usually do not
+// have to. The thread stops once this many free pages are zeroed.
+static const size_t kZeroPoolTarget = 16384;
+
+static event_t zero_event = EVENT_INITIAL_VALUE(zero_event, false, EVENT_FLAG_AUTOUNSIGNAL);
+// True while the zeroing thread is waiting for work.
+static bool zero_thread_waiting TA_GUARDED(arena_lock) = false;
+static bool zero_pool_enabled TA_GUARDED(arena_lock) = !PMM_ENABLE_FREE_FILL;
+
 #if PMM_ENABLE_FREE_FILL
 static void pmm_enforce_fill(uint level) {
     for (auto& a : arena_list) {
@@ -108,25 +123,70 @@ done_add:
     return MX_OK;
 }
 
-vm_page_t* pmm_alloc_page(uint alloc_flags, paddr_t* pa) {
-    AutoLock al(&arena_lock);
+static size_t pmm_count_zeroed_pages_locked() TA_REQ(arena_lock) {
+    size_t zeroed = 0u;
+    for (const auto& a : arena_list) {
+        zeroed += a.zeroed_count();
+    }
+    return zeroed;
+}
 
-    /* walk the arenas in order until we find one with a free page */
-    for (auto& a : arena_list) {
-        /* skip the arena if it's not KMAP and the KMAP only allocation flag was passed */
-        if (alloc_flags & PMM_ALLOC_FLAG_KMAP) {
-            if ((a.flags() & PMM_ARENA_FLAG_KMAP) == 0)
-                continue;
+// Wakes the zeroing thread if it is idle and there is work for it to do.
+static void pmm_zero_pool_kick_locked() TA_REQ(arena_lock) {
+    if (zero_thread_waiting && zero_pool_enabled &&
+        (pmm_count_zeroed_pages_locked() < kZeroPoolTarget)) {
+        zero_thread_waiting = false;
+        event_signal(&zero_event, false);
+    }
+}
+
+// Finishes a PMM_ALLOC_FLAG_ZEROED allocation, outside the arena lock:
+// zeroes the page if it did not come from the zero pool.
+static void pmm_zero_allocated_page(vm_page_t* page, paddr_t pa) {
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+        page->flags &= ~VM_PAGE_FLAG_ZEROED;
+        return;
+    }
+    void* ptr = paddr_to_kvaddr(pa);
+    DEBUG_ASSERT(ptr);
+    arch_zero_page(ptr);
+}
+
+vm_page_t* pmm_alloc_page(uint alloc_flags, paddr_t* _pa) {
+    const bool zeroed = alloc_flags & PMM_ALLOC_FLAG_ZEROED;
+    vm_page_t* page = nullptr;
+    paddr_t pa;
+    {
+        AutoLock al(&arena_lock);
+
+        /* walk the arenas in order until we find one with a free page */
+        for (auto& a : arena_list) {
+            /* skip the arena if it's not KMAP and the KMAP only allocation flag was passed */
+            if (alloc_flags & PMM_ALLOC_FLAG_KMAP) {
+                if ((a.flags() & PMM_ARENA_FLAG_KMAP) == 0)
+                    continue;
+            }
+
+            // try to allocate the page out of the arena
+            page = a.AllocPage(&pa, zeroed && zero_pool_enabled);
+            if (page)
+                break;
         }
 
-        // try to allocate the page out of the arena
-        vm_page_t* page = a.AllocPage(pa);
-        if (page)
-            return page;
+        if (!page) {
+            LTRACEF("failed to allocate page\n");
+            return nullptr;
+        }
+
+        if (page->flags & VM_PAGE_FLAG_ZEROED)
+            pmm_zero_pool_kick_locked();
     }
 
-    LTRACEF("failed to allocate page\n");
-    return nullptr;
+    if (zeroed)
+        pmm_zero_allocated_page(page, pa);
+    if (_pa)
+        *_pa = pa;
+    return page;
 }
 
 size_t pmm_alloc_pages(size_t count, uint alloc_flags, struct list_node* list) {
@@ -138,24 +198,40 @@ size_t pmm_alloc_pages(size_t count, uint alloc_flags, struct list_node* list) {
     if (count == 0)
         return 0;
 
-    AutoLock al(&arena_lock);
+    const bool zeroed = alloc_flags & PMM_ALLOC_FLAG_ZEROED;
 
-    /* walk the arenas in order, allocating as many pages as we can from each */
+    // Remember where the new pages start, in case they have to be zeroed.
+    list_node* prev_tail = list->prev;
     size_t allocated = 0;
-    for (auto& a : arena_list) {
-        DEBUG_ASSERT(count > allocated);
+    {
+        AutoLock al(&arena_lock);
 
-        /* skip the arena if it's not KMAP and the KMAP only allocation flag was passed */
-        if (alloc_flags & PMM_ALLOC_FLAG_KMAP) {
-            if ((a.flags() & PMM_ARENA_FLAG_KMAP) == 0)
-                continue;
+        /* walk the arenas in order, allocating as many pages as we can from each */
+        for (auto& a : arena_list) {
+            DEBUG_ASSERT(count > allocated);
+
+            /* skip the arena if it's not KMAP and the KMAP only allocation flag was passed */
+            if (alloc_flags & PMM_ALLOC_FLAG_KMAP) {
+                if ((a.flags() & PMM_ARENA_FLAG_KMAP) == 0)
+                    continue;
+            }
+
+            // ask the arena to allocate some pages
+            allocated += a.AllocPages(count - allocated, list, zeroed && zero_pool_enabled);
+            DEBUG_ASSERT(allocated <= count);
+            if (allocated == count)
+                break;
         }
 
-        // ask the arena to allocate some pages
-        allocated += a.AllocPages(count - allocated, list);
-        DEBUG_ASSERT(allocated <= count);
-        if (allocated == count)
-            break;
+        if (zeroed)
+            pmm_zero_pool_kick_locked();
+    }
+
+    if (zeroed) {
+        for (list_node* node = prev_tail->next; node != list; node = node->next) {
+            vm_page_t* p = containerof(node, vm_page_t, free.node);
+            pmm_zero_allocated_page(p, vm_page_to_paddr(p));
+        }
     }
 
     return allocated;
@@ -313,6 +389,8 @@ size_t pmm_free(struct list_node* list) {
         }
     }
 
+    pmm_zero_pool_kick_locked();
+
     LTRACEF("returning count %u\n", count);
 
     return count;
@@ -340,9 +418,72 @@ size_t pmm_count_free_pages() {
     return pmm_count_free_pages_locked();
 }
 
+size_t pmm_count_zeroed_pages() {
+    AutoLock al(&arena_lock);
+    return pmm_count_zeroed_pages_locked();
+}
+
+void pmm_set_zero_pool_enabled(bool enabled) {
+    AutoLock al(&arena_lock);
+    zero_pool_enabled = enabled && !PMM_ENABLE_FREE_FILL;
+    pmm_zero_pool_kick_locked();
+}
+
+// Takes a dirty free page to zero, if the zero pool wants one.
+static vm_page_t* pmm_take_dirty_page_locked(PmmArena** arena) TA_REQ(arena_lock) {
+    if (!zero_pool_enabled || (pmm_count_zeroed_pages_locked() >= kZeroPoolTarget))
+        return nullptr;
+    for (auto& a : arena_list) {
+        // Pages are zeroed through the kernel's physical map.
+        if ((a.flags() & PMM_ARENA_FLAG_KMAP) == 0)
+            continue;
+        vm_page_t* page = a.TakeDirtyPage();
+        if (page) {
+            *arena = &a;
+            return page;
+        }
+    }
+    return nullptr;
+}
+
+static int pmm_zero_thread(void*) {
+    for (;;) {
+        PmmArena* arena = nullptr;
+        vm_page_t* page;
+        {
+            AutoLock al(&arena_lock);
+            page = pmm_take_dirty_page_locked(&arena);
+            if (!page)
+                zero_thread_waiting = true;
+        }
+        if (!page) {
+            event_wait(&zero_event);
+            continue;
+        }
+
+        // Avoid evicting useful data from the cache for a page which may not
+        // be used for a while.
+        arch_zero_page_nontemporal(paddr_to_kvaddr(arena->page_address_from_arena(page)));
+
+        AutoLock al(&arena_lock);
+        arena->ReturnZeroedPage(page);
+    }
+    return 0;
+}
+
+static void pmm_zero_pool_init(uint level) {
+    // Run only when nothing but the idle thread would.
+    thread_t* t = thread_create("pmm zero", &pmm_zero_thread, nullptr, LOWEST_PRIORITY + 1,
+                                DEFAULT_STACK_SIZE);
+    if (t)
+        thread_detach_and_resume(t);
+}
+LK_INIT_HOOK(pmm_zero_pool, &pmm_zero_pool_init, LK_INIT_LEVEL_THREADING);
+
 static void pmm_dump_free() TA_REQ(arena_lock) {
     auto megabytes_free = pmm_count_free_pages_locked() / 256u;
-    printf(" %zu free MBs\n", megabytes_free);
+    auto megabytes_zeroed = pmm_count_zeroed_pages_locked() / 256u;
+    printf(" %zu free MBs (%zu zeroed)\n", megabytes_free, megabytes_zeroed);
 }
 
 static size_t pmm_count_total_bytes_locked() TA_REQ(arena_lock) {
@@ -70,22 +70,48 @@ void PmmArena::BootAllocArray() {
     free_count_ += page_count;
 }
 
-vm_page_t* PmmArena::AllocPage(paddr_t* pa) {
-    vm_page_t* page = list_remove_head_type(&free_list_, vm_page_t, free.node);
+// Removes a page from the free lists, trying the zeroed list first if
+// |zeroed| is set and the other list first if not.
+vm_page_t* PmmArena::TakeFreePage(bool zeroed) {
+    list_node* first = zeroed ? &zeroed_list_ : &free_list_;
+    list_node* second = zeroed ? &free_list_ : &zeroed_list_;
+
+    vm_page_t* page = list_remove_head_type(first, vm_page_t, free.node);
+    if (!page)
+        page = list_remove_head_type(second, vm_page_t, free.node);
     if (!page)
         return nullptr;
 
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+        DEBUG_ASSERT(zeroed_count_ > 0);
+        zeroed_count_--;
+        if (!zeroed)
+            page->flags &= ~VM_PAGE_FLAG_ZEROED;
+    }
+    return page;
+}
+
+// Updates the accounting for a page which has been removed from a free list.
+void PmmArena::MarkAllocated(vm_page_t* page) {
     DEBUG_ASSERT(free_count_ > 0);
 
     free_count_--;
 
     DEBUG_ASSERT(page_is_free(page));
-
-    page->state = VM_PAGE_STATE_ALLOC;
 #if PMM_ENABLE_FREE_FILL
     CheckFreeFill(page);
 #endif
 
+    page->state = VM_PAGE_STATE_ALLOC;
+}
+
+vm_page_t* PmmArena::AllocPage(paddr_t* pa, bool zeroed) {
+    vm_page_t* page = TakeFreePage(zeroed);
+    if (!page)
+        return nullptr;
+
+    MarkAllocated(page);
+
     if (pa) {
         /* compute the physical address of the page based on its offset into the arena */
         *pa = page_address_from_arena(page);
@@ -112,36 +138,27 @@ vm_page_t* PmmArena::AllocSpecific(paddr_t pa) {
     }
 
     list_delete(&page->free.node);
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+        zeroed_count_--;
+        page->flags &= ~VM_PAGE_FLAG_ZEROED;
+    }
 
-    page->state = VM_PAGE_STATE_ALLOC;
-
-    DEBUG_ASSERT(free_count_ > 0);
-
-    free_count_--;
+    MarkAllocated(page);
 
     return page;
 }
 
-size_t PmmArena::AllocPages(size_t count, list_node* list) {
+size_t PmmArena::AllocPages(size_t count, list_node* list, bool zeroed) {
     size_t allocated = 0;
 
     while (allocated < count) {
-        vm_page_t* page = list_remove_head_type(&free_list_, vm_page_t, free.node);
+        vm_page_t* page = TakeFreePage(zeroed);
         if (!page)
             return allocated;
 
         LTRACEF("allocating page %p, pa %#" PRIxPTR "\n", page, page_address_from_arena(page));
 
-        DEBUG_ASSERT(free_count_ > 0);
-
-        free_count_--;
-
-        DEBUG_ASSERT(page_is_free(page));
-#if PMM_ENABLE_FREE_FILL
-        CheckFreeFill(page);
-#endif
-
-        page->state = VM_PAGE_STATE_ALLOC;
+        MarkAllocated(page);
         list_add_tail(list, &page->free.node);
 
         allocated++;
@@ -192,15 +209,12 @@ retry:
             DEBUG_ASSERT(list_in_list(&p->free.node));
 
             list_delete(&p->free.node);
-            p->state = VM_PAGE_STATE_ALLOC;
-
-            DEBUG_ASSERT(free_count_ > 0);
-
-            free_count_--;
+            if (p->flags & VM_PAGE_FLAG_ZEROED) {
+                zeroed_count_--;
+                p->flags &= ~VM_PAGE_FLAG_ZEROED;
+            }
 
-#if PMM_ENABLE_FREE_FILL
-            CheckFreeFill(p);
-#endif
+            MarkAllocated(p);
 
             if (list)
                 list_add_tail(list, &p->free.node);
@@ -227,12 +241,36 @@ status_t PmmArena::FreePage(vm_page_t* page) {
 #endif
 
     page->state = VM_PAGE_STATE_FREE;
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
 
     list_add_head(&free_list_, &page->free.node);
     free_count_++;
     return MX_OK;
 }
 
+vm_page_t* PmmArena::TakeDirtyPage() {
+    // Take the least recently freed page, which is the least likely to
+    // still be in the cache.
+    vm_page_t* page = list_remove_tail_type(&free_list_, vm_page_t, free.node);
+    if (!page)
+        return nullptr;
+
+    MarkAllocated(page);
+    return page;
+}
+
+void PmmArena::ReturnZeroedPage(vm_page_t* page) {
+    DEBUG_ASSERT(page_belongs_to_arena(page));
+    DEBUG_ASSERT(page->state == VM_PAGE_STATE_ALLOC);
+
+    page->state = VM_PAGE_STATE_FREE;
+    page->flags |= VM_PAGE_FLAG_ZEROED;
+
+    list_add_tail(&zeroed_list_, &page->free.node);
+    free_count_++;
+    zeroed_count_++;
+}
+
 void PmmArena::CountStates(size_t state_count[_VM_PAGE_STATE_COUNT]) const {
     for (size_t i = 0; i < size() / PAGE_SIZE; i++) {
         state_count[page_array_[i].state]++;
@@ -243,7 +281,8 @@ void PmmArena::Dump(bool dump_pages, bool dump_free_ranges) {
     char pbuf[16];
     printf("arena %p: name '%s' base %#" PRIxPTR " size %s (0x%zx) priority %u flags 0x%x\n", this, name(), base(),
            format_size(pbuf, sizeof(pbuf), size()), size(), priority(), flags());
-    printf("\tpage_array %p, free_count %zu\n", page_array_, free_count_);
+    printf("\tpage_array %p, free_count %zu, zeroed_count %zu\n", page_array_, free_count_,
+           zeroed_count_);
 
     /* dump all of the pages */
     if (dump_pages) {
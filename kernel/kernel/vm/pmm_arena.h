@@ -38,6 +38,7 @@ public:
     unsigned int flags() const { return info_.flags; }
     unsigned int priority() const { return info_.priority; }
     size_t free_count() const { return free_count_; };
+    size_t zeroed_count() const { return zeroed_count_; };
 
     // Counts the number of pages in every state. For each page in the arena,
     // increments the corresponding VM_PAGE_STATE_*-indexed entry of
@@ -47,12 +48,20 @@ public:
     vm_page_t* get_page(size_t index) { return &page_array_[index]; }
 
     // main allocation routines
-    vm_page_t* AllocPage(paddr_t* pa);
+    // If |zeroed| is true, zeroed pages are preferred and are returned with
+    // VM_PAGE_FLAG_ZEROED set; otherwise the flag is always clear.
+    vm_page_t* AllocPage(paddr_t* pa, bool zeroed);
     vm_page_t* AllocSpecific(paddr_t pa);
-    size_t AllocPages(size_t count, list_node* list);
+    size_t AllocPages(size_t count, list_node* list, bool zeroed);
     size_t AllocContiguous(size_t count, uint8_t alignment_log2, paddr_t* pa, struct list_node* list);
     status_t FreePage(vm_page_t* page);
 
+    // Removes a free page which is not known to be zeroed, for it to be zeroed
+    // without holding the arena lock. The page is returned with
+    // ReturnZeroedPage().
+    vm_page_t* TakeDirtyPage();
+    void ReturnZeroedPage(vm_page_t* page);
+
     // helpers
     bool page_belongs_to_arena(const vm_page* page) const {
         uintptr_t page_addr = reinterpret_cast<uintptr_t>(page);
@@ -74,6 +83,9 @@ public:
     }
 
 private:
+    vm_page_t* TakeFreePage(bool zeroed);
+    void MarkAllocated(vm_page_t* page);
+
 #if PMM_ENABLE_FREE_FILL
     void FreeFill(vm_page_t* page);
     void CheckFreeFill(vm_page_t* page);
@@ -82,8 +94,12 @@ private:
     const pmm_arena_info_t info_;
     vm_page_t* page_array_ = nullptr;
 
+    // Free pages are on one of two lists, depending on whether they are
+    // known to be zeroed. free_count_ includes both.
     size_t free_count_ = 0;
     list_node free_list_ = LIST_INITIAL_VALUE(free_list_);
+    size_t zeroed_count_ = 0;
+    list_node zeroed_list_ = LIST_INITIAL_VALUE(zeroed_list_);
 
 #if PMM_ENABLE_FREE_FILL
     bool enforce_fill_ = false;
@@ -13,11 +13,13 @@ MODULE_DEPS += \
     kernel/lib/mxtl \
     kernel/lib/pretty \
     kernel/lib/user_copy \
-    third_party/lib/cryptolib
+    third_party/lib/cryptolib \
+    third_party/lib/lz4
 
 MODULE_SRCS += \
     $(LOCAL_DIR)/bootalloc.cpp \
     $(LOCAL_DIR)/page.cpp \
+    $(LOCAL_DIR)/page_compressor.cpp \
     $(LOCAL_DIR)/pmm.cpp \
     $(LOCAL_DIR)/pmm_arena.cpp \
     $(LOCAL_DIR)/vm.cpp \
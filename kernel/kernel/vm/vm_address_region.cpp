@@ -233,7 +233,8 @@ status_t VmAddressRegion::CreateVmMapping(size_t mapping_offset, size_t size, ui
     LTRACEF("%p %#zx %#zx %x\n", this, mapping_offset, size, vmar_flags);
 
     // Check that only allowed flags have been set
-    if (vmar_flags & ~(VMAR_FLAG_SPECIFIC | VMAR_FLAG_SPECIFIC_OVERWRITE | VMAR_CAN_RWX_FLAGS)) {
+    if (vmar_flags & ~(VMAR_FLAG_SPECIFIC | VMAR_FLAG_SPECIFIC_OVERWRITE | VMAR_FLAG_LARGE_PAGES |
+                       VMAR_CAN_RWX_FLAGS)) {
         return MX_ERR_INVALID_ARGS;
     }
 
@@ -403,6 +403,30 @@ status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
     currently_faulting_ = true;
     auto ac = mxtl::MakeAutoCall([&]() { currently_faulting_ = false; });
 
+    // pages are mapped in physically contiguous runs if the mapping allows
+    // large pages, and one at a time otherwise
+    const bool coalesce = (flags_ & VMAR_FLAG_LARGE_PAGES) != 0;
+    vaddr_t run_va = 0;
+    paddr_t run_pa = 0;
+    size_t run_count = 0;
+    auto map_run = [&]() {
+        if (run_count == 0)
+            return;
+
+        LTRACEF_LEVEL(2, "mapping pa %#" PRIxPTR " to va %#" PRIxPTR " count %zu\n",
+                      run_pa, run_va, run_count);
+
+        size_t mapped;
+        auto ret = aspace_->arch_aspace().Map(run_va, run_pa, run_count, arch_mmu_flags_, &mapped);
+        if (ret < 0) {
+            TRACEF("error %d mapping %zu pages at va %#" PRIxPTR " pa %#" PRIxPTR "\n",
+                   ret, run_count, run_va, run_pa);
+        }
+
+        DEBUG_ASSERT(mapped == run_count);
+        run_count = 0;
+    };
+
     // iterate through the range, grabbing a page from the underlying object and
     // mapping it in
     size_t o;
@@ -413,6 +437,7 @@ status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
         paddr_t pa;
         status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, nullptr, &pa);
         if (status < 0) {
+            map_run();
             // no page to map
             if (commit) {
                 // fail when we can't commit every requested page
@@ -424,16 +449,18 @@ status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
         }
 
         vaddr_t va = base_ + o;
-        LTRACEF_LEVEL(2, "mapping pa %#" PRIxPTR " to va %#" PRIxPTR "\n", pa, va);
-
-        size_t mapped;
-        auto ret = aspace_->arch_aspace().Map(va, pa, 1, arch_mmu_flags_, &mapped);
-        if (ret < 0) {
-            TRACEF("error %d mapping page at va %#" PRIxPTR " pa %#" PRIxPTR "\n", ret, va, pa);
+        if (coalesce && run_count > 0 &&
+            va == run_va + run_count * PAGE_SIZE && pa == run_pa + run_count * PAGE_SIZE) {
+            run_count++;
+            continue;
         }
 
-        DEBUG_ASSERT(mapped == 1);
+        map_run();
+        run_va = va;
+        run_pa = pa;
+        run_count = 1;
     }
+    map_run();
 
     return MX_OK;
 }
@@ -30,12 +30,6 @@ VmObject::VmObject(mxtl::RefPtr<VmObject> parent)
     : lock_(parent ? parent->lock_ref() : local_lock_),
       parent_(mxtl::move(parent)) {
     LTRACEF("%p\n", this);
-
-    // Add ourself to the global VMO list, newer VMOs at the end.
-    {
-        AutoLock a(&all_vmos_lock_);
-        all_vmos_.push_back(this);
-    }
 }
 
 VmObject::~VmObject() {
@@ -60,12 +54,32 @@ VmObject::~VmObject() {
     DEBUG_ASSERT(mapping_list_.is_empty());
     DEBUG_ASSERT(children_list_.is_empty());
 
-    // Remove ourself from the global VMO list.
+    // Remove ourself from the global VMO list, if we made it on.
     {
         AutoLock a(&all_vmos_lock_);
-        DEBUG_ASSERT(global_list_state_.InContainer() == true);
+        if (global_list_state_.InContainer()) {
+            all_vmos_.erase(*this);
+        }
+    }
+}
+
+void VmObject::AddToGlobalList() {
+    AutoLock a(&all_vmos_lock_);
+    DEBUG_ASSERT(!global_list_state_.InContainer());
+    // Newer VMOs at the end.
+    all_vmos_.push_back(this);
+}
+
+bool VmObject::RemoveFromGlobalListIfUnshared() {
+    // GetVmoRefs() only takes new references under this lock.
+    AutoLock a(&all_vmos_lock_);
+    if (ref_count_debug() != 1) {
+        return false;
+    }
+    if (global_list_state_.InContainer()) {
         all_vmos_.erase(*this);
     }
+    return true;
 }
 
 void VmObject::get_name(char *out_name, size_t len) const {
@@ -106,12 +120,38 @@ uint64_t VmObject::parent_user_id() const {
     return parent->user_id();
 }
 
+size_t VmObject::GetVmoRefs(VmObject* after, mxtl::RefPtr<VmObject>* refs, size_t max) {
+    AutoLock a(&all_vmos_lock_);
+    // |after| can not leave the list while the caller holds a reference to it.
+    auto iter = after ? ++all_vmos_.make_iterator(*after) : all_vmos_.begin();
+    size_t count = 0;
+    for (; iter.IsValid() && count < max; ++iter) {
+        // Skip VMOs which are being destroyed.
+        refs[count] = mxtl::MakeRefPtrUpgradeFromRaw(&*iter);
+        if (refs[count]) {
+            count++;
+        }
+    }
+    return count;
+}
+
 bool VmObject::is_cow_clone() const {
     canary_.Assert();
     AutoLock a(&lock_);
     return parent_ != nullptr;
 }
 
+uint32_t VmObject::CowChainDepth() {
+    canary_.Assert();
+    AutoLock a(&lock_);
+    // Every object in a clone tree shares the lock of its root.
+    uint32_t depth = 0;
+    for (const VmObject* o = parent_.get(); o != nullptr; o = o->parent_.get()) {
+        depth++;
+    }
+    return depth;
+}
+
 void VmObject::AddMappingLocked(VmMapping* r) {
     canary_.Assert();
     DEBUG_ASSERT(lock_.IsHeld());
@@ -19,6 +19,7 @@
 #include <lib/console.h>
 #include <lib/user_copy.h>
 #include <mxalloc/new.h>
+#include <mxtl/algorithm.h>
 #include <safeint/safe_math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,6 +29,12 @@
 
 namespace {
 
+// Ages of pages, in reclaim scans since they were last looked up. A page is
+// unmapped when it reaches kPageAgeUnmapped, so that its next use faults and
+// resets its age, and may be compressed once it reaches kPageAgeCold.
+constexpr uint8_t kPageAgeUnmapped = 2;
+constexpr uint8_t kPageAgeCold = 3;
+
 void ZeroPage(paddr_t pa) {
     void* ptr = paddr_to_kvaddr(pa);
     DEBUG_ASSERT(ptr);
@@ -45,6 +52,7 @@ void InitializeVmPage(vm_page_t* p) {
     p->state = VM_PAGE_STATE_OBJECT;
     p->object.pin_count = 0;
     p->object.contiguous_pin = 0;
+    p->object.age = 0;
 }
 
 } // namespace
@@ -70,6 +78,7 @@ VmObjectPaged::~VmObjectPaged() {
 
     // free all of the pages attached to us
     page_list_.FreeAllPages();
+    compressed_pages_.clear();
 }
 
 mx_status_t VmObjectPaged::Create(uint32_t pmm_alloc_flags, uint64_t size, mxtl::RefPtr<VmObject>* obj) {
@@ -78,9 +87,10 @@ mx_status_t VmObjectPaged::Create(uint32_t pmm_alloc_flags, uint64_t size, mxtl:
         return MX_ERR_INVALID_ARGS;
 
     AllocChecker ac;
-    auto vmo = mxtl::AdoptRef<VmObject>(new (&ac) VmObjectPaged(pmm_alloc_flags, nullptr));
+    auto vmo = mxtl::AdoptRef<VmObjectPaged>(new (&ac) VmObjectPaged(pmm_alloc_flags, nullptr));
     if (!ac.check())
         return MX_ERR_NO_MEMORY;
+    vmo->AddToGlobalList();
 
     auto err = vmo->Resize(size);
     if (err != MX_OK)
@@ -100,6 +110,7 @@ status_t VmObjectPaged::CloneCOW(uint64_t offset, uint64_t size, bool copy_name,
     auto vmo = mxtl::AdoptRef<VmObjectPaged>(new (&ac) VmObjectPaged(pmm_alloc_flags_, mxtl::WrapRefPtr(this)));
     if (!ac.check())
         return MX_ERR_NO_MEMORY;
+    vmo->AddToGlobalList();
 
     AutoLock a(&lock_);
 
@@ -142,8 +153,8 @@ void VmObjectPaged::Dump(uint depth, bool verbose) {
         printf("  ");
     }
     printf("vmo %p/k%" PRIu64 " size %#" PRIx64
-           " pages %zu ref %d parent k%" PRIu64 "\n",
-           this, user_id_, size_, count, ref_count_debug(), parent_id);
+           " pages %zu compressed %zu ref %d parent k%" PRIu64 "\n",
+           this, user_id_, size_, count, compressed_pages_.size(), ref_count_debug(), parent_id);
 
     if (verbose) {
         auto f = [depth](const auto p, uint64_t offset) {
@@ -263,7 +274,8 @@ mx_status_t VmObjectPaged::CreateFromROData(const void* data, size_t size, mxtl:
 // this VMO has a parent and the requested page isn't found, the parent will be searched.
 //
 // |free_list|, if not NULL, is a list of allocated but unused vm_page_t that
-// this function may allocate from.  This function will need at most one entry,
+// this function may allocate from.  The pages must have been allocated with
+// PMM_ALLOC_FLAG_ZEROED.  This function will need at most one entry,
 // and will not fail if |free_list| is a non-empty list, faulting in was requested,
 // and offset is in range.
 status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
@@ -280,6 +292,7 @@ status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node*
     // see if we already have a page at that offset
     p = page_list_.GetPage(offset);
     if (p) {
+        p->object.age = 0;
         if (page_out)
             *page_out = p;
         if (pa_out)
@@ -291,8 +304,21 @@ status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node*
     LTRACEF("vmo %p, offset %#" PRIx64 ", pf_flags %#x (%s)\n", this, offset, pf_flags,
             vmm_pf_flags_to_string(pf_flags, pf_string));
 
-    // if we have a parent see if they have a page for us
+    // the page may have been compressed, in which case it's ours regardless
+    // of the fault flags
+    if (!compressed_pages_.is_empty()) {
+        status_t status = DecompressPageLocked(offset, free_list, page_out, pa_out);
+        if (status != MX_ERR_NOT_FOUND)
+            return status;
+    }
+
+    // a miss searches the whole chain of parents, so shorten it if we can
     if (parent_) {
+        CollapseParentsLocked();
+    }
+
+    // if we have a parent see if they have a page for us
+    if (parent_ && offset < parent_limit_) {
         safeint::CheckedNumeric<uint64_t> parent_offset = parent_offset_;
         parent_offset += offset;
         DEBUG_ASSERT(parent_offset.IsValid());
@@ -373,7 +399,7 @@ status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node*
         return MX_OK;
     }
 
-    // allocate a page
+    // allocate a zeroed page; pages on |free_list| were allocated zeroed too
     if (free_list) {
         p = list_remove_head_type(free_list, vm_page_t, free.node);
         if (p) {
@@ -381,7 +407,7 @@ status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node*
         }
     }
     if (!p) {
-        p = pmm_alloc_page(pmm_alloc_flags_, &pa);
+        p = pmm_alloc_page(pmm_alloc_flags_ | PMM_ALLOC_FLAG_ZEROED, &pa);
     }
     if (!p) {
         return MX_ERR_NO_MEMORY;
@@ -389,9 +415,6 @@ status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node*
 
     InitializeVmPage(p);
 
-    // TODO: remove once pmm returns zeroed pages
-    ZeroPage(pa);
-
     status_t status = AddPageLocked(p, offset);
     DEBUG_ASSERT(status == MX_OK);
 
@@ -453,7 +476,7 @@ status_t VmObjectPaged::CommitRange(uint64_t offset, uint64_t len, uint64_t* com
     list_node page_list;
     list_initialize(&page_list);
 
-    size_t allocated = pmm_alloc_pages(count, pmm_alloc_flags_, &page_list);
+    size_t allocated = pmm_alloc_pages(count, pmm_alloc_flags_ | PMM_ALLOC_FLAG_ZEROED, &page_list);
     if (allocated < count) {
         LTRACEF("failed to allocate enough pages (asked for %zu, got %zu)\n", count, allocated);
         pmm_free(&page_list);
@@ -522,7 +545,7 @@ status_t VmObjectPaged::CommitRangeContiguous(uint64_t offset, uint64_t len, uin
     // make a pass through the list, making sure we have an empty run on the object
     size_t count = 0;
     for (uint64_t o = offset; o < end; o += PAGE_SIZE) {
-        if (!page_list_.GetPage(o))
+        if (!page_list_.GetPage(o) && !compressed_pages_.find(o).IsValid())
             count++;
     }
 
@@ -622,6 +645,10 @@ status_t VmObjectPaged::DecommitRange(uint64_t offset, uint64_t len, uint64_t* d
         start += PAGE_SIZE;
     }
 
+    size_t freed = FreeCompressedRangeLocked(ROUNDDOWN(offset, PAGE_SIZE), end);
+    if (decommitted)
+        *decommitted += freed * PAGE_SIZE;
+
     return MX_OK;
 }
 
@@ -645,8 +672,13 @@ status_t VmObjectPaged::PinLocked(uint64_t offset, uint64_t len) {
     const uint64_t start_page_offset = ROUNDDOWN(offset, PAGE_SIZE);
     const uint64_t end_page_offset = ROUNDUP(offset + len, PAGE_SIZE);
 
+    // compressed pages are committed, so bring them back to pin them
+    status_t status = DecompressRangeLocked(start_page_offset, end_page_offset);
+    if (status != MX_OK)
+        return status;
+
     uint64_t expected_next_off = start_page_offset;
-    status_t status = page_list_.ForEveryPageInRange(
+    status = page_list_.ForEveryPageInRange(
             [&expected_next_off](const auto p, uint64_t off) {
                 if (off != expected_next_off) {
                     return MX_ERR_NOT_FOUND;
@@ -758,6 +790,8 @@ status_t VmObjectPaged::ResizeLocked(uint64_t s) {
             // unmap all of the pages in this range on all the mapping regions
             RangeChangeUpdateLocked(start, page_aligned_len);
 
+            FreeCompressedRangeLocked(start, end);
+
             // iterate through the pages, freeing them
             while (start < end) {
                 page_list_.FreePage(start);
@@ -810,6 +844,288 @@ status_t VmObjectPaged::SetParentOffsetLocked(uint64_t offset) {
     return MX_OK;
 }
 
+void VmObjectPaged::CollapseParentsLocked() {
+    DEBUG_ASSERT(lock_.IsHeld());
+
+    while (CollapseParentLocked()) {
+    }
+}
+
+// Splices our parent out of the chain, if nothing but us can observe it: it
+// must itself be a clone, with no other children and no mappings, and our
+// parent_ must hold the only reference to it. Taking it off the global VMO list
+// at the same time stops the page compressor making a new reference, after
+// which none can be made without going through us; and the whole clone tree
+// shares our lock, so these conditions hold for as long as we hold it.
+//
+// The pages of the parent which we can see are moved to us and the rest are
+// freed. Returns true if the parent was collapsed.
+bool VmObjectPaged::CollapseParentLocked() {
+    DEBUG_ASSERT(lock_.IsHeld());
+
+    if (!parent_ || !parent_->is_paged())
+        return false;
+
+    auto parent = static_cast<VmObjectPaged*>(parent_.get());
+    if (!parent->parent_ || parent->children_list_len_ != 1 ||
+        parent->mapping_list_len_ != 0)
+        return false;
+
+    safeint::CheckedNumeric<uint64_t> grandparent_offset = parent->parent_offset_;
+    grandparent_offset += parent_offset_;
+    if (!grandparent_offset.IsValid())
+        return false;
+
+    if (!parent->RemoveFromGlobalListIfUnshared())
+        return false;
+
+    // Offsets below limit currently reach the parent, which may hold pages of
+    // its own past its parent_limit_ from an earlier collapse. Of those, the
+    // ones below grandparent_limit also reach the grandparent; later growth
+    // must not expose any more of it.
+    uint64_t limit = mxtl::min(size_, parent_limit_);
+    limit = mxtl::min(limit, (parent->size_ > parent_offset_) ? parent->size_ - parent_offset_ : 0);
+    uint64_t grandparent_limit = mxtl::min(limit,
+        (parent->parent_limit_ > parent_offset_) ? parent->parent_limit_ - parent_offset_ : 0);
+
+    LTRACEF("vmo %p collapsing parent %p, limit %#" PRIx64 " grandparent limit %#" PRIx64 "\n",
+            this, parent, limit, grandparent_limit);
+
+    // Move the pages we can see and have not copied. Should this fail partway
+    // the moved pages are still the ones we would have found in the parent.
+    const uint64_t parent_offset = parent_offset_;
+    auto move_page = [this, parent_offset, limit](vm_page_t*& p, uint64_t offset) {
+        if (offset < parent_offset || offset - parent_offset >= limit)
+            return MX_ERR_NEXT;
+        uint64_t our_offset = offset - parent_offset;
+        if (page_list_.GetPage(our_offset) || compressed_pages_.find(our_offset).IsValid())
+            return MX_ERR_NEXT;
+        status_t status = page_list_.AddPage(p, our_offset);
+        if (status != MX_OK)
+            return status;
+        p = nullptr;
+        return MX_ERR_NEXT;
+    };
+    if (parent->page_list_.ForEveryPage(move_page) != MX_OK) {
+        parent->AddToGlobalList();
+        return false;
+    }
+
+    // Likewise the compressed pages.
+    for (auto iter = parent->compressed_pages_.begin(); iter.IsValid();) {
+        auto cur = iter++;
+        uint64_t offset = cur->offset();
+        if (offset < parent_offset || offset - parent_offset >= limit)
+            continue;
+        uint64_t our_offset = offset - parent_offset;
+        if (page_list_.GetPage(our_offset) || compressed_pages_.find(our_offset).IsValid())
+            continue;
+        auto page = parent->compressed_pages_.erase(cur);
+        page->set_offset(our_offset);
+        compressed_pages_.insert(mxtl::move(page));
+    }
+
+    // Nothing can see the remaining pages.
+    parent->page_list_.FreeAllPages();
+    parent->compressed_pages_.clear();
+
+    mxtl::RefPtr<VmObject> grandparent = mxtl::move(parent->parent_);
+    grandparent->RemoveChildLocked(parent);
+    grandparent->AddChildLocked(this);
+    parent->RemoveChildLocked(this);
+
+    parent_offset_ = grandparent_offset.ValueOrDie();
+    parent_limit_ = grandparent_limit;
+    physical_lookup_ |= parent->physical_lookup_;
+
+    // This drops the last reference to the old parent.
+    parent_ = mxtl::move(grandparent);
+
+    return true;
+}
+
+uint32_t VmObjectPaged::CowChainDepth() {
+    canary_.Assert();
+
+    {
+        AutoLock a(&lock_);
+        CollapseParentsLocked();
+    }
+
+    return VmObject::CowChainDepth();
+}
+
+bool VmObjectPaged::ReclaimableLocked() const {
+    DEBUG_ASSERT(lock_.IsHeld());
+
+    // Only reclaim user memory, which the kernel does not touch without
+    // looking it up first. Children can see our pages through mappings of
+    // their own, which may be kernel mappings, so leave parents alone too.
+    // Nor can we tell when a device is done with a physical address handed
+    // out by Lookup(), such as for DMA.
+    if (user_id_ == 0 || children_list_len_ != 0 || physical_lookup_)
+        return false;
+    for (const auto& m : mapping_list_) {
+        if (!m.aspace()->is_user())
+            return false;
+    }
+    return true;
+}
+
+// Ages our pages and compresses up to |max_pages| of those which have become
+// cold. Aging is all that tracks use: a page is unmapped once it has gone
+// unused for kPageAgeUnmapped scans, so that touching it again faults it in
+// through GetPageLocked(), which resets its age. A page which is not touched
+// for another scan after that is compressed.
+size_t VmObjectPaged::ReclaimPages(size_t max_pages) {
+    canary_.Assert();
+
+    AutoLock a(&lock_);
+
+    if (!ReclaimableLocked())
+        return 0;
+
+    // Unmap the pages reaching kPageAgeUnmapped with a single update; the
+    // others this covers are looked up again if they are still in use.
+    bool have_cold = false;
+    uint64_t unmap_start = UINT64_MAX;
+    uint64_t unmap_end = 0;
+    page_list_.ForEveryPage([&](const auto p, uint64_t off) {
+        if (p->state != VM_PAGE_STATE_OBJECT || p->object.pin_count > 0)
+            return MX_ERR_NEXT;
+        if (p->object.age < kPageAgeCold) {
+            p->object.age++;
+            if (p->object.age == kPageAgeUnmapped) {
+                unmap_start = mxtl::min(unmap_start, off);
+                unmap_end = off + PAGE_SIZE;
+            }
+        }
+        if (p->object.age == kPageAgeCold)
+            have_cold = true;
+        return MX_ERR_NEXT;
+    });
+    if (unmap_start < unmap_end)
+        RangeChangeUpdateLocked(unmap_start, unmap_end - unmap_start);
+
+    if (!have_cold || max_pages == 0)
+        return 0;
+
+    // Pick the pages to compress first, since compressing them changes the
+    // page list.
+    list_node free_list;
+    list_initialize(&free_list);
+    size_t compressed = 0;
+    uint64_t off = 0;
+    while (compressed < max_pages && off < size_) {
+        vm_page_t* page = nullptr;
+        page_list_.ForEveryPageInRange([&page, &off](const auto p, uint64_t o) {
+            off = o + PAGE_SIZE;
+            if (p->state != VM_PAGE_STATE_OBJECT || p->object.pin_count > 0 ||
+                p->object.age != kPageAgeCold)
+                return MX_ERR_NEXT;
+            page = p;
+            off = o;
+            return MX_ERR_STOP;
+        }, off, ROUNDUP_PAGE_SIZE(size_));
+        if (!page)
+            break;
+
+        // The page has not been mapped since it was aged past
+        // kPageAgeUnmapped, so nothing can be using it.
+        auto cpage = VmCompressedPage::Create(vm_page_to_paddr(page), off);
+        if (!cpage) {
+            // Don't try again until it has aged once more.
+            page->object.age = 0;
+        } else {
+            vm_page_t* removed = page_list_.RemovePage(off);
+            DEBUG_ASSERT(removed == page);
+            compressed_pages_.insert(mxtl::move(cpage));
+            list_add_tail(&free_list, &removed->free.node);
+            compressed++;
+        }
+        off += PAGE_SIZE;
+    }
+
+    pmm_free(&free_list);
+
+    LTRACEF("vmo %p compressed %zu pages\n", this, compressed);
+    return compressed;
+}
+
+size_t VmObjectPaged::CompressedPages() const {
+    canary_.Assert();
+    AutoLock a(&lock_);
+    return compressed_pages_.size();
+}
+
+status_t VmObjectPaged::DecompressPageLocked(uint64_t offset, list_node* free_list,
+                                             vm_page_t** const page_out, paddr_t* const pa_out) {
+    DEBUG_ASSERT(lock_.IsHeld());
+
+    auto iter = compressed_pages_.find(offset);
+    if (!iter.IsValid())
+        return MX_ERR_NOT_FOUND;
+
+    // any page will do, since it is about to be overwritten
+    vm_page_t* p = nullptr;
+    paddr_t pa;
+    if (free_list) {
+        p = list_remove_head_type(free_list, vm_page_t, free.node);
+        if (p) {
+            pa = vm_page_to_paddr(p);
+        }
+    }
+    if (!p) {
+        p = pmm_alloc_page(pmm_alloc_flags_, &pa);
+    }
+    if (!p) {
+        return MX_ERR_NO_MEMORY;
+    }
+
+    InitializeVmPage(p);
+    iter->Decompress(pa);
+    compressed_pages_.erase(iter);
+
+    status_t status = AddPageLocked(p, offset);
+    DEBUG_ASSERT(status == MX_OK);
+
+    LTRACEF("decompressed page %p, pa %#" PRIxPTR " at offset %#" PRIx64 "\n", p, pa, offset);
+
+    if (page_out)
+        *page_out = p;
+    if (pa_out)
+        *pa_out = pa;
+
+    return MX_OK;
+}
+
+status_t VmObjectPaged::DecompressRangeLocked(uint64_t start, uint64_t end) {
+    DEBUG_ASSERT(lock_.IsHeld());
+
+    for (auto iter = compressed_pages_.lower_bound(start);
+         iter.IsValid() && iter->offset() < end;
+         iter = compressed_pages_.lower_bound(start)) {
+        // decompressing erases the entry, so look up the next one afresh
+        start = iter->offset() + PAGE_SIZE;
+        status_t status = DecompressPageLocked(iter->offset(), nullptr, nullptr, nullptr);
+        if (status != MX_OK)
+            return status;
+    }
+    return MX_OK;
+}
+
+size_t VmObjectPaged::FreeCompressedRangeLocked(uint64_t start, uint64_t end) {
+    DEBUG_ASSERT(lock_.IsHeld());
+
+    size_t count = 0;
+    auto iter = compressed_pages_.lower_bound(start);
+    while (iter.IsValid() && iter->offset() < end) {
+        compressed_pages_.erase(iter++);
+        count++;
+    }
+    return count;
+}
+
 // perform some sort of copy in/out on a range of the object using a passed in lambda
 // for the copy routine
 template <typename T>
@@ -911,6 +1227,10 @@ status_t VmObjectPaged::Lookup(uint64_t offset, uint64_t len, uint pf_flags,
     if (unlikely(!InRange(offset, len, size_)))
         return MX_ERR_OUT_OF_RANGE;
 
+    // the caller may hand these addresses to hardware, so the pages must
+    // stay where they are
+    physical_lookup_ = true;
+
     const uint64_t start_page_offset = ROUNDDOWN(offset, PAGE_SIZE);
     const uint64_t end_page_offset = ROUNDUP(offset + len, PAGE_SIZE);
 
@@ -1101,7 +1421,7 @@ void VmObjectPaged::RangeChangeUpdateFromParentLocked(const uint64_t offset, con
     // with our offset into the parent and pass it on
     uint64_t offset_new;
     uint64_t len_new;
-    if (!GetIntersect(parent_offset_, size_, offset, len,
+    if (!GetIntersect(parent_offset_, mxtl::min(size_, parent_limit_), offset, len,
                       &offset_new, &len_new))
         return;
 
@@ -44,9 +44,10 @@ status_t VmObjectPhysical::Create(paddr_t base, uint64_t size, mxtl::RefPtr<VmOb
         return MX_ERR_INVALID_ARGS;
 
     AllocChecker ac;
-    auto vmo = mxtl::AdoptRef<VmObject>(new (&ac) VmObjectPhysical(base, size));
+    auto vmo = mxtl::AdoptRef<VmObjectPhysical>(new (&ac) VmObjectPhysical(base, size));
     if (!ac.check())
         return MX_ERR_NO_MEMORY;
+    vmo->AddToGlobalList();
 
     // Physical VMOs should default to uncached access.
     vmo->SetMappingCachePolicy(ARCH_MMU_FLAG_UNCACHED);
@@ -112,6 +112,31 @@ vm_page* VmPageList::GetPage(uint64_t offset) {
     return pln->GetPage(index);
 }
 
+vm_page* VmPageList::RemovePage(uint64_t offset) {
+    uint64_t node_offset = ROUNDDOWN(offset, PAGE_SIZE * VmPageListNode::kPageFanOut);
+    size_t index = (offset >> PAGE_SIZE_SHIFT) % VmPageListNode::kPageFanOut;
+
+    LTRACEF_LEVEL(2, "%p offset %#" PRIx64 " node_offset %#" PRIx64 " index %zu\n", this, offset, node_offset,
+                  index);
+
+    // lookup the tree node that holds this page
+    auto pln = list_.find(node_offset);
+    if (!pln.IsValid()) {
+        return nullptr;
+    }
+
+    auto page = pln->RemovePage(index);
+    if (page) {
+        // if it was the last page in the node, remove the node from the tree
+        if (pln->IsEmpty()) {
+            LTRACEF_LEVEL(2, "%p freeing the list node\n", this);
+            list_.erase(*pln);
+        }
+    }
+
+    return page;
+}
+
 status_t VmPageList::FreePage(uint64_t offset) {
     uint64_t node_offset = ROUNDDOWN(offset, PAGE_SIZE * VmPageListNode::kPageFanOut);
     size_t index = (offset >> PAGE_SIZE_SHIFT) % VmPageListNode::kPageFanOut;
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <err.h>
 #include <kernel/vm.h>
+#include <kernel/vm/page_compressor.h>
 #include <kernel/vm/vm_address_region.h>
 #include <kernel/vm/vm_aspace.h>
 #include <kernel/vm/vm_object.h>
@@ -14,6 +15,7 @@
 #include <kernel/vm/vm_object_physical.h>
 #include <mxalloc/new.h>
 #include <mxtl/array.h>
+#include <string.h>
 #include <unittest.h>
 
 static const uint kArchRwFlags = ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE;
@@ -885,6 +887,168 @@ static bool vmo_lookup_test(void* context) {
     END_TEST;
 }
 
+// Fills |page| of |vmo| with data which compresses well.
+static status_t write_compressible_page(const mxtl::RefPtr<VmObject>& vmo, size_t page) {
+    uint8_t buf[256];
+    for (size_t off = 0; off < PAGE_SIZE; off += sizeof(buf)) {
+        memset(buf, static_cast<int>(page * 16 + off / sizeof(buf)), sizeof(buf));
+        size_t written;
+        status_t status = vmo->Write(buf, page * PAGE_SIZE + off, sizeof(buf), &written);
+        if (status != MX_OK)
+            return status;
+    }
+    return MX_OK;
+}
+
+static bool check_compressible_page(const mxtl::RefPtr<VmObject>& vmo, size_t page) {
+    uint8_t buf[256];
+    for (size_t off = 0; off < PAGE_SIZE; off += sizeof(buf)) {
+        size_t read;
+        if (vmo->Read(buf, page * PAGE_SIZE + off, sizeof(buf), &read) != MX_OK)
+            return false;
+        for (size_t i = 0; i < sizeof(buf); i++) {
+            if (buf[i] != static_cast<uint8_t>(page * 16 + off / sizeof(buf)))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Compresses the cold pages of a VMO and reads them back.
+static bool vmo_compress_test(void* context) {
+    BEGIN_TEST;
+    static const size_t kPages = 8;
+    static const size_t alloc_size = PAGE_SIZE * kPages;
+
+    mxtl::RefPtr<VmObject> vmo;
+    status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, alloc_size, &vmo);
+    REQUIRE_EQ(status, MX_OK, "vmobject creation\n");
+    // Only user VMOs are reclaimed.
+    vmo->set_user_id(1);
+
+    for (size_t i = 0; i < kPages - 1; i++) {
+        REQUIRE_EQ(MX_OK, write_compressible_page(vmo, i), "writing compressible page\n");
+    }
+    // Random data does not compress.
+    AllocChecker ac;
+    mxtl::Array<uint8_t> a(new (&ac) uint8_t[PAGE_SIZE], PAGE_SIZE);
+    REQUIRE_TRUE(ac.check(), "");
+    fill_region(99, a.get(), PAGE_SIZE);
+    size_t bytes;
+    status = vmo->Write(a.get(), (kPages - 1) * PAGE_SIZE, PAGE_SIZE, &bytes);
+    REQUIRE_EQ(MX_OK, status, "writing incompressible page\n");
+    EXPECT_EQ(kPages, vmo->AllocatedPages(), "all pages committed\n");
+
+    // Pages become cold on the third scan; keep page 0 in use.
+    EXPECT_EQ(0u, vmo->ReclaimPages(SIZE_MAX), "first scan compresses nothing\n");
+    EXPECT_EQ(0u, vmo->ReclaimPages(SIZE_MAX), "second scan compresses nothing\n");
+    EXPECT_TRUE(check_compressible_page(vmo, 0), "reading page in use\n");
+    EXPECT_EQ(kPages - 2, vmo->ReclaimPages(SIZE_MAX), "third scan compresses cold pages\n");
+    EXPECT_EQ(kPages - 2, vmo->CompressedPages(), "cold pages compressed\n");
+    EXPECT_EQ(2u, vmo->AllocatedPages(), "page in use and incompressible page remain\n");
+
+    // Compress page 0 too, a page at a time.
+    EXPECT_EQ(0u, vmo->ReclaimPages(0), "scan without compressing\n");
+    EXPECT_EQ(0u, vmo->ReclaimPages(0), "scan without compressing\n");
+    EXPECT_EQ(1u, vmo->ReclaimPages(1), "compress last cold page\n");
+    EXPECT_EQ(0u, vmo->ReclaimPages(SIZE_MAX), "nothing left to compress\n");
+    EXPECT_EQ(kPages - 1, vmo->CompressedPages(), "compressible pages compressed\n");
+    EXPECT_EQ(1u, vmo->AllocatedPages(), "incompressible page remains\n");
+
+    // Reading them brings them back.
+    for (size_t i = 0; i < kPages - 1; i++) {
+        EXPECT_TRUE(check_compressible_page(vmo, i), "reading compressed page\n");
+    }
+    mxtl::Array<uint8_t> b(new (&ac) uint8_t[PAGE_SIZE], PAGE_SIZE);
+    REQUIRE_TRUE(ac.check(), "");
+    status = vmo->Read(b.get(), (kPages - 1) * PAGE_SIZE, PAGE_SIZE, &bytes);
+    EXPECT_EQ(MX_OK, status, "reading incompressible page\n");
+    EXPECT_EQ(0, memcmp(a.get(), b.get(), PAGE_SIZE), "incompressible page intact\n");
+    EXPECT_EQ(0u, vmo->CompressedPages(), "all pages decompressed\n");
+    EXPECT_EQ(kPages, vmo->AllocatedPages(), "all pages committed\n");
+
+    // Decommitting drops compressed pages.
+    for (size_t i = 0; i < 3; i++) {
+        vmo->ReclaimPages(SIZE_MAX);
+    }
+    EXPECT_EQ(kPages - 1, vmo->CompressedPages(), "compressible pages compressed\n");
+    uint64_t decommitted;
+    status = vmo->DecommitRange(0, alloc_size, &decommitted);
+    EXPECT_EQ(MX_OK, status, "decommitting\n");
+    EXPECT_EQ(alloc_size, decommitted, "decommitting\n");
+    EXPECT_EQ(0u, vmo->CompressedPages(), "compressed pages dropped\n");
+
+    END_TEST;
+}
+
+// Pages whose physical addresses were looked up, say for DMA, stay put.
+static bool vmo_lookup_not_reclaimed_test(void* context) {
+    BEGIN_TEST;
+    static const size_t kPages = 4;
+    static const size_t alloc_size = PAGE_SIZE * kPages;
+
+    mxtl::RefPtr<VmObject> vmo;
+    status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, alloc_size, &vmo);
+    REQUIRE_EQ(status, MX_OK, "vmobject creation\n");
+    vmo->set_user_id(1);
+
+    for (size_t i = 0; i < kPages; i++) {
+        REQUIRE_EQ(MX_OK, write_compressible_page(vmo, i), "writing compressible page\n");
+    }
+
+    paddr_t pa = 0;
+    auto lookup_fn = [](void* context, size_t offset, size_t index, paddr_t pa) {
+        *static_cast<paddr_t*>(context) = pa;
+        return MX_OK;
+    };
+    status = vmo->Lookup(0, PAGE_SIZE, 0, lookup_fn, &pa);
+    EXPECT_EQ(MX_OK, status, "lookup\n");
+
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_EQ(0u, vmo->ReclaimPages(SIZE_MAX), "scan compresses nothing\n");
+    }
+    EXPECT_EQ(0u, vmo->CompressedPages(), "nothing compressed\n");
+    EXPECT_EQ(kPages, vmo->AllocatedPages(), "all pages committed\n");
+
+    END_TEST;
+}
+
+// Drives the compressor with a simulated memory limit.
+static bool vmo_compress_memory_limit_test(void* context) {
+    BEGIN_TEST;
+    static const size_t kPages = 16;
+    static const size_t alloc_size = PAGE_SIZE * kPages;
+
+    mxtl::RefPtr<VmObject> vmo;
+    status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, alloc_size, &vmo);
+    REQUIRE_EQ(status, MX_OK, "vmobject creation\n");
+    vmo->set_user_id(1);
+    for (size_t i = 0; i < kPages; i++) {
+        REQUIRE_EQ(MX_OK, write_compressible_page(vmo, i), "writing compressible page\n");
+    }
+
+    // Limit memory to what is in use, leaving nothing free.
+    size_t used = pmm_count_total_bytes() - pmm_count_free_pages() * PAGE_SIZE;
+    page_compressor_set_memory_limit(used);
+    size_t total = 0;
+    for (size_t i = 0; i < 4; i++) {
+        total += page_compressor_reclaim_step();
+    }
+    EXPECT_LT(0u, total, "memory pressure\n");
+    EXPECT_EQ(kPages, vmo->CompressedPages(), "memory pressure\n");
+
+    page_compressor_set_memory_limit(0);
+    // Run a step to leave the reclaiming state.
+    page_compressor_reclaim_step();
+
+    for (size_t i = 0; i < kPages; i++) {
+        EXPECT_TRUE(check_compressible_page(vmo, i), "reading compressed page\n");
+    }
+    EXPECT_EQ(0u, vmo->CompressedPages(), "all pages decompressed\n");
+
+    END_TEST;
+}
+
 // Use the function name as the test name
 #define VM_UNITTEST(fname) UNITTEST(#fname, fname)
 
@@ -915,6 +1079,9 @@ VM_UNITTEST(vmo_double_remap_test)
 VM_UNITTEST(vmo_read_write_smoke_test)
 VM_UNITTEST(vmo_cache_test)
 VM_UNITTEST(vmo_lookup_test)
+VM_UNITTEST(vmo_compress_test)
+VM_UNITTEST(vmo_lookup_not_reclaimed_test)
+VM_UNITTEST(vmo_compress_memory_limit_test)
 // Uncomment for debugging
 // VM_UNITTEST(dump_all_aspaces)  // Run last
 UNITTEST_END_TESTCASE(vm_tests, "vmtests", "Virtual memory tests", nullptr, nullptr);
@@ -38,7 +38,7 @@
 #define PADDING_FILL 0x55
 
 #if !defined(HEAP_GROW_SIZE)
-#define HEAP_GROW_SIZE (1 * 1024 * 1024) /* Grow aggressively */
+#define HEAP_GROW_SIZE (2 * 1024 * 1024) /* Grow aggressively, by a large page */
 #endif
 
 static_assert(IS_PAGE_ALIGNED(HEAP_GROW_SIZE), "");
@@ -86,6 +86,8 @@ struct heap {
 // Heap static vars.
 static struct heap theheap;
 
+LOCKSTAT_CLASS_DEFINE(heap, "heap");
+
 static ssize_t heap_grow(size_t len, free_t **bucket);
 
 static void lock(void) TA_ACQ(theheap.lock)
@@ -763,8 +765,13 @@ void *cmpct_alloc(size_t size)
     if (bucket == -1) {
         // Grow heap by at least 12% if we can.
         size_t growby = MIN(1u << HEAP_ALLOC_VIRTUAL_BITS,
-                            MAX(theheap.size >> 3,
-                                MAX(HEAP_GROW_SIZE, rounded_up)));
+                            MAX(theheap.size >> 3, HEAP_GROW_SIZE));
+        if (growby >= (size_t)LARGE_PAGE_SIZE) {
+            // Make the growth, sentinels included, whole large pages, which
+            // heap_page_alloc() can back with aligned large pages.
+            growby = ROUNDDOWN(growby, LARGE_PAGE_SIZE) - 2 * sizeof(header_t);
+        }
+        growby = MAX(growby, rounded_up);
         while (heap_grow(growby, NULL) < 0) {
             if (growby <= rounded_up) {
                 unlock();
@@ -920,7 +927,7 @@ void cmpct_init(void)
     LTRACE_ENTRY;
 
     // Create a mutex.
-    mutex_init(&theheap.lock);
+    mutex_init_class(&theheap.lock, LOCKSTAT_CLASS(heap));
 
     // Initialize the free list.
     for (int i = 0; i < NUMBER_OF_BUCKETS; i++) {
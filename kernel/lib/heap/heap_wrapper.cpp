@@ -126,9 +126,16 @@ void free(void *ptr)
     cmpct_free(ptr);
 }
 
+// number of heap_page_alloc() calls backed by whole, aligned large pages of
+// the physmap, and not
+static size_t heap_large_page_allocs;
+static size_t heap_small_page_allocs;
+
 static void heap_dump(bool panic_time)
 {
     cmpct_dump(panic_time);
+    printf("\tpage allocations: %zu large page aligned, %zu not\n",
+           heap_large_page_allocs, heap_small_page_allocs);
 }
 
 void heap_get_info(size_t *size_bytes, size_t *free_bytes) {
@@ -146,7 +153,23 @@ void *heap_page_alloc(size_t pages)
 
     struct list_node list = LIST_INITIAL_VALUE(list);
 
-    void *result = pmm_alloc_kpages(pages, &list, NULL);
+    // The heap lives in the physmap, which is mapped with large pages, so
+    // ask for whole large pages to be aligned; the heap then spans as few
+    // TLB entries as possible. If there is no aligned run, take any.
+    void *result = NULL;
+    if (pages * PAGE_SIZE % LARGE_PAGE_SIZE == 0) {
+        paddr_t pa;
+        if (pmm_alloc_contiguous(pages, PMM_ALLOC_FLAG_KMAP, LARGE_PAGE_SIZE_SHIFT,
+                                 &pa, &list) == pages) {
+            result = paddr_to_kvaddr(pa);
+            heap_large_page_allocs++;
+        }
+    }
+    if (!result) {
+        result = pmm_alloc_kpages(pages, &list, NULL);
+        if (result)
+            heap_small_page_allocs++;
+    }
 
     if (likely(result)) {
         // mark all of the allocated page as HEAP
@@ -12,6 +12,7 @@
 #include <arch/ops.h>
 #include <arch/user_copy.h>
 #include <kernel/cmdline.h>
+#include <kernel/lockstat.h>
 #include <kernel/vm/vm_aspace.h>
 #include <lib/ktrace.h>
 #include <lk/init.h>
@@ -82,6 +83,13 @@ static void ktrace_report_probes(void) {
     mutex_release(&probe_list_lock);
 }
 
+static void ktrace_report_lock_classes(void) {
+    for (size_t i = 0; i < lockstat_class_count(); i++) {
+        ktrace_name_etc(TAG_LOCK_CLASS_NAME, static_cast<uint32_t>(i), 0,
+                        lockstat_class_name(i), true);
+    }
+}
+
 typedef struct ktrace_state {
     // where the next record will be written
     int offset;
@@ -162,6 +170,7 @@ status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
         atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
         ktrace_report_syscalls(kt_syscall_info);
         ktrace_report_probes();
+        ktrace_report_lock_classes();
         break;
     case KTRACE_ACTION_NEW_PROBE: {
         ktrace_probe_info_t* probe;
@@ -237,6 +246,7 @@ void ktrace_init(unsigned level) {
     atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
     ktrace_report_syscalls(kt_syscall_info);
     ktrace_report_probes();
+    ktrace_report_lock_classes();
     atomic_store(&ks->grpmask, KTRACE_GRP_TO_MASK(grpmask));
 
     // report names of existing threads
@@ -26,6 +26,8 @@
 
 #define LOCAL_TRACE 0
 
+LOCKSTAT_CLASS_DEFINE(channel, "channel");
+
 // static
 status_t ChannelDispatcher::Create(uint32_t flags,
                                    mxtl::RefPtr<Dispatcher>* dispatcher0,
@@ -24,10 +24,22 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (auto& bucket : buckets_) {
+        AutoLock lock(&bucket.lock);
+        DEBUG_ASSERT(bucket.futexes.is_empty());
+    }
+}
+
+FutexContext::Bucket* FutexContext::GetBucket(uintptr_t futex_key) {
+    // Futexes are ints, and unrelated futexes are frequently close together
+    // (e.g. in the same struct), so mix in some higher bits.
+    uintptr_t hash = futex_key >> 2;
+    hash ^= (hash >> 6) ^ (hash >> 12);
+    return &buckets_[hash % kNumBuckets];
 }
 
-status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline) {
+status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline,
+                                 thread_t* owner) {
     LTRACE_ENTRY;
 
     uintptr_t futex_key = reinterpret_cast<uintptr_t>(value_ptr.get());
@@ -42,16 +54,17 @@ status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    lock_.Acquire();
+    Bucket* bucket = GetBucket(futex_key);
+    bucket->lock.Acquire();
 
     int value;
     status_t result = value_ptr.copy_from_user(&value);
     if (result != MX_OK) {
-        lock_.Release();
+        bucket->lock.Release();
         return result;
     }
     if (value != current_value) {
-        lock_.Release();
+        bucket->lock.Release();
         return MX_ERR_BAD_STATE;
     }
 
@@ -60,10 +73,11 @@ status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_
     node->set_hash_key(futex_key);
     node->SetAsSingletonList();
 
-    QueueNodesLocked(node);
+    QueueNodesLocked(bucket, node);
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
-    result = node->BlockThread(&lock_, deadline);
+    // Block current thread.  This releases the bucket lock and does not
+    // reacquire it.
+    result = node->BlockThread(&bucket->lock, deadline, owner);
     if (result == MX_OK) {
         DEBUG_ASSERT(!node->IsInQueue());
         // All the work necessary for removing us from the hash table was done by FutexWake()
@@ -76,8 +90,7 @@ status_t FutexContext::FutexWait(user_ptr<int> value_ptr, int current_value, mx_
     //
     // We need to ensure that the thread's node is removed from the wait
     // queue, because FutexWake() probably didn't do that.
-    AutoLock lock(&lock_);
-    if (UnqueueNodeLocked(node)) {
+    if (UnqueueNode(node)) {
         return result;
     }
     // The current thread was not found on the wait queue.  This means
@@ -112,9 +125,10 @@ status_t FutexContext::FutexWake(user_ptr<const int> value_ptr,
     if (futex_key % sizeof(int))
         return MX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    Bucket* bucket = GetBucket(futex_key);
+    AutoLock lock(&bucket->lock);
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    FutexNode* node = EraseLocked(bucket, futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return MX_OK;
@@ -127,7 +141,7 @@ status_t FutexContext::FutexWake(user_ptr<const int> value_ptr,
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        bucket->futexes.push_front(remaining_waiters);
     }
 
     if (any_woken) {
@@ -138,32 +152,55 @@ status_t FutexContext::FutexWake(user_ptr<const int> value_ptr,
     return MX_OK;
 }
 
+// The buckets for the two futexes are locked in address order, so that
+// concurrent requeues between the same pair of buckets cannot deadlock.
+// Thread safety analysis cannot follow the conditional locking.
 status_t FutexContext::FutexRequeue(user_ptr<int> wake_ptr, uint32_t wake_count, int current_value,
-                                    user_ptr<int> requeue_ptr, uint32_t requeue_count) {
+                                    user_ptr<int> requeue_ptr, uint32_t requeue_count)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
     LTRACE_ENTRY;
 
     if ((requeue_ptr.get() == nullptr) && requeue_count)
         return MX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
+    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
+
+    Bucket* wake_bucket = GetBucket(wake_key);
+    Bucket* requeue_bucket = GetBucket(requeue_key);
+    Bucket* first = (wake_bucket < requeue_bucket) ? wake_bucket : requeue_bucket;
+    Bucket* second = (wake_bucket < requeue_bucket) ? requeue_bucket : wake_bucket;
+    AutoLock first_lock(&first->lock);
+    // Only used when the two futexes are in different buckets.
+    Mutex* second_lock = (first != second) ? &second->lock : nullptr;
+    if (second_lock)
+        second_lock->Acquire();
+    auto release_second = [second_lock]() {
+        if (second_lock)
+            second_lock->Release();
+    };
 
     int value;
     status_t result = wake_ptr.copy_from_user(&value);
-    if (result != MX_OK) return result;
-    if (value != current_value) return MX_ERR_BAD_STATE;
+    if (result != MX_OK || value != current_value) {
+        release_second();
+        return (result != MX_OK) ? result : MX_ERR_BAD_STATE;
+    }
 
-    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
-    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
-    if (wake_key == requeue_key) return MX_ERR_INVALID_ARGS;
-    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
+    // Checked only after the value, so that a changed value is reported as
+    // MX_ERR_BAD_STATE even when the pointers are also bad.
+    if ((wake_key == requeue_key) || wake_key % sizeof(int) || requeue_key % sizeof(int)) {
+        release_second();
         return MX_ERR_INVALID_ARGS;
+    }
 
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
-    // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    // nodes below, because the bucket lists look at the GetKey field of
+    // the list head nodes for wake_key and requeue_key.
+    FutexNode* node = EraseLocked(wake_bucket, wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
+        release_second();
         return MX_OK;
     }
 
@@ -182,56 +219,81 @@ status_t FutexContext::FutexRequeue(user_ptr<int> wake_ptr, uint32_t wake_count,
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            QueueNodesLocked(requeue_bucket, requeue_head);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
+        wake_bucket->futexes.push_front(node);
     }
 
+    release_second();
     if (any_woken) {
-        lock.release();
+        first_lock.release();
         thread_reschedule();
     }
 
     return MX_OK;
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.IsHeld());
+FutexNode* FutexContext::EraseLocked(Bucket* bucket, uintptr_t futex_key) {
+    DEBUG_ASSERT(bucket->lock.IsHeld());
+
+    return bucket->futexes.erase_if([futex_key](const FutexNode& node) {
+        return node.GetKey() == futex_key;
+    });
+}
+
+void FutexContext::QueueNodesLocked(Bucket* bucket, FutexNode* head) {
+    DEBUG_ASSERT(bucket->lock.IsHeld());
 
-    FutexNode::HashTable::iterator iter;
+    uintptr_t futex_key = head->GetKey();
 
-    // Attempt to insert this FutexNode into the hash table.  If the insert
-    // succeeds, then the current thread is first to block on this futex and we
-    // are finished.  If the insert fails, then there is already a thread
-    // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+    // If there is already a thread waiting on this futex, add ourselves to
+    // that thread's list.  Otherwise the current thread is first to block on
+    // this futex, and becomes the head of its list.
+    auto iter = bucket->futexes.find_if([futex_key](const FutexNode& node) {
+        return node.GetKey() == futex_key;
+    });
+    if (iter.IsValid()) {
         iter->AppendList(head);
+    } else {
+        bucket->futexes.push_front(head);
+    }
 }
 
 // This attempts to unqueue a thread (which may or may not be waiting on a
 // futex), given its FutexNode.  This returns whether the FutexNode was
 // found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.IsHeld());
+bool FutexContext::UnqueueNodeLocked(Bucket* bucket, FutexNode* node) {
+    DEBUG_ASSERT(bucket->lock.IsHeld());
 
     if (!node->IsInQueue())
         return false;
 
-    // Note: When UnqueueNode() is called from FutexWait(), it might be
-    // tempting to reuse the futex key that was passed to FutexWait().
-    // However, that could be out of date if the thread was requeued by
-    // FutexRequeue(), so we need to re-get the hash table key here.
     uintptr_t futex_key = node->GetKey();
 
-    FutexNode* old_head = futex_table_.erase(futex_key);
+    FutexNode* old_head = EraseLocked(bucket, futex_key);
     DEBUG_ASSERT(old_head);
     FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
     if (new_head)
-        futex_table_.insert(new_head);
+        bucket->futexes.push_front(new_head);
     return true;
 }
+
+// Like UnqueueNodeLocked(), but first locks the bucket for |node|'s futex.
+bool FutexContext::UnqueueNode(FutexNode* node) {
+    // Note: When UnqueueNode() is called from FutexWait(), it might be
+    // tempting to reuse the futex key that was passed to FutexWait().
+    // However, that could be out of date if the thread was requeued by
+    // FutexRequeue(), so we need to re-get the key here.  It can also
+    // change until we hold the lock for its bucket, so check it again then.
+    for (;;) {
+        Bucket* bucket = GetBucket(node->GetKey());
+        AutoLock lock(&bucket->lock);
+        if (GetBucket(node->GetKey()) == bucket)
+            return UnqueueNodeLocked(bucket, node);
+    }
+}
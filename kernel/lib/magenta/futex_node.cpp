@@ -131,6 +131,8 @@ FutexNode* FutexNode::RemoveFromHead(FutexNode* list_head, uint32_t count,
         // For requeuing, update the key so that FutexWait() can remove the
         // thread from its current queue if the wait operation times out.
         node->set_hash_key(new_hash_key);
+        // The owner of the old futex is not the owner of the new one.
+        node->ClearOwner();
 
         node = node->queue_next_;
         if (node == list_head) {
@@ -149,7 +151,8 @@ FutexNode* FutexNode::RemoveFromHead(FutexNode* list_head, uint32_t count,
 // This blocks the current thread.  This releases the given mutex (which
 // must be held when BlockThread() is called).  To reduce contention, it
 // does not reclaim the mutex on return.
-status_t FutexNode::BlockThread(Mutex* mutex, mx_time_t deadline) TA_NO_THREAD_SAFETY_ANALYSIS {
+status_t FutexNode::BlockThread(Mutex* mutex, mx_time_t deadline,
+                                thread_t* owner) TA_NO_THREAD_SAFETY_ANALYSIS {
     THREAD_LOCK(state);
 
     // We specifically want reschedule=false here, otherwise the
@@ -163,7 +166,11 @@ status_t FutexNode::BlockThread(Mutex* mutex, mx_time_t deadline) TA_NO_THREAD_S
     thread_t* current_thread = get_current_thread();
     status_t result;
     current_thread->interruptable = true;
+    wait_queue_set_owner(&wait_queue_, owner);
     result = wait_queue_block(&wait_queue_, deadline);
+    // The owner is only pinned (by the caller's reference to it) until we
+    // return, so it must not remain the owner after that.
+    wait_queue_set_owner(&wait_queue_, nullptr);
     current_thread->interruptable = false;
 
     THREAD_UNLOCK(state);
@@ -171,6 +178,12 @@ status_t FutexNode::BlockThread(Mutex* mutex, mx_time_t deadline) TA_NO_THREAD_S
     return result;
 }
 
+void FutexNode::ClearOwner() {
+    THREAD_LOCK(state);
+    wait_queue_set_owner(&wait_queue_, nullptr);
+    THREAD_UNLOCK(state);
+}
+
 // This returns whether the thread was woken.  This will usually return
 // true, but can sometimes return false if our wakeup coincides with the
 // thread waking up from a timeout.
@@ -180,20 +193,20 @@ bool FutexNode::WakeThread() {
     // cases to consider:
     //  1) The thread's wait times out, or the thread is killed or
     //     suspended.  In those cases, FutexWait() will reacquire the
-    //     FutexContext lock.  We are currently holding that lock, so
-    //     FutexWait() will not race with us.
+    //     FutexContext bucket lock for this futex.  We are currently
+    //     holding that lock, so FutexWait() will not race with us.
     //  2) The thread is woken by our wait_queue_wake_one() call.  In
-    //     this case, FutexWait() will *not* reacquire the FutexContext
-    //     lock.  To handle this correctly, we must not access |this|
-    //     after wait_queue_wake_one().
+    //     this case, FutexWait() will *not* reacquire the bucket lock.
+    //     To handle this correctly, we must not access |this| after
+    //     wait_queue_wake_one().
 
     // We must do this before we wake the thread, to handle case 2.
     MarkAsNotInQueue();
 
     // Place the waiting thread in the runnable state, but do not
-    // reschedule yet.  Our caller is currently holding the main
-    // futex_lock, and any threads which get woken by this action are going
-    // to immediately attempt to obtain the main futex_lock.  If we
+    // reschedule yet.  Our caller is currently holding the
+    // futex's bucket lock, and any threads which get woken by this action
+    // are going to immediately attempt to obtain that lock.  If we
     // indicate that the thread was woken during this process, our caller
     // will release the lock and then arrange for a reschedule operation
     // (which leads to a smoother transition).
@@ -8,6 +8,8 @@
 
 #include <stdint.h>
 
+#include <kernel/lockstat.h>
+
 #include <magenta/dispatcher.h>
 #include <magenta/message_packet.h>
 #include <magenta/state_tracker.h>
@@ -19,6 +21,8 @@
 #include <mxtl/ref_counted.h>
 #include <mxtl/unique_ptr.h>
 
+LOCKSTAT_CLASS_DECLARE(channel);
+
 class ChannelDispatcher final : public Dispatcher {
 public:
     class MessageWaiter;
@@ -106,7 +110,7 @@ private:
 
     mxtl::Canary<mxtl::magic("CHAN")> canary_;
 
-    Mutex lock_;
+    Mutex lock_{LOCKSTAT_CLASS(channel)};
     MessageList messages_ TA_GUARDED(lock_);
     WaiterList waiters_ TA_GUARDED(lock_);
     StateTracker state_tracker_;
@@ -13,7 +13,8 @@
 
 // FutexContext is a class that encapsulates support for futex operations.
 // FutexContext uses a hash table keyed on the futex address (a pointer to integer in userspace)
-// to contain all active futexes.
+// to contain all active futexes. Each bucket of the table has its own lock, so that operations
+// on futexes in different buckets do not contend.
 // A futex is considered active if there is one or more threads blocked on the futex.
 // After no threads are left blocked on a futex it is removed from the hash table.
 // The value in the futex hash table is the FutexNode object associated with the head
@@ -33,7 +34,13 @@ public:
     // Otherwise it will block the current thread until the |deadline| passes,
     // or until the thread is woken by a FutexWake or FutexRequeue operation
     // on the same |value_ptr| futex.
-    status_t FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline);
+    //
+    // If |owner| is non-null, it is the thread holding the lock the futex
+    // implements, and it runs at no lower a priority than the current thread
+    // for as long as the current thread waits.  The caller must keep |owner|
+    // alive until FutexWait returns.
+    status_t FutexWait(user_ptr<int> value_ptr, int current_value, mx_time_t deadline,
+                       thread_t* owner);
 
     // FutexWake will wake up to |count| number of threads blocked on the |value_ptr| futex.
     status_t FutexWake(user_ptr<const int> value_ptr, uint32_t count);
@@ -51,14 +58,28 @@ private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    static constexpr size_t kNumBuckets = 64;
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    // A bucket of the futex hash table.
+    // Holds the FutexNode for the head of the blocked thread list of each active futex
+    // whose address hashes to this bucket.
+    struct Bucket {
+        // protects futexes
+        Mutex lock;
+        mxtl::SinglyLinkedList<FutexNode*> futexes TA_GUARDED(lock);
+    };
 
-    // protects futex_table_
-    Mutex lock_;
+    Bucket* GetBucket(uintptr_t futex_key);
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+    // Removes and returns the head of the blocked thread list of the |futex_key| futex,
+    // or returns nullptr if no threads are blocked on it.
+    static FutexNode* EraseLocked(Bucket* bucket, uintptr_t futex_key) TA_REQ(bucket->lock);
+
+    static void QueueNodesLocked(Bucket* bucket, FutexNode* head) TA_REQ(bucket->lock);
+
+    static bool UnqueueNodeLocked(Bucket* bucket, FutexNode* node) TA_REQ(bucket->lock);
+
+    bool UnqueueNode(FutexNode* node);
+
+    Bucket buckets_[kNumBuckets];
 };
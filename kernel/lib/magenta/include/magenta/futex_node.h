@@ -11,14 +11,12 @@
 #include <kernel/wait.h>
 #include <list.h>
 #include <magenta/types.h>
-#include <mxtl/intrusive_hash_table.h>
+#include <mxtl/intrusive_single_list.h>
 
 // Node for linked list of threads blocked on a futex
 // Intended to be embedded within a ThreadDispatcher Instance
 class FutexNode : public mxtl::SinglyLinkedListable<FutexNode*> {
 public:
-    using HashTable = mxtl::HashTable<uintptr_t, FutexNode*>;
-
     FutexNode();
     ~FutexNode();
 
@@ -42,15 +40,15 @@ public:
                                      uintptr_t new_hash_key);
 
     // This must be called with |mutex| held and returns without |mutex| held.
-    status_t BlockThread(Mutex* mutex, mx_time_t deadline) TA_REL(mutex);
+    // If |owner| is non-null, it inherits the current thread's priority
+    // until the wait ends or the node is requeued.
+    status_t BlockThread(Mutex* mutex, mx_time_t deadline, thread_t* owner) TA_REL(mutex);
 
     void set_hash_key(uintptr_t key) {
         hash_key_ = key;
     }
 
-    // Trait implementation for mxtl::HashTable
     uintptr_t GetKey() const { return hash_key_; }
-    static size_t GetHash(uintptr_t key) { return (key >> 3); }
 
 private:
     static void RelinkAsAdjacent(FutexNode* node1, FutexNode* node2);
@@ -60,15 +58,21 @@ private:
 
     void MarkAsNotInQueue();
 
+    void ClearOwner();
+
     // hash_key_ contains the futex address.  This field has two roles:
     //  * It is used by FutexWait() to determine which queue to remove the
     //    thread from when a wait operation times out.
     //  * Additionally, when this FutexNode is the head of a futex wait
-    //    queue, this field is used by the HashTable (because it uses
-    //    intrusive SinglyLinkedLists).
+    //    queue, this field is used to find it in its FutexContext bucket.
+    //  * While the node is in a queue, it is only changed with the
+    //    FutexContext bucket lock for its current value held (and, when
+    //    requeuing, the lock for the new value too).
     uintptr_t hash_key_;
 
-    // Used for waking the thread corresponding to the FutexNode.
+    // Used for waking the thread corresponding to the FutexNode.  While the
+    // thread waits, the owner of this queue is the futex owner named by the
+    // waiter, if any.
     wait_queue_t wait_queue_;
 
     // queue_prev_ and queue_next_ are used for maintaining a circular
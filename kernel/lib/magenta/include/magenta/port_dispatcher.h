@@ -69,13 +69,16 @@
 //   Note that the objet no longer has a |w| to the observer
 //   but the observer still owns the port via |rc|.
 //
-//   For repeating ports |w| is always valid until the wait is
-//   canceled.
+//   For repeating and edge ports |w| is always valid until the wait is
+//   canceled. While the packet is queued, further state changes update it
+//   in place rather than queuing another.
 //
 //   The |o1| pointer is used to destroy the port observer only
 //   when cancelation happens and the port still owns the packet.
 //
 
+LOCKSTAT_CLASS_DECLARE(port);
+
 class PortDispatcher;
 class PortObserver;
 
@@ -128,6 +131,10 @@ private:
     const Handle* const handle_;
     mxtl::RefPtr<PortDispatcher> const port_;
 
+    // The state last seen by an MX_PKT_TYPE_SIGNAL_EDGE observer, against
+    // which newly asserted signals are found. Guarded by the state tracker.
+    mx_signals_t last_state_;
+
     PortPacket packet_;
 };
 
@@ -142,6 +149,10 @@ public:
 
     void on_zero_handles() final;
 
+    // Queues |port_packet|. For signal packets (|observed| is non-zero) which
+    // are already queued, the packet is updated in place instead: |observed|
+    // replaces the observed signals and, for edge packets, |count| is added
+    // to the count of edges not yet dequeued.
     mx_status_t Queue(PortPacket* port_packet, mx_signals_t observed, uint64_t count);
     mx_status_t QueueUser(const mx_port_packet_t& packet);
     mx_status_t DeQueue(mx_time_t deadline, mx_port_packet_t* packet);
@@ -174,7 +185,7 @@ private:
     void UnlinkExceptionPort(ExceptionPort* eport);
 
     mxtl::Canary<mxtl::magic("POR2")> canary_;
-    Mutex lock_;
+    Mutex lock_{LOCKSTAT_CLASS(port)};
     Semaphore sema_;
     bool zero_handles_ TA_GUARDED(lock_);
     mxtl::DoublyLinkedList<PortPacket*> packets_ TA_GUARDED(lock_);
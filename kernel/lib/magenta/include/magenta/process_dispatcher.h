@@ -31,6 +31,8 @@
 
 class JobDispatcher;
 
+LOCKSTAT_CLASS_DECLARE(handle_table);
+
 class ProcessDispatcher : public Dispatcher {
 public:
     static mx_status_t Create(
@@ -309,7 +311,7 @@ private:
     mxtl::RefPtr<VmAspace> aspace_;
 
     // our list of handles
-    mutable Mutex handle_table_lock_; // protects |handles_|.
+    mutable Mutex handle_table_lock_{LOCKSTAT_CLASS(handle_table)}; // protects |handles_|.
     mxtl::DoublyLinkedList<Handle*> handles_ TA_GUARDED(handle_table_lock_);
 
     StateTracker state_tracker_;
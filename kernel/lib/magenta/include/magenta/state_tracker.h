@@ -17,6 +17,8 @@
 
 class Handle;
 
+LOCKSTAT_CLASS_DECLARE(state_tracker);
+
 class CookieJar {
 public:
     CookieJar() : scope_(MX_KOID_INVALID), cookie_(0) {}
@@ -76,7 +78,7 @@ private:
     mxtl::Canary<mxtl::magic("STRK")> canary_;
 
     mx_signals_t signals_;
-    Mutex lock_;
+    Mutex lock_{LOCKSTAT_CLASS(state_tracker)};
 
     // Active observers are elements in |observers_|.
     ObserverList observers_ TA_GUARDED(lock_);
@@ -112,6 +112,8 @@ public:
     ProcessDispatcher* process() { return process_.get(); }
 
     FutexNode* futex_node() { return &futex_node_; }
+    // The underlying kernel thread, which lives as long as this dispatcher.
+    thread_t* kernel_thread() { return &thread_; }
     status_t set_name(const char* name, size_t len) final;
     void get_name(char out_name[MX_MAX_NAME_LEN]) const final;
     uint64_t runtime_ns() const { return thread_runtime(&thread_); }
@@ -154,6 +156,9 @@ public:
     // Fetch per thread stats for userspace.
     mx_status_t GetStatsForUserspace(mx_info_thread_stats_t* info);
 
+    // Fetch the scheduler latency histograms of the thread for userspace.
+    mx_status_t GetSchedStatsForUserspace(mx_info_thread_sched_stats_t* info);
+
     // For debugger usage.
     // TODO(dje): The term "state" here conflicts with "state tracker".
     uint32_t get_num_state_kinds() const;
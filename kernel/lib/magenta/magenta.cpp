@@ -46,8 +46,10 @@ constexpr size_t kMaxHandleCount = 256 * 1024u;
 // there are this many outstanding handles.
 constexpr size_t kHighHandleCount = (kMaxHandleCount * 7) / 8;
 
+LOCKSTAT_CLASS_DEFINE(handle, "handle");
+
 // The handle arena and its mutex. It also guards Dispatcher::handle_count_.
-static Mutex handle_mutex;
+static Mutex handle_mutex(LOCKSTAT_CLASS(handle));
 static mxtl::Arena TA_GUARDED(handle_mutex) handle_arena;
 static size_t outstanding_handles TA_GUARDED(handle_mutex) = 0u;
 
@@ -506,7 +508,7 @@ static void oom_lowmem(size_t shortfall_bytes) {
 }
 
 void magenta_init(uint level) TA_NO_THREAD_SAFETY_ANALYSIS {
-    handle_arena.Init("handles", sizeof(Handle), kMaxHandleCount);
+    handle_arena.Init("handles", sizeof(Handle), kMaxHandleCount, mxtl::Arena::kFlagLargePages);
     root_job = JobDispatcher::CreateRootJob();
     policy_manager = PolicyManager::Create();
     // Be sure to update kernel_cmdline.md if any of these defaults change.
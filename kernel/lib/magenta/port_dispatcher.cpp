@@ -21,6 +21,8 @@
 
 #include <kernel/auto_lock.h>
 
+LOCKSTAT_CLASS_DEFINE(port, "port");
+
 PortPacket::PortPacket() : packet{}, observer(nullptr) {
     // Note that packet is initialized to zeros.
 }
@@ -31,7 +33,8 @@ PortObserver::PortObserver(uint32_t type, Handle* handle, mxtl::RefPtr<PortDispa
       key_(key),
       trigger_(signals),
       handle_(handle),
-      port_(mxtl::move(port)) {
+      port_(mxtl::move(port)),
+      last_state_(0u) {
 
     auto& packet = packet_.packet;
     packet.status = MX_OK;
@@ -44,7 +47,8 @@ StateObserver::Flags PortObserver::OnInitialize(mx_signals_t initial_state,
                                                 const StateObserver::CountInfo* cinfo) {
     uint64_t count = 1u;
 
-    if (cinfo) {
+    // Edge packets count transitions rather than pending operations.
+    if (cinfo && (type_ != MX_PKT_TYPE_SIGNAL_EDGE)) {
         for (const auto& entry : cinfo->entry) {
             if ((entry.signal & trigger_) && (entry.count > 0u)) {
                 count = entry.count;
@@ -80,8 +84,18 @@ void PortObserver::OnRemoved() {
 
 StateObserver::Flags PortObserver::MaybeQueue(mx_signals_t new_state, uint64_t count) {
     // Always called with the object state lock being held.
-    if ((trigger_ & new_state) == 0u)
+    if (type_ == MX_PKT_TYPE_SIGNAL_EDGE) {
+        // Queue a packet only for trigger signals which have just become
+        // asserted, that is, which were deasserted at the previous state
+        // change. A signal which stays asserted is reported once, not again
+        // on every later state change.
+        mx_signals_t rising = trigger_ & new_state & ~last_state_;
+        last_state_ = new_state;
+        if (rising == 0u)
+            return 0;
+    } else if ((trigger_ & new_state) == 0u) {
         return 0;
+    }
 
     auto status = port_->Queue(&packet_, new_state, count);
 
@@ -164,10 +178,16 @@ mx_status_t PortDispatcher::Queue(PortPacket* port_packet,
             return MX_ERR_BAD_STATE;
 
         if (observed) {
-            if (port_packet->InContainer())
+            auto& signal = port_packet->packet.signal;
+            if (port_packet->InContainer()) {
+                // Coalesce with the packet which has not been dequeued yet.
+                signal.observed = observed;
+                if (port_packet->type() == MX_PKT_TYPE_SIGNAL_EDGE)
+                    signal.count += count;
                 return MX_OK;
-            port_packet->packet.signal.observed = observed;
-            port_packet->packet.signal.count = count;
+            }
+            signal.observed = observed;
+            signal.count = count;
         }
 
         packets_.push_back(port_packet);
@@ -234,13 +254,26 @@ mx_status_t PortDispatcher::MakeObservers(uint32_t options, Handle* handle,
 
     // Called under the handle table lock.
 
+    uint32_t type;
+    switch (options) {
+    case MX_WAIT_ASYNC_ONCE:
+        type = MX_PKT_TYPE_SIGNAL_ONE;
+        break;
+    case MX_WAIT_ASYNC_REPEATING:
+        type = MX_PKT_TYPE_SIGNAL_REP;
+        break;
+    case MX_WAIT_ASYNC_EDGE:
+        type = MX_PKT_TYPE_SIGNAL_EDGE;
+        break;
+    default:
+        return MX_ERR_INVALID_ARGS;
+    }
+
     auto dispatcher = handle->dispatcher();
     if (!dispatcher->get_state_tracker())
         return MX_ERR_NOT_SUPPORTED;
 
     AllocChecker ac;
-    auto type = (options == MX_WAIT_ASYNC_ONCE) ?
-        MX_PKT_TYPE_SIGNAL_ONE : MX_PKT_TYPE_SIGNAL_REP;
 
     auto observer = new (&ac) PortObserver(type,
             handle, mxtl::RefPtr<PortDispatcher>(this), key, signals);
@@ -40,6 +40,8 @@
 
 #define LOCAL_TRACE 0
 
+LOCKSTAT_CLASS_DEFINE(handle_table, "handle_table");
+
 static mx_handle_t map_handle_to_value(const Handle* handle, mx_handle_t mixer) {
     // Ensure that the last bit of the result is not zero, and make sure
     // we don't lose any base_value bits or make the result negative
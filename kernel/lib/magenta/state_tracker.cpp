@@ -9,6 +9,8 @@
 #include <kernel/auto_lock.h>
 #include <magenta/wait_event.h>
 
+LOCKSTAT_CLASS_DEFINE(state_tracker, "state_tracker");
+
 namespace {
 
 template <typename Func>
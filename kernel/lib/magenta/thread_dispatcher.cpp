@@ -885,6 +885,27 @@ mx_status_t ThreadDispatcher::GetStatsForUserspace(mx_info_thread_stats_t* info)
     return MX_OK;
 }
 
+mx_status_t ThreadDispatcher::GetSchedStatsForUserspace(mx_info_thread_sched_stats_t* info) {
+    canary_.Assert();
+
+    LTRACE_ENTRY_OBJ;
+
+    struct sched_stats stats;
+    thread_get_sched_stats(&thread_, &stats);
+
+    static_assert(MX_INFO_SCHED_STATS_TIME_BUCKETS == SCHED_STATS_TIME_BUCKETS, "");
+    static_assert(MX_INFO_SCHED_STATS_DEPTH_BUCKETS == SCHED_STATS_DEPTH_BUCKETS, "");
+    *info = {};
+    for (uint i = 0; i < SCHED_STATS_TIME_BUCKETS; i++) {
+        info->wakeup_latency[i] = stats.wakeup_latency[i];
+        info->run_slice[i] = stats.run_slice[i];
+    }
+    for (uint i = 0; i < SCHED_STATS_DEPTH_BUCKETS; i++) {
+        info->run_queue_depth[i] = stats.run_queue_depth[i];
+    }
+    return MX_OK;
+}
+
 status_t ThreadDispatcher::GetExceptionReport(mx_exception_report_t* report) {
     canary_.Assert();
 
@@ -33,12 +33,14 @@ Arena::~Arena() {
     }
 }
 
-status_t Arena::Init(const char* name, size_t ob_size, size_t count) {
+status_t Arena::Init(const char* name, size_t ob_size, size_t count, uint32_t flags) {
     if ((ob_size == 0) || (ob_size > PAGE_SIZE))
         return MX_ERR_INVALID_ARGS;
     if (!count)
         return MX_ERR_INVALID_ARGS;
-    LTRACEF("Arena '%s': ob_size %zu, count %zu\n", name, ob_size, count);
+    if (flags & ~kFlagLargePages)
+        return MX_ERR_INVALID_ARGS;
+    LTRACEF("Arena '%s': ob_size %zu, count %zu, flags %#x\n", name, ob_size, count, flags);
 
     // Carve out the memory:
     // - Kernel root VMAR
@@ -47,11 +49,15 @@ status_t Arena::Init(const char* name, size_t ob_size, size_t count) {
     //     + Unmapped guard page
     //     + Data pool mapping
     // Both mappings are backed by a single VMO.
+    // With kFlagLargePages, the data pool is sized and aligned to large
+    // pages, with the guard widened to match.
+    const bool large_pages = (flags & kFlagLargePages) != 0;
+    const size_t data_align = large_pages ? LARGE_PAGE_SIZE : PAGE_SIZE;
     const size_t control_mem_sz = ROUNDUP(count * sizeof(Node), PAGE_SIZE);
-    const size_t data_mem_sz = ROUNDUP(count * ob_size, PAGE_SIZE);
-    const size_t guard_sz = PAGE_SIZE;
+    const size_t data_mem_sz = ROUNDUP(count * ob_size, data_align);
+    const size_t data_offset = ROUNDUP(control_mem_sz + PAGE_SIZE, data_align);
     const size_t vmo_sz = control_mem_sz + data_mem_sz;
-    const size_t vmar_sz = vmo_sz + guard_sz;
+    const size_t vmar_sz = data_offset + data_mem_sz;
 
     // Create the VMO.
     mxtl::RefPtr<VmObject> vmo;
@@ -74,7 +80,7 @@ status_t Arena::Init(const char* name, size_t ob_size, size_t count) {
     mxtl::RefPtr<VmAddressRegion> vmar;
     status_t st = root_vmar->CreateSubVmar(0, // offset (ignored)
                                            vmar_sz,
-                                           false, // align_pow2
+                                           large_pages ? LARGE_PAGE_SIZE_SHIFT : 0,
                                            VMAR_FLAG_CAN_MAP_READ |
                                                VMAR_FLAG_CAN_MAP_WRITE |
                                                VMAR_FLAG_CAN_MAP_SPECIFIC,
@@ -108,10 +114,11 @@ status_t Arena::Init(const char* name, size_t ob_size, size_t count) {
     // Create a mapping for the data pool, leaving an unmapped gap
     // between it and the control pool.
     mxtl::RefPtr<VmMapping> data_mapping;
-    st = vmar->CreateVmMapping(control_mem_sz + guard_sz, // mapping_offset
+    st = vmar->CreateVmMapping(data_offset, // mapping_offset
                                data_mem_sz,
                                false, // align_pow2
-                               VMAR_FLAG_SPECIFIC,
+                               VMAR_FLAG_SPECIFIC |
+                                   (large_pages ? VMAR_FLAG_LARGE_PAGES : 0),
                                vmo,
                                control_mem_sz, // vmo_offset
                                ARCH_MMU_FLAG_PERM_READ |
@@ -126,8 +133,8 @@ status_t Arena::Init(const char* name, size_t ob_size, size_t count) {
     // TODO(dbort): Add a VmMapping flag that says "do not demand page",
     // requiring and ensuring that we commit our pages manually.
 
-    control_.Init("control", control_mapping, sizeof(Node));
-    data_.Init("data", data_mapping, ob_size);
+    control_.Init("control", control_mapping, sizeof(Node), false);
+    data_.Init("data", data_mapping, ob_size, large_pages);
 
     vmar_ = vmar;
     destroy_vmar.cancel();
@@ -139,12 +146,14 @@ status_t Arena::Init(const char* name, size_t ob_size, size_t count) {
 }
 
 void Arena::Pool::Init(const char* name, mxtl::RefPtr<VmMapping> mapping,
-                       size_t slot_size) {
+                       size_t slot_size, bool large_pages) {
     DEBUG_ASSERT(mapping != nullptr);
     DEBUG_ASSERT(slot_size > 0);
+    DEBUG_ASSERT(!large_pages || (mapping->flags() & VMAR_FLAG_LARGE_PAGES));
 
     strlcpy(const_cast<char*>(name_), name, sizeof(name_));
     slot_size_ = slot_size;
+    large_pages_ = large_pages;
     mapping_ = mapping;
     committed_max_ = committed_ = top_ = start_ =
         reinterpret_cast<char*>(mapping_->base());
@@ -152,6 +161,8 @@ void Arena::Pool::Init(const char* name, mxtl::RefPtr<VmMapping> mapping,
 
     DEBUG_ASSERT(IS_PAGE_ALIGNED(start_));
     DEBUG_ASSERT(IS_PAGE_ALIGNED(end_));
+    DEBUG_ASSERT(!large_pages_ || IS_ALIGNED(start_, LARGE_PAGE_SIZE));
+    DEBUG_ASSERT(!large_pages_ || IS_ALIGNED(end_, LARGE_PAGE_SIZE));
 }
 
 // Pick values that avoid lots of commits + decommits when
@@ -167,7 +178,7 @@ void* Arena::Pool::Pop() {
     }
     if (top_ + slot_size_ > committed_) {
         // We've hit the end of our committed pages; commit some more.
-        char* nc = committed_ + kPoolCommitIncrease;
+        char* nc = committed_ + (large_pages_ ? LARGE_PAGE_SIZE : kPoolCommitIncrease);
         if (nc > end_) {
             nc = end_;
         }
@@ -175,6 +186,12 @@ void* Arena::Pool::Pop() {
         const size_t offset =
             reinterpret_cast<vaddr_t>(committed_) - mapping_->base();
         const size_t len = nc - committed_;
+        if (large_pages_) {
+            // Try for an aligned physical run, which MapRange will map with
+            // a large page. Failing that, it commits individual pages.
+            mapping_->vmo()->CommitRangeContiguous(mapping_->object_offset() + offset, len,
+                                                   nullptr, LARGE_PAGE_SIZE_SHIFT);
+        }
         status_t st = mapping_->MapRange(offset, len, /* commit */ true);
         if (st != MX_OK) {
             LTRACEF("%s: can't map range 0x%p..0x%p: %d\n",
@@ -198,7 +215,10 @@ void Arena::Pool::Push(void* p) {
     // Can only push the most-recently-popped slot.
     ASSERT(reinterpret_cast<char*>(p) + slot_size_ == top_);
     top_ -= slot_size_;
-    if (static_cast<size_t>(committed_ - top_) >= kPoolDecommitThreshold) {
+    // Large pages are not decommitted: CommitRangeContiguous() pins them, and
+    // the arch layer can't unmap part of one.
+    if (!large_pages_ &&
+        static_cast<size_t>(committed_ - top_) >= kPoolDecommitThreshold) {
         char* nc = reinterpret_cast<char*>(
             ROUNDUP(reinterpret_cast<uintptr_t>(top_ + kPoolCommitIncrease),
                     PAGE_SIZE));
@@ -242,6 +242,38 @@ static bool committing_tests(void* context) {
     END_TEST;
 }
 
+static bool large_page_committing_tests(void* context) {
+    BEGIN_TEST;
+    static const size_t num_slots = (2 * LARGE_PAGE_SIZE) / sizeof(TestObj);
+
+    Arena arena;
+    EXPECT_EQ(MX_OK, arena.Init("name", sizeof(TestObj), num_slots,
+                                Arena::kFlagLargePages), "");
+
+    auto start = reinterpret_cast<vaddr_t>(arena.start());
+    auto end = reinterpret_cast<vaddr_t>(arena.end());
+    EXPECT_TRUE(IS_ALIGNED(start, LARGE_PAGE_SIZE), "");
+    EXPECT_TRUE(IS_ALIGNED(end, LARGE_PAGE_SIZE), "");
+
+    // Allocating an object should commit exactly the first large page.
+    size_t committed;
+    size_t uncommitted;
+    auto obj = arena.Alloc();
+    EXPECT_NONNULL(obj, "");
+    EXPECT_TRUE(
+        count_committed_pages(start, end, &committed, &uncommitted), "");
+    EXPECT_EQ(static_cast<size_t>(LARGE_PAGE_SIZE / PAGE_SIZE), committed, "");
+
+    // Every page of it should be mapped, whether or not the memory was
+    // contiguous.
+    for (vaddr_t va = start; va < start + LARGE_PAGE_SIZE; va += PAGE_SIZE) {
+        paddr_t pa;
+        EXPECT_EQ(MX_OK, VmAspace::kernel_aspace()->arch_aspace().Query(va, &pa, nullptr), "");
+    }
+    arena.Free(obj);
+    END_TEST;
+}
+
 // Friend class that can see inside an Arena.
 namespace mxtl {
 class ArenaTestFriend {
@@ -503,6 +535,7 @@ ARENA_UNITTEST(start_and_end_look_good)
 ARENA_UNITTEST(in_range_tests)
 ARENA_UNITTEST(out_of_memory)
 ARENA_UNITTEST(committing_tests)
+ARENA_UNITTEST(large_page_committing_tests)
 ARENA_UNITTEST(uncommitting_tests)
 ARENA_UNITTEST(memory_cleanup)
 ARENA_UNITTEST(content_preservation)
@@ -31,7 +31,11 @@ public:
     Arena() = default;
     ~Arena();
 
-    status_t Init(const char* name, size_t ob_size, size_t max_count);
+    // Back the objects with large pages where physically contiguous memory
+    // is available. Memory is then committed a large page at a time.
+    static constexpr uint32_t kFlagLargePages = 1u << 0;
+
+    status_t Init(const char* name, size_t ob_size, size_t max_count, uint32_t flags = 0);
     void* Alloc();
     void Free(void* addr);
     bool in_range(void* addr) const {
@@ -64,8 +68,10 @@ private:
         // Initializes the pool. |mapping| must be fully backed by its
         // VMO, but should not have any committed pages. |slot_size|
         // is the size of object returned/accepted by Pop/Push.
+        // If |large_pages|, |mapping| must be created with
+        // VMAR_FLAG_LARGE_PAGES and be large page aligned.
         void Init(const char* name, mxtl::RefPtr<VmMapping> mapping,
-                  size_t slot_size);
+                  size_t slot_size, bool large_pages);
 
         // Returns a pointer to a |slot_size| piece of memory, or nullptr
         // if there is no memory available.
@@ -98,6 +104,7 @@ private:
 
         mxtl::RefPtr<VmMapping> mapping_;
         size_t slot_size_;
+        bool large_pages_;
         char* start_;
         char* top_;           // |start|..|top| contains all allocated slots.
         char* committed_;     // |start|..|mapped| is committed.
@@ -7,6 +7,7 @@
 #include <trace.h>
 
 #include <magenta/process_dispatcher.h>
+#include <magenta/thread_dispatcher.h>
 
 #include "syscalls_priv.h"
 
@@ -16,7 +17,28 @@ mx_status_t sys_futex_wait(user_ptr<mx_futex_t> value_ptr, int current_value, mx
     LTRACEF("futex %p current %d\n", value_ptr.get(), current_value);
 
     return ProcessDispatcher::GetCurrent()->futex_context()->FutexWait(
-        value_ptr, current_value, deadline);
+        value_ptr, current_value, deadline, nullptr);
+}
+
+mx_status_t sys_futex_wait_owner(user_ptr<mx_futex_t> value_ptr, int current_value,
+                                 mx_handle_t owner, mx_time_t deadline) {
+    LTRACEF("futex %p current %d owner %x\n", value_ptr.get(), current_value, owner);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // The reference keeps the owner's kernel thread alive for the whole wait.
+    mxtl::RefPtr<ThreadDispatcher> thread;
+    mx_status_t status = up->GetDispatcherWithRights(owner, MX_RIGHT_READ, &thread);
+    if (status != MX_OK)
+        return status;
+
+    // Futexes are private to a process, and so are their owners.  A thread
+    // which waits for itself would never be woken.
+    if (thread->process() != up || thread.get() == ThreadDispatcher::GetCurrent())
+        return MX_ERR_INVALID_ARGS;
+
+    return up->futex_context()->FutexWait(
+        value_ptr, current_value, deadline, thread->kernel_thread());
 }
 
 mx_status_t sys_futex_wake(user_ptr<const mx_futex_t> value_ptr, uint32_t count) {
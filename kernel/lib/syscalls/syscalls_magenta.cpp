@@ -20,6 +20,7 @@
 #include <lib/crypto/global_prng.h>
 #include <lib/user_copy.h>
 #include <lib/user_copy/user_ptr.h>
+#include <lib/vdso.h>
 
 #include <magenta/event_dispatcher.h>
 #include <magenta/event_pair_dispatcher.h>
@@ -59,7 +60,11 @@ mx_status_t sys_nanosleep(mx_time_t deadline) {
 // This must be accessed atomically from any given thread.
 static mxtl::atomic<int64_t> utc_offset;
 
-uint64_t sys_time_get(uint32_t clock_id) {
+// Serializes updates of utc_offset and of its copy in the vDSO, so the two
+// can't be left disagreeing by racing mx_clock_adjust calls.
+static Mutex utc_offset_lock;
+
+uint64_t sys_time_get_kernel(uint32_t clock_id) {
     switch (clock_id) {
     case MX_CLOCK_MONOTONIC:
         return current_time();
@@ -83,9 +88,12 @@ mx_status_t sys_clock_adjust(mx_handle_t hrsrc, uint32_t clock_id, int64_t offse
     switch (clock_id) {
     case MX_CLOCK_MONOTONIC:
         return MX_ERR_ACCESS_DENIED;
-    case MX_CLOCK_UTC:
+    case MX_CLOCK_UTC: {
+        AutoLock lock(&utc_offset_lock);
         utc_offset.store(offset);
+        VDso::SetUtcOffset(offset);
         return MX_OK;
+    }
     default:
         return MX_ERR_INVALID_ARGS;
     }
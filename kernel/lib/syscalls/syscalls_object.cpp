@@ -8,11 +8,13 @@
 #include <inttypes.h>
 #include <trace.h>
 
+#include <kernel/lockstat.h>
 #include <kernel/mp.h>
 #include <kernel/stats.h>
 #include <kernel/vm/pmm.h>
 #include <lib/heap.h>
 #include <platform.h>
+#include <string.h>
 
 #include <magenta/diagnostics.h>
 #include <magenta/handle_owner.h>
@@ -22,6 +24,7 @@
 #include <magenta/resource_dispatcher.h>
 #include <magenta/thread_dispatcher.h>
 #include <magenta/vm_address_region_dispatcher.h>
+#include <magenta/vm_object_dispatcher.h>
 
 #include <mxtl/ref_ptr.h>
 
@@ -279,6 +282,23 @@ mx_status_t sys_object_get_info(mx_handle_t handle, uint32_t topic,
             return single_record_result(
                 _buffer, buffer_size, _actual, _avail, &info, sizeof(info));
         }
+        case MX_INFO_THREAD_SCHED_STATS: {
+            // grab a reference to the dispatcher
+            mxtl::RefPtr<ThreadDispatcher> thread;
+            auto error = up->GetDispatcherWithRights(handle, MX_RIGHT_READ, &thread);
+            if (error < 0)
+                return error;
+
+            // build the info structure
+            mx_info_thread_sched_stats_t info = { };
+
+            auto err = thread->GetSchedStatsForUserspace(&info);
+            if (err != MX_OK)
+                return err;
+
+            return single_record_result(
+                _buffer, buffer_size, _actual, _avail, &info, sizeof(info));
+        }
         case MX_INFO_TASK_STATS: {
             // TODO(MG-458): Handle forward/backward compatibility issues
             // with changes to the struct.
@@ -430,6 +450,55 @@ mx_status_t sys_object_get_info(mx_handle_t handle, uint32_t topic,
                 return MX_ERR_INVALID_ARGS;
             return MX_OK;
         }
+        case MX_INFO_CPU_SCHED_STATS: {
+            // grab a reference to the dispatcher
+            mxtl::RefPtr<ResourceDispatcher> resource;
+            auto error = up->GetDispatcherWithRights(handle, MX_RIGHT_NONE, &resource);
+            if (error < 0)
+                return error;
+
+            // TODO: check that this is the root resource
+
+            size_t num_cpus = arch_max_num_cpus();
+            size_t num_space_for = buffer_size / sizeof(mx_info_cpu_sched_stats_t);
+            size_t num_to_copy = MIN(num_cpus, num_space_for);
+
+            user_ptr<mx_info_cpu_sched_stats_t> cpu_buf(
+                static_cast<mx_info_cpu_sched_stats_t*>(_buffer.get()));
+
+            static_assert(MX_INFO_SCHED_STATS_TIME_BUCKETS == SCHED_STATS_TIME_BUCKETS, "");
+            static_assert(MX_INFO_SCHED_STATS_DEPTH_BUCKETS == SCHED_STATS_DEPTH_BUCKETS, "");
+            for (unsigned int i = 0; i < static_cast<unsigned int>(num_to_copy); i++) {
+                // the histograms are updated under the thread lock, so copy
+                // them whole before copying out
+                struct sched_stats sched;
+                {
+                    AutoSpinLockIrqSave lock(&thread_lock);
+                    sched = percpu[i].stats.sched;
+                }
+
+                mx_info_cpu_sched_stats_t stats = {};
+                stats.cpu_number = i;
+                stats.flags = mp_is_cpu_online(i) ? MX_INFO_CPU_STATS_FLAG_ONLINE : 0;
+                for (uint b = 0; b < SCHED_STATS_TIME_BUCKETS; b++) {
+                    stats.wakeup_latency[b] = sched.wakeup_latency[b];
+                    stats.run_slice[b] = sched.run_slice[b];
+                }
+                for (uint b = 0; b < SCHED_STATS_DEPTH_BUCKETS; b++) {
+                    stats.run_queue_depth[b] = sched.run_queue_depth[b];
+                }
+
+                // copy out one at a time
+                if (cpu_buf.copy_array_to_user(&stats, 1, i) != MX_OK)
+                    return MX_ERR_INVALID_ARGS;
+            }
+
+            if (_actual && (_actual.copy_to_user(num_to_copy) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            if (_avail && (_avail.copy_to_user(num_cpus) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            return MX_OK;
+        }
         case MX_INFO_KMEM_STATS: {
             // grab a reference to the dispatcher
             mxtl::RefPtr<ResourceDispatcher> resource;
@@ -497,6 +566,65 @@ mx_status_t sys_object_get_info(mx_handle_t handle, uint32_t topic,
             return single_record_result(
                 _buffer, buffer_size, _actual, _avail, &info, sizeof(info));
         }
+        case MX_INFO_VMO_CHAIN: {
+            mxtl::RefPtr<VmObjectDispatcher> vmo;
+            mx_status_t status = up->GetDispatcherWithRights(handle, MX_RIGHT_READ, &vmo);
+            if (status < 0)
+                return status;
+
+            mx_info_vmo_chain_t info = {};
+            info.depth = vmo->vmo()->CowChainDepth();
+
+            return single_record_result(
+                _buffer, buffer_size, _actual, _avail, &info, sizeof(info));
+        }
+        case MX_INFO_LOCK_STATS: {
+            // grab a reference to the dispatcher
+            mxtl::RefPtr<ResourceDispatcher> resource;
+            auto error = up->GetDispatcherWithRights(handle, MX_RIGHT_NONE, &resource);
+            if (error < 0)
+                return error;
+
+            // TODO: check that this is the root resource
+
+            // there are no lock classes unless the kernel is built with them
+            size_t num_classes = lockstat_class_count();
+            if (num_classes == 0)
+                return MX_ERR_NOT_SUPPORTED;
+
+            size_t num_space_for = buffer_size / sizeof(mx_info_lock_stats_t);
+            size_t num_to_copy = MIN(num_classes, num_space_for);
+
+            user_ptr<mx_info_lock_stats_t> stats_buf(
+                static_cast<mx_info_lock_stats_t*>(_buffer.get()));
+
+            static_assert(MX_INFO_LOCK_STATS_BUCKETS == LOCKSTAT_HISTOGRAM_BUCKETS, "");
+            for (size_t i = 0; i < num_to_copy; i++) {
+                lockstat_counters_t counters;
+                const char* name = lockstat_read_class(i, &counters);
+
+                mx_info_lock_stats_t stats = {};
+                strlcpy(stats.name, name, sizeof(stats.name));
+                stats.acquisitions = counters.acquisitions;
+                stats.contentions = counters.contentions;
+                stats.wait_time = counters.wait_time;
+                stats.max_wait_time = counters.max_wait_time;
+                stats.hold_time = counters.hold_time;
+                stats.max_hold_time = counters.max_hold_time;
+                memcpy(stats.wait_histogram, counters.wait_histogram, sizeof(stats.wait_histogram));
+                memcpy(stats.hold_histogram, counters.hold_histogram, sizeof(stats.hold_histogram));
+
+                // copy out one at a time
+                if (stats_buf.copy_array_to_user(&stats, 1, i) != MX_OK)
+                    return MX_ERR_INVALID_ARGS;
+            }
+
+            if (_actual && (_actual.copy_to_user(num_to_copy) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            if (_avail && (_avail.copy_to_user(num_classes) != MX_OK))
+                return MX_ERR_INVALID_ARGS;
+            return MX_OK;
+        }
         default:
             return MX_ERR_NOT_SUPPORTED;
     }
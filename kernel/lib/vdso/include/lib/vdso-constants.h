@@ -11,9 +11,12 @@
 // environments.  It must use only the basic types so that struct
 // layouts match exactly in both contexts.
 
-#define VDSO_CONSTANTS_SIZE (4 * 4 + 2 * 8)
+#define VDSO_CONSTANTS_SIZE (6 * 4 + 2 * 8)
 #define VDSO_CONSTANTS_ALIGN 8
 
+#define VDSO_UTC_SIZE 8
+#define VDSO_UTC_ALIGN 8
+
 #ifndef ASSEMBLY
 
 #include <stdint.h>
@@ -34,6 +37,16 @@ struct vdso_constants {
     // Number of bytes in an instruction cache line.
     uint32_t icache_line_size;
 
+    // Conversion factor from the hardware counter (the TSC on x86, the
+    // virtual counter on ARM) to MX_CLOCK_MONOTONIC nanoseconds, as the
+    // three words of a struct fp_32_64 (see kernel/lib/fixed_point).
+    // The kernel computes its own time the same way, so the two agree
+    // exactly.  All zero if the kernel's clock is not that counter, in
+    // which case the vDSO asks the kernel for the time.
+    uint32_t ns_per_tick_l0;
+    uint32_t ns_per_tick_l32;
+    uint32_t ns_per_tick_l64;
+
     // Conversion factor for mx_ticks_get return values to seconds.
     uint64_t ticks_per_second;
 
@@ -46,4 +59,18 @@ static_assert(VDSO_CONSTANTS_SIZE == sizeof(vdso_constants),
 static_assert(VDSO_CONSTANTS_ALIGN == alignof(vdso_constants),
               "Need to adjust VDSO_CONSTANTS_ALIGN");
 
+// Unlike vdso_constants, this is rewritten by the kernel whenever
+// mx_clock_adjust sets the UTC offset.  The offset is a single
+// naturally-aligned word, so the vDSO reads it with one atomic load.
+struct vdso_utc {
+
+    // MX_CLOCK_UTC minus MX_CLOCK_MONOTONIC, in nanoseconds.
+    int64_t offset;
+};
+
+static_assert(VDSO_UTC_SIZE == sizeof(vdso_utc),
+              "Need to adjust VDSO_UTC_SIZE");
+static_assert(VDSO_UTC_ALIGN == alignof(vdso_utc),
+              "Need to adjust VDSO_UTC_ALIGN");
+
 #endif // ASSEMBLY
@@ -12,6 +12,7 @@
 #include <kernel/vm/pmm.h>
 #include <kernel/vm/vm_aspace.h>
 #include <kernel/vm/vm_object.h>
+#include <lib/fixed_point.h>
 #include <mxalloc/new.h>
 #include <mxtl/type_support.h>
 #include <platform.h>
@@ -197,6 +198,24 @@ void blacklist_##category##_syscalls(VDsoDynSymWindow& dynsym_window, \
 #undef SYSCALL_IN_CATEGORY_END
 #undef SYSCALL_CATEGORY_END
 
+// The vdso_utc struct of each variant's VMO stays mapped into the kernel
+// for the lifetime of the system, so SetUtcOffset can rewrite it.  Each
+// window is written once before the VMO can be mapped by any process, so
+// that a COW clone has its own copy of the page rather than sharing the
+// main VMO's.
+KernelVmoWindow<vdso_utc>* utc_windows[VDso::variants()];
+
+void create_utc_window(VDso::Variant variant, mxtl::RefPtr<VmObject> vmo) {
+    static_assert(sizeof(vdso_utc) == VDSO_DATA_UTC_SIZE,
+                  "gen-rodso-code.sh is suspect");
+    AllocChecker ac;
+    auto window = new(&ac) KernelVmoWindow<vdso_utc>(
+        "vDSO UTC offset", mxtl::move(vmo), VDSO_DATA_UTC);
+    ASSERT(ac.check());
+    window->data()->offset = 0;
+    utc_windows[static_cast<size_t>(variant)] = window;
+}
+
 } // anonymous namespace
 
 const VDso* VDso::instance_ = NULL;
@@ -220,6 +239,14 @@ const VDso* VDso::Create() {
         "vDSO constants", vdso->vmo()->vmo(), VDSO_DATA_CONSTANTS);
     uint64_t per_second = ticks_per_second();
 
+    // If the kernel's clock is a counter user mode can read too, the vDSO
+    // computes mx_time_get itself; all zeros make it use the syscall.
+    struct fp_32_64 ns_per_tick = {};
+    if (!current_time_from_user_counter(&ns_per_tick) ||
+        cmdline_get_bool("vdso.soft_time", false)) {
+        ns_per_tick = {};
+    }
+
     // Initialize the constants that should be visible to the vDSO.
     // Rather than assigning each member individually, do this with
     // struct assignment and a compound literal so that the compiler
@@ -228,6 +255,9 @@ const VDso* VDso::Create() {
         arch_max_num_cpus(),
         arch_dcache_line_size(),
         arch_icache_line_size(),
+        ns_per_tick.l0,
+        ns_per_tick.l32,
+        ns_per_tick.l64,
         per_second,
         pmm_count_total_bytes(),
     };
@@ -243,6 +273,8 @@ const VDso* VDso::Create() {
         REDIRECT_SYSCALL(dynsym_window, mx_ticks_get, soft_ticks_get);
     }
 
+    create_utc_window(Variant::FULL, vdso->vmo()->vmo());
+
     for (size_t v = static_cast<size_t>(Variant::FULL) + 1;
          v < static_cast<size_t>(Variant::COUNT);
          ++v)
@@ -256,6 +288,12 @@ uintptr_t VDso::base_address(const mxtl::RefPtr<VmMapping>& code_mapping) {
     return code_mapping ? code_mapping->base() - VDSO_CODE_START : 0;
 }
 
+void VDso::SetUtcOffset(int64_t offset) {
+    for (auto window : utc_windows) {
+        __atomic_store_n(&window->data()->offset, offset, __ATOMIC_RELAXED);
+    }
+}
+
 HandleOwner VDso::vmo_handle(Variant variant) const {
     ASSERT(variant < Variant::COUNT);
 
@@ -290,6 +328,7 @@ void VDso::CreateVariant(Variant variant) {
 
     VDsoDynSymWindow dynsym_window(new_vmo);
     VDsoCodeWindow code_window(new_vmo);
+    create_utc_window(variant, new_vmo);
 
     const char* name = nullptr;
     switch (variant) {
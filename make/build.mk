@@ -97,6 +97,27 @@ ifneq ($(USER_AUTORUN),)
 USER_MANIFEST_LINES += autorun=$(USER_AUTORUN)
 endif
 
+# A manifest of the notes of the drivers in bootfs, for devmgr to read at
+# boot rather than opening each of these drivers.  devmgr still lists its
+# driver directories, and opens any driver which is not in the manifest.
+ifneq ($(HOST_PLATFORM),darwin)
+DRIVER_MANIFEST := $(BUILDDIR)/driver-manifest
+DRIVER_MANIFEST_LINES := \
+    $(sort $(filter-out driver/test/%,$(filter driver/%,$(USER_MANIFEST_LINES)))) \
+    $(sort $(filter driver/test/%,$(USER_MANIFEST_LINES))) \
+    $(sort $(filter lib/driver/%,$(USER_MANIFEST_LINES)))
+DRIVER_MANIFEST_DEPS := $(foreach x,$(DRIVER_MANIFEST_LINES),$(lastword $(subst =,$(SPACE),$(strip $(x)))))
+
+$(DRIVER_MANIFEST): $(DRIVER_MANIFEST_TOOL) $(DRIVER_MANIFEST_DEPS)
+	$(call BUILDECHO,generating $@)
+	@$(MKDIR)
+	$(NOECHO)$(DRIVER_MANIFEST_TOOL) -o $@ $(addprefix /boot/,$(DRIVER_MANIFEST_LINES))
+
+GENERATED += $(DRIVER_MANIFEST)
+
+USER_MANIFEST_LINES += config/driver-manifest=$(DRIVER_MANIFEST)
+endif
+
 # generate a new manifest and compare to see if it differs from the previous one
 # USER_MANIFEST_DEBUG_INPUTS is a dependency here as the file name to put in
 # the manifest must be computed *after* the input file is produced (to get the
@@ -24,6 +24,7 @@ ENABLE_BUILD_LISTFILES := $(call TOBOOL,$(ENABLE_BUILD_LISTFILES))
 ENABLE_BUILD_SYSROOT := $(call TOBOOL,$(ENABLE_BUILD_SYSROOT))
 ENABLE_NEW_FB := true
 ENABLE_ACPI_BUS ?= false
+ENABLE_LOCK_STATS ?= false
 USE_ASAN ?= false
 USE_SANCOV ?= false
 USE_CLANG ?= $(USE_ASAN)
@@ -357,6 +358,11 @@ MDI_INCLUDES := system/public/magenta/mdi/magenta.mdi
 KERNEL_DEFINES += WITH_PANIC_BACKTRACE=1 WITH_FRAME_POINTERS=1
 KERNEL_COMPILEFLAGS += $(KEEP_FRAME_POINTER_COMPILEFLAGS)
 
+# Per lock class contention statistics (see kernel/include/kernel/lockstat.h)
+ifeq ($(call TOBOOL,$(ENABLE_LOCK_STATS)),true)
+KERNEL_DEFINES += WITH_LOCK_STATS=1
+endif
+
 # userspace boot file system generated by the build system
 USER_BOOTDATA := $(BUILDDIR)/bootdata.bin
 USER_FS := $(BUILDDIR)/user.fs
@@ -723,6 +729,7 @@ endif
 
 # tool locations
 MKBOOTFS := $(BUILDDIR)/tools/mkbootfs
+DRIVER_MANIFEST_TOOL := $(BUILDDIR)/tools/driver-manifest
 MDIGEN := $(BUILDDIR)/tools/mdigen
 
 # the logic to compile and link stuff is in here
@@ -16,6 +16,7 @@
 typedef struct dc_work work_t;
 typedef struct dc_pending pending_t;
 typedef struct dc_devhost devhost_t;
+typedef struct dc_devhost_launch devhost_launch_t;
 typedef struct dc_device device_t;
 typedef struct dc_driver driver_t;
 typedef struct dc_devnode devnode_t;
@@ -31,6 +32,8 @@ struct dc_pending {
     list_node_t node;
     void* ctx;
     uint32_t op;
+    // the txid of the request, which its reply carries
+    mx_txid_t txid;
 };
 
 #define PENDING_BIND 1
@@ -43,6 +46,10 @@ struct dc_devhost {
     int32_t refcount;
     uint32_t flags;
 
+    // set until the process has been started; proc and koid are only
+    // valid after that
+    devhost_launch_t* launch;
+
     // list of all devices on this devhost
     list_node_t devices;
 };
@@ -114,6 +121,17 @@ struct dc_device {
 
 #define DEV_CTX_SHADOW     0x40
 
+// The most protocols a driver is indexed under; a binding
+// program that can match more is treated as matching any.
+#define BIND_INDEX_MAX_PROTOCOLS 4
+
+typedef struct bind_index_entry {
+    // listnode for this entry in its bind index bucket
+    list_node_t node;
+    driver_t* drv;
+    uint32_t protocol_id;
+} bind_index_entry_t;
+
 struct dc_driver {
     const char* name;
     const mx_bind_inst_t* binding;
@@ -121,8 +139,42 @@ struct dc_driver {
     uint32_t flags;
     struct list_node node;
     const char* libname;
+
+    // Filled in by dc_compile_binding(): the protocols the
+    // binding program can match devices of, unless it can
+    // match devices of any protocol.
+    bool bind_any;
+    uint32_t bind_protocol_count;
+    uint32_t bind_protocols[BIND_INDEX_MAX_PROTOCOLS];
+
+    // position in the bind index; drivers are tried in
+    // increasing order
+    int64_t bind_order;
+    bind_index_entry_t bind_entries[BIND_INDEX_MAX_PROTOCOLS];
 };
 
+#define BIND_INDEX_BUCKETS 64
+
+// An index of drivers by the protocols their binding
+// programs can match, so that the drivers which might
+// bind to a device can be found without running the
+// binding program of every driver.
+typedef struct bind_index {
+    list_node_t buckets[BIND_INDEX_BUCKETS];
+    // drivers whose binding programs can match any protocol
+    list_node_t any;
+    int64_t head_order;
+    int64_t tail_order;
+} bind_index_t;
+
+// Walks the candidate drivers for a protocol, in order.
+typedef struct bind_index_cursor {
+    bind_index_t* index;
+    uint32_t protocol_id;
+    list_node_t* bucket_pos;
+    list_node_t* any_pos;
+} bind_index_cursor_t;
+
 #define DRIVER_NAME_LEN_MAX 64
 
 mx_status_t devfs_publish(device_t* parent, device_t* dev);
@@ -136,10 +188,45 @@ void dc_driver_added(driver_t* drv, const char* version);
 void load_driver(const char* path);
 void find_loadable_drivers(const char* path);
 
+// Reads a driver manifest made at build time.  find_loadable_drivers() takes
+// the info of the drivers listed there from the manifest rather than opening
+// them; drivers it finds which are not listed are opened as usual.
+// Returns MX_ERR_NOT_FOUND if there is no manifest at |path|.
+mx_status_t load_driver_manifest(const char* path);
+// Frees the manifest's drivers which find_loadable_drivers() did not come across.
+void release_driver_manifest(void);
+
 bool dc_is_bindable(driver_t* drv, uint32_t protocol_id,
                     mx_device_prop_t* props, size_t prop_count,
                     bool autobind);
 
+// Returns the protocol which binding programs see for a device:
+// its BIND_PROTOCOL property if it has one, else |protocol_id|.
+uint32_t dc_device_protocol(uint32_t protocol_id,
+                            const mx_device_prop_t* props, size_t prop_count);
+
+// Works out which protocols the binding program of a driver
+// can match, for the bind index.
+void dc_compile_binding(driver_t* drv);
+
+// Returns whether the compiled binding program of a driver
+// can match a device of protocol |protocol_id|, as returned
+// by dc_device_protocol().
+bool dc_binding_may_match(const driver_t* drv, uint32_t protocol_id);
+
+void dc_bind_index_init(bind_index_t* index);
+
+// Adds a compiled driver to the index, to be tried before
+// (|at_head|) or after every driver already in it.
+void dc_bind_index_add(bind_index_t* index, driver_t* drv, bool at_head);
+
+// Returns the drivers which may bind to a device of protocol
+// |protocol_id|, as returned by dc_device_protocol(), in the
+// order they were added; NULL at the end.
+driver_t* dc_bind_index_first(bind_index_t* index, uint32_t protocol_id,
+                              bind_index_cursor_t* cursor);
+driver_t* dc_bind_index_next(bind_index_cursor_t* cursor);
+
 #define DC_MAX_DATA 4096
 
 // The first two fields of devcoordinator messages align
@@ -193,4 +280,19 @@ mx_status_t dc_msg_rpc(mx_handle_t h, dc_msg_t* msg, size_t msglen,
                        mx_handle_t* handles, size_t hcount,
                        dc_status_t* rsp, size_t rsp_len);
 
+// Returns a txid for a request, unique among those outstanding in
+// this process.  Never 0, which is used for messages needing no reply,
+// and never has DC_TXID_COORDINATOR set.
+mx_txid_t dc_msg_txid(void);
+
+// Set in the txid of requests devcoordinator sends to a devhost.  A
+// devhost waits in mx_channel_call() for the replies to its own requests,
+// which takes any message with a matching txid as the reply, so the two
+// ends draw their txids from separate ranges.
+#define DC_TXID_COORDINATOR 0x80000000u
+
+// A burst of messages, such as a hub adding all of its ports, queues up
+// on a channel; this many are read each time it becomes readable.
+#define DC_READ_BATCH 16
+
 void devmgr_set_mdi(mx_handle_t mdi_handle);
@@ -4,6 +4,7 @@
 
 // Code shared between devhost and devmgr
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -64,7 +65,7 @@ mx_status_t dc_msg_unpack(dc_msg_t* msg, size_t len, const void** data,
     if (len < (sizeof(dc_msg_t) - DC_MAX_DATA)) {
         return MX_ERR_BUFFER_TOO_SMALL;
     }
-    len -= sizeof(dc_msg_t);
+    len -= sizeof(dc_msg_t) - DC_MAX_DATA;
     uint8_t* ptr = msg->data;
     if (msg->datalen) {
         if (msg->datalen > len) {
@@ -99,6 +100,16 @@ mx_status_t dc_msg_unpack(dc_msg_t* msg, size_t len, const void** data,
     return MX_OK;
 }
 
+static atomic_uint dc_next_txid = ATOMIC_VAR_INIT(1);
+
+mx_txid_t dc_msg_txid(void) {
+    mx_txid_t txid;
+    while ((txid = (atomic_fetch_add(&dc_next_txid, 1) & ~DC_TXID_COORDINATOR)) == 0) {
+        ;
+    }
+    return txid;
+}
+
 mx_status_t dc_msg_rpc(mx_handle_t h, dc_msg_t* msg, size_t msglen,
                        mx_handle_t* handles, size_t hcount,
                        dc_status_t* rsp, size_t rsplen) {
@@ -113,8 +124,7 @@ mx_status_t dc_msg_rpc(mx_handle_t h, dc_msg_t* msg, size_t msglen,
         .rd_num_handles = 0,
     };
 
-    //TODO: incrementing txids
-    msg->txid = 1;
+    msg->txid = dc_msg_txid();
     mx_status_t r;
     if ((r = mx_channel_call(h, 0, MX_TIME_INFINITE,
                              &args, &args.rd_num_bytes, &args.rd_num_handles,
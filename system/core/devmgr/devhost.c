@@ -342,11 +342,11 @@ static mx_status_t dh_handle_rpc_read(mx_handle_t h, iostate_t* ios) {
             }
         }
         dc_msg_t reply = {
-            .txid = 0,
+            .txid = msg.txid,
             .op = DC_OP_STATUS,
             .status = r,
         };
-        mx_channel_write(h, 0, &reply, sizeof(reply), NULL, 0);
+        mx_channel_write(h, 0, &reply, sizeof(reply) - DC_MAX_DATA, NULL, 0);
         return MX_OK;
 
     default:
@@ -379,12 +379,22 @@ static mx_status_t dh_handle_dc_rpc(port_handler_t* ph, mx_signals_t signals, ui
         return MX_ERR_STOP;
     }
     if (signals & MX_CHANNEL_READABLE) {
-        mx_status_t r = dh_handle_rpc_read(ph->handle, ios);
-        if (r != MX_OK) {
-            log(ERROR, "devhost: devmgr rpc unhandleable ios=%p r=%d. fatal.\n", ios, r);
-            exit(0);
+        for (unsigned n = 0; n < DC_READ_BATCH; n++) {
+            if (ios->dead) {
+                // the last message removed the device, and closed
+                // the channel along with it
+                return MX_ERR_STOP;
+            }
+            mx_status_t r = dh_handle_rpc_read(ph->handle, ios);
+            if (r == MX_ERR_SHOULD_WAIT) {
+                break;
+            }
+            if (r != MX_OK) {
+                log(ERROR, "devhost: devmgr rpc unhandleable ios=%p r=%d. fatal.\n", ios, r);
+                exit(0);
+            }
         }
-        return r;
+        return MX_OK;
     }
     if (signals & MX_CHANNEL_PEER_CLOSED) {
         log(ERROR, "devhost: devmgr disconnected! fatal. (ios=%p)\n", ios);
@@ -6,7 +6,9 @@
 #include <ddk/driver.h>
 #include <ddk/binding.h>
 
+#include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "devcoordinator.h"
 
@@ -154,3 +156,190 @@ bool dc_is_bindable(driver_t* drv, uint32_t protocol_id,
     ctx.autobind = autobind ? 1 : 0;
     return is_bindable(&ctx);
 }
+
+uint32_t dc_device_protocol(uint32_t protocol_id,
+                            const mx_device_prop_t* props, size_t prop_count) {
+    bpctx_t ctx;
+    ctx.props = props;
+    ctx.end = props + prop_count;
+    ctx.protocol_id = protocol_id;
+    return dev_get_prop(&ctx, BIND_PROTOCOL);
+}
+
+static bool add_protocol(uint32_t* protocols, uint32_t* count, uint32_t protocol_id) {
+    for (uint32_t i = 0; i < *count; i++) {
+        if (protocols[i] == protocol_id) {
+            return true;
+        }
+    }
+    if (*count == BIND_INDEX_MAX_PROTOCOLS) {
+        return false;
+    }
+    protocols[(*count)++] = protocol_id;
+    return true;
+}
+
+// Binding programs almost always start by checking the protocol,
+// so this only follows the straight-line instructions at the start
+// of a program, while it can tell which protocols a match depends
+// on. Anything it can't follow means the program may match any
+// protocol, which is always safe: the index only narrows down which
+// programs are run.
+void dc_compile_binding(driver_t* drv) {
+    const mx_bind_inst_t* ip = drv->binding;
+    const mx_bind_inst_t* end = ip + (drv->binding_size / sizeof(mx_bind_inst_t));
+    uint32_t protocols[BIND_INDEX_MAX_PROTOCOLS];
+    uint32_t count = 0;
+
+    drv->bind_any = true;
+    drv->bind_protocol_count = 0;
+
+    for (; ip < end; ip++) {
+        uint32_t inst = ip->op;
+        uint32_t cc = BINDINST_CC(inst);
+        bool on_protocol = (cc != COND_AL) && (BINDINST_PB(inst) == BIND_PROTOCOL);
+
+        switch (BINDINST_OP(inst)) {
+        case OP_MATCH:
+            if (!on_protocol || (cc != COND_EQ)) {
+                return;
+            }
+            // a match for one protocol; the rest of the
+            // program deals with the others
+            if (!add_protocol(protocols, &count, ip->arg)) {
+                return;
+            }
+            break;
+        case OP_ABORT:
+            if (cc == COND_AL) {
+                goto done;
+            }
+            if (on_protocol && (cc == COND_NE)) {
+                // nothing past here matches other protocols
+                if (!add_protocol(protocols, &count, ip->arg)) {
+                    return;
+                }
+                goto done;
+            }
+            // other aborts can only rule devices out
+            break;
+        case OP_SET:
+        case OP_CLEAR:
+        case OP_LABEL:
+            // flags are never compared here, and with no
+            // GOTO yet a label is only reached in sequence
+            break;
+        default:
+            // GOTO, or an illegal instruction
+            return;
+        }
+    }
+
+done:
+    // falling off the end of the program is no match
+    drv->bind_any = false;
+    drv->bind_protocol_count = count;
+    memcpy(drv->bind_protocols, protocols, count * sizeof(protocols[0]));
+}
+
+bool dc_binding_may_match(const driver_t* drv, uint32_t protocol_id) {
+    if (drv->bind_any) {
+        return true;
+    }
+    for (uint32_t i = 0; i < drv->bind_protocol_count; i++) {
+        if (drv->bind_protocols[i] == protocol_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static list_node_t* bind_index_bucket(bind_index_t* index, uint32_t protocol_id) {
+    // protocol ids are mostly four character codes, so mix
+    // all of their bytes into the bucket number
+    return &index->buckets[(protocol_id * 2654435761u) >> 26];
+}
+
+static_assert(BIND_INDEX_BUCKETS == (1u << (32 - 26)), "bucket hash must cover buckets");
+
+void dc_bind_index_init(bind_index_t* index) {
+    for (size_t i = 0; i < BIND_INDEX_BUCKETS; i++) {
+        list_initialize(&index->buckets[i]);
+    }
+    list_initialize(&index->any);
+    index->head_order = 0;
+    index->tail_order = 0;
+}
+
+static void bind_index_insert(list_node_t* list, bind_index_entry_t* entry, bool at_head) {
+    // every list stays sorted by bind_order, since drivers
+    // only ever come before or after all the others
+    if (at_head) {
+        list_add_head(list, &entry->node);
+    } else {
+        list_add_tail(list, &entry->node);
+    }
+}
+
+void dc_bind_index_add(bind_index_t* index, driver_t* drv, bool at_head) {
+    drv->bind_order = at_head ? --index->head_order : ++index->tail_order;
+
+    if (drv->bind_any) {
+        bind_index_entry_t* entry = &drv->bind_entries[0];
+        entry->drv = drv;
+        entry->protocol_id = 0;
+        bind_index_insert(&index->any, entry, at_head);
+        return;
+    }
+    for (uint32_t i = 0; i < drv->bind_protocol_count; i++) {
+        bind_index_entry_t* entry = &drv->bind_entries[i];
+        entry->drv = drv;
+        entry->protocol_id = drv->bind_protocols[i];
+        bind_index_insert(bind_index_bucket(index, entry->protocol_id), entry, at_head);
+    }
+}
+
+// Returns the entry at or after |pos| in |list| for |protocol_id|,
+// or NULL if there is none.
+static bind_index_entry_t* bind_index_seek(list_node_t* list, list_node_t* pos,
+                                           uint32_t protocol_id, bool any) {
+    for (; pos != list; pos = pos->next) {
+        bind_index_entry_t* entry = containerof(pos, bind_index_entry_t, node);
+        if (any || (entry->protocol_id == protocol_id)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+driver_t* dc_bind_index_next(bind_index_cursor_t* cursor) {
+    list_node_t* bucket = bind_index_bucket(cursor->index, cursor->protocol_id);
+    list_node_t* any = &cursor->index->any;
+    bind_index_entry_t* a = bind_index_seek(bucket, cursor->bucket_pos,
+                                            cursor->protocol_id, false);
+    bind_index_entry_t* b = bind_index_seek(any, cursor->any_pos, 0, true);
+
+    // merge the two lists by order
+    if ((a == NULL) && (b == NULL)) {
+        cursor->bucket_pos = bucket;
+        cursor->any_pos = any;
+        return NULL;
+    }
+    if ((b == NULL) || ((a != NULL) && (a->drv->bind_order < b->drv->bind_order))) {
+        cursor->bucket_pos = a->node.next;
+        cursor->any_pos = b ? &b->node : any;
+        return a->drv;
+    }
+    cursor->bucket_pos = a ? &a->node : bucket;
+    cursor->any_pos = b->node.next;
+    return b->drv;
+}
+
+driver_t* dc_bind_index_first(bind_index_t* index, uint32_t protocol_id,
+                              bind_index_cursor_t* cursor) {
+    cursor->index = index;
+    cursor->protocol_id = protocol_id;
+    cursor->bucket_pos = bind_index_bucket(index, protocol_id)->next;
+    cursor->any_pos = index->any.next;
+    return dc_bind_index_next(cursor);
+}
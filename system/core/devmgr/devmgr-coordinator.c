@@ -7,6 +7,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <threads.h>
 
 #include <ddk/driver.h>
 #include <driver-info/driver-info.h>
@@ -36,6 +37,10 @@ static void dc_dump_drivers(void);
 
 static mx_handle_t dmctl_socket;
 
+// Guards devhost_t.proc, .koid and .launch while a devhost is being launched
+// (see dc_launch_devhost_thread()).
+static mtx_t devhost_launch_lock = MTX_INIT;
+
 static void dmprintf(const char* fmt, ...) {
     if (dmctl_socket == MX_HANDLE_INVALID) {
         return;
@@ -146,6 +151,9 @@ static list_node_t list_drivers = LIST_INITIAL_VALUE(list_drivers);
 // Drivers to add to All Drivers
 static list_node_t list_drivers_new = LIST_INITIAL_VALUE(list_drivers_new);
 
+// All Drivers, indexed by the protocols they bind to
+static bind_index_t bind_index;
+
 // All Devices (excluding static immortal devices)
 static list_node_t list_devices = LIST_INITIAL_VALUE(list_devices);
 
@@ -242,7 +250,12 @@ void devmgr_set_mdi(mx_handle_t mdi_handle) {
 }
 
 static void dc_dump_device(device_t* dev, size_t indent) {
-    mx_koid_t pid = dev->host ? dev->host->koid : 0;
+    mx_koid_t pid = 0;
+    if (dev->host) {
+        mtx_lock(&devhost_launch_lock);
+        pid = dev->host->koid;
+        mtx_unlock(&devhost_launch_lock);
+    }
     char extra[256];
     if (log_flags & LOG_DEVLC) {
         snprintf(extra, sizeof(extra), " dev=%p ref=%d", dev, dev->refcount);
@@ -508,11 +521,71 @@ static void dc_watch(mx_handle_t h) {
     }
 }
 
+// A devhost process is loaded and started on a thread of its own, so that
+// the coordinator carries on binding drivers elsewhere in the device tree
+// meanwhile, and devhosts for separate parts of the tree start concurrently.
+// Until then, messages to the devhost wait in its rpc channel.
+struct dc_devhost_launch {
+    launchpad_t* lp;
+    // cleared under devhost_launch_lock if the devhost is released first
+    devhost_t* host;
+    char name[32];
+};
+
+static int dc_launch_devhost_thread(void* arg) {
+    devhost_launch_t* launch = arg;
+
+    launchpad_load_from_file(launch->lp, devhost_bin);
+
+    mx_handle_t proc = MX_HANDLE_INVALID;
+    mx_koid_t koid = 0;
+    const char* errmsg;
+    mx_status_t status = launchpad_go(launch->lp, &proc, &errmsg);
+    if (status < 0) {
+        // the devhost's end of its rpc channel is gone with the launchpad,
+        // so its devices are removed as if it had crashed
+        log(ERROR, "devcoord: launch devhost '%s': failed: %d: %s\n",
+            launch->name, status, errmsg);
+    } else {
+        mx_info_handle_basic_t info;
+        if (mx_object_get_info(proc, MX_INFO_HANDLE_BASIC, &info,
+                               sizeof(info), NULL, NULL) == MX_OK) {
+            koid = info.koid;
+        }
+        log(INFO, "devcoord: launch devhost '%s': pid=%zu\n",
+            launch->name, koid);
+    }
+
+    mtx_lock(&devhost_launch_lock);
+    devhost_t* host = launch->host;
+    if (host != NULL) {
+        host->proc = proc;
+        host->koid = koid;
+        host->launch = NULL;
+        proc = MX_HANDLE_INVALID;
+    }
+    mtx_unlock(&devhost_launch_lock);
+
+    if (proc != MX_HANDLE_INVALID) {
+        // released while it was starting
+        mx_task_kill(proc);
+        mx_handle_close(proc);
+    }
+    free(launch);
+    return 0;
+}
+
 static mx_status_t dc_launch_devhost(devhost_t* host,
                                      const char* name, mx_handle_t hrpc) {
+    devhost_launch_t* launch = calloc(1, sizeof(devhost_launch_t));
+    if (launch == NULL) {
+        mx_handle_close(hrpc);
+        return MX_ERR_NO_MEMORY;
+    }
+    snprintf(launch->name, sizeof(launch->name), "%s", name);
+
     launchpad_t* lp;
     launchpad_create_with_jobs(devhost_job, 0, name, &lp);
-    launchpad_load_from_file(lp, devhost_bin);
     launchpad_set_args(lp, 1, &devhost_bin);
 
     launchpad_add_handle(lp, hrpc, PA_HND(PA_USER0, 0));
@@ -552,21 +625,17 @@ static mx_status_t dc_launch_devhost(devhost_t* host,
     }
 #endif
 
-    const char* errmsg;
-    mx_status_t status = launchpad_go(lp, &host->proc, &errmsg);
-    if (status < 0) {
-        log(ERROR, "devcoord: launch devhost '%s': failed: %d: %s\n",
-            name, status, errmsg);
-        return status;
-    }
-    mx_info_handle_basic_t info;
-    if (mx_object_get_info(host->proc, MX_INFO_HANDLE_BASIC, &info,
-                           sizeof(info), NULL, NULL) == MX_OK) {
-        host->koid = info.koid;
-    }
-    log(INFO, "devcoord: launch devhost '%s': pid=%zu\n",
-        name, host->koid);
+    launch->lp = lp;
+    launch->host = host;
+    host->launch = launch;
 
+    thrd_t t;
+    if (thrd_create_with_name(&t, dc_launch_devhost_thread, launch,
+                              "devhost-launch") == thrd_success) {
+        thrd_detach(t);
+    } else {
+        dc_launch_devhost_thread(launch);
+    }
     return MX_OK;
 }
 
@@ -583,14 +652,14 @@ static mx_status_t dc_new_devhost(const char* name, devhost_t** out) {
         return r;
     }
 
+    list_initialize(&dh->devices);
+
     if ((r = dc_launch_devhost(dh, name, hrpc)) < 0) {
         mx_handle_close(dh->hrpc);
         free(dh);
         return r;
     }
 
-    list_initialize(&dh->devices);
-
     *out = dh;
     return MX_OK;
 }
@@ -602,9 +671,17 @@ static void dc_release_devhost(devhost_t* dh) {
         return;
     }
     log(INFO, "devcoord: destroy host %p\n", dh);
+    mtx_lock(&devhost_launch_lock);
+    if (dh->launch != NULL) {
+        // still starting; the launch thread kills it once it has started
+        dh->launch->host = NULL;
+    }
+    mtx_unlock(&devhost_launch_lock);
     mx_handle_close(dh->hrpc);
-    mx_task_kill(dh->proc);
-    mx_handle_close(dh->proc);
+    if (dh->proc != MX_HANDLE_INVALID) {
+        mx_task_kill(dh->proc);
+        mx_handle_close(dh->proc);
+    }
     free(dh);
 }
 
@@ -877,8 +954,10 @@ static mx_status_t dc_bind_device(device_t* dev, const char* drvlibname) {
     bool autobind = (drvlibname[0] == 0);
 
     //TODO: disallow if we're in the middle of enumeration, etc
-    driver_t* drv;
-    list_for_every_entry(&list_drivers, drv, driver_t, node) {
+    uint32_t protocol_id = dc_device_protocol(dev->protocol_id, dev->props, dev->prop_count);
+    bind_index_cursor_t cursor;
+    for (driver_t* drv = dc_bind_index_first(&bind_index, protocol_id, &cursor);
+         drv != NULL; drv = dc_bind_index_next(&cursor)) {
         if (autobind || !strcmp(drv->libname, drvlibname)) {
             if (dc_is_bindable(drv, dev->protocol_id,
                                dev->props, dev->prop_count, autobind)) {
@@ -1005,11 +1084,17 @@ static mx_status_t dc_handle_device_read(device_t* dev) {
         }
         // all of these return directly and do not write a
         // reply, since this message is a reply itself
-        pending_t* pending = list_remove_tail_type(&dev->pending, pending_t, node);
-        if (pending == NULL) {
+        pending_t* pending;
+        list_for_every_entry(&dev->pending, pending, pending_t, node) {
+            if (pending->txid == msg.txid) {
+                break;
+            }
+        }
+        if (&pending->node == &dev->pending) {
             log(ERROR, "devcoord: rpc: spurious status message\n");
             return MX_OK;
         }
+        list_delete(&pending->node);
         switch (pending->op) {
         case PENDING_BIND:
             if (msg.status != MX_OK) {
@@ -1059,14 +1144,19 @@ static mx_status_t dc_handle_device(port_handler_t* ph, mx_signals_t signals, ui
     device_t* dev = dev_from_ph(ph);
 
     if (signals & MX_CHANNEL_READABLE) {
-        mx_status_t r;
-        if ((r = dc_handle_device_read(dev)) < 0) {
-            if (r != MX_ERR_STOP) {
-                log(ERROR, "devcoord: device %p name='%s' rpc status: %d\n",
-                    dev, dev->name, r);
+        for (unsigned n = 0; n < DC_READ_BATCH; n++) {
+            mx_status_t r;
+            if ((r = dc_handle_device_read(dev)) < 0) {
+                if (r == MX_ERR_SHOULD_WAIT) {
+                    break;
+                }
+                if (r != MX_ERR_STOP) {
+                    log(ERROR, "devcoord: device %p name='%s' rpc status: %d\n",
+                        dev, dev->name, r);
+                }
+                dc_remove_device(dev, true);
+                return MX_ERR_STOP;
             }
-            dc_remove_device(dev, true);
-            return MX_ERR_STOP;
         }
         return MX_OK;
     }
@@ -1201,7 +1291,7 @@ static mx_status_t dh_bind_driver(device_t* dev, const char* libname) {
         return r;
     }
 
-    msg.txid = 0;
+    msg.txid = dc_msg_txid() | DC_TXID_COORDINATOR;
     msg.op = DC_OP_BIND_DRIVER;
 
     if ((r = mx_channel_write(dev->hrpc, 0, &msg, mlen, &vmo, 1)) < 0) {
@@ -1212,6 +1302,7 @@ static mx_status_t dh_bind_driver(device_t* dev, const char* libname) {
     dev->flags |= DEV_CTX_BOUND;
     pending->op = PENDING_BIND;
     pending->ctx = NULL;
+    pending->txid = msg.txid;
     list_add_tail(&dev->pending, &pending->node);
     return MX_OK;
 }
@@ -1264,9 +1355,11 @@ static mx_status_t dc_attempt_bind(driver_t* drv, device_t* dev) {
 }
 
 static void dc_handle_new_device(device_t* dev) {
-    driver_t* drv;
-
-    list_for_every_entry(&list_drivers, drv, driver_t, node) {
+    // only run the binding programs which might match
+    uint32_t protocol_id = dc_device_protocol(dev->protocol_id, dev->props, dev->prop_count);
+    bind_index_cursor_t cursor;
+    for (driver_t* drv = dc_bind_index_first(&bind_index, protocol_id, &cursor);
+         drv != NULL; drv = dc_bind_index_next(&cursor)) {
         if (dc_is_bindable(drv, dev->protocol_id,
                            dev->props, dev->prop_count, true)) {
             log(INFO, "devcoord: drv='%s' bindable to dev='%s'\n",
@@ -1328,8 +1421,10 @@ void dc_driver_added(driver_t* drv, const char* version) {
         // debugging / development hack
         // prioritize drivers with version "!..." over others
         list_add_head(&list_drivers, &drv->node);
+        dc_bind_index_add(&bind_index, drv, true);
     } else {
         list_add_tail(&list_drivers, &drv->node);
+        dc_bind_index_add(&bind_index, drv, false);
     }
 }
 
@@ -1351,6 +1446,7 @@ device_t* coordinator_init(mx_handle_t root_job) {
     mx_object_set_property(devhost_job, MX_PROP_NAME, "magenta-drivers", 15);
 
     port_init(&dc_port);
+    dc_bind_index_init(&bind_index);
 
     return &root_device;
 }
@@ -1399,6 +1495,11 @@ void dc_bind_driver(driver_t* drv) {
                 // if device is already bound or being destroyed, skip it
                 continue;
             }
+            uint32_t protocol_id = dc_device_protocol(dev->protocol_id,
+                                                      dev->props, dev->prop_count);
+            if (!dc_binding_may_match(drv, protocol_id)) {
+                continue;
+            }
             if (dc_is_bindable(drv, dev->protocol_id,
                                dev->props, dev->prop_count, true)) {
                 log(INFO, "devcoord: drv='%s' bindable to dev='%s'\n",
@@ -1414,6 +1515,7 @@ void dc_handle_new_driver(void) {
     driver_t* drv;
     while ((drv = list_remove_head_type(&list_drivers_new, driver_t, node)) != NULL) {
         list_add_tail(&list_drivers, &drv->node);
+        dc_bind_index_add(&bind_index, drv, false);
         dc_bind_driver(drv);
     }
 }
@@ -1463,9 +1565,13 @@ void coordinator(void) {
         devfs_publish(&root_device, &platform_device);
     }
 
+    // the build's list of the drivers in bootfs saves opening those drivers
+    // to read their notes; anything else in bootfs is still found
+    load_driver_manifest("/boot/config/driver-manifest");
     find_loadable_drivers("/boot/driver");
     find_loadable_drivers("/boot/driver/test");
     find_loadable_drivers("/boot/lib/driver");
+    release_driver_manifest();
 
     // Special case early handling for the ramdisk boot
     // path where /system is present before the coordinator
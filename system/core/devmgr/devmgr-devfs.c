@@ -15,6 +15,7 @@
 #include <mxio/remoteio.h>
 
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -357,6 +358,14 @@ got_name:
         list_add_tail(&dir->children, &dnlink->node);
         dev->link = dnlink;
         devfs_notify(dir, dnlink->name, VFS_WATCH_EVT_ADDED);
+
+        // how long boot takes to get to a usable disk is worth watching
+        static bool block_published = false;
+        if ((dev->protocol_id == MX_PROTOCOL_BLOCK) && !block_published) {
+            block_published = true;
+            printf("devmgr: /dev/class/block/%s published %" PRIu64 " ms after boot\n",
+                   dnlink->name, mx_time_get(MX_CLOCK_MONOTONIC) / MX_MSEC(1));
+        }
     }
 
 done:
@@ -4,9 +4,11 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include "devcoordinator.h"
@@ -22,18 +24,19 @@ static bool is_driver_disabled(const char* name) {
     return getenv(opt) != NULL;
 }
 
-static void found_driver(magenta_driver_note_payload_t* note,
-                         const mx_bind_inst_t* bi, void* cookie) {
+// Makes a driver_t for the driver |libname| from its driver info, or returns
+// NULL if the driver is disabled.  Safe to call from any thread.
+static driver_t* new_driver(magenta_driver_note_payload_t* note,
+                            const mx_bind_inst_t* bi, const char* libname) {
     // ensure strings are terminated
     note->name[sizeof(note->name) - 1] = 0;
     note->vendor[sizeof(note->vendor) - 1] = 0;
     note->version[sizeof(note->version) - 1] = 0;
 
     if (is_driver_disabled(note->name)) {
-        return;
+        return NULL;
     }
 
-    const char* libname = cookie;
     size_t pathlen = strlen(libname) + 1;
     size_t namelen = strlen(note->name) + 1;
     size_t bindlen = note->bindcount * sizeof(mx_bind_inst_t);
@@ -41,7 +44,7 @@ static void found_driver(magenta_driver_note_payload_t* note,
 
     driver_t* drv;
     if ((drv = malloc(len)) == NULL) {
-        return;
+        return NULL;
     }
 
     memset(drv, 0, sizeof(driver_t));
@@ -54,8 +57,10 @@ static void found_driver(magenta_driver_note_payload_t* note,
     memcpy((void*) drv->libname, libname, pathlen);
     memcpy((void*) drv->name, note->name, namelen);
 
+    dc_compile_binding(drv);
+
 #if VERBOSE_DRIVER_LOAD
-    printf("found driver: %s\n", (char*) cookie);
+    printf("found driver: %s\n", libname);
     printf("        name: %s\n", note->name);
     printf("      vendor: %s\n", note->vendor);
     printf("     version: %s\n", note->version);
@@ -65,7 +70,98 @@ static void found_driver(magenta_driver_note_payload_t* note,
     }
 #endif
 
-    dc_driver_added(drv, note->version);
+    return drv;
+}
+
+static void found_driver(magenta_driver_note_payload_t* note,
+                         const mx_bind_inst_t* bi, void* cookie) {
+    driver_t* drv = new_driver(note, bi, cookie);
+    if (drv != NULL) {
+        dc_driver_added(drv, note->version);
+    }
+}
+
+static void report_driver_info_error(const char* libname, mx_status_t status) {
+    if (status == MX_ERR_NOT_FOUND) {
+        printf("devcoord: no driver info in '%s'\n", libname);
+    } else {
+        printf("devcoord: error reading info from '%s'\n", libname);
+    }
+}
+
+// Reading the driver info of a driver means opening it and reading its ELF
+// headers and notes, which for a boot's worth of drivers adds up, so a
+// directory's drivers are read by a few threads at once.
+#define SCAN_THREADS 4
+
+typedef struct {
+    char libname[256 + 32];
+    char version[sizeof(((magenta_driver_note_payload_t*)0)->version)];
+    driver_t* drv;
+    bool opened;
+    mx_status_t status;
+} scan_entry_t;
+
+typedef struct {
+    int dirfd;
+    scan_entry_t* entries;
+    size_t count;
+    atomic_size_t next;
+} scan_t;
+
+// The drivers listed in the driver manifest, sorted by libname.  Each is
+// taken by find_loadable_drivers() when it comes across the driver's file.
+typedef struct {
+    char libname[256 + 32];
+    char version[sizeof(((magenta_driver_note_payload_t*)0)->version)];
+    driver_t* drv; // NULL if disabled, or once taken
+} manifest_entry_t;
+
+static manifest_entry_t* manifest;
+static size_t manifest_count;
+
+static manifest_entry_t* manifest_find(const char* libname) {
+    size_t lo = 0;
+    size_t hi = manifest_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int r = strcmp(libname, manifest[mid].libname);
+        if (r == 0) {
+            return manifest + mid;
+        } else if (r < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+static void scan_found_driver(magenta_driver_note_payload_t* note,
+                              const mx_bind_inst_t* bi, void* cookie) {
+    scan_entry_t* entry = cookie;
+    entry->drv = new_driver(note, bi, entry->libname);
+    memcpy(entry->version, note->version, sizeof(entry->version));
+}
+
+static int scan_thread(void* arg) {
+    scan_t* scan = arg;
+    size_t n;
+    while ((n = atomic_fetch_add(&scan->next, 1)) < scan->count) {
+        scan_entry_t* entry = scan->entries + n;
+        if (entry->opened) {
+            continue;
+        }
+        const char* name = strrchr(entry->libname, '/') + 1;
+        int fd;
+        if ((fd = openat(scan->dirfd, name, O_RDONLY)) < 0) {
+            continue;
+        }
+        entry->opened = true;
+        entry->status = di_read_driver_info(fd, entry, scan_found_driver);
+        close(fd);
+    }
+    return 0;
 }
 
 void find_loadable_drivers(const char* path) {
@@ -73,37 +169,84 @@ void find_loadable_drivers(const char* path) {
     if (dir == NULL) {
         return;
     }
+
+    scan_t scan = {
+        .dirfd = dirfd(dir),
+        .entries = NULL,
+        .count = 0,
+    };
+    atomic_init(&scan.next, 0);
+
+    size_t max = 0;
+    size_t unopened = 0;
     struct dirent* de;
     while ((de = readdir(dir)) != NULL) {
         if (de->d_name[0] == '.') {
             continue;
         }
-
-        char libname[256 + 32];
-        if (de->d_name[0] == '.') {
-            continue;
+        if (scan.count == max) {
+            size_t newmax = max ? max * 2 : 64;
+            scan_entry_t* entries = realloc(scan.entries, newmax * sizeof(scan_entry_t));
+            if (entries == NULL) {
+                break;
+            }
+            scan.entries = entries;
+            max = newmax;
         }
-        int r = snprintf(libname, sizeof(libname), "%s/%s", path, de->d_name);
-        if ((r < 0) || (r >= (int)sizeof(libname))) {
+        scan_entry_t* entry = scan.entries + scan.count;
+        int r = snprintf(entry->libname, sizeof(entry->libname), "%s/%s", path, de->d_name);
+        if ((r < 0) || (r >= (int)sizeof(entry->libname))) {
             continue;
         }
+        entry->drv = NULL;
+        entry->opened = false;
+        entry->status = MX_OK;
+        scan.count++;
 
-        int fd;
-        if ((fd = openat(dirfd(dir), de->d_name, O_RDONLY)) < 0) {
-            continue;
+        // no need to open a driver whose info is in the manifest
+        manifest_entry_t* m = manifest_find(entry->libname);
+        if (m != NULL) {
+            entry->drv = m->drv;
+            memcpy(entry->version, m->version, sizeof(entry->version));
+            entry->opened = true;
+            m->drv = NULL;
+        } else {
+            unopened++;
         }
-        mx_status_t status = di_read_driver_info(fd, libname, found_driver);
-        close(fd);
+    }
 
-        if (status) {
-            if (status == MX_ERR_NOT_FOUND) {
-                printf("devcoord: no driver info in '%s'\n", libname);
-            } else {
-                printf("devcoord: error reading info from '%s'\n", libname);
-            }
+    thrd_t threads[SCAN_THREADS];
+    size_t thread_count = 0;
+    while ((thread_count < SCAN_THREADS) && (thread_count + 1 < unopened)) {
+        if (thrd_create_with_name(threads + thread_count, scan_thread, &scan,
+                                  "devmgr-scan") != thrd_success) {
+            break;
         }
+        thread_count++;
+    }
+    // this thread does its share too, and all of it if none could be started
+    scan_thread(&scan);
+    for (size_t n = 0; n < thread_count; n++) {
+        thrd_join(threads[n], NULL);
     }
     closedir(dir);
+
+    // add the drivers in directory order, as they'd have been found by
+    // reading them one at a time
+    for (size_t n = 0; n < scan.count; n++) {
+        scan_entry_t* entry = scan.entries + n;
+        if (!entry->opened) {
+            continue;
+        }
+        if (entry->status != MX_OK) {
+            report_driver_info_error(entry->libname, entry->status);
+            continue;
+        }
+        if (entry->drv != NULL) {
+            dc_driver_added(entry->drv, entry->version);
+        }
+    }
+    free(scan.entries);
 }
 
 void load_driver(const char* path) {
@@ -117,10 +260,59 @@ void load_driver(const char* path) {
     close(fd);
 
     if (status) {
-        if (status == MX_ERR_NOT_FOUND) {
-            printf("devcoord: no driver info in '%s'\n", path);
-        } else {
-            printf("devcoord: error reading info from '%s'\n", path);
+        report_driver_info_error(path, status);
+    }
+}
+
+static void manifest_found_driver(const char* libname,
+                                  magenta_driver_note_payload_t* note,
+                                  const mx_bind_inst_t* bi, void* cookie) {
+    size_t* max = cookie;
+    if (manifest_count == *max) {
+        size_t newmax = *max ? *max * 2 : 64;
+        manifest_entry_t* entries = realloc(manifest, newmax * sizeof(manifest_entry_t));
+        if (entries == NULL) {
+            return;
         }
+        manifest = entries;
+        *max = newmax;
+    }
+    manifest_entry_t* m = manifest + manifest_count;
+    int r = snprintf(m->libname, sizeof(m->libname), "%s", libname);
+    if ((r < 0) || (r >= (int)sizeof(m->libname))) {
+        return;
+    }
+    m->drv = new_driver(note, bi, libname);
+    memcpy(m->version, note->version, sizeof(m->version));
+    manifest_count++;
+}
+
+static int manifest_entry_cmp(const void* a, const void* b) {
+    return strcmp(((const manifest_entry_t*)a)->libname,
+                  ((const manifest_entry_t*)b)->libname);
+}
+
+mx_status_t load_driver_manifest(const char* path) {
+    int fd;
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return MX_ERR_NOT_FOUND;
+    }
+    size_t max = 0;
+    mx_status_t status = di_read_driver_manifest(fd, &max, manifest_found_driver);
+    close(fd);
+
+    if (status < 0) {
+        printf("devcoord: error reading driver manifest '%s': %d\n", path, status);
+    }
+    qsort(manifest, manifest_count, sizeof(manifest_entry_t), manifest_entry_cmp);
+    return status;
+}
+
+void release_driver_manifest(void) {
+    for (size_t n = 0; n < manifest_count; n++) {
+        free(manifest[n].drv);
     }
+    free(manifest);
+    manifest = NULL;
+    manifest_count = 0;
 }
@@ -55,14 +55,16 @@ struct bootfile {
 
 struct callback_data {
     mx_handle_t vmo;
+    bootdata_lazy_t* lazy;
     unsigned int file_count;
-    mx_status_t (*add_file)(const char* path, mx_handle_t vmo, mx_off_t off, size_t len);
+    mx_status_t (*add_file)(const char* path, mx_handle_t vmo, mx_off_t off, size_t len,
+                            bootdata_lazy_t* lazy);
 };
 
 static void callback(void* arg, const char* path, size_t off, size_t len) {
     struct callback_data* cd = arg;
     //printf("bootfs: %s @%zd (%zd bytes)\n", path, off, len);
-    cd->add_file(path, cd->vmo, off, len);
+    cd->add_file(path, cd->vmo, off, len, cd->lazy);
     ++cd->file_count;
 }
 
@@ -142,7 +144,8 @@ static void start_system_init(void) {
 }
 
 static bool has_secondary_bootfs = false;
-static ssize_t setup_bootfs_vmo(uint32_t n, uint32_t type, mx_handle_t vmo) {
+static ssize_t setup_bootfs_vmo(uint32_t n, uint32_t type, mx_handle_t vmo,
+                                bootdata_lazy_t* lazy) {
     uint64_t size;
     mx_status_t status = mx_vmo_get_size(vmo, &size);
     if (status != MX_OK) {
@@ -160,6 +163,7 @@ static ssize_t setup_bootfs_vmo(uint32_t n, uint32_t type, mx_handle_t vmo) {
 
     struct callback_data cd = {
         .vmo = vmo,
+        .lazy = lazy,
         .add_file = (type == BOOTDATA_BOOTFS_SYSTEM) ? systemfs_add_file : bootfs_add_file,
     };
     if ((type == BOOTDATA_BOOTFS_SYSTEM) && !has_secondary_bootfs) {
@@ -209,7 +213,7 @@ static void setup_last_crashlog(mx_handle_t vmo_in, uint64_t off_in, size_t sz)
     if (copy_vmo(vmo_in, off_in, sz, &vmo) != MX_OK) {
         return;
     }
-    bootfs_add_file("log/last-panic.txt", vmo, 0, sz);
+    bootfs_add_file("log/last-panic.txt", vmo, 0, sz, NULL);
 }
 
 static mx_status_t devmgr_read_mdi(mx_handle_t vmo, mx_off_t offset, size_t length) {
@@ -237,7 +241,7 @@ static void setup_bootfs(void) {
     unsigned idx = 0;
 
     if ((vmo = mx_get_startup_handle(HND_BOOTFS(0)))) {
-        setup_bootfs_vmo(idx++, BOOTDATA_BOOTFS_BOOT, vmo);
+        setup_bootfs_vmo(idx++, BOOTDATA_BOOTFS_BOOT, vmo, NULL);
     } else {
         printf("devmgr: missing primary bootfs?!\n");
     }
@@ -278,13 +282,24 @@ static void setup_bootfs(void) {
             case BOOTDATA_BOOTFS_SYSTEM: {
                 const char* errmsg;
                 mx_handle_t bootfs_vmo;
-                status = decompress_bootdata(mx_vmar_root_self(), vmo,
-                                             off, bootdata.length + sizeof(bootdata),
-                                             &bootfs_vmo, &errmsg);
+                bootdata_lazy_t* lazy = NULL;
+                status = MX_ERR_NOT_SUPPORTED;
+                if (getenv("devmgr.bootfs-lazy")) {
+                    // Files are decompressed as they are first accessed.
+                    status = decompress_bootdata_lazy(mx_vmar_root_self(), vmo,
+                                                      off, bootdata.length + sizeof(bootdata),
+                                                      &lazy, &bootfs_vmo, &errmsg);
+                }
+                if (status == MX_ERR_NOT_SUPPORTED) {
+                    status = decompress_bootdata_parallel(mx_vmar_root_self(), vmo,
+                                                          off, bootdata.length + sizeof(bootdata),
+                                                          mx_system_get_num_cpus(),
+                                                          &bootfs_vmo, &errmsg);
+                }
                 if (status < 0) {
                     printf("devmgr: failed to decompress bootdata: %s\n", errmsg);
                 } else {
-                    setup_bootfs_vmo(idx++, bootdata.type, bootfs_vmo);
+                    setup_bootfs_vmo(idx++, bootdata.type, bootfs_vmo, lazy);
                 }
                 break;
             }
@@ -315,7 +330,7 @@ done:
 }
 
 ssize_t devmgr_add_systemfs_vmo(mx_handle_t vmo) {
-    ssize_t added = setup_bootfs_vmo(100, BOOTDATA_BOOTFS_SYSTEM, vmo);
+    ssize_t added = setup_bootfs_vmo(100, BOOTDATA_BOOTFS_SYSTEM, vmo, NULL);
     if (added > 0) {
         start_system_init();
     }
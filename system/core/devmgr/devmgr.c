@@ -242,7 +242,7 @@ static void fetch_vmos(uint_fast8_t type, const char* debug_type_name) {
                    debug_type_name, i, mx_status_get_string(status));
             continue;
         }
-        status = bootfs_add_file(name, vmo, 0, size);
+        status = bootfs_add_file(name, vmo, 0, size, NULL);
         if (status != MX_OK) {
             printf("devmgr: failed to add %s %u to filesystem: %s\n",
                    debug_type_name, i, mx_status_get_string(status));
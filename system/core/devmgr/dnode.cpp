@@ -44,6 +44,7 @@ void Dnode::RemoveFromParent() {
 
     // Detach from parent
     if (parent_) {
+        parent_->UnindexChild(this);
         parent_->children_.erase(*this);
         if (IsDirectory()) {
             // '..' no longer references parent.
@@ -93,10 +94,67 @@ void Dnode::AddChild(mxtl::RefPtr<Dnode> parent, mxtl::RefPtr<Dnode> child) {
     } else {
         child->ordering_token_ = parent->children_.back().ordering_token_ + 1;
     }
+    parent->IndexChild(child.get());
     parent->children_.push_back(mxtl::move(child));
 }
 
+size_t Dnode::NameHashTraits::GetHash(const NameKey& key) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < key.len; i++) {
+        hash ^= static_cast<uint8_t>(key.name[i]);
+        hash *= 16777619u;
+    }
+    return hash % kChildIndexBuckets;
+}
+
+void Dnode::IndexChild(Dnode* child) {
+    child_count_++;
+    if (child_index_ != nullptr) {
+        child_index_->insert(child);
+        return;
+    }
+    if (child_count_ <= kChildIndexThreshold) {
+        return;
+    }
+
+    // The directory just outgrew a linear search; index every child.
+    // If the index cannot be allocated, lookups remain linear.
+    AllocChecker ac;
+    child_index_.reset(new (&ac) ChildIndex());
+    if (!ac.check()) {
+        return;
+    }
+    for (auto& dn : children_) {
+        child_index_->insert(&dn);
+    }
+    child_index_->insert(child);
+}
+
+void Dnode::UnindexChild(Dnode* child) {
+    MX_DEBUG_ASSERT(child_count_ > 0);
+    child_count_--;
+    if (child_index_ == nullptr) {
+        return;
+    }
+    child_index_->erase(*child);
+    if (child_count_ == 0) {
+        child_index_.reset();
+    }
+}
+
 mx_status_t Dnode::Lookup(const char* name, size_t len, mxtl::RefPtr<Dnode>* out) const {
+    if (child_index_ != nullptr) {
+        auto dn = child_index_->find(NameKey{name, len});
+        if (!dn.IsValid()) {
+            return MX_ERR_NOT_FOUND;
+        }
+        if (out != nullptr) {
+            *out = mxtl::RefPtr<Dnode>(&(*dn));
+        }
+        return MX_OK;
+    }
+
     auto dn = children_.find_if([&name, &len](const Dnode& elem) -> bool {
         return elem.NameMatch(name, len);
     });
@@ -195,7 +253,8 @@ void Dnode::PutName(mxtl::unique_ptr<char[]> name, size_t len) {
 bool Dnode::IsDirectory() const { return vnode_->IsDirectory(); }
 
 Dnode::Dnode(mxtl::RefPtr<VnodeMemfs> vn, mxtl::unique_ptr<char[]> name, uint32_t flags) :
-    vnode_(mxtl::move(vn)), parent_(nullptr), ordering_token_(0), flags_(flags), name_(mxtl::move(name)) {
+    vnode_(mxtl::move(vn)), parent_(nullptr), ordering_token_(0), child_count_(0),
+    flags_(flags), name_(mxtl::move(name)) {
 };
 
 size_t Dnode::NameLen() const {
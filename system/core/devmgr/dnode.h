@@ -10,6 +10,7 @@
 #include <fs/vfs.h>
 #include <mxio/vfs.h>
 #include <mxtl/intrusive_double_list.h>
+#include <mxtl/intrusive_hash_table.h>
 #include <mxtl/ref_counted.h>
 #include <mxtl/ref_ptr.h>
 #include <mxtl/unique_ptr.h>
@@ -97,18 +98,52 @@ private:
     friend struct TypeChildTraits;
     friend struct TypeDeviceTraits;
 
+    // Directories with more than kChildIndexThreshold children index them
+    // by name, in addition to keeping them in children_ (which provides a
+    // stable readdir order). Smaller directories are searched linearly.
+    static constexpr size_t kChildIndexThreshold = 16;
+    static constexpr size_t kChildIndexBuckets = 1024;
+
+    struct NameKey {
+        const char* name;
+        size_t len;
+    };
+
+    using HashNodeState = mxtl::DoublyLinkedListNodeState<Dnode*>;
+    struct TypeHashTraits { static HashNodeState& node_state(Dnode& dn) { return dn.type_hash_state_; }};
+    struct NameKeyTraits {
+        static NameKey GetKey(const Dnode& dn) { return NameKey{dn.name_.get(), dn.NameLen()}; }
+        static bool EqualTo(const NameKey& k1, const NameKey& k2) {
+            return (k1.len == k2.len) && (memcmp(k1.name, k2.name, k1.len) == 0);
+        }
+    };
+    struct NameHashTraits { static size_t GetHash(const NameKey& key); };
+
+    using ChildIndex = mxtl::HashTable<NameKey, Dnode*,
+                                       mxtl::DoublyLinkedList<Dnode*, TypeHashTraits>,
+                                       size_t, kChildIndexBuckets,
+                                       NameKeyTraits, NameHashTraits>;
+
     Dnode(mxtl::RefPtr<VnodeMemfs> vn, mxtl::unique_ptr<char[]> name, uint32_t flags);
 
     size_t NameLen() const;
     bool NameMatch(const char* name, size_t len) const;
 
+    // Maintain the name index of this directory as children come and go.
+    void IndexChild(Dnode* child);
+    void UnindexChild(Dnode* child);
+
     NodeState type_child_state_;
     NodeState type_device_state_;
+    HashNodeState type_hash_state_;
     mxtl::RefPtr<VnodeMemfs> vnode_;
     mxtl::RefPtr<Dnode> parent_;
     // Used to impose an absolute order on dnodes within a directory.
     size_t ordering_token_;
     ChildList children_;
+    size_t child_count_;
+    // Allocated lazily once the directory grows past kChildIndexThreshold.
+    mxtl::unique_ptr<ChildIndex> child_index_;
     uint32_t flags_;
     mxtl::unique_ptr<char[]> name_;
 };
@@ -6,6 +6,7 @@
 
 #include <threads.h>
 
+#include <bootdata/decompress.h>
 #include <ddk/device.h>
 #include <fs/vfs.h>
 #include <magenta/compiler.h>
@@ -84,8 +85,10 @@ public:
     // Create a vnode from a VMO.
     // Fails if the vnode already exists.
     // Passes the vmo to the Vnode; does not duplicate it.
+    // If lazy is provided, the range of the (vmofile) VMO backing the vnode
+    // is populated from it on first access.
     mx_status_t CreateFromVmo(bool vmofile, const char* name, size_t namelen, mx_handle_t vmo,
-                              mx_off_t off, mx_off_t len);
+                              mx_off_t off, mx_off_t len, bootdata_lazy_t* lazy = nullptr);
 
     // Use the watcher container to implement a directory watcher
     void Notify(const char* name, size_t len, unsigned event) final;
@@ -128,7 +131,7 @@ private:
 
 class VnodeVmo final : public VnodeMemfs {
 public:
-    VnodeVmo(mx_handle_t vmo, mx_off_t offset, mx_off_t length);
+    VnodeVmo(mx_handle_t vmo, mx_off_t offset, mx_off_t length, bootdata_lazy_t* lazy);
     ~VnodeVmo();
 
     virtual mx_status_t Open(uint32_t flags) override;
@@ -140,10 +143,16 @@ private:
     mx_status_t GetHandles(uint32_t flags, mx_handle_t* hnds,
                            uint32_t* type, void* extra, uint32_t* esize) final;
 
+    // Decompress the file's contents if they have not been accessed before.
+    mx_status_t Populate();
+
     mx_handle_t vmo_;
     mx_off_t offset_;
     mx_off_t length_;
     bool have_local_clone_;
+    // Non-null until the contents of a lazily decompressed bootfs file
+    // have been populated.
+    bootdata_lazy_t* lazy_;
 };
 
 } // namespace memfs
@@ -175,11 +184,13 @@ mx_handle_t vfs_create_root_handle(VnodeMemfs* vn);
 mx_status_t devfs_mount(mx_handle_t h);
 
 // boot fs
-mx_status_t bootfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len);
+mx_status_t bootfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len,
+                            bootdata_lazy_t* lazy);
 
 // system fs
 VnodeDir* systemfs_get_root(void);
-mx_status_t systemfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len);
+mx_status_t systemfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len,
+                              bootdata_lazy_t* lazy);
 
 // Create the global root to memfs
 VnodeDir* vfs_create_global_root(void) TA_NO_THREAD_SAFETY_ANALYSIS;
@@ -24,7 +24,7 @@
 namespace memfs {
 
 static mx_status_t add_file(mxtl::RefPtr<VnodeDir> vnb, const char* path, mx_handle_t vmo,
-                            mx_off_t off, size_t len) {
+                            mx_off_t off, size_t len, bootdata_lazy_t* lazy) {
     mx_status_t r;
     if ((path[0] == '/') || (path[0] == 0))
         return MX_ERR_INVALID_ARGS;
@@ -35,7 +35,7 @@ static mx_status_t add_file(mxtl::RefPtr<VnodeDir> vnb, const char* path, mx_han
                 return MX_ERR_INVALID_ARGS;
             }
             bool vmofile = true;
-            return vnb->CreateFromVmo(vmofile, path, strlen(path), vmo, off, len);
+            return vnb->CreateFromVmo(vmofile, path, strlen(path), vmo, off, len, lazy);
         } else {
             if (nextpath == path) {
                 return MX_ERR_INVALID_ARGS;
@@ -61,10 +61,12 @@ static mx_status_t add_file(mxtl::RefPtr<VnodeDir> vnb, const char* path, mx_han
 // The following functions exist outside the memfs namespace so they can
 // be exposed to C:
 
-mx_status_t bootfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len) {
-    return add_file(BootfsRoot(), path, vmo, off, len);
+mx_status_t bootfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len,
+                            bootdata_lazy_t* lazy) {
+    return add_file(BootfsRoot(), path, vmo, off, len, lazy);
 }
 
-mx_status_t systemfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len) {
-    return add_file(SystemfsRoot(), path, vmo, off, len);
+mx_status_t systemfs_add_file(const char* path, mx_handle_t vmo, mx_off_t off, size_t len,
+                              bootdata_lazy_t* lazy) {
+    return add_file(SystemfsRoot(), path, vmo, off, len, lazy);
 }
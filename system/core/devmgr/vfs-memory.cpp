@@ -73,8 +73,8 @@ VnodeDir::VnodeDir() {
 }
 VnodeDir::~VnodeDir() {}
 
-VnodeVmo::VnodeVmo(mx_handle_t vmo, mx_off_t offset, mx_off_t length) :
-    vmo_(vmo), offset_(offset), length_(length), have_local_clone_(false) {}
+VnodeVmo::VnodeVmo(mx_handle_t vmo, mx_off_t offset, mx_off_t length, bootdata_lazy_t* lazy) :
+    vmo_(vmo), offset_(offset), length_(length), have_local_clone_(false), lazy_(lazy) {}
 VnodeVmo::~VnodeVmo() {
     if (have_local_clone_) {
         mx_handle_close(vmo_);
@@ -113,12 +113,28 @@ mx_status_t VnodeVmo::Serve(fs::Vfs* vfs, mx::channel channel, uint32_t flags) {
     return MX_OK;
 }
 
+mx_status_t VnodeVmo::Populate() {
+    if (lazy_ == nullptr) {
+        return MX_OK;
+    }
+    mx_status_t status = bootdata_lazy_populate(lazy_, offset_, length_);
+    if (status != MX_OK) {
+        return status;
+    }
+    lazy_ = nullptr;
+    return MX_OK;
+}
+
 mx_status_t VnodeVmo::GetHandles(uint32_t flags, mx_handle_t* hnds,
                                  uint32_t* type, void* extra, uint32_t* esize) {
     mx_off_t* off = static_cast<mx_off_t*>(extra);
     mx_off_t* len = off + 1;
     mx_handle_t vmo;
     mx_status_t status;
+    // The contents must be present before the VMO is cloned or handed out.
+    if ((status = Populate()) != MX_OK) {
+        return status;
+    }
     if (!have_local_clone_ && !WindowMatchesVMO(vmo_, offset_, length_)) {
         status = mx_vmo_clone(vmo_, MX_VMO_CLONE_COPY_ON_WRITE, offset_, length_, &vmo_);
         if (status < 0)
@@ -159,6 +175,10 @@ ssize_t VnodeFile::Read(void* data, size_t len, size_t off) {
 ssize_t VnodeVmo::Read(void* data, size_t len, size_t off) {
     if (off > length_)
         return 0;
+    mx_status_t status;
+    if ((status = Populate()) != MX_OK) {
+        return status;
+    }
     size_t rlen = length_ - off;
     if (len > rlen)
         len = rlen;
@@ -610,10 +630,12 @@ static mx_status_t memfs_create_fs(const char* name, mxtl::RefPtr<VnodeDir>* out
 
 static void memfs_mount_locked(mxtl::RefPtr<VnodeDir> parent, mxtl::RefPtr<VnodeDir> subtree) {
     Dnode::AddChild(parent->dnode_, subtree->dnode_);
+    memfs::vfs.FlushDentryCache();
 }
 
 mx_status_t VnodeDir::CreateFromVmo(bool vmofile, const char* name, size_t namelen,
-                                    mx_handle_t vmo, mx_off_t off, mx_off_t len) {
+                                    mx_handle_t vmo, mx_off_t off, mx_off_t len,
+                                    bootdata_lazy_t* lazy) {
     mxtl::AutoLock lock(&memfs::vfs.vfs_lock_);
     mx_status_t status;
     if ((status = CanCreate(name, namelen)) != MX_OK) {
@@ -623,7 +645,7 @@ mx_status_t VnodeDir::CreateFromVmo(bool vmofile, const char* name, size_t namel
     AllocChecker ac;
     mxtl::RefPtr<VnodeMemfs> vn;
     if (vmofile) {
-        vn = mxtl::AdoptRef(new (&ac) VnodeVmo(vmo, off, len));
+        vn = mxtl::AdoptRef(new (&ac) VnodeVmo(vmo, off, len, lazy));
     } else {
         vn = mxtl::AdoptRef(new (&ac) VnodeFile(vmo, len));
     }
@@ -667,6 +689,10 @@ mx_status_t VnodeDir::AttachVnode(mxtl::RefPtr<VnodeMemfs> vn, const char* name,
 
     // parent takes first reference
     Dnode::AddChild(dnode_, mxtl::move(dn));
+
+    // Nodes may be attached without going through the VFS (e.g. bootfs), so
+    // drop any negative entry the dentry cache holds for this name.
+    memfs::vfs.InvalidateDentry(this, name, namelen);
     return MX_OK;
 }
 
@@ -789,6 +815,7 @@ mx_handle_t vfs_create_root_handle(VnodeMemfs* vn) {
     fs::MxioDispatcher::Create(&memfs::global_dispatcher);
     memfs::global_dispatcher->StartThread();
     memfs::vfs.SetDispatcher(memfs::global_dispatcher.get());
+    memfs::vfs.EnableDentryCache();
     if ((r = memfs::vfs.ServeDirectory(mxtl::RefPtr<fs::Vnode>(vn),
                                        mxtl::move(h1))) != MX_OK) {
         return r;
@@ -0,0 +1,125 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Writes a driver manifest (see driver-info.h) of the drivers given on the
+// command line, for devmgr to read at boot in place of the drivers' notes.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <driver-info/driver-info.h>
+
+static uint8_t* manifest;
+static size_t manifest_size;
+static size_t manifest_max;
+static uint32_t manifest_count;
+
+static void* manifest_append(size_t len) {
+    if (manifest_size + len > manifest_max) {
+        size_t max = manifest_max ? manifest_max : 16384;
+        while (manifest_size + len > max) {
+            max *= 2;
+        }
+        if ((manifest = realloc(manifest, max)) == NULL) {
+            fprintf(stderr, "error: out of memory\n");
+            exit(1);
+        }
+        manifest_max = max;
+    }
+    void* ptr = manifest + manifest_size;
+    memset(ptr, 0, len);
+    manifest_size += len;
+    return ptr;
+}
+
+static void add_driver(magenta_driver_note_payload_t* note,
+                       const mx_bind_inst_t* binding, void* cookie) {
+    const char* libname = cookie;
+    size_t pathlen = strlen(libname) + 1;
+    size_t bindlen = note->bindcount * sizeof(mx_bind_inst_t);
+    size_t size = sizeof(di_manifest_record_t) + sizeof(*note) + bindlen + pathlen;
+    size = (size + 3) & ~3;
+
+    di_manifest_record_t* rec = manifest_append(size);
+    rec->size = size;
+    rec->pathlen = pathlen;
+    uint8_t* data = (uint8_t*)(rec + 1);
+    memcpy(data, note, sizeof(*note));
+    data += sizeof(*note);
+    memcpy(data, binding, bindlen);
+    data += bindlen;
+    memcpy(data, libname, pathlen);
+    manifest_count++;
+}
+
+static int usage(void) {
+    fprintf(stderr,
+            "usage: driver-manifest -o <output> <bootpath>=<file> ...\n"
+            "\n"
+            "Writes the driver info of each <file> to <output>, to be found at <bootpath>.\n"
+            "Files without driver info are skipped.\n");
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    const char* output = NULL;
+    argc--;
+    argv++;
+    if ((argc >= 2) && !strcmp(argv[0], "-o")) {
+        output = argv[1];
+        argc -= 2;
+        argv += 2;
+    }
+    if (output == NULL) {
+        return usage();
+    }
+
+    manifest_append(sizeof(di_manifest_header_t));
+    for (; argc > 0; argc--, argv++) {
+        char* libname = argv[0];
+        char* path = strchr(libname, '=');
+        if (path == NULL) {
+            return usage();
+        }
+        *path++ = 0;
+
+        int fd;
+        if ((fd = open(path, O_RDONLY)) < 0) {
+            fprintf(stderr, "error: cannot open '%s': %s\n", path, strerror(errno));
+            return 1;
+        }
+        mx_status_t status = di_read_driver_info(fd, libname, add_driver);
+        close(fd);
+        if (status == MX_ERR_NOT_FOUND) {
+            fprintf(stderr, "warning: no driver info in '%s'\n", path);
+        } else if (status != MX_OK) {
+            fprintf(stderr, "error: cannot read driver info from '%s': %d\n", path, status);
+            return 1;
+        }
+    }
+
+    // the manifest was allocated with the header first, so it can only be
+    // filled in now that the records have stopped moving it around
+    di_manifest_header_t* hdr = (di_manifest_header_t*)manifest;
+    hdr->magic = DI_MANIFEST_MAGIC;
+    hdr->version = DI_MANIFEST_VERSION;
+    hdr->count = manifest_count;
+
+    FILE* fp;
+    if ((fp = fopen(output, "wb")) == NULL) {
+        fprintf(stderr, "error: cannot create '%s': %s\n", output, strerror(errno));
+        return 1;
+    }
+    if ((fwrite(manifest, manifest_size, 1, fp) != 1) || (fclose(fp) != 0)) {
+        fprintf(stderr, "error: cannot write '%s'\n", output);
+        unlink(output);
+        return 1;
+    }
+    return 0;
+}
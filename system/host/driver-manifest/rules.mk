@@ -0,0 +1,26 @@
+# Copyright 2017 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+# driver-info.c reads ELF files with the host's <elf.h>, which macOS lacks;
+# there devmgr reads the drivers' notes at boot instead.
+ifneq ($(HOST_PLATFORM),darwin)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := hostapp
+
+MODULE_SRCS += \
+    system/ulib/driver-info/driver-info.c \
+    $(LOCAL_DIR)/driver-manifest.c \
+
+MODULE_CFLAGS := -Isystem/ulib/driver-info/include
+
+# for pread() in driver-info.c
+MODULE_DEFINES += _POSIX_C_SOURCE=200809L
+
+include make/module.mk
+
+endif
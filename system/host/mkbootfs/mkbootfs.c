@@ -18,6 +18,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <lz4.h>
 #include <lz4frame.h>
 
 #include <magenta/boot/bootdata.h>
@@ -482,6 +483,103 @@ ssize_t compress_finish(int fd, void* cookie) {
     return r;
 }
 
+// Size of the LZ4 frame header written by LZ4F_compressBegin with our
+// preferences: magic, FLG, BD, content size, header checksum.
+#define LZ4_FRAME_HEADER_SIZE (4 + 1 + 1 + 8 + 1)
+#define LZ4_MAX_BLOCK_SIZE 65536
+
+// Append a block index (see BOOTDATA_BOOTFS_FLAG_INDEXED) for the LZ4 frame
+// which starts at frame_start and ends at the current file offset, so that
+// the blocks may be decompressed independently at boot.
+ssize_t write_lz4_index(int fd, off_t frame_start) {
+    off_t frame_end = lseek(fd, 0, SEEK_CUR);
+    if (frame_end < frame_start) {
+        fprintf(stderr, "error: couldn't seek\n");
+        return -1;
+    }
+    size_t frame_len = frame_end - frame_start;
+    uint8_t* frame = malloc(frame_len);
+    char* scratch = malloc(LZ4_MAX_BLOCK_SIZE);
+    bootdata_lz4_block_t* index = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    ssize_t r = -1;
+    if ((frame == NULL) || (scratch == NULL)) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        goto done;
+    }
+    if (pread(fd, frame, frame_len, frame_start) != (ssize_t)frame_len) {
+        fprintf(stderr, "error: cannot read back compressed bootfs\n");
+        goto done;
+    }
+
+    size_t off = LZ4_FRAME_HEADER_SIZE;
+    uint32_t dst = 0;
+    for (;;) {
+        uint32_t blocksize;
+        if (off + sizeof(blocksize) > frame_len) {
+            fprintf(stderr, "error: truncated lz4 frame\n");
+            goto done;
+        }
+        memcpy(&blocksize, frame + off, sizeof(blocksize));
+        if (blocksize == 0) {
+            break;
+        }
+        uint32_t actual = blocksize & 0x7fffffff;
+        if (off + sizeof(blocksize) + actual > frame_len) {
+            fprintf(stderr, "error: truncated lz4 block\n");
+            goto done;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            bootdata_lz4_block_t* tmp = realloc(index, capacity * sizeof(*index));
+            if (tmp == NULL) {
+                fprintf(stderr, "OUT OF MEMORY\n");
+                goto done;
+            }
+            index = tmp;
+        }
+        index[count].src_offset = off;
+        index[count].dst_offset = dst;
+        count++;
+
+        // If the data is uncompressed, the high bit is 1.
+        int n = actual;
+        if (!(blocksize >> 31)) {
+            n = LZ4_decompress_safe((const char*)frame + off + sizeof(blocksize), scratch,
+                                    actual, LZ4_MAX_BLOCK_SIZE);
+            if (n < 0) {
+                fprintf(stderr, "error: cannot decompress lz4 block\n");
+                goto done;
+            }
+        }
+        dst += n;
+        off += sizeof(blocksize) + actual;
+    }
+
+    uint32_t hdr[2] = {
+        BOOTDATA_LZ4_INDEX_MAGIC,
+        count * sizeof(*index) + 2 * sizeof(uint32_t),
+    };
+    uint32_t footer[2] = {
+        count,
+        BOOTDATA_LZ4_INDEX_MAGIC,
+    };
+    if ((writex(fd, hdr, sizeof(hdr)) < 0) ||
+        (writex(fd, index, count * sizeof(*index)) < 0) ||
+        (writex(fd, footer, sizeof(footer)) < 0)) {
+        goto done;
+    }
+    r = sizeof(hdr) + count * sizeof(*index) + sizeof(footer);
+
+done:
+    free(index);
+    free(scratch);
+    free(frame);
+    return r;
+}
+
 static const io_ops io_compressed = {
     .setup = compress_setup,
     .write = compress_data,
@@ -609,6 +707,9 @@ fail:
     if (op->finish) {
         CHECK(op->finish(fd, cookie));
     }
+    if (compressed) {
+        CHECK(write_lz4_index(fd, start + sizeof(bootdata_t)));
+    }
 
     off_t end = lseek(fd, 0, SEEK_CUR);
     if (end < 0) {
@@ -635,7 +736,8 @@ fail:
                 BOOTDATA_BOOTFS_SYSTEM : BOOTDATA_BOOTFS_BOOT,
         .length = wrote,
         .extra = compressed ? item->outsize : wrote,
-        .flags = compressed ? BOOTDATA_BOOTFS_FLAG_COMPRESSED : 0
+        .flags = compressed ?
+                 (BOOTDATA_BOOTFS_FLAG_COMPRESSED | BOOTDATA_BOOTFS_FLAG_INDEXED) : 0
     };
     if (writex(fd, &boothdr, sizeof(boothdr)) < 0) {
         return -1;
@@ -656,7 +758,8 @@ int write_bootdata(const char* fn, item_t* item) {
     int fd;
     const io_ops* op = compressed ? &io_compressed : &io_plain;
 
-    fd = open(fn, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    // The compressed bootfs block index is built by reading back the output.
+    fd = open(fn, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
     if (fd < 0) {
         fprintf(stderr, "error: cannot create '%s'\n", fn);
         return -1;
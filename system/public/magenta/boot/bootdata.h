@@ -42,6 +42,19 @@
 // Flag indicating that the bootfs is compressed.
 #define BOOTDATA_BOOTFS_FLAG_COMPRESSED  (1 << 0)
 
+// Flag indicating that a compressed bootfs is followed by a block index,
+// which allows its LZ4 blocks to be located and decompressed independently.
+// The index is stored in an LZ4 skippable frame at the end of the payload:
+//   magic      (BOOTDATA_LZ4_INDEX_MAGIC)
+//   framesize  (size of the remainder of the frame)
+//   entries    (bootdata_lz4_block_t[count])
+//   count      (number of entries)
+//   magic      (BOOTDATA_LZ4_INDEX_MAGIC)
+// so that it may be found from the end of the payload.
+#define BOOTDATA_BOOTFS_FLAG_INDEXED     (1 << 1)
+
+#define BOOTDATA_LZ4_INDEX_MAGIC  (0x184D2A5B) // LZ4 skippable frame
+
 
 // These items are for passing from bootloader to kernel
 
@@ -110,6 +123,15 @@ typedef struct {
     uint32_t flags;
 } bootdata_t;
 
+// One entry of a compressed bootfs block index.
+typedef struct {
+    // Offset of the block's size word, relative to the LZ4 frame magic.
+    uint32_t src_offset;
+    // Offset of the block's decompressed data, relative to the end of the
+    // bootdata header.
+    uint32_t dst_offset;
+} bootdata_lz4_block_t;
+
 typedef struct {
     uint64_t phys_base;
     uint32_t width;
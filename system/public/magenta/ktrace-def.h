@@ -17,6 +17,7 @@ KTRACE_DEF(0x022,NAME,PROC_NAME,META) // pid, 0, name[]
 KTRACE_DEF(0x023,NAME,SYSCALL_NAME,META) // num, 0, name[]
 KTRACE_DEF(0x024,NAME,IRQ_NAME,META) // num, 0, name[]
 KTRACE_DEF(0x025,NAME,PROBE_NAME,META) // num, 0, name[]
+KTRACE_DEF(0x026,NAME,LOCK_CLASS_NAME,META) // class, 0, name[]
 
 KTRACE_DEF(0x030,16B,IRQ_ENTER,IRQ) // (irqn << 8) | cpu
 KTRACE_DEF(0x031,16B,IRQ_EXIT,IRQ) // (irqn << 8) | cpu
@@ -51,6 +52,10 @@ KTRACE_DEF(0x143,32B,PORT_QUEUE,IPC) // id, size
 KTRACE_DEF(0x150,32B,WAIT_ONE,IPC) // id, signals, timeoutlo, timeouthi
 KTRACE_DEF(0x151,32B,WAIT_ONE_DONE,IPC) // id, status, pending
 
+KTRACE_DEF(0x160,32B,MUTEX_CONTEND,LOCK) // class, holder-tid, holder-kt, lock
+KTRACE_DEF(0x161,32B,SPINLOCK_CONTEND,LOCK) // class, holder-cpu, cpu, lock
+KTRACE_DEF(0x162,32B,LOCK_WAIT_DONE,LOCK) // class, wait_ns_lo, wait_ns_hi, lock
+
 // events from 0x200-0x2ff are for arch-specific needs
 
 #ifdef __x86_64__
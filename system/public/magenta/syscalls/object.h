@@ -30,6 +30,10 @@ typedef enum {
     MX_INFO_CPU_STATS                  = 16, // mx_info_cpu_stats_t[n]
     MX_INFO_KMEM_STATS                 = 17, // mx_info_kmem_stats_t[1]
     MX_INFO_RESOURCE                   = 18, // mx_info_resource_t[1]
+    MX_INFO_VMO_CHAIN                  = 19, // mx_info_vmo_chain_t[1]
+    MX_INFO_LOCK_STATS                 = 20, // mx_info_lock_stats_t[n]
+    MX_INFO_CPU_SCHED_STATS            = 21, // mx_info_cpu_sched_stats_t[n]
+    MX_INFO_THREAD_SCHED_STATS         = 22, // mx_info_thread_sched_stats_t[1]
     MX_INFO_LAST
 } mx_object_info_topic_t;
 
@@ -115,6 +119,27 @@ typedef struct mx_info_thread_stats {
     mx_time_t total_runtime;
 } mx_info_thread_stats_t;
 
+// Time histogram bucket N of the scheduler statistics counts times below
+// 256ns << (2 * N); the last bucket counts everything longer.
+#define MX_INFO_SCHED_STATS_TIME_BUCKETS 12
+
+// Run queue depth histogram bucket 0 of the scheduler statistics counts an
+// empty run queue, and bucket N counts depths below 1 << N; the last bucket
+// counts everything deeper.
+#define MX_INFO_SCHED_STATS_DEPTH_BUCKETS 12
+
+// Scheduler latency histograms of a thread.
+typedef struct mx_info_thread_sched_stats {
+    // Time from being woken up to running.
+    uint64_t wakeup_latency[MX_INFO_SCHED_STATS_TIME_BUCKETS];
+
+    // Time run before being switched away from.
+    uint64_t run_slice[MX_INFO_SCHED_STATS_TIME_BUCKETS];
+
+    // Number of threads waiting to run when the thread was woken up.
+    uint64_t run_queue_depth[MX_INFO_SCHED_STATS_DEPTH_BUCKETS];
+} mx_info_thread_sched_stats_t;
+
 // Statistics about resources (e.g., memory) used by a task. Can be relatively
 // expensive to gather.
 typedef struct mx_info_task_stats {
@@ -271,6 +296,15 @@ typedef struct mx_info_vmo {
     mx_rights_t handle_rights;
 } mx_info_vmo_t;
 
+// Describes the chain of copy-on-write clones behind a VMO.
+typedef struct mx_info_vmo_chain {
+    // The number of copy-on-write ancestors of this VMO, which a page fault
+    // may have to search for a page it has not copied. Zero if the VMO is
+    // not a clone. Ancestors which only this VMO can reach are collapsed
+    // into it, and are not counted.
+    uint32_t depth;
+} mx_info_vmo_chain_t;
+
 // kernel statistics per cpu
 typedef struct mx_info_cpu_stats {
     uint32_t cpu_number;
@@ -298,6 +332,19 @@ typedef struct mx_info_cpu_stats {
     uint64_t generic_ipis;
 } mx_info_cpu_stats_t;
 
+// kernel scheduler latency histograms per cpu, summed over the threads which
+// ran on it; see mx_info_thread_sched_stats_t for the buckets
+typedef struct mx_info_cpu_sched_stats {
+    uint32_t cpu_number;
+    uint32_t flags;         // MX_INFO_CPU_STATS_FLAG_*
+
+    uint64_t wakeup_latency[MX_INFO_SCHED_STATS_TIME_BUCKETS];
+    uint64_t run_slice[MX_INFO_SCHED_STATS_TIME_BUCKETS];
+
+    // number of threads waiting to run whenever the cpu picked one to run
+    uint64_t run_queue_depth[MX_INFO_SCHED_STATS_DEPTH_BUCKETS];
+} mx_info_cpu_sched_stats_t;
+
 // Information about kernel memory usage.
 // Can be expensive to gather.
 typedef struct mx_info_kmem_stats {
@@ -345,6 +392,29 @@ typedef struct mx_info_resource {
     uint64_t high;
 } mx_info_resource_t;
 
+// Histogram bucket N of mx_info_lock_stats_t counts times below
+// 256ns << (2 * N); the last bucket counts everything longer.
+#define MX_INFO_LOCK_STATS_BUCKETS 12
+
+// kernel lock contention statistics, per lock class
+typedef struct mx_info_lock_stats {
+    char name[MX_MAX_NAME_LEN];
+
+    uint64_t acquisitions;
+    uint64_t contentions;   // acquisitions which had to wait
+
+    // time spent waiting for contended acquisitions, in ns
+    uint64_t wait_time;
+    uint64_t max_wait_time;
+
+    // time held, in ns
+    uint64_t hold_time;
+    uint64_t max_hold_time;
+
+    uint64_t wait_histogram[MX_INFO_LOCK_STATS_BUCKETS];
+    uint64_t hold_histogram[MX_INFO_LOCK_STATS_BUCKETS];
+} mx_info_lock_stats_t;
+
 #define MX_INFO_CPU_STATS_FLAG_ONLINE       (1u<<0)
 
 // Object properties.
@@ -11,12 +11,14 @@ __BEGIN_CDECLS
 // mx_object_wait_async() options
 #define MX_WAIT_ASYNC_ONCE          0u
 #define MX_WAIT_ASYNC_REPEATING     1u
+#define MX_WAIT_ASYNC_EDGE          2u
 
 // packet types.
 #define MX_PKT_TYPE_USER            0x00u
 #define MX_PKT_TYPE_SIGNAL_ONE      0x01u
 #define MX_PKT_TYPE_SIGNAL_REP      0x02u
 #define MX_PKT_TYPE_EXCEPTION(n)    (0x03u | (((n) & 0xFFu) << 8))
+#define MX_PKT_TYPE_SIGNAL_EDGE     0x04u
 
 #define MX_PKT_TYPE_MASK            0xFFu
 
@@ -24,6 +26,7 @@ __BEGIN_CDECLS
 #define MX_PKT_IS_SIGNAL_ONE(type)  ((type) == MX_PKT_TYPE_SIGNAL_ONE)
 #define MX_PKT_IS_SIGNAL_REP(type)  ((type) == MX_PKT_TYPE_SIGNAL_REP)
 #define MX_PKT_IS_EXCEPTION(type)   (((type) & MX_PKT_TYPE_MASK) == MX_PKT_TYPE_EXCEPTION(0))
+#define MX_PKT_IS_SIGNAL_EDGE(type) ((type) == MX_PKT_TYPE_SIGNAL_EDGE)
 
 // port_packet_t::type MX_PKT_TYPE_USER.
 typedef union mx_packet_user {
@@ -33,7 +36,8 @@ typedef union mx_packet_user {
     uint8_t   c8[32];
 } mx_packet_user_t;
 
-// port_packet_t::type MX_PKT_TYPE_SIGNAL_ONE and MX_PKT_TYPE_SIGNAL_REP.
+// port_packet_t::type MX_PKT_TYPE_SIGNAL_ONE, MX_PKT_TYPE_SIGNAL_REP and
+// MX_PKT_TYPE_SIGNAL_EDGE.
 typedef struct mx_packet_signal {
     mx_signals_t trigger;
     mx_signals_t observed;
@@ -240,10 +240,26 @@ public:
 
     mx_status_t AttachVmo(mx_handle_t vmo, vmoid_t* out);
     mx_status_t Txn(block_fifo_request_t* requests, size_t count) {
+        // Synchronous transactions are ordered after any asynchronous
+        // writes still in flight.
+        mx_status_t status = queue_.Wait();
+        if (status != MX_OK) {
+            return status;
+        }
         return block_fifo_txn(fifo_client_, requests, count);
     }
     txnid_t TxnId() const { return txnid_; }
 
+    // Sends a write transaction without waiting for it to complete.
+    // Errors are reported by the next Txn or Sync.
+    mx_status_t TxnAsync(block_fifo_request_t* requests, size_t count) {
+        return queue_.Issue(requests, count);
+    }
+    fs::TxnRequestPool* RequestPool() { return &request_pool_; }
+
+    // Waits for all outstanding writes, and flushes the block device.
+    mx_status_t Sync();
+
     int blockfd_;
     blobstore_info_t info_;
 
@@ -284,6 +300,8 @@ private:
 
     fifo_client_t* fifo_client_{};
     txnid_t txnid_{};
+    fs::TxnQueue queue_;
+    fs::TxnRequestPool request_pool_;
     RawBitmap block_map_{};
     vmoid_t block_map_vmoid_{};
     mxtl::unique_ptr<MappedVmo> node_map_{};
@@ -182,9 +182,8 @@ mx_status_t VnodeBlob::WriteMetadata() {
         }
     }
 
-    // TODO(smklein): We could probably flush out these disk structures asynchronously.
-    // Even writing the above blocks could be done async. The "node" write must be done
-    // LAST, after everything else is complete, but that's the only restriction.
+    // The data and bitmap writes are issued asynchronously. The "node" write must be
+    // done LAST, after everything else is complete, but that's the only restriction.
     //
     // This 'kBlobFlagSync' is currently not used, but it indicates when the sync is
     // complete.
@@ -198,8 +197,10 @@ mx_status_t VnodeBlob::WriteMetadata() {
         return MX_ERR_IO;
     }
 
-    // Flush the block allocation bitmap to disk
-    fsync(blobstore_->blockfd_);
+    // Flush the blob data and block allocation bitmap to disk
+    if (txn.Flush() != MX_OK || blobstore_->Sync() != MX_OK) {
+        return MX_ERR_IO;
+    }
 
     // Update the on-disk hash
     memcpy(inode->merkle_root_hash, &digest_[0], Digest::kLength);
@@ -419,7 +420,16 @@ void Blobstore::FreeNode(size_t node_index) {
     info_.alloc_inode_count--;
 }
 
+mx_status_t Blobstore::Sync() {
+    mx_status_t status = queue_.Wait();
+    if (status != MX_OK) {
+        return status;
+    }
+    return (fsync(blockfd_) < 0) ? MX_ERR_IO : MX_OK;
+}
+
 mx_status_t Blobstore::Unmount() {
+    queue_.Wait();
     close(blockfd_);
     return MX_OK;
 }
@@ -596,6 +606,7 @@ Blobstore::Blobstore(int fd, const blobstore_info_t* info)
 
 Blobstore::~Blobstore() {
     if (fifo_client_ != nullptr) {
+        queue_.Release(blockfd_);
         ioctl_block_free_txn(blockfd_, &txnid_);
         block_fifo_release_client(fifo_client_);
         ioctl_block_fifo_close(blockfd_);
@@ -628,6 +639,8 @@ mx_status_t Blobstore::Create(int fd, const blobstore_info_t* info, mxtl::RefPtr
         ioctl_block_free_txn(fd, &fs->txnid_);
         mx_handle_close(fifo);
         return status;
+    } else if ((status = fs->queue_.Init(fd, fs->fifo_client_)) != MX_OK) {
+        return status;
     }
 
     // Keep the block_map_ aligned to a block multiple
@@ -43,6 +43,7 @@ int do_blobstore_mount(int fd, int argc, char** argv) {
         return status;
     }
     fs::Vfs vfs(dispatcher.get());
+    vfs.EnableDentryCache();
     if ((status = vfs.ServeDirectory(mxtl::move(vn), mx::channel(h))) != MX_OK) {
         return status;
     }
@@ -9,14 +9,22 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <launchpad/launchpad.h>
 #include <magenta/compiler.h>
+#include <magenta/process.h>
+#include <magenta/processargs.h>
 #include <magenta/syscalls.h>
 #include <mxtl/algorithm.h>
 #include <mxtl/unique_ptr.h>
 
 namespace {
 
+constexpr char kBinName[] = "/boot/bin/channel-perf";
+// Passed as the sole argument to the child process of a ping-pong test.
+constexpr char kEchoArg[] = "echo";
+
 void argument_error(const char* argv0, const char* message) {
     fprintf(stderr, "%s: error: %s\nRun with -h for help.\n", argv0, message);
     exit(EXIT_FAILURE);
@@ -112,9 +120,123 @@ void do_test(uint32_t duration, const TestArgs& test_args) {
            test_args.size, test_args.handles, test_args.queue, its_per_second);
 }
 
+// Runs in the child process of a ping-pong test: sends every message back
+// until the other end of the channel is closed.
+int echo_main() {
+    mx_handle_t channel = mx_get_startup_handle(PA_HND(PA_USER0, 0));
+    if (channel == MX_HANDLE_INVALID)
+        return EXIT_FAILURE;
+
+    static uint8_t data[MX_CHANNEL_MAX_MSG_BYTES];
+    for (;;) {
+        uint32_t size;
+        mx_status_t status = mx_channel_read(channel, 0u, data, nullptr, sizeof(data), 0u,
+                                             &size, nullptr);
+        if (status == MX_ERR_SHOULD_WAIT) {
+            mx_signals_t pending;
+            status = mx_object_wait_one(channel, MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED,
+                                        MX_TIME_INFINITE, &pending);
+            if (status != MX_OK || !(pending & MX_CHANNEL_READABLE))
+                break;
+            continue;
+        }
+        if (status != MX_OK)
+            break;
+        if (mx_channel_write(channel, 0u, data, size, nullptr, 0u) != MX_OK)
+            break;
+    }
+    mx_handle_close(channel);
+    return EXIT_SUCCESS;
+}
+
+// Starts a child process which echoes messages sent over |channel|.
+// Consumes |channel|.
+mx_handle_t launch_echo_process(mx_handle_t channel) {
+    const char* args[] = {kBinName, kEchoArg};
+    uint32_t id = PA_HND(PA_USER0, 0);
+
+    launchpad_t* lp;
+    launchpad_create(MX_HANDLE_INVALID, "channel-perf-echo", &lp);
+    launchpad_load_from_file(lp, kBinName);
+    launchpad_set_args(lp, mxtl::count_of(args), args);
+    launchpad_add_handles(lp, 1u, &channel, &id);
+
+    mx_handle_t proc;
+    const char* errmsg;
+    mx_status_t status = launchpad_go(lp, &proc, &errmsg);
+    if (status != MX_OK) {
+        fprintf(stderr, "error: failed to launch %s (%d): %s\n", kBinName, status, errmsg);
+        exit(EXIT_FAILURE);
+    }
+    return proc;
+}
+
+// Measures round trips of a message between this process and another one.
+// When both processes share a CPU, each round trip switches address spaces
+// twice, so this is sensitive to the cost of TLB flushes on those switches.
+void do_pingpong_test(uint32_t duration, uint32_t size) {
+    __UNUSED mx_status_t status;
+
+    uint64_t duration_ns = duration * 1000000000ull;
+
+    mx_handle_t mp[2] = {MX_HANDLE_INVALID, MX_HANDLE_INVALID};
+    status = mx_channel_create(0u, &mp[0], &mp[1]);
+    assert(status == MX_OK);
+    mx_handle_t proc = launch_echo_process(mp[1]);
+
+    mxtl::unique_ptr<uint8_t[]> data;
+    if (size) {
+        data.reset(new uint8_t[size]);
+        for (uint32_t i = 0; i < size; i++)
+            data[i] = static_cast<uint8_t>(i);
+    }
+
+    static constexpr uint32_t big_it_size = 1000;
+    uint64_t big_its = 0;
+    uint64_t start_ns = mx_time_get(MX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            status = mx_channel_write(mp[0], 0u, data.get(), size, nullptr, 0u);
+            assert(status == MX_OK);
+
+            status = mx_object_wait_one(mp[0], MX_CHANNEL_READABLE, MX_TIME_INFINITE, nullptr);
+            assert(status == MX_OK);
+
+            uint32_t r_size = size;
+            status = mx_channel_read(mp[0], 0u, data.get(), nullptr, size, 0u, &r_size, nullptr);
+            assert(status == MX_OK);
+            assert(r_size == size);
+        }
+
+        end_ns = mx_time_get(MX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    // Closing our end makes the child exit.
+    status = mx_handle_close(mp[0]);
+    assert(status == MX_OK);
+    status = mx_object_wait_one(proc, MX_PROCESS_TERMINATED, MX_TIME_INFINITE, nullptr);
+    assert(status == MX_OK);
+    status = mx_handle_close(proc);
+    assert(status == MX_OK);
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    double round_trips = static_cast<double>(big_its) * big_it_size;
+    printf("ping-pong %" PRIu32 " bytes with another process: "
+               "%.0f round trips/second, %.0f ns/round trip\n",
+           size, round_trips / real_duration,
+           static_cast<double>(end_ns - start_ns) / round_trips);
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], kEchoArg))
+        return echo_main();
+
     static constexpr char help[] =
         "Usage: %s [options ...]\n"
         "\n"
@@ -122,13 +244,15 @@ int main(int argc, char** argv) {
         "  -h    show help (this)\n"
         "  -o    run single test (default)\n"
         "  -s    run suite (ignores -S/-H/-Q)\n"
+        "  -p    run ping-pong test with another process (uses -S; ignores -H/-Q)\n"
         "  -n N  set test repetition count to N (default: 1)\n"
         "  -d N  set test duration to N seconds (default: 5)\n"
         "  -S N  set message size to N bytes (default: 10)\n"
         "  -H N  set message handle count to N handles (default: 0)\n"
         "  -Q N  set message pre-queue count to N messages (default: 0)\n";
 
-    bool run_suite = false;  // -o/-s
+    bool run_suite = false;     // -o/-s
+    bool run_pingpong = false;  // -o/-p
     uint32_t duration = 5;   // -d
     uint32_t repeats = 1;    // -n
     // Ignored when running a suite:
@@ -139,7 +263,7 @@ int main(int argc, char** argv) {
     };
 
     int opt;
-    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:")) != -1) {
+    while ((opt = getopt(argc, argv, "+hospn:d:S:H:Q:")) != -1) {
         // Our option values are always unsigned numbers.
         uint32_t value = 0;
         if (optarg) {
@@ -157,9 +281,15 @@ int main(int argc, char** argv) {
                 return EXIT_SUCCESS;
             case 'o':
                 run_suite = false;
+                run_pingpong = false;
                 break;
             case 's':
                 run_suite = true;
+                run_pingpong = false;
+                break;
+            case 'p':
+                run_suite = false;
+                run_pingpong = true;
                 break;
             case 'n':
                 assert(optarg);
@@ -217,6 +347,8 @@ int main(int argc, char** argv) {
             };
             for (size_t i = 0; i < mxtl::count_of(suite); i++)
                 do_test(duration, suite[i]);
+        } else if (run_pingpong) {
+            do_pingpong_test(duration, test_args.size);
         } else {
             do_test(duration, test_args);
         }
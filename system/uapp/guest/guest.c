@@ -10,6 +10,7 @@
 #include <unistd.h>
 
 #include <hypervisor/acpi.h>
+#include <hypervisor/block.h>
 #include <hypervisor/guest.h>
 #include <hypervisor/vcpu.h>
 #include <magenta/process.h>
@@ -209,6 +210,18 @@ int main(int argc, char** argv) {
         return status;
     }
 
+    // Service the block queue on its own thread, so that the VCPU continues
+    // to run while I/O is in flight.
+    block_async_t* block_async;
+    status = block_async_create(&guest_state.block_queue, guest_state.mem_addr,
+                                guest_state.mem_size, guest_state.block_fd, physmem_vmo,
+                                virtio_block_interrupt, &vcpu_context, &block_async);
+    if (status != MX_OK) {
+        fprintf(stderr, "Failed to start block device\n");
+        return status;
+    }
+    guest_state.block_async = block_async;
+
     status = vcpu_loop(&vcpu_context);
     if (status != MX_OK)
         fprintf(stderr, "Failed to enter guest %d\n", status);
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <fs/trace.h>
@@ -19,14 +20,18 @@
 
 namespace minfs {
 
+#ifdef __Fuchsia__
+
 mx_status_t Bcache::Readblk(uint32_t bno, void* data) {
-    off_t off = bno * kMinfsBlockSize;
-    FS_TRACE(IO, "readblk() bno=%u off=%#llx\n", bno, (unsigned long long)off);
-    if (lseek(fd_, off, SEEK_SET) < 0) {
-        FS_TRACE_ERROR("minfs: cannot seek to block %u\n", bno);
-        return MX_ERR_IO;
+    mx_status_t status = queue_.Wait();
+    if (status != MX_OK) {
+        return status;
     }
-    if (read(fd_, data, kMinfsBlockSize) != kMinfsBlockSize) {
+    // Positional I/O: vnode operations may run on several threads at once,
+    // and must not race on the shared file offset.
+    off_t off = static_cast<off_t>(bno) * kMinfsBlockSize;
+    FS_TRACE(IO, "readblk() bno=%u off=%#llx\n", bno, (unsigned long long)off);
+    if (pread(fd_, data, kMinfsBlockSize, off) != kMinfsBlockSize) {
         FS_TRACE_ERROR("minfs: cannot read block %u\n", bno);
         return MX_ERR_IO;
     }
@@ -34,13 +39,13 @@ mx_status_t Bcache::Readblk(uint32_t bno, void* data) {
 }
 
 mx_status_t Bcache::Writeblk(uint32_t bno, const void* data) {
-    off_t off = bno * kMinfsBlockSize;
-    FS_TRACE(IO, "writeblk() bno=%u off=%#llx\n", bno, (unsigned long long)off);
-    if (lseek(fd_, off, SEEK_SET) < 0) {
-        FS_TRACE_ERROR("minfs: cannot seek to block %u\n", bno);
-        return MX_ERR_IO;
+    mx_status_t status = queue_.Wait();
+    if (status != MX_OK) {
+        return status;
     }
-    if (write(fd_, data, kMinfsBlockSize) != kMinfsBlockSize) {
+    off_t off = static_cast<off_t>(bno) * kMinfsBlockSize;
+    FS_TRACE(IO, "writeblk() bno=%u off=%#llx\n", bno, (unsigned long long)off);
+    if (pwrite(fd_, data, kMinfsBlockSize, off) != kMinfsBlockSize) {
         FS_TRACE_ERROR("minfs: cannot write block %u\n", bno);
         return MX_ERR_IO;
     }
@@ -48,9 +53,153 @@ mx_status_t Bcache::Writeblk(uint32_t bno, const void* data) {
 }
 
 int Bcache::Sync() {
+    if (queue_.Wait() != MX_OK) {
+        return -1;
+    }
+    return fsync(fd_);
+}
+
+#else
+
+Bcache::CacheBlock* Bcache::CacheLookup(uint32_t bno) {
+    auto iter = cache_hash_.find(bno);
+    if (!iter.IsValid()) {
+        return nullptr;
+    }
+    CacheBlock* blk = &*iter;
+    cache_lru_.erase(*blk);
+    cache_lru_.push_back(blk);
+    return blk;
+}
+
+mx_status_t Bcache::CacheInsert(uint32_t bno, CacheBlock** out) {
+    CacheBlock* blk;
+    if (cache_hash_.size() < kCacheBlocksMax) {
+        AllocChecker ac;
+        blk = new (&ac) CacheBlock;
+        if (!ac.check()) {
+            return MX_ERR_NO_MEMORY;
+        }
+    } else {
+        // Recycle the least recently used block, writing back everything
+        // dirty first so that write-back happens in large batches.
+        if (cache_lru_.front().dirty) {
+            mx_status_t status = CacheFlush();
+            if (status != MX_OK) {
+                return status;
+            }
+        }
+        blk = cache_lru_.pop_front();
+        cache_hash_.erase(*blk);
+    }
+    blk->bno = bno;
+    blk->dirty = false;
+    cache_hash_.insert(blk);
+    cache_lru_.push_back(blk);
+    *out = blk;
+    return MX_OK;
+}
+
+mx_status_t Bcache::CacheFlush() {
+    if (dirty_count_ == 0) {
+        return MX_OK;
+    }
+
+    // Gather the dirty blocks in device order.
+    AllocChecker ac;
+    mxtl::unique_ptr<CacheBlock*[]> dirty(new (&ac) CacheBlock*[dirty_count_]);
+    if (!ac.check()) {
+        return MX_ERR_NO_MEMORY;
+    }
+    size_t count = 0;
+    for (auto& blk : cache_lru_) {
+        if (blk.dirty) {
+            dirty[count++] = &blk;
+        }
+    }
+    assert(count == dirty_count_);
+    qsort(dirty.get(), count, sizeof(CacheBlock*), [](const void* a, const void* b) {
+        uint32_t bno_a = (*static_cast<CacheBlock* const*>(a))->bno;
+        uint32_t bno_b = (*static_cast<CacheBlock* const*>(b))->bno;
+        return (bno_a < bno_b) ? -1 : (bno_a > bno_b) ? 1 : 0;
+    });
+
+    // Write back each run of contiguous blocks with a single call.
+    constexpr size_t kMaxIovecs = 256;
+    struct iovec iov[kMaxIovecs];
+    size_t i = 0;
+    while (i < count) {
+        uint32_t start = dirty[i]->bno;
+        size_t n = 0;
+        while ((i + n < count) && (n < kMaxIovecs) && (dirty[i + n]->bno == start + n)) {
+            iov[n].iov_base = dirty[i + n]->data;
+            iov[n].iov_len = kMinfsBlockSize;
+            n++;
+        }
+        off_t off = static_cast<off_t>(start) * kMinfsBlockSize;
+        FS_TRACE(IO, "writeback() bno=%u count=%zu off=%#llx\n", start, n,
+                 (unsigned long long)off);
+        ssize_t len = n * kMinfsBlockSize;
+        if (pwritev(fd_, iov, static_cast<int>(n), off) != len) {
+            FS_TRACE_ERROR("minfs: cannot write blocks %u-%zu\n", start, start + n - 1);
+            return MX_ERR_IO;
+        }
+        for (size_t j = 0; j < n; j++) {
+            dirty[i + j]->dirty = false;
+        }
+        dirty_count_ -= n;
+        i += n;
+    }
+    return MX_OK;
+}
+
+mx_status_t Bcache::Readblk(uint32_t bno, void* data) {
+    CacheBlock* blk = CacheLookup(bno);
+    if (blk == nullptr) {
+        off_t off = static_cast<off_t>(bno) * kMinfsBlockSize;
+        FS_TRACE(IO, "readblk() bno=%u off=%#llx\n", bno, (unsigned long long)off);
+        mx_status_t status = CacheInsert(bno, &blk);
+        if (status != MX_OK) {
+            return status;
+        }
+        if (pread(fd_, blk->data, kMinfsBlockSize, off) != kMinfsBlockSize) {
+            FS_TRACE_ERROR("minfs: cannot read block %u\n", bno);
+            cache_lru_.erase(*blk);
+            cache_hash_.erase(*blk);
+            delete blk;
+            return MX_ERR_IO;
+        }
+    }
+    memcpy(data, blk->data, kMinfsBlockSize);
+    return MX_OK;
+}
+
+mx_status_t Bcache::Writeblk(uint32_t bno, const void* data) {
+    FS_TRACE(IO, "writeblk() bno=%u\n", bno);
+    CacheBlock* blk = CacheLookup(bno);
+    if (blk == nullptr) {
+        mx_status_t status = CacheInsert(bno, &blk);
+        if (status != MX_OK) {
+            return status;
+        }
+    }
+    memcpy(blk->data, data, kMinfsBlockSize);
+    if (!blk->dirty) {
+        blk->dirty = true;
+        dirty_count_++;
+    }
+    return MX_OK;
+}
+
+int Bcache::Sync() {
+    if (CacheFlush() != MX_OK) {
+        return -1;
+    }
     return fsync(fd_);
 }
 
+#endif
+
 mx_status_t Bcache::Create(mxtl::unique_ptr<Bcache>* out, int fd, uint32_t blockmax) {
     AllocChecker ac;
     mxtl::unique_ptr<Bcache> bc(new (&ac) Bcache(fd, blockmax));
@@ -71,6 +220,8 @@ mx_status_t Bcache::Create(mxtl::unique_ptr<Bcache>* out, int fd, uint32_t block
         ioctl_block_free_txn(fd, &bc->txnid_);
         mx_handle_close(fifo);
         return status;
+    } else if ((status = bc->queue_.Init(fd, bc->fifo_client_)) != MX_OK) {
+        return status;
     }
 #endif
 
@@ -102,8 +253,18 @@ Bcache::Bcache(int fd, uint32_t blockmax) :
     fd_(fd), blockmax_(blockmax) {}
 
 Bcache::~Bcache() {
-#ifdef __Fuchsia__
+#ifndef __Fuchsia__
+    if (CacheFlush() != MX_OK) {
+        FS_TRACE_ERROR("minfs: failed to write back block cache\n");
+    }
+    while (!cache_lru_.is_empty()) {
+        CacheBlock* blk = cache_lru_.pop_front();
+        cache_hash_.erase(*blk);
+        delete blk;
+    }
+#else
     if (fifo_client_ != nullptr) {
+        queue_.Release(fd_);
         ioctl_block_free_txn(fd_, &txnid_);
         ioctl_block_fifo_close(fd_);
         block_fifo_release_client(fifo_client_);
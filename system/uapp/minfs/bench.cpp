@@ -0,0 +1,307 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays a recorded trace of filesystem operations against a minfs image on
+// the host, reporting how long each kind of operation took.
+//
+// A trace is a text file with one operation per line. Blank lines and lines
+// starting with '#' are ignored. Paths are relative to the root of the image.
+// Files are referred to by a small integer slot once opened.
+//
+//   open <slot> <path> <flags>    flags: any of r, w, c (create), x (excl)
+//   close <slot>
+//   read <slot> <offset> <length>
+//   write <slot> <offset> <length>
+//   mkdir <path>
+//   unlink <path>
+//   stat <path>
+//   readdir <path>
+//   sync
+//
+// Written data is a deterministic pattern, so that replaying a trace twice
+// produces identical images.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mxtl/algorithm.h>
+
+#include "host.h"
+#include "minfs-private.h"
+
+namespace {
+
+constexpr size_t kMaxSlots = 256;
+constexpr size_t kMaxIo = 1024 * 1024;
+
+enum Op {
+    kOpOpen,
+    kOpClose,
+    kOpRead,
+    kOpWrite,
+    kOpMkdir,
+    kOpUnlink,
+    kOpStat,
+    kOpReaddir,
+    kOpSync,
+    kOpCount,
+};
+
+const char* kOpNames[kOpCount] = {
+    "open", "close", "read", "write", "mkdir", "unlink", "stat", "readdir", "sync",
+};
+
+struct OpStats {
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+struct BenchState {
+    minfs::Bcache* bc;
+    int fds[kMaxSlots];
+    uint8_t* buffer;
+    OpStats stats[kOpCount];
+};
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Turns a trace path into a path within the image.
+const char* image_path(const char* path, char* out, size_t len) {
+    while (*path == '/') {
+        path++;
+    }
+    snprintf(out, len, "%s%s", PATH_PREFIX, path);
+    return out;
+}
+
+int parse_flags(const char* str) {
+    bool rd = false;
+    bool wr = false;
+    int flags = 0;
+    for (; *str; str++) {
+        switch (*str) {
+        case 'r': rd = true; break;
+        case 'w': wr = true; break;
+        case 'c': flags |= O_CREAT; break;
+        case 'x': flags |= O_EXCL; break;
+        default: return -1;
+        }
+    }
+    if (rd && wr) {
+        return flags | O_RDWR;
+    }
+    return flags | (wr ? O_WRONLY : O_RDONLY);
+}
+
+int get_slot(BenchState* bs, const char* str, bool must_be_open) {
+    char* end;
+    unsigned long slot = strtoul(str, &end, 10);
+    if ((*end != 0) || (slot >= kMaxSlots) || (must_be_open && (bs->fds[slot] < 0))) {
+        return -1;
+    }
+    return static_cast<int>(slot);
+}
+
+void fill_pattern(uint8_t* buf, uint64_t offset, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint64_t pos = offset + i;
+        buf[i] = static_cast<uint8_t>((pos >> 8) ^ pos);
+    }
+}
+
+// Executes one trace operation, returning the operation kind, or -1 on error.
+int run_op(BenchState* bs, int argc, char** argv, uint64_t* bytes) {
+    char path[PATH_MAX];
+    const char* cmd = argv[0];
+    *bytes = 0;
+
+    if (!strcmp(cmd, "open") && (argc == 4)) {
+        int slot = get_slot(bs, argv[1], false);
+        int flags = parse_flags(argv[3]);
+        if ((slot < 0) || (bs->fds[slot] >= 0) || (flags < 0)) {
+            return -1;
+        }
+        if ((bs->fds[slot] = emu_open(image_path(argv[2], path, sizeof(path)), flags, 0644)) < 0) {
+            return -1;
+        }
+        return kOpOpen;
+    } else if (!strcmp(cmd, "close") && (argc == 2)) {
+        int slot = get_slot(bs, argv[1], true);
+        if (slot < 0) {
+            return -1;
+        }
+        emu_close(bs->fds[slot]);
+        bs->fds[slot] = -1;
+        return kOpClose;
+    } else if ((!strcmp(cmd, "read") || !strcmp(cmd, "write")) && (argc == 4)) {
+        bool write = !strcmp(cmd, "write");
+        int slot = get_slot(bs, argv[1], true);
+        if (slot < 0) {
+            return -1;
+        }
+        uint64_t off = strtoull(argv[2], nullptr, 0);
+        uint64_t len = strtoull(argv[3], nullptr, 0);
+        int fd = bs->fds[slot];
+        if (emu_lseek(fd, off, SEEK_SET) < 0) {
+            return -1;
+        }
+        while (len > 0) {
+            size_t xfer = mxtl::min<uint64_t>(len, kMaxIo);
+            ssize_t r;
+            if (write) {
+                fill_pattern(bs->buffer, off, xfer);
+                r = emu_write(fd, bs->buffer, xfer);
+            } else {
+                r = emu_read(fd, bs->buffer, xfer);
+            }
+            if (r < 0) {
+                return -1;
+            } else if (r == 0) {
+                break;
+            }
+            off += r;
+            len -= r;
+            *bytes += r;
+        }
+        return write ? kOpWrite : kOpRead;
+    } else if (!strcmp(cmd, "mkdir") && (argc == 2)) {
+        if (emu_mkdir(image_path(argv[1], path, sizeof(path)), 0755) < 0) {
+            return -1;
+        }
+        return kOpMkdir;
+    } else if (!strcmp(cmd, "unlink") && (argc == 2)) {
+        if (emu_unlink(image_path(argv[1], path, sizeof(path))) < 0) {
+            return -1;
+        }
+        return kOpUnlink;
+    } else if (!strcmp(cmd, "stat") && (argc == 2)) {
+        struct stat s;
+        if (emu_stat(image_path(argv[1], path, sizeof(path)), &s) < 0) {
+            return -1;
+        }
+        return kOpStat;
+    } else if (!strcmp(cmd, "readdir") && (argc == 2)) {
+        DIR* dir = emu_opendir(image_path(argv[1], path, sizeof(path)));
+        if (dir == nullptr) {
+            return -1;
+        }
+        while (emu_readdir(dir) != nullptr) {
+        }
+        emu_closedir(dir);
+        return kOpReaddir;
+    } else if (!strcmp(cmd, "sync") && (argc == 1)) {
+        if (bs->bc->Sync() < 0) {
+            return -1;
+        }
+        return kOpSync;
+    }
+    return -1;
+}
+
+void print_stats(const BenchState* bs, uint64_t elapsed_ns) {
+    fprintf(stdout, "%-8s %10s %14s %12s %12s %12s\n",
+            "op", "count", "bytes", "total ms", "avg us", "max us");
+    for (size_t i = 0; i < kOpCount; i++) {
+        const OpStats& st = bs->stats[i];
+        if (st.count == 0) {
+            continue;
+        }
+        fprintf(stdout, "%-8s %10" PRIu64 " %14" PRIu64 " %12.3f %12.3f %12.3f\n",
+                kOpNames[i], st.count, st.bytes, st.total_ns / 1e6,
+                st.total_ns / 1e3 / st.count, st.max_ns / 1e3);
+    }
+    fprintf(stdout, "total: %.3f ms\n", elapsed_ns / 1e6);
+}
+
+} // namespace anonymous
+
+int run_fs_bench(minfs::Bcache* bc, int argc, char** argv) {
+    if (argc != 1) {
+        fprintf(stderr, "bench requires a trace file\n");
+        return -1;
+    }
+    FILE* trace = fopen(argv[0], "r");
+    if (trace == nullptr) {
+        fprintf(stderr, "error: cannot open trace '%s'\n", argv[0]);
+        return -1;
+    }
+
+    BenchState* bs = static_cast<BenchState*>(calloc(1, sizeof(BenchState)));
+    uint8_t* buffer = static_cast<uint8_t*>(malloc(kMaxIo));
+    if ((bs == nullptr) || (buffer == nullptr)) {
+        free(bs);
+        free(buffer);
+        fclose(trace);
+        return -1;
+    }
+    bs->bc = bc;
+    bs->buffer = buffer;
+    for (size_t i = 0; i < kMaxSlots; i++) {
+        bs->fds[i] = -1;
+    }
+
+    int r = 0;
+    char line[2 * PATH_MAX + 64];
+    unsigned lineno = 0;
+    uint64_t start = now_ns();
+    while (fgets(line, sizeof(line), trace) != nullptr) {
+        lineno++;
+        char* args[5];
+        int nargs = 0;
+        for (char* tok = strtok(line, " \t\r\n"); tok != nullptr && nargs < 5;
+             tok = strtok(nullptr, " \t\r\n")) {
+            args[nargs++] = tok;
+        }
+        if ((nargs == 0) || (args[0][0] == '#')) {
+            continue;
+        }
+
+        uint64_t bytes;
+        uint64_t t0 = now_ns();
+        int op = run_op(bs, nargs, args, &bytes);
+        uint64_t t1 = now_ns();
+        if (op < 0) {
+            fprintf(stderr, "error: %s:%u: '%s' failed\n", argv[0], lineno, args[0]);
+            r = -1;
+            break;
+        }
+        OpStats* st = &bs->stats[op];
+        st->count++;
+        st->bytes += bytes;
+        st->total_ns += t1 - t0;
+        st->max_ns = mxtl::max(st->max_ns, t1 - t0);
+    }
+
+    for (size_t i = 0; i < kMaxSlots; i++) {
+        if (bs->fds[i] >= 0) {
+            emu_close(bs->fds[i]);
+        }
+    }
+    // Include writing back the block cache in the total.
+    if ((r == 0) && (bc->Sync() < 0)) {
+        fprintf(stderr, "error: failed to sync image\n");
+        r = -1;
+    }
+    if (r == 0) {
+        print_stats(bs, now_ns() - start);
+    }
+
+    free(buffer);
+    free(bs);
+    fclose(trace);
+    return r;
+}
@@ -310,7 +310,7 @@ struct dirent* emu_readdir(DIR* dirp) {
             dir->size = 0;
         }
         mx_status_t status = dir->vn->Readdir(&dir->cookie, &dir->data, DIR_BUFSIZE);
-        if (status < 0) {
+        if (status <= 0) {
             break;
         }
         dir->ptr = dir->data;
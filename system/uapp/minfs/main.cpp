@@ -32,6 +32,7 @@
 extern mxtl::RefPtr<minfs::VnodeMinfs> fake_root;
 
 int run_fs_tests(int argc, char** argv);
+int run_fs_bench(minfs::Bcache* bc, int argc, char** argv);
 
 #endif
 
@@ -65,6 +66,7 @@ int do_minfs_mount(mxtl::unique_ptr<minfs::Bcache> bc, int argc, char** argv) {
         return status;
     }
     minfs::vfs.SetDispatcher(dispatcher.get());
+    minfs::vfs.EnableDentryCache();
     if ((status = minfs::vfs.ServeDirectory(mxtl::move(vn),
                                             mx::channel(h))) != MX_OK) {
         return status;
@@ -73,12 +75,17 @@ int do_minfs_mount(mxtl::unique_ptr<minfs::Bcache> bc, int argc, char** argv) {
     return 0;
 }
 #else
+// The filesystem mounted by io_setup, which is never unmounted; its block
+// cache is written back once the command completes.
+minfs::Minfs* mounted_fs;
+
 int io_setup(mxtl::unique_ptr<minfs::Bcache> bc) {
     mxtl::RefPtr<minfs::VnodeMinfs> vn;
     if (minfs_mount(&vn, mxtl::move(bc)) < 0) {
         return -1;
     }
     fake_root = vn;
+    mounted_fs = vn->fs_;
     return 0;
 }
 
@@ -89,6 +96,13 @@ int do_minfs_test(mxtl::unique_ptr<minfs::Bcache> bc, int argc, char** argv) {
     return run_fs_tests(argc, argv);
 }
 
+int do_bench(mxtl::unique_ptr<minfs::Bcache> bc, int argc, char** argv) {
+    if (io_setup(mxtl::move(bc))) {
+        return -1;
+    }
+    return run_fs_bench(mounted_fs->bc_.get(), argc, argv);
+}
+
 int do_cp(mxtl::unique_ptr<minfs::Bcache> bc, int argc, char** argv) {
     if (argc != 2) {
         fprintf(stderr, "cp requires two arguments\n");
@@ -260,6 +274,7 @@ struct {
     {"mount", do_minfs_mount, O_RDWR, "mount filesystem"},
 #else
     {"test", do_minfs_test, O_RDWR, "run tests against filesystem"},
+    {"bench", do_bench, O_RDWR, "replay an operation trace, reporting timings"},
     {"cp", do_cp, O_RDWR, "copy to/from fs"},
     {"mkdir", do_mkdir, O_RDWR, "create directory"},
     {"rm", do_unlink, O_RDWR, "delete file or directory"},
@@ -409,7 +424,14 @@ found:
 
     for (unsigned i = 0; i < mxtl::count_of(CMDS); i++) {
         if (!strcmp(cmd, CMDS[i].name)) {
-            return CMDS[i].func(mxtl::move(bc), argc - 3, argv + 3);
+            int r = CMDS[i].func(mxtl::move(bc), argc - 3, argv + 3);
+#ifndef __Fuchsia__
+            if ((mounted_fs != nullptr) && (mounted_fs->bc_->Sync() < 0)) {
+                fprintf(stderr, "minfs: failed to write back block cache\n");
+                return -1;
+            }
+#endif
+            return r;
         }
     }
     return -1;
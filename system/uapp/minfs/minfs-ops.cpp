@@ -197,6 +197,7 @@ mx_status_t VnodeMinfs::InitIndirectVmo() {
 // track all 'empty/read/dirty' blocks for each vnode, rather than reading
 // the entire file.
 mx_status_t VnodeMinfs::InitVmo() {
+    mxtl::AutoLock lock(&vmo_lock_);
     if (vmo_.is_valid()) {
         return MX_OK;
     }
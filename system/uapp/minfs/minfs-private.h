@@ -10,8 +10,7 @@
 #endif
 
 #include <mxtl/algorithm.h>
-#include <mxtl/intrusive_hash_table.h>
-#include <mxtl/intrusive_single_list.h>
+#include <mxtl/intrusive_resizable_hash_table.h>
 #include <mxtl/macros.h>
 #include <mxtl/ref_ptr.h>
 #include <mxtl/unique_ptr.h>
@@ -93,6 +92,13 @@ public:
     fs::Dispatcher* GetDispatcher() {
         return dispatcher_.get();
     }
+
+    // Guards the inode and block bitmaps and the allocation counts in info_.
+    // The VFS issues writes and truncates on distinct vnodes concurrently,
+    // so every allocator entry point takes this lock itself.
+    mxtl::Mutex alloc_lock_;
+    // Guards vnode_hash_; one vnode may be destroyed while another is looked up.
+    mxtl::Mutex hash_lock_;
 #endif
     void ValidateBno(uint32_t bno) const {
         MX_DEBUG_ASSERT(info_.dat_block <= bno);
@@ -109,6 +115,9 @@ private:
     // Find a free inode, allocate it in the inode bitmap, and write it back to disk
     mx_status_t InoNew(WriteTxn* txn, const minfs_inode_t* inode, uint32_t* ino_out);
 
+    // BlockFree, with alloc_lock_ already held
+    mx_status_t BlockFreeLocked(WriteTxn* txn, uint32_t bno);
+
     // Enqueues an update for allocated inode/block counts
     mx_status_t CountUpdate(WriteTxn* txn);
 #ifdef __Fuchsia__
@@ -129,7 +138,8 @@ private:
 
     // Vnodes exist in the hash table as long as one or more reference exists;
     // when the Vnode is deleted, it is immediately removed from the map.
-    using HashTable = mxtl::HashTable<uint32_t, VnodeMinfs*>;
+    // The table grows with the number of open vnodes.
+    using HashTable = mxtl::ResizableHashTable<uint32_t, VnodeMinfs*>;
     HashTable vnode_hash_{};
 };
 
@@ -147,8 +157,6 @@ struct DirectoryOffset {
     size_t off_prev; // Offset in directory of previous record
 };
 
-#define INO_HASH(ino) fnv1a_tiny(ino, kMinfsHashBits)
-
 // clang-format off
 constexpr uint32_t kMinfsFlagDeletedDirectory = 0x00010000;
 constexpr uint32_t kMinfsFlagReservedMask     = 0xFFFF0000;
@@ -157,7 +165,7 @@ constexpr uint32_t kMinfsFlagReservedMask     = 0xFFFF0000;
 static_assert((kMinfsFlagReservedMask & V_FLAG_RESERVED_MASK) == 0,
               "MinFS should not be using any Vnode flags which are reserved");
 
-class VnodeMinfs final : public fs::Vnode, public mxtl::SinglyLinkedListable<VnodeMinfs*> {
+class VnodeMinfs final : public fs::Vnode, public mxtl::ResizableHashTableable<VnodeMinfs*> {
 public:
     // Allocates a Vnode and initializes the inode given the type.
     static mx_status_t Allocate(Minfs* fs, uint32_t type, mxtl::RefPtr<VnodeMinfs>* out);
@@ -169,7 +177,9 @@ public:
     mx_status_t CanUnlink() const;
 
     uint32_t GetKey() const { return ino_; }
-    static size_t GetHash(uint32_t key) { return INO_HASH(key); }
+    // Inode numbers are allocated densely from the bottom of the inode
+    // table, so their low bits already spread vnodes across buckets.
+    static size_t GetHash(uint32_t key) { return key; }
 
     mx_status_t UnlinkChild(WriteTxn* txn, mxtl::RefPtr<VnodeMinfs> child,
                             minfs_dirent_t* de, DirectoryOffset* offs);
@@ -255,6 +265,9 @@ private:
     // a VMO into memory when it is read/written.
     mx::vmo vmo_{};
     mxtl::unique_ptr<MappedVmo> vmo_indirect_{};
+    // Guards lazy initialization of vmo_ and vmo_indirect_, which may be
+    // raced by concurrent reads of this vnode.
+    mxtl::Mutex vmo_lock_;
     vmoid_t vmoid_{};
     vmoid_t vmoid_indirect_{};
 
@@ -106,6 +106,9 @@ mx_status_t Minfs::InoFree(
     const minfs_inode_t& inode, uint32_t ino) {
     // We're going to be updating block bitmaps repeatedly.
     WriteTxn txn(bc_.get());
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&alloc_lock_);
+#endif
 #ifdef __Fuchsia__
     auto ibm_id = inode_map_vmoid_;
 #else
@@ -127,7 +130,7 @@ mx_status_t Minfs::InoFree(
         }
         ValidateBno(inode.dnum[n]);
         block_count--;
-        BlockFree(&txn, inode.dnum[n]);
+        BlockFreeLocked(&txn, inode.dnum[n]);
     }
 
     // release all indirect blocks
@@ -149,11 +152,11 @@ mx_status_t Minfs::InoFree(
                 continue;
             }
             block_count--;
-            BlockFree(&txn, entry[m]);
+            BlockFreeLocked(&txn, entry[m]);
         }
         // release the direct block itself
         block_count--;
-        BlockFree(&txn, inode.inum[n]);
+        BlockFreeLocked(&txn, inode.inum[n]);
     }
 
     CountUpdate(&txn);
@@ -162,6 +165,9 @@ mx_status_t Minfs::InoFree(
 }
 
 mx_status_t Minfs::InoNew(WriteTxn* txn, const minfs_inode_t* inode, uint32_t* ino_out) {
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&alloc_lock_);
+#endif
     size_t bitoff_start;
     mx_status_t status = inode_map_.Find(false, 0, inode_map_.size(), 1, &bitoff_start);
     if (status != MX_OK) {
@@ -221,6 +227,9 @@ mx_status_t Minfs::VnodeNew(WriteTxn* txn, mxtl::RefPtr<VnodeMinfs>* out, uint32
         return status;
     }
 
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&hash_lock_);
+#endif
     vnode_hash_.insert(vn.get());
 
     *out = mxtl::move(vn);
@@ -228,18 +237,35 @@ mx_status_t Minfs::VnodeNew(WriteTxn* txn, mxtl::RefPtr<VnodeMinfs>* out, uint32
 }
 
 void Minfs::VnodeRelease(VnodeMinfs* vn) {
-    vnode_hash_.erase(*vn);
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&hash_lock_);
+#endif
+    // VnodeGet may already have replaced a vnode which was being destroyed.
+    if (vn->InContainer()) {
+        vnode_hash_.erase(*vn);
+    }
 }
 
 mx_status_t Minfs::VnodeGet(mxtl::RefPtr<VnodeMinfs>* out, uint32_t ino) {
     if ((ino < 1) || (ino >= info_.inode_count)) {
         return MX_ERR_OUT_OF_RANGE;
     }
-    mxtl::RefPtr<VnodeMinfs> vn = mxtl::RefPtr<VnodeMinfs>(vnode_hash_.find(ino).CopyPointer());
-    if (vn != nullptr) {
-        *out = mxtl::move(vn);
-        return MX_OK;
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&hash_lock_);
+#endif
+    auto raw = vnode_hash_.find(ino);
+    if (raw.IsValid()) {
+        // The last reference may have been dropped on another thread, which is
+        // now waiting in VnodeRelease; in that case, start over with a fresh
+        // vnode and let the dying one go.
+        mxtl::RefPtr<VnodeMinfs> vn = mxtl::MakeRefPtrUpgradeFromRaw(raw.CopyPointer());
+        if (vn != nullptr) {
+            *out = mxtl::move(vn);
+            return MX_OK;
+        }
+        vnode_hash_.erase(raw);
     }
+    mxtl::RefPtr<VnodeMinfs> vn;
     mx_status_t status;
     if ((status = VnodeMinfs::AllocateHollow(this, &vn)) != MX_OK) {
         return MX_ERR_NO_MEMORY;
@@ -263,6 +289,13 @@ mx_status_t Minfs::VnodeGet(mxtl::RefPtr<VnodeMinfs>* out, uint32_t ino) {
 }
 
 mx_status_t Minfs::BlockFree(WriteTxn* txn, uint32_t bno) {
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&alloc_lock_);
+#endif
+    return BlockFreeLocked(txn, bno);
+}
+
+mx_status_t Minfs::BlockFreeLocked(WriteTxn* txn, uint32_t bno) {
     ValidateBno(bno);
 
 #ifdef __Fuchsia__
@@ -283,6 +316,9 @@ mx_status_t Minfs::BlockFree(WriteTxn* txn, uint32_t bno) {
 // If hint is nonzero it indicates which block number to start the search for
 // free blocks from.
 mx_status_t Minfs::BlockNew(WriteTxn* txn, uint32_t hint, uint32_t* out_bno) {
+#ifdef __Fuchsia__
+    mxtl::AutoLock lock(&alloc_lock_);
+#endif
     size_t bitoff_start;
     mx_status_t status;
     if ((status = block_map_.Find(false, hint, block_map_.size(), 1, &bitoff_start)) != MX_OK) {
@@ -25,6 +25,9 @@
 
 #ifdef __Fuchsia__
 #include <block-client/client.h>
+#include <fs/block-txn.h>
+#include <mxtl/auto_lock.h>
+#include <mxtl/mutex.h>
 using RawBitmap = bitmap::RawBitmapGeneric<bitmap::VmoStorage>;
 #else
 using RawBitmap = bitmap::RawBitmapGeneric<bitmap::DefaultStorage>;
@@ -162,8 +165,6 @@ static_assert(kMinfsMaxDirectorySize <= kMinfsReclenMask,
 // 32GB -> 4096K blocks -> 512K bitmap (64K qwords)
 
 // Block Cache (bcache.c)
-constexpr uint32_t kMinfsHashBits = (8);
-
 class Bcache {
 public:
     DISALLOW_COPY_ASSIGN_AND_MOVE(Bcache);
@@ -182,9 +183,25 @@ public:
     ssize_t GetDevicePath(char* out, size_t out_len);
     mx_status_t AttachVmo(mx_handle_t vmo, vmoid_t* out);
     mx_status_t Txn(block_fifo_request_t* requests, size_t count) {
+        // Synchronous transactions are ordered after any asynchronous
+        // writes still in flight.
+        mx_status_t status = queue_.Wait();
+        if (status != MX_OK) {
+            return status;
+        }
+        // The fifo client (and its synchronous txnid) is shared by every
+        // thread serving this filesystem.
+        mxtl::AutoLock lock(&txn_lock_);
         return block_fifo_txn(fifo_client_, requests, count);
     }
     txnid_t TxnId() const { return txnid_; }
+
+    // Sends a write transaction without waiting for it to complete.
+    // Errors are reported by the next Txn, Readblk, Writeblk or Sync.
+    mx_status_t TxnAsync(block_fifo_request_t* requests, size_t count) {
+        return queue_.Issue(requests, count);
+    }
+    fs::TxnRequestPool* RequestPool() { return &request_pool_; }
 #endif
 
     int Sync();
@@ -194,9 +211,45 @@ public:
 private:
     Bcache(int fd, uint32_t blockmax);
 
+#ifndef __Fuchsia__
+    // On the host, blocks are cached in memory. Writes are buffered and
+    // written back in runs of contiguous blocks (with pwritev) once the
+    // cache fills up, or on Sync.
+    struct CacheBlock : public mxtl::SinglyLinkedListable<CacheBlock*>,
+                        public mxtl::DoublyLinkedListable<CacheBlock*> {
+        uint32_t GetKey() const { return bno; }
+        static size_t GetHash(uint32_t key) { return key; }
+
+        uint32_t bno;
+        bool dirty;
+        uint8_t data[kMinfsBlockSize];
+    };
+    static constexpr size_t kCacheBuckets = 4096;
+    static constexpr size_t kCacheBlocksMax = 8192; // 64MB of 8K blocks
+    using CacheHash = mxtl::HashTable<uint32_t, CacheBlock*,
+                                      mxtl::SinglyLinkedList<CacheBlock*>,
+                                      size_t, kCacheBuckets>;
+
+    // Returns the cached copy of bno (marking it most recently used), or
+    // nullptr.
+    CacheBlock* CacheLookup(uint32_t bno);
+    // Adds an (uninitialized) entry for bno, evicting the least recently
+    // used entry if the cache is full.
+    mx_status_t CacheInsert(uint32_t bno, CacheBlock** out);
+    // Writes back every dirty block.
+    mx_status_t CacheFlush();
+
+    CacheHash cache_hash_;
+    mxtl::DoublyLinkedList<CacheBlock*> cache_lru_; // Least recently used first
+    size_t dirty_count_ = 0;
+#endif
+
 #ifdef __Fuchsia__
     fifo_client_t* fifo_client_{}; // Fast path to interact with block device
-    txnid_t txnid_{}; // TODO(smklein): One per thread
+    txnid_t txnid_{}; // Used for synchronous transactions
+    mxtl::Mutex txn_lock_;
+    fs::TxnQueue queue_; // Asynchronous write transactions
+    fs::TxnRequestPool request_pool_;
 #endif
     int fd_ = -1;
     uint32_t blockmax_{};
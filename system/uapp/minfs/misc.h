@@ -35,16 +35,6 @@ static inline uint64_t fnv1a64(const void* ptr, size_t len) {
     return n;
 }
 
-// for bits 0..15
-static inline uint32_t fnv1a_tiny(uint32_t n, uint32_t bits) {
-    uint32_t hash = FNV32_OFFSET_BASIS;
-    hash = (hash ^ (n & 0xFF)) * FNV32_PRIME; n >>= 8;
-    hash = (hash ^ (n & 0xFF)) * FNV32_PRIME; n >>= 8;
-    hash = (hash ^ (n & 0xFF)) * FNV32_PRIME; n >>= 8;
-    hash = (hash ^ n) * FNV32_PRIME;
-    return ((hash >> bits) ^ hash) & ((1 << bits) - 1);
-}
-
 #define fnv1a32str(str) fnv1a32(str, strlen(str))
 #define fnv1a64str(str) fnv1a64(str, strlen(str))
 
@@ -0,0 +1,139 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+#include <threads.h>
+
+#include <magenta/syscalls.h>
+#include <mxtl/algorithm.h>
+#include <mxtl/unique_ptr.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+struct MessageArgs {
+    uint32_t size;
+    uint32_t handles;
+};
+
+// Writes a message to a channel and reads it back from the other end, in
+// the same thread.  The handles sent are duplicates of an event, and come
+// back in the same array to be sent again.
+bool channel_write_read_test(perftest::RepeatState* state, MessageArgs args) {
+    mx_handle_t channel[2];
+    if (mx_channel_create(0u, &channel[0], &channel[1]) != MX_OK)
+        return false;
+
+    mx_handle_t event;
+    if (mx_event_create(0u, &event) != MX_OK)
+        return false;
+
+    mxtl::unique_ptr<uint8_t[]> data(new uint8_t[args.size]);
+    mxtl::unique_ptr<mx_handle_t[]> handles(new mx_handle_t[args.handles]);
+    bool ok = true;
+    for (uint32_t i = 0; i < args.handles; i++) {
+        ok = ok && mx_handle_duplicate(event, MX_RIGHT_SAME_RIGHTS, &handles[i]) == MX_OK;
+    }
+
+    while (ok && state->KeepRunning()) {
+        uint32_t actual_size;
+        uint32_t actual_handles;
+        ok = mx_channel_write(channel[0], 0u, data.get(), args.size,
+                              handles.get(), args.handles) == MX_OK &&
+             mx_channel_read(channel[1], 0u, data.get(), handles.get(),
+                             args.size, args.handles,
+                             &actual_size, &actual_handles) == MX_OK &&
+             actual_size == args.size && actual_handles == args.handles;
+    }
+
+    for (uint32_t i = 0; i < args.handles; i++) {
+        mx_handle_close(handles[i]);
+    }
+    mx_handle_close(event);
+    mx_handle_close(channel[0]);
+    mx_handle_close(channel[1]);
+    return ok;
+}
+
+// Sends back every message received on the channel, until the other end
+// is closed.
+int echo_thread(void* arg) {
+    mx_handle_t channel = *static_cast<mx_handle_t*>(arg);
+    mxtl::unique_ptr<uint8_t[]> data(new uint8_t[MX_CHANNEL_MAX_MSG_BYTES]);
+
+    for (;;) {
+        mx_signals_t pending;
+        if (mx_object_wait_one(channel, MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED,
+                               MX_TIME_INFINITE, &pending) != MX_OK ||
+            !(pending & MX_CHANNEL_READABLE))
+            break;
+
+        uint32_t size;
+        if (mx_channel_read(channel, 0u, data.get(), nullptr, MX_CHANNEL_MAX_MSG_BYTES,
+                            0u, &size, nullptr) != MX_OK ||
+            mx_channel_write(channel, 0u, data.get(), size, nullptr, 0u) != MX_OK)
+            break;
+    }
+
+    mx_handle_close(channel);
+    return 0;
+}
+
+// A round trip with mx_channel_call to another thread of this process.
+bool channel_call_test(perftest::RepeatState* state, uint32_t size) {
+    mx_handle_t channel[2];
+    if (mx_channel_create(0u, &channel[0], &channel[1]) != MX_OK)
+        return false;
+
+    thrd_t thread;
+    if (thrd_create(&thread, echo_thread, &channel[1]) != thrd_success) {
+        mx_handle_close(channel[0]);
+        mx_handle_close(channel[1]);
+        return false;
+    }
+
+    mxtl::unique_ptr<uint8_t[]> request(new uint8_t[size]());
+    mxtl::unique_ptr<uint8_t[]> reply(new uint8_t[size]);
+    mx_channel_call_args_t call = {
+        request.get(), nullptr, reply.get(), nullptr, size, 0u, size, 0u,
+    };
+
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        uint32_t actual_size;
+        uint32_t actual_handles;
+        mx_status_t read_status;
+        ok = mx_channel_call(channel[0], 0u, MX_TIME_INFINITE, &call, &actual_size,
+                             &actual_handles, &read_status) == MX_OK &&
+             actual_size == size;
+    }
+
+    // Closing our end makes the echo thread exit.
+    mx_handle_close(channel[0]);
+    thrd_join(thread, nullptr);
+    return ok;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    static const MessageArgs kWriteReadArgs[] = {
+        {64, 0}, {1024, 0}, {32 * 1024, 0}, {64, 1}, {64, 8},
+    };
+    for (const MessageArgs& args : kWriteReadArgs) {
+        char name[64];
+        snprintf(name, sizeof(name), "Channel/WriteRead/%ubytes/%uhandles",
+                 args.size, args.handles);
+        perftest::RegisterTest(name, channel_write_read_test, args);
+    }
+
+    // Messages start with the transaction ID set by mx_channel_call.
+    static const uint32_t kCallSizes[] = { 64, 1024, 32 * 1024 };
+    for (uint32_t size : kCallSizes) {
+        char name[64];
+        snprintf(name, sizeof(name), "Channel/Call/%ubytes", size);
+        perftest::RegisterTest(name, channel_call_test, size);
+    }
+}
+
+} // namespace
@@ -0,0 +1,49 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <magenta/syscalls.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+bool event_signal_test(perftest::RepeatState* state) {
+    mx_handle_t event;
+    if (mx_event_create(0u, &event) != MX_OK)
+        return false;
+
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        ok = mx_object_signal(event, 0u, MX_EVENT_SIGNALED) == MX_OK &&
+             mx_object_signal(event, MX_EVENT_SIGNALED, 0u) == MX_OK;
+    }
+
+    mx_handle_close(event);
+    return ok;
+}
+
+// Waiting on an event which is already signaled, so the wait never blocks.
+bool event_signal_wait_test(perftest::RepeatState* state) {
+    mx_handle_t event;
+    if (mx_event_create(0u, &event) != MX_OK)
+        return false;
+
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        ok = mx_object_signal(event, 0u, MX_EVENT_SIGNALED) == MX_OK &&
+             mx_object_wait_one(event, MX_EVENT_SIGNALED, MX_TIME_INFINITE,
+                                nullptr) == MX_OK &&
+             mx_object_signal(event, MX_EVENT_SIGNALED, 0u) == MX_OK;
+    }
+
+    mx_handle_close(event);
+    return ok;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    perftest::RegisterTest("Event/SignalClear", event_signal_test);
+    perftest::RegisterTest("Event/SignalWaitClear", event_signal_wait_test);
+}
+
+} // namespace
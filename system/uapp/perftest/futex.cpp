@@ -0,0 +1,76 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <magenta/syscalls.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+bool futex_wake_test(perftest::RepeatState* state) {
+    mx_futex_t futex = 0;
+    while (state->KeepRunning()) {
+        if (mx_futex_wake(&futex, 1u) != MX_OK)
+            return false;
+    }
+    return true;
+}
+
+// Each side sets its flag and wakes the other, then waits for its own
+// flag to be set in turn.
+struct PingPong {
+    mx_futex_t ping = 0;
+    mx_futex_t pong = 0;
+    bool stop = false;
+};
+
+void signal_flag(mx_futex_t* flag) {
+    __atomic_store_n(flag, 1, __ATOMIC_SEQ_CST);
+    mx_futex_wake(flag, 1u);
+}
+
+void wait_flag(mx_futex_t* flag) {
+    while (__atomic_load_n(flag, __ATOMIC_SEQ_CST) == 0) {
+        mx_futex_wait(flag, 0, MX_TIME_INFINITE);
+    }
+    __atomic_store_n(flag, 0, __ATOMIC_SEQ_CST);
+}
+
+int pong_thread(void* arg) {
+    PingPong* pp = static_cast<PingPong*>(arg);
+    for (;;) {
+        wait_flag(&pp->ping);
+        if (__atomic_load_n(&pp->stop, __ATOMIC_SEQ_CST))
+            break;
+        signal_flag(&pp->pong);
+    }
+    return 0;
+}
+
+// A round trip between two threads which block on futexes.
+bool futex_ping_pong_test(perftest::RepeatState* state) {
+    PingPong pp;
+    thrd_t thread;
+    if (thrd_create(&thread, pong_thread, &pp) != thrd_success)
+        return false;
+
+    while (state->KeepRunning()) {
+        signal_flag(&pp.ping);
+        wait_flag(&pp.pong);
+    }
+
+    __atomic_store_n(&pp.stop, true, __ATOMIC_SEQ_CST);
+    signal_flag(&pp.ping);
+    thrd_join(thread, nullptr);
+    return true;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    perftest::RegisterTest("Futex/WakeNoWaiters", futex_wake_test);
+    perftest::RegisterTest("Futex/PingPong", futex_ping_pong_test);
+}
+
+} // namespace
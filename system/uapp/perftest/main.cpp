@@ -0,0 +1,17 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <perftest/perftest.h>
+
+#include "perftest.h"
+
+int main(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], kExitArg))
+        return EXIT_SUCCESS;
+
+    return perftest::PerfTestMain(argc, argv);
+}
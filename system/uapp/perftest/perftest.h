@@ -0,0 +1,11 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+constexpr char kBinName[] = "/boot/bin/perftest";
+
+// Passed as the sole argument to make the program exit immediately, for the
+// process launch test.
+constexpr char kExitArg[] = "exit";
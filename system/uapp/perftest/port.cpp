@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/port.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+// Queues a user packet and dequeues it again.
+bool port_queue_wait_test(perftest::RepeatState* state) {
+    mx_handle_t port;
+    if (mx_port_create(0u, &port) != MX_OK)
+        return false;
+
+    mx_port_packet_t packet = {};
+    packet.type = MX_PKT_TYPE_USER;
+
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        ok = mx_port_queue(port, &packet, 0u) == MX_OK &&
+             mx_port_wait(port, MX_TIME_INFINITE, &packet, 0u) == MX_OK;
+    }
+
+    mx_handle_close(port);
+    return ok;
+}
+
+// Arms a one-shot wait on an event, signals the event and dequeues the
+// resulting packet: the path taken by an event loop.
+bool port_wait_async_test(perftest::RepeatState* state) {
+    mx_handle_t port;
+    if (mx_port_create(0u, &port) != MX_OK)
+        return false;
+    mx_handle_t event;
+    if (mx_event_create(0u, &event) != MX_OK) {
+        mx_handle_close(port);
+        return false;
+    }
+
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        mx_port_packet_t packet;
+        ok = mx_object_wait_async(event, port, 0u, MX_EVENT_SIGNALED,
+                                  MX_WAIT_ASYNC_ONCE) == MX_OK &&
+             mx_object_signal(event, 0u, MX_EVENT_SIGNALED) == MX_OK &&
+             mx_port_wait(port, MX_TIME_INFINITE, &packet, 0u) == MX_OK &&
+             mx_object_signal(event, MX_EVENT_SIGNALED, 0u) == MX_OK;
+    }
+
+    mx_handle_close(event);
+    mx_handle_close(port);
+    return ok;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    perftest::RegisterTest("Port/QueueWait", port_queue_wait_test);
+    perftest::RegisterTest("Port/WaitAsyncSignalWait", port_wait_async_test);
+}
+
+} // namespace
@@ -0,0 +1,57 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <launchpad/launchpad.h>
+#include <magenta/syscalls.h>
+#include <mxtl/algorithm.h>
+#include <perftest/perftest.h>
+
+#include "perftest.h"
+
+namespace {
+
+// Launches a process running this program, which exits as soon as it
+// starts, and waits for it to terminate.
+bool process_launch_test(perftest::RepeatState* state) {
+    const char* args[] = {kBinName, kExitArg};
+
+    while (state->KeepRunning()) {
+        launchpad_t* lp;
+        mx_status_t status = launchpad_create(MX_HANDLE_INVALID, "perftest-exit", &lp);
+        if (status == MX_OK)
+            status = launchpad_load_from_file(lp, kBinName);
+        if (status == MX_OK)
+            status = launchpad_set_args(lp, mxtl::count_of(args), args);
+        if (status != MX_OK) {
+            fprintf(stderr, "failed to set up %s (%d): %s\n", kBinName, status,
+                    launchpad_error_message(lp));
+            launchpad_destroy(lp);
+            return false;
+        }
+
+        // launchpad_go() destroys |lp| whether or not it succeeds.
+        mx_handle_t proc;
+        const char* errmsg;
+        status = launchpad_go(lp, &proc, &errmsg);
+        if (status != MX_OK) {
+            fprintf(stderr, "failed to launch %s (%d): %s\n", kBinName, status, errmsg);
+            return false;
+        }
+
+        status = mx_object_wait_one(proc, MX_PROCESS_TERMINATED, MX_TIME_INFINITE, nullptr);
+        mx_handle_close(proc);
+        if (status != MX_OK)
+            return false;
+    }
+    return true;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    perftest::RegisterTest("Process/LaunchWait", process_launch_test);
+}
+
+} // namespace
@@ -0,0 +1,25 @@
+# Copyright 2017 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := userapp
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/channel.cpp \
+    $(LOCAL_DIR)/event.cpp \
+    $(LOCAL_DIR)/futex.cpp \
+    $(LOCAL_DIR)/main.cpp \
+    $(LOCAL_DIR)/port.cpp \
+    $(LOCAL_DIR)/process.cpp \
+    $(LOCAL_DIR)/syscall.cpp \
+    $(LOCAL_DIR)/thread.cpp \
+    $(LOCAL_DIR)/vmo.cpp \
+
+MODULE_LIBS := system/ulib/launchpad system/ulib/magenta system/ulib/mxio system/ulib/c
+MODULE_STATIC_LIBS := system/ulib/perftest system/ulib/mxalloc system/ulib/mxcpp system/ulib/mxtl
+
+include make/module.mk
@@ -0,0 +1,35 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <magenta/syscalls.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+// The cost of entering and leaving the kernel.
+bool syscall_null_test(perftest::RepeatState* state) {
+    while (state->KeepRunning()) {
+        if (mx_syscall_test_0() != MX_OK)
+            return false;
+    }
+    return true;
+}
+
+// Computed in the vDSO when the kernel's clock allows, so normally much
+// cheaper than a syscall.
+bool time_get_test(perftest::RepeatState* state, uint32_t clock_id) {
+    while (state->KeepRunning()) {
+        mx_time_get(clock_id);
+    }
+    return true;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    perftest::RegisterTest("Syscall/Null", syscall_null_test);
+    perftest::RegisterTest("Time/Get/Monotonic", time_get_test, MX_CLOCK_MONOTONIC);
+    perftest::RegisterTest("Time/Get/Thread", time_get_test, MX_CLOCK_THREAD);
+}
+
+} // namespace
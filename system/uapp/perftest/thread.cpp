@@ -0,0 +1,31 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <perftest/perftest.h>
+
+namespace {
+
+int null_thread(void* arg) {
+    return 0;
+}
+
+// Creates a C11 thread which exits immediately, and joins it.
+bool thread_create_join_test(perftest::RepeatState* state) {
+    while (state->KeepRunning()) {
+        thrd_t thread;
+        if (thrd_create(&thread, null_thread, nullptr) != thrd_success ||
+            thrd_join(thread, nullptr) != thrd_success)
+            return false;
+    }
+    return true;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    perftest::RegisterTest("Thread/CreateJoin", thread_create_join_test);
+}
+
+} // namespace
@@ -0,0 +1,80 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <limits.h>
+#include <stdio.h>
+
+#include <magenta/process.h>
+#include <magenta/syscalls.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+constexpr uint32_t kMapFlags = MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE;
+
+bool vmo_create_test(perftest::RepeatState* state, size_t size) {
+    while (state->KeepRunning()) {
+        mx_handle_t vmo;
+        if (mx_vmo_create(size, 0u, &vmo) != MX_OK)
+            return false;
+        mx_handle_close(vmo);
+    }
+    return true;
+}
+
+// Maps and unmaps a VMO whose pages are all committed, without touching
+// them.
+bool vmo_map_test(perftest::RepeatState* state, size_t size) {
+    mx_handle_t vmo;
+    if (mx_vmo_create(size, 0u, &vmo) != MX_OK)
+        return false;
+
+    bool ok = mx_vmo_op_range(vmo, MX_VMO_OP_COMMIT, 0u, size, nullptr, 0u) == MX_OK;
+    while (ok && state->KeepRunning()) {
+        uintptr_t addr;
+        ok = mx_vmar_map(mx_vmar_root_self(), 0u, vmo, 0u, size, kMapFlags, &addr) == MX_OK &&
+             mx_vmar_unmap(mx_vmar_root_self(), addr, size) == MX_OK;
+    }
+
+    mx_handle_close(vmo);
+    return ok;
+}
+
+// Creates and maps a VMO, then writes to every page, so each page is
+// allocated and zeroed by a fault.
+bool vmo_map_fault_test(perftest::RepeatState* state, size_t size) {
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        mx_handle_t vmo;
+        uintptr_t addr;
+        ok = mx_vmo_create(size, 0u, &vmo) == MX_OK;
+        if (!ok)
+            break;
+        ok = mx_vmar_map(mx_vmar_root_self(), 0u, vmo, 0u, size, kMapFlags, &addr) == MX_OK;
+        if (ok) {
+            for (size_t offset = 0; offset < size; offset += PAGE_SIZE) {
+                reinterpret_cast<volatile uint8_t*>(addr)[offset] = 1;
+            }
+            ok = mx_vmar_unmap(mx_vmar_root_self(), addr, size) == MX_OK;
+        }
+        mx_handle_close(vmo);
+    }
+    return ok;
+}
+
+PERFTEST_CTOR(register_tests)
+void register_tests() {
+    static const size_t kSizes[] = { PAGE_SIZE, 16 * PAGE_SIZE, 256 * PAGE_SIZE };
+    for (size_t size : kSizes) {
+        char name[64];
+        snprintf(name, sizeof(name), "Vmo/Create/%zupages", size / PAGE_SIZE);
+        perftest::RegisterTest(name, vmo_create_test, size);
+        snprintf(name, sizeof(name), "Vmo/MapUnmap/%zupages", size / PAGE_SIZE);
+        perftest::RegisterTest(name, vmo_map_test, size);
+        snprintf(name, sizeof(name), "Vmo/CreateMapFault/%zupages", size / PAGE_SIZE);
+        perftest::RegisterTest(name, vmo_map_fault_test, size);
+    }
+}
+
+} // namespace
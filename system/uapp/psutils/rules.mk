@@ -29,7 +29,9 @@ MODULE := $(LOCAL_DIR).top
 
 MODULE_TYPE := userapp
 
-MODULE_SRCS += $(LOCAL_DIR)/top.c
+MODULE_SRCS += \
+    $(LOCAL_DIR)/top.c \
+    $(LOCAL_DIR)/resources.c
 
 MODULE_NAME := top
 
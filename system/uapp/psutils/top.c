@@ -19,6 +19,8 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "resources.h"
+
 enum sort_order {
     UNSORTED,
     SORT_TIME_DELTA
@@ -36,6 +38,9 @@ typedef struct {
     mx_koid_t koid;
     mx_info_thread_t info;
     mx_info_thread_stats_t stats;
+    mx_info_thread_sched_stats_t sched_stats;
+    // scheduler histograms accumulated since the last pass
+    mx_info_thread_sched_stats_t delta_sched_stats;
     char name[MX_MAX_NAME_LEN];
     char proc_name[MX_MAX_NAME_LEN];
 } thread_info_t;
@@ -45,12 +50,17 @@ static mx_time_t delay = MX_SEC(1);
 static int count = -1;
 static bool print_all = false;
 static bool raw_time = false;
+static bool sched_latency = false;
 static enum sort_order sort_order = SORT_TIME_DELTA;
 
 // active locals
 static struct list_node thread_list = LIST_INITIAL_VALUE(thread_list);
 static char last_process_name[MX_MAX_NAME_LEN];
 static mx_koid_t last_process_scanned;
+static mx_handle_t root_resource = MX_HANDLE_INVALID;
+
+// TODO: dynamically compute this based on what it returns
+#define MAX_CPUS 32
 
 // Return text representation of thread state.
 static const char* state_string(const mx_info_thread_t* info) {
@@ -76,6 +86,77 @@ static const char* state_string(const mx_info_thread_t* info) {
     }
 }
 
+// Subtracts the histogram |old| from |hist|, |n| buckets long.
+static void histogram_delta(uint64_t* hist, const uint64_t* old, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        hist[i] -= old[i];
+    }
+}
+
+// Returns the bucket of a histogram |n| buckets long which holds the sample
+// at the given percentile, or -1 if it holds no samples.
+static int histogram_percentile(const uint64_t* hist, size_t n, unsigned percent) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += hist[i];
+    }
+    if (total == 0)
+        return -1;
+
+    // the nearest-rank percentile
+    uint64_t rank = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < n; i++) {
+        seen += hist[i];
+        if (seen >= rank)
+            return (int)i;
+    }
+    return (int)n - 1;
+}
+
+// Formats a time in ns with the largest of the units ns, us and ms which it
+// is at least one of, rounding down.
+static void format_time(char* buf, size_t len, const char* prefix, uint64_t ns) {
+    if (ns < 1000) {
+        snprintf(buf, len, "%s%" PRIu64 "ns", prefix, ns);
+    } else if (ns < 1000000) {
+        snprintf(buf, len, "%s%" PRIu64 "us", prefix, ns / 1000);
+    } else {
+        snprintf(buf, len, "%s%" PRIu64 "ms", prefix, ns / 1000000);
+    }
+}
+
+// Formats the percentile of a time histogram as the bound of its bucket.
+static const char* format_time_percentile(char* buf, size_t len,
+                                          const uint64_t* hist, unsigned percent) {
+    int bucket = histogram_percentile(hist, MX_INFO_SCHED_STATS_TIME_BUCKETS, percent);
+    if (bucket < 0) {
+        snprintf(buf, len, "-");
+    } else if (bucket < MX_INFO_SCHED_STATS_TIME_BUCKETS - 1) {
+        format_time(buf, len, "<", (uint64_t)256 << (2 * bucket));
+    } else {
+        format_time(buf, len, ">=", (uint64_t)256 << (2 * (bucket - 1)));
+    }
+    return buf;
+}
+
+// Formats the percentile of a run queue depth histogram as the bound of its
+// bucket.
+static const char* format_depth_percentile(char* buf, size_t len,
+                                           const uint64_t* hist, unsigned percent) {
+    int bucket = histogram_percentile(hist, MX_INFO_SCHED_STATS_DEPTH_BUCKETS, percent);
+    if (bucket < 0) {
+        snprintf(buf, len, "-");
+    } else if (bucket == 0) {
+        snprintf(buf, len, "0");
+    } else if (bucket < MX_INFO_SCHED_STATS_DEPTH_BUCKETS - 1) {
+        snprintf(buf, len, "<%u", 1u << bucket);
+    } else {
+        snprintf(buf, len, ">=%u", 1u << (bucket - 1));
+    }
+    return buf;
+}
+
 static mx_status_t process_callback(void* unused_ctx, int depth,
                                     mx_handle_t proc,
                                     mx_koid_t koid, mx_koid_t parent_koid) {
@@ -113,6 +194,13 @@ static mx_status_t thread_callback(void* unused_ctx, int depth,
     if (status != MX_OK) {
         return status;
     }
+    if (sched_latency) {
+        status = mx_object_get_info(thread, MX_INFO_THREAD_SCHED_STATS,
+                                    &e.sched_stats, sizeof(e.sched_stats), NULL, NULL);
+        if (status != MX_OK) {
+            return status;
+        }
+    }
 
     // see if this thread is in the list
     thread_info_t* temp;
@@ -125,6 +213,18 @@ static mx_status_t thread_callback(void* unused_ctx, int depth,
                 e.stats.total_runtime - temp->stats.total_runtime;
             temp->info = e.info;
             temp->stats = e.stats;
+
+            temp->delta_sched_stats = e.sched_stats;
+            histogram_delta(temp->delta_sched_stats.wakeup_latency,
+                            temp->sched_stats.wakeup_latency,
+                            MX_INFO_SCHED_STATS_TIME_BUCKETS);
+            histogram_delta(temp->delta_sched_stats.run_slice,
+                            temp->sched_stats.run_slice,
+                            MX_INFO_SCHED_STATS_TIME_BUCKETS);
+            histogram_delta(temp->delta_sched_stats.run_queue_depth,
+                            temp->sched_stats.run_queue_depth,
+                            MX_INFO_SCHED_STATS_DEPTH_BUCKETS);
+            temp->sched_stats = e.sched_stats;
             return MX_OK;
         }
     }
@@ -168,10 +268,64 @@ static void sort_threads(enum sort_order order) {
     list_move(&new_list, &thread_list);
 }
 
+// Prints the scheduler latency percentiles of each cpu since the last pass.
+static void print_cpu_sched_stats(void) {
+    static mx_info_cpu_sched_stats_t old_stats[MAX_CPUS];
+    mx_info_cpu_sched_stats_t stats[MAX_CPUS];
+
+    size_t actual;
+    mx_status_t status = mx_object_get_info(root_resource, MX_INFO_CPU_SCHED_STATS,
+                                            stats, sizeof(stats), &actual, NULL);
+    if (status != MX_OK) {
+        fprintf(stderr, "WARNING: MX_INFO_CPU_SCHED_STATS failed: %s (%d)\n",
+                mx_status_get_string(status), status);
+        return;
+    }
+
+    printf("%3s %8s %8s %8s %8s %8s %8s\n",
+           "CPU", "WAKE50", "WAKE99", "SLICE50", "SLICE99", "RUNQ50", "RUNQ99");
+    for (size_t i = 0; i < actual; i++) {
+        mx_info_cpu_sched_stats_t delta = stats[i];
+        histogram_delta(delta.wakeup_latency, old_stats[i].wakeup_latency,
+                        MX_INFO_SCHED_STATS_TIME_BUCKETS);
+        histogram_delta(delta.run_slice, old_stats[i].run_slice,
+                        MX_INFO_SCHED_STATS_TIME_BUCKETS);
+        histogram_delta(delta.run_queue_depth, old_stats[i].run_queue_depth,
+                        MX_INFO_SCHED_STATS_DEPTH_BUCKETS);
+        old_stats[i] = stats[i];
+
+        if (!(stats[i].flags & MX_INFO_CPU_STATS_FLAG_ONLINE))
+            continue;
+
+        char b[6][16];
+        printf("%3zu %8s %8s %8s %8s %8s %8s\n", i,
+               format_time_percentile(b[0], sizeof(b[0]), delta.wakeup_latency, 50),
+               format_time_percentile(b[1], sizeof(b[1]), delta.wakeup_latency, 99),
+               format_time_percentile(b[2], sizeof(b[2]), delta.run_slice, 50),
+               format_time_percentile(b[3], sizeof(b[3]), delta.run_slice, 99),
+               format_depth_percentile(b[4], sizeof(b[4]), delta.run_queue_depth, 50),
+               format_depth_percentile(b[5], sizeof(b[5]), delta.run_queue_depth, 99));
+    }
+    printf("\n");
+}
+
+// Prints the scheduler latency percentiles of a thread since the last pass.
+static void print_thread_sched_stats(const thread_info_t* e) {
+    const mx_info_thread_sched_stats_t* s = &e->delta_sched_stats;
+    char b[4][16];
+    printf(" %8s %8s %8s %8s",
+           format_time_percentile(b[0], sizeof(b[0]), s->wakeup_latency, 50),
+           format_time_percentile(b[1], sizeof(b[1]), s->wakeup_latency, 99),
+           format_time_percentile(b[2], sizeof(b[2]), s->run_slice, 50),
+           format_time_percentile(b[3], sizeof(b[3]), s->run_slice, 99));
+}
+
 static void print_threads(void) {
     thread_info_t* e;
-    printf("%8s %8s %10s %5s %s\n",
-           "PID", "TID", raw_time ? "TIME_NS" : "TIME%", "STATE", "NAME");
+    printf("%8s %8s %10s %5s", "PID", "TID", raw_time ? "TIME_NS" : "TIME%", "STATE");
+    if (sched_latency)
+        printf(" %8s %8s %8s %8s", "WAKE50", "WAKE99", "SLICE50", "SLICE99");
+    printf(" %s\n", "NAME");
 
     int i = 0;
     list_for_every_entry (&thread_list, e, thread_info_t, node) {
@@ -184,14 +338,15 @@ static void print_threads(void) {
             if (e->delta_time > 0)
                 percent = e->delta_time / (double)delay * 100;
 
-            printf("%8lu %8lu %10.2f %5s %s:%s\n",
-                   e->proc_koid, e->koid, percent, state_string(&e->info),
-                   e->proc_name, e->name);
+            printf("%8lu %8lu %10.2f %5s",
+                   e->proc_koid, e->koid, percent, state_string(&e->info));
         } else {
-            printf("%8lu %8lu %10lu %5s %s:%s\n",
-                   e->proc_koid, e->koid, e->delta_time, state_string(&e->info),
-                   e->proc_name, e->name);
+            printf("%8lu %8lu %10lu %5s",
+                   e->proc_koid, e->koid, e->delta_time, state_string(&e->info));
         }
+        if (sched_latency)
+            print_thread_sched_stats(e);
+        printf(" %s:%s\n", e->proc_name, e->name);
 
         // only print the first count items (or all, if count < 0)
         if (++i == count)
@@ -205,12 +360,18 @@ static void print_help(FILE* f) {
     fprintf(f, " -a              Print all threads, even if inactive\n");
     fprintf(f, " -c <count>      Print the first count threads (default infinity)\n");
     fprintf(f, " -d <delay>      Delay in seconds (default 1 second)\n");
+    fprintf(f, " -l              Print scheduler latency percentiles of each cpu and thread\n");
     fprintf(f, " -n <times>      Run this many times and then exit\n");
     fprintf(f, " -o <sort field> Sort by different fields (default is time)\n");
     fprintf(f, " -r              Print raw time in nanoseconds\n");
     fprintf(f, "\nSupported sort fields:\n");
     fprintf(f, "\tnone : no sorting, in job order\n");
     fprintf(f, "\ttime : sort by delta time between scans\n");
+    fprintf(f, "\nScheduler latency columns, as the bound of the histogram bucket\n"
+               "holding the 50th or 99th percentile since the last scan:\n");
+    fprintf(f, "\tWAKE  : time from being woken up to running\n");
+    fprintf(f, "\tSLICE : time run before switching away\n");
+    fprintf(f, "\tRUNQ  : threads waiting to run when the cpu picked one\n");
 }
 
 int main(int argc, char** argv) {
@@ -273,6 +434,8 @@ int main(int argc, char** argv) {
             i++;
         } else if (!strcmp(arg, "-r")) {
             raw_time = true;
+        } else if (!strcmp(arg, "-l")) {
+            sched_latency = true;
         } else {
             fprintf(stderr, "Unknown option: %s\n", arg);
             print_help(stderr);
@@ -280,6 +443,14 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (sched_latency) {
+        mx_status_t status = get_root_resource(&root_resource);
+        if (status != MX_OK) {
+            fprintf(stderr, "WARNING: no root resource, not printing cpu latency: %s (%d)\n",
+                    mx_status_get_string(status), status);
+        }
+    }
+
     // set stdin to non blocking
     fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
 
@@ -315,6 +486,8 @@ int main(int argc, char** argv) {
         sort_threads(sort_order);
 
         // dump the list of threads
+        if (root_resource != MX_HANDLE_INVALID)
+            print_cpu_sched_stats();
         print_threads();
 
         if (num_loops > 0) {
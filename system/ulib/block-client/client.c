@@ -3,12 +3,13 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <stdbool.h>
 #include <unistd.h>
 
 #include <magenta/compiler.h>
 #include <magenta/device/block.h>
 #include <magenta/syscalls.h>
-#include <sync/completion.h>
+#include <threads.h>
 
 #include "block-client/client.h"
 
@@ -61,14 +62,24 @@ static mx_status_t do_read(mx_handle_t fifo, block_fifo_response_t* response) {
     }
 }
 
-typedef struct block_completion {
-    completion_t completion;
+typedef struct block_txn {
+    // True from the moment the transaction is sent until its response
+    // has been read from the fifo.
+    bool pending;
     mx_status_t status;
-} block_completion_t;
+    block_fifo_callback_t callback;
+    void* cookie;
+} block_txn_t;
 
 typedef struct fifo_client {
     mx_handle_t fifo;
-    block_completion_t txns[MAX_TXN_COUNT];
+    mtx_t lock;
+    // Signalled whenever a response is consumed, or the reader steps down.
+    cnd_t cond;
+    // Only one thread reads responses from the fifo at a time; it completes
+    // the transactions of every other waiter on their behalf.
+    bool reading;
+    block_txn_t txns[MAX_TXN_COUNT];
 } fifo_client_t;
 
 mx_status_t block_fifo_create_client(mx_handle_t fifo, fifo_client_t** out) {
@@ -77,6 +88,8 @@ mx_status_t block_fifo_create_client(mx_handle_t fifo, fifo_client_t** out) {
         return MX_ERR_NO_MEMORY;
     }
     client->fifo = fifo;
+    mtx_init(&client->lock, mtx_plain);
+    cnd_init(&client->cond);
     *out = client;
     return MX_OK;
 }
@@ -87,45 +100,108 @@ void block_fifo_release_client(fifo_client_t* client) {
     }
 
     mx_handle_close(client->fifo);
+    cnd_destroy(&client->cond);
+    mtx_destroy(&client->lock);
     free(client);
 }
 
-mx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count) {
-    if (count == 0) {
-        return MX_OK;
-    } else if (count > MAX_TXN_MESSAGES) {
+mx_status_t block_fifo_txn_async(fifo_client_t* client, block_fifo_request_t* requests,
+                                 size_t count, block_fifo_callback_t callback, void* cookie) {
+    if (count == 0 || count > MAX_TXN_MESSAGES) {
         return MX_ERR_INVALID_ARGS;
     }
 
     txnid_t txnid = requests[0].txnid;
     assert(txnid < MAX_TXN_COUNT);
-    completion_reset(&client->txns[txnid].completion);
-    client->txns[txnid].status = MX_ERR_IO;
+    block_txn_t* txn = &client->txns[txnid];
+    mtx_lock(&client->lock);
+    if (txn->pending) {
+        mtx_unlock(&client->lock);
+        return MX_ERR_BAD_STATE;
+    }
+    txn->pending = true;
+    txn->status = MX_ERR_IO;
+    txn->callback = callback;
+    txn->cookie = cookie;
+    mtx_unlock(&client->lock);
 
-    mx_status_t status;
     for (size_t i = 0; i < count; i++) {
         assert(requests[i].txnid == txnid);
         requests[i].opcode = (requests[i].opcode & BLOCKIO_OP_MASK) |
                              (i == count - 1 ? BLOCKIO_TXN_END : 0);
     }
+    mx_status_t status;
     if ((status = do_write(client->fifo, &requests[0], count)) != MX_OK) {
+        mtx_lock(&client->lock);
+        txn->pending = false;
+        mtx_unlock(&client->lock);
         return status;
     }
+    return MX_OK;
+}
 
-    // As expected by the protocol, when we send one "BLOCKIO_TXN_END" message, we
-    // must read a reply message.
-    block_fifo_response_t response;
-    if ((status = do_read(client->fifo, &response)) != MX_OK) {
-        return status;
-    }
+mx_status_t block_fifo_txn_wait(fifo_client_t* client, txnid_t txnid) {
+    assert(txnid < MAX_TXN_COUNT);
+    mtx_lock(&client->lock);
+    while (client->txns[txnid].pending) {
+        if (client->reading) {
+            // Somebody else is reading responses; they'll wake us when
+            // ours arrives.
+            cnd_wait(&client->cond, &client->lock);
+            continue;
+        }
+
+        // As expected by the protocol, each "BLOCKIO_TXN_END" message sent
+        // produces exactly one reply message, though not necessarily in the
+        // order the transactions were sent.
+        client->reading = true;
+        mtx_unlock(&client->lock);
+        block_fifo_response_t response;
+        mx_status_t status = do_read(client->fifo, &response);
+        mtx_lock(&client->lock);
+        client->reading = false;
+
+        if (status != MX_OK) {
+            cnd_broadcast(&client->cond);
+            mtx_unlock(&client->lock);
+            return status;
+        }
+        if (response.txnid >= MAX_TXN_COUNT || !client->txns[response.txnid].pending) {
+            // Not a response to anything we sent; drop it.
+            cnd_broadcast(&client->cond);
+            continue;
+        }
 
-    // Wake up someone who is waiting (it might be ourselves)
-    txnid_t response_txnid = response.txnid;
-    client->txns[response_txnid].status = response.status;
-    completion_signal(&client->txns[response_txnid].completion);
+        block_txn_t* txn = &client->txns[response.txnid];
+        block_fifo_callback_t callback = txn->callback;
+        void* cookie = txn->cookie;
+        if (callback != NULL) {
+            // Run the callback before marking the transaction complete, so
+            // that waiters observe its side effects, but outside the lock,
+            // so that it may issue further transactions.
+            client->reading = true;
+            mtx_unlock(&client->lock);
+            callback(cookie, response.status);
+            mtx_lock(&client->lock);
+            client->reading = false;
+        }
+        txn->status = response.status;
+        txn->pending = false;
+        cnd_broadcast(&client->cond);
+    }
+    mx_status_t status = client->txns[txnid].status;
+    mtx_unlock(&client->lock);
+    return status;
+}
 
-    // Wait for someone to signal us
-    completion_wait(&client->txns[txnid].completion, MX_TIME_INFINITE);
+mx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count) {
+    if (count == 0) {
+        return MX_OK;
+    }
 
-    return client->txns[txnid].status;
+    mx_status_t status;
+    if ((status = block_fifo_txn_async(client, requests, count, NULL, NULL)) != MX_OK) {
+        return status;
+    }
+    return block_fifo_txn_wait(client, requests[0].txnid);
 }
@@ -15,16 +15,15 @@ __BEGIN_CDECLS
 typedef struct fifo_client fifo_client_t;
 
 // Allocates a block fifo client. The client is thread-safe, as long
-// as each thread accessing the client uses a distinct txnid.
+// as each outstanding transaction uses a distinct txnid.
 mx_status_t block_fifo_create_client(mx_handle_t fifo, fifo_client_t** out);
 
 // Frees a block fifo client
 void block_fifo_release_client(fifo_client_t* client);
 
 // Sends 'count' block device requests and waits for a response.
-// The current implementation is thread-safe, but may only be called from a
-// single process, as it differentiates callers by stack addresses (in an
-// effort to make each transaction require no heap allocation).
+// The current implementation is thread-safe: while one caller reads
+// responses from the fifo, others wait for it to deliver theirs.
 //
 // Each of the requests should set the following:
 // FIELD                                    OPS
@@ -37,4 +36,25 @@ void block_fifo_release_client(fifo_client_t* client);
 // dev_offset                               read, write
 mx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count);
 
+// Invoked with the status of an asynchronous transaction once its response
+// has been read. Callbacks run on whichever thread happens to be reading
+// responses (inside block_fifo_txn or block_fifo_txn_wait), and must not
+// themselves wait on the client.
+typedef void (*block_fifo_callback_t)(void* cookie, mx_status_t status);
+
+// Sends 'count' block device requests, set up as for block_fifo_txn, without
+// waiting for a response. Up to MAX_TXN_COUNT transactions may be
+// outstanding at once, each with a distinct txnid; reusing a txnid which is
+// still outstanding returns MX_ERR_BAD_STATE.
+//
+// The transaction completes (and 'callback', if any, is invoked) once
+// block_fifo_txn_wait or block_fifo_txn is called on the client, by any
+// thread, and reads its response.
+mx_status_t block_fifo_txn_async(fifo_client_t* client, block_fifo_request_t* requests,
+                                 size_t count, block_fifo_callback_t callback, void* cookie);
+
+// Waits for the transaction outstanding on 'txnid' (if any) to complete,
+// returning its status.
+mx_status_t block_fifo_txn_wait(fifo_client_t* client, txnid_t txnid);
+
 __END_CDECLS
@@ -13,7 +13,6 @@ MODULE_SRCS += \
 
 MODULE_STATIC_LIBS := \
     system/ulib/fs \
-    system/ulib/sync \
 
 MODULE_LIBS := \
     system/ulib/c \
@@ -0,0 +1,308 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <bootdata/decompress.h>
+
+#include "decompress-private.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include <magenta/boot/bootdata.h>
+#include <magenta/syscalls.h>
+
+// Decompression of bootfs images which carry a block index (see
+// BOOTDATA_BOOTFS_FLAG_INDEXED). The index gives the source and destination
+// offset of every LZ4 block, so blocks may be decompressed in any order:
+// either all at once across several threads, or one at a time as the files
+// they hold are first accessed.
+//
+// Userboot cannot create threads, and so only uses the serial decompressor
+// in decompress.c.
+
+#define MAX_DECOMPRESS_THREADS 16
+
+typedef struct {
+    const lz4_bootfs_t* fs;
+    uint8_t* dst;
+    atomic_size_t next_block;
+    atomic_int status;
+    const char* err;
+} parallel_work_t;
+
+static int decompress_worker(void* arg) {
+    parallel_work_t* work = arg;
+    for (;;) {
+        size_t n = atomic_fetch_add(&work->next_block, 1);
+        if ((n >= work->fs->block_count) || (atomic_load(&work->status) != MX_OK)) {
+            return 0;
+        }
+        const char* err;
+        mx_status_t status = bootfs_decompress_lz4_block(work->fs, n, work->dst, &err);
+        if (status != MX_OK) {
+            int expected = MX_OK;
+            if (atomic_compare_exchange_strong(&work->status, &expected, status)) {
+                work->err = err;
+            }
+            return 0;
+        }
+    }
+}
+
+mx_status_t decompress_bootdata_parallel(mx_handle_t vmar, mx_handle_t vmo,
+                                         size_t offset, size_t length,
+                                         uint32_t nthreads,
+                                         mx_handle_t* out, const char** err) {
+    *err = "none";
+
+    uintptr_t addr;
+    size_t map_len;
+    const uint8_t* data;
+    mx_status_t status = bootdata_map(vmar, vmo, offset, length, &addr, &map_len, &data, err);
+    if (status < 0) {
+        return status;
+    }
+
+    lz4_bootfs_t fs;
+    const bootdata_t* hdr = (const bootdata_t*)data;
+    if ((nthreads <= 1) || !(hdr->flags & BOOTDATA_BOOTFS_FLAG_COMPRESSED) ||
+        (bootfs_parse_lz4_index(data, length, &fs, err) != MX_OK)) {
+        mx_vmar_unmap(vmar, addr, map_len);
+        return decompress_bootdata(vmar, vmo, offset, length, out, err);
+    }
+
+    mx_handle_t dst_vmo;
+    uintptr_t dst_addr;
+    size_t dst_size;
+    if ((status = bootfs_create_dst_vmo(vmar, hdr, &dst_vmo, &dst_addr,
+                                        &dst_size, err)) != MX_OK) {
+        mx_vmar_unmap(vmar, addr, map_len);
+        return status;
+    }
+
+    parallel_work_t work = {
+        .fs = &fs,
+        .dst = (uint8_t*)dst_addr,
+        .err = "none",
+    };
+    atomic_init(&work.next_block, 0);
+    atomic_init(&work.status, MX_OK);
+
+    if (nthreads > MAX_DECOMPRESS_THREADS) {
+        nthreads = MAX_DECOMPRESS_THREADS;
+    }
+    if (nthreads > fs.block_count) {
+        nthreads = fs.block_count;
+    }
+
+    // This thread takes a share of the blocks too.
+    thrd_t threads[MAX_DECOMPRESS_THREADS];
+    uint32_t started = 0;
+    while (started < nthreads - 1) {
+        if (thrd_create_with_name(&threads[started], decompress_worker, &work,
+                                  "bootfs-decompress") != thrd_success) {
+            break;
+        }
+        started++;
+    }
+    decompress_worker(&work);
+    for (uint32_t i = 0; i < started; i++) {
+        thrd_join(threads[i], NULL);
+    }
+
+    mx_vmar_unmap(vmar, dst_addr, dst_size);
+    mx_vmar_unmap(vmar, addr, map_len);
+
+    status = atomic_load(&work.status);
+    if (status != MX_OK) {
+        *err = work.err;
+        mx_handle_close(dst_vmo);
+        return status;
+    }
+    *out = dst_vmo;
+    return MX_OK;
+}
+
+struct bootdata_lazy {
+    mtx_t lock;
+    mx_handle_t vmar;
+    // Mapping of the compressed bootdata item.
+    uintptr_t src_addr;
+    size_t src_len;
+    // Mapping of the decompressed bootfs VMO.
+    uintptr_t dst_addr;
+    size_t dst_size;
+    lz4_bootfs_t fs;
+    // Number of blocks not yet decompressed. Once every block has been
+    // decompressed the mappings are removed.
+    size_t remaining;
+    bool populated[];
+};
+
+// Returns the index of the block holding byte pos of the decompressed image
+// (excluding the bootdata header).
+static size_t lazy_find_block(const lz4_bootfs_t* fs, size_t pos) {
+    size_t lo = 0;
+    size_t hi = fs->block_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (fs->index[mid].dst_offset <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static mx_status_t lazy_populate_locked(bootdata_lazy_t* lazy, size_t offset, size_t length,
+                                        const char** err) {
+    if (lazy->remaining == 0) {
+        return MX_OK;
+    }
+    // The bootdata header is written when the VMO is created.
+    if (offset + length <= sizeof(bootdata_t)) {
+        return MX_OK;
+    }
+    size_t start = (offset > sizeof(bootdata_t)) ? offset - sizeof(bootdata_t) : 0;
+    size_t end = offset + length - sizeof(bootdata_t);
+    if (end > lazy->fs.content_size) {
+        end = lazy->fs.content_size;
+    }
+    if (start >= end) {
+        return MX_OK;
+    }
+
+    size_t last = lazy_find_block(&lazy->fs, end - 1);
+    for (size_t n = lazy_find_block(&lazy->fs, start); n <= last; n++) {
+        if (lazy->populated[n]) {
+            continue;
+        }
+        mx_status_t status = bootfs_decompress_lz4_block(&lazy->fs, n,
+                                                         (uint8_t*)lazy->dst_addr, err);
+        if (status != MX_OK) {
+            return status;
+        }
+        lazy->populated[n] = true;
+        lazy->remaining--;
+    }
+    return MX_OK;
+}
+
+static void lazy_unmap(bootdata_lazy_t* lazy) {
+    mx_vmar_unmap(lazy->vmar, lazy->dst_addr, lazy->dst_size);
+    mx_vmar_unmap(lazy->vmar, lazy->src_addr, lazy->src_len);
+}
+
+// Populate the bootfs directory, which bootfs_parse reads from the start of
+// the image: a sequence of records, terminated by one with a zero name length.
+static mx_status_t lazy_populate_directory(bootdata_lazy_t* lazy, const char** err) {
+    const uint8_t* dst = (const uint8_t*)lazy->dst_addr;
+    size_t off = sizeof(bootdata_t);
+    size_t end = sizeof(bootdata_t) + lazy->fs.content_size;
+    for (;;) {
+        uint32_t record[3];
+        if (off + sizeof(record) > end) {
+            *err = "bootfs directory extends past end of image";
+            return MX_ERR_INVALID_ARGS;
+        }
+        mx_status_t status = lazy_populate_locked(lazy, off, sizeof(record), err);
+        if (status != MX_OK) {
+            return status;
+        }
+        memcpy(record, dst + off, sizeof(record));
+        off += sizeof(record);
+        if (record[0] == 0) {
+            return MX_OK;
+        }
+        if (record[0] > end - off) {
+            *err = "bootfs directory extends past end of image";
+            return MX_ERR_INVALID_ARGS;
+        }
+        if ((status = lazy_populate_locked(lazy, off, record[0], err)) != MX_OK) {
+            return status;
+        }
+        off += record[0];
+    }
+}
+
+mx_status_t decompress_bootdata_lazy(mx_handle_t vmar, mx_handle_t vmo,
+                                     size_t offset, size_t length,
+                                     bootdata_lazy_t** out_lazy, mx_handle_t* out,
+                                     const char** err) {
+    *err = "none";
+
+    uintptr_t addr;
+    size_t map_len;
+    const uint8_t* data;
+    mx_status_t status = bootdata_map(vmar, vmo, offset, length, &addr, &map_len, &data, err);
+    if (status < 0) {
+        return status;
+    }
+
+    lz4_bootfs_t fs;
+    const bootdata_t* hdr = (const bootdata_t*)data;
+    if (!(hdr->flags & BOOTDATA_BOOTFS_FLAG_COMPRESSED)) {
+        *err = "bootfs is not compressed";
+        status = MX_ERR_NOT_SUPPORTED;
+        goto fail_unmap_src;
+    }
+    if ((status = bootfs_parse_lz4_index(data, length, &fs, err)) != MX_OK) {
+        goto fail_unmap_src;
+    }
+
+    bootdata_lazy_t* lazy = calloc(1, sizeof(bootdata_lazy_t) + fs.block_count * sizeof(bool));
+    if (lazy == NULL) {
+        *err = "out of memory for lazy bootfs";
+        status = MX_ERR_NO_MEMORY;
+        goto fail_unmap_src;
+    }
+    mx_handle_t dst_vmo;
+    if ((status = bootfs_create_dst_vmo(vmar, hdr, &dst_vmo, &lazy->dst_addr,
+                                        &lazy->dst_size, err)) != MX_OK) {
+        goto fail_free;
+    }
+    mtx_init(&lazy->lock, mtx_plain);
+    lazy->vmar = vmar;
+    lazy->src_addr = addr;
+    lazy->src_len = map_len;
+    lazy->fs = fs;
+    lazy->remaining = fs.block_count;
+
+    if ((status = lazy_populate_directory(lazy, err)) != MX_OK) {
+        lazy_unmap(lazy);
+        mx_handle_close(dst_vmo);
+        free(lazy);
+        return status;
+    }
+    if (lazy->remaining == 0) {
+        lazy_unmap(lazy);
+    }
+
+    *out_lazy = lazy;
+    *out = dst_vmo;
+    return MX_OK;
+
+fail_free:
+    free(lazy);
+fail_unmap_src:
+    mx_vmar_unmap(vmar, addr, map_len);
+    return status;
+}
+
+mx_status_t bootdata_lazy_populate(bootdata_lazy_t* lazy, size_t offset, size_t length) {
+    const char* err;
+    mtx_lock(&lazy->lock);
+    bool was_complete = (lazy->remaining == 0);
+    mx_status_t status = lazy_populate_locked(lazy, offset, length, &err);
+    if (!was_complete && (lazy->remaining == 0)) {
+        // Every block has been decompressed; the mappings are no longer needed.
+        lazy_unmap(lazy);
+    }
+    mtx_unlock(&lazy->lock);
+    return status;
+}
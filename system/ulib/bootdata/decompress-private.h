@@ -0,0 +1,52 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <magenta/boot/bootdata.h>
+#include <magenta/types.h>
+
+#pragma GCC visibility push(hidden)
+
+// A compressed bootfs item which carries a block index.
+typedef struct {
+    const bootdata_t* hdr;
+    // The LZ4 frame magic; block index offsets are relative to this.
+    const uint8_t* frame;
+    // The start of the block index frame, which bounds the LZ4 blocks.
+    const uint8_t* frame_end;
+    // Size of the decompressed image, excluding the bootdata header.
+    size_t content_size;
+    const bootdata_lz4_block_t* index;
+    size_t block_count;
+} lz4_bootfs_t;
+
+// Map the bootdata item at offset of total size length.
+// On success, data points at the bootdata header, and map_addr / map_len
+// describe the mapping which must be removed by the caller.
+mx_status_t bootdata_map(mx_handle_t vmar, mx_handle_t vmo, size_t offset, size_t length,
+                         uintptr_t* map_addr, size_t* map_len, const uint8_t** data,
+                         const char** err);
+
+// Validate the LZ4 frame and block index of the compressed bootfs whose
+// bootdata header is at data, with length bytes mapped there.
+mx_status_t bootfs_parse_lz4_index(const uint8_t* data, size_t length, lz4_bootfs_t* fs,
+                                   const char** err);
+
+// Create (and map) the destination VMO for decompressing the bootfs
+// described by hdr, and fill in its uncompressed bootdata header.
+mx_status_t bootfs_create_dst_vmo(mx_handle_t vmar, const bootdata_t* hdr,
+                                  mx_handle_t* out, uintptr_t* out_addr,
+                                  size_t* out_size, const char** err);
+
+// Decompress block n of fs into the destination mapping at dst_base.
+// Blocks are independent, so distinct blocks may be decompressed
+// concurrently.
+mx_status_t bootfs_decompress_lz4_block(const lz4_bootfs_t* fs, size_t n,
+                                        uint8_t* dst_base, const char** err);
+
+#pragma GCC visibility pop
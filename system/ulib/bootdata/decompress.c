@@ -4,6 +4,8 @@
 
 #include <bootdata/decompress.h>
 
+#include "decompress-private.h"
+
 #include <limits.h>
 #include <string.h>
 
@@ -46,6 +48,8 @@ typedef struct {
 #define MX_LZ4_BLOCK_1MB          (6 << 4)
 #define MX_LZ4_BLOCK_4MB          (7 << 4)
 
+#define MX_LZ4_BLOCK_SIZE_MAX     65536
+
 static mx_status_t check_lz4_frame(const lz4_frame_desc* fd,
                                    size_t expected, const char** err) {
     if ((fd->flag & MX_LZ4_FLAG_VERSION) != MX_LZ4_VERSION) {
@@ -85,25 +89,10 @@ static mx_status_t check_lz4_frame(const lz4_frame_desc* fd,
     return MX_OK;
 }
 
-static mx_status_t decompress_bootfs_vmo(mx_handle_t vmar,
-                                         const uint8_t* data, mx_handle_t* out,
-                                         const char** err) {
-    const bootdata_t* hdr = (bootdata_t*)data;
-
-    // Skip past the bootdata header
-    data += sizeof(bootdata_t);
-
-    if (*(const uint32_t*)data != MX_LZ4_MAGIC) {
-        *err = "bad magic number for compressed bootfs";
-        return MX_ERR_INVALID_ARGS;
-    }
-    data += sizeof(uint32_t);
-
-    size_t newsize = hdr->extra;
-    check_lz4_frame((const lz4_frame_desc*)data, newsize - sizeof(bootdata_t), err);
-    data += sizeof(lz4_frame_desc);
-
-    newsize = (newsize + 4095) & ~4095;
+mx_status_t bootfs_create_dst_vmo(mx_handle_t vmar, const bootdata_t* hdr,
+                                  mx_handle_t* out, uintptr_t* out_addr,
+                                  size_t* out_size, const char** err) {
+    size_t newsize = (hdr->extra + 4095) & ~4095;
     if (newsize < hdr->extra) {
         // newsize wrapped, which means the outsize was too large
         *err = "lz4 output size too large";
@@ -122,18 +111,198 @@ static mx_status_t decompress_bootfs_vmo(mx_handle_t vmar,
             MX_VM_FLAG_PERM_READ|MX_VM_FLAG_PERM_WRITE, &dst_addr);
     if (status < 0) {
         *err = "mx_vmar_map failed on bootfs vmo during decompression";
+        mx_handle_close(dst_vmo);
         return status;
     }
 
-    size_t remaining = newsize;
-    uint8_t* dst = (uint8_t*)dst_addr;
-
-    bootdata_t* boothdr = (bootdata_t*)dst;
+    bootdata_t* boothdr = (bootdata_t*)dst_addr;
     // Copy the bootdata header but mark it as not compressed
     *boothdr = *hdr;
     boothdr->length = hdr->extra;
-    boothdr->flags &= ~BOOTDATA_BOOTFS_FLAG_COMPRESSED;
-    dst += sizeof(bootdata_t);
+    boothdr->flags &= ~(BOOTDATA_BOOTFS_FLAG_COMPRESSED | BOOTDATA_BOOTFS_FLAG_INDEXED);
+
+    *out = dst_vmo;
+    *out_addr = dst_addr;
+    *out_size = newsize;
+    return MX_OK;
+}
+
+mx_status_t bootfs_parse_lz4_index(const uint8_t* data, size_t length, lz4_bootfs_t* fs,
+                                   const char** err) {
+    const bootdata_t* hdr = (const bootdata_t*)data;
+    if (length < sizeof(bootdata_t)) {
+        *err = "compressed bootfs too small";
+        return MX_ERR_INVALID_ARGS;
+    }
+    if (!(hdr->flags & BOOTDATA_BOOTFS_FLAG_INDEXED)) {
+        *err = "compressed bootfs has no block index";
+        return MX_ERR_NOT_SUPPORTED;
+    }
+
+    const uint8_t* frame = data + sizeof(bootdata_t);
+    size_t payload = hdr->length;
+    if (payload > length - sizeof(bootdata_t)) {
+        *err = "compressed bootfs extends past end of bootdata";
+        return MX_ERR_INVALID_ARGS;
+    }
+    if ((hdr->extra < sizeof(bootdata_t)) ||
+        (payload < sizeof(uint32_t) + sizeof(lz4_frame_desc) + 4 * sizeof(uint32_t))) {
+        *err = "compressed bootfs too small";
+        return MX_ERR_INVALID_ARGS;
+    }
+    if (*(const uint32_t*)frame != MX_LZ4_MAGIC) {
+        *err = "bad magic number for compressed bootfs";
+        return MX_ERR_INVALID_ARGS;
+    }
+    size_t content_size = hdr->extra - sizeof(bootdata_t);
+    mx_status_t status = check_lz4_frame((const lz4_frame_desc*)(frame + sizeof(uint32_t)),
+                                         content_size, err);
+    if (status != MX_OK) {
+        return status;
+    }
+
+    // The index footer is the last eight bytes of the payload.
+    const uint32_t* footer = (const uint32_t*)(frame + payload - 2 * sizeof(uint32_t));
+    size_t count = footer[0];
+    if (footer[1] != BOOTDATA_LZ4_INDEX_MAGIC) {
+        *err = "bad magic number for bootfs block index";
+        return MX_ERR_INVALID_ARGS;
+    }
+    size_t index_size = count * sizeof(bootdata_lz4_block_t) + 4 * sizeof(uint32_t);
+    if ((count == 0) || (count > payload / sizeof(bootdata_lz4_block_t)) ||
+        (index_size > payload)) {
+        *err = "bad bootfs block index size";
+        return MX_ERR_INVALID_ARGS;
+    }
+    const uint8_t* index_start = frame + payload - index_size;
+    if (*(const uint32_t*)index_start != BOOTDATA_LZ4_INDEX_MAGIC) {
+        *err = "bad magic number for bootfs block index";
+        return MX_ERR_INVALID_ARGS;
+    }
+
+    // The blocks must follow one another from the frame header on, without
+    // gaps or overlaps, and lie before the index. Their decompressed data must
+    // cover the image from its start, in order, and each block may hold no
+    // more than the frame's maximum block size.
+    const bootdata_lz4_block_t* index =
+        (const bootdata_lz4_block_t*)(index_start + 2 * sizeof(uint32_t));
+    size_t src_end = (size_t)(index_start - frame);
+    size_t src_next = sizeof(uint32_t) + sizeof(lz4_frame_desc);
+    for (size_t n = 0; n < count; n++) {
+        size_t dst_start = index[n].dst_offset;
+        size_t dst_end = (n + 1 < count) ? index[n + 1].dst_offset : content_size;
+        if ((index[n].src_offset != src_next) ||
+            (src_next + sizeof(uint32_t) > src_end) ||
+            ((n == 0) && (dst_start != 0)) ||
+            (dst_start >= dst_end) || (dst_end > content_size) ||
+            (dst_end - dst_start > MX_LZ4_BLOCK_SIZE_MAX)) {
+            *err = "bad bootfs block index entry";
+            return MX_ERR_INVALID_ARGS;
+        }
+        uint32_t blocksize = *(const uint32_t*)(frame + src_next);
+        src_next += sizeof(uint32_t) + (blocksize & 0x7fffffff);
+        if (src_next > src_end) {
+            *err = "lz4 block extends past end of compressed bootfs";
+            return MX_ERR_INVALID_ARGS;
+        }
+    }
+
+    fs->hdr = hdr;
+    fs->frame = frame;
+    fs->frame_end = index_start;
+    fs->content_size = content_size;
+    fs->index = index;
+    fs->block_count = count;
+    return MX_OK;
+}
+
+mx_status_t bootfs_decompress_lz4_block(const lz4_bootfs_t* fs, size_t n,
+                                        uint8_t* dst_base, const char** err) {
+    const uint8_t* src = fs->frame + fs->index[n].src_offset;
+    size_t dst_offset = fs->index[n].dst_offset;
+    size_t dst_end = (n + 1 < fs->block_count) ? fs->index[n + 1].dst_offset : fs->content_size;
+    size_t capacity = dst_end - dst_offset;
+    uint8_t* dst = dst_base + sizeof(bootdata_t) + dst_offset;
+
+    uint32_t blocksize = *(const uint32_t*)src;
+    uint32_t actual = blocksize & 0x7fffffff;
+    src += sizeof(uint32_t);
+    if (actual > (size_t)(fs->frame_end - src)) {
+        *err = "lz4 block extends past end of compressed bootfs";
+        return MX_ERR_INVALID_ARGS;
+    }
+
+    // If the data is uncompressed, the high bit is 1.
+    if (blocksize >> 31) {
+        if (actual != capacity) {
+            *err = "bootfs block index does not match block size";
+            return MX_ERR_INVALID_ARGS;
+        }
+        memcpy(dst, src, actual);
+        return MX_OK;
+    }
+    int dcmp = LZ4_decompress_safe((const char*)src, (char*)dst, actual, capacity);
+    if (dcmp < 0) {
+        *err = "lz4 decompression failed";
+        return MX_ERR_BAD_STATE;
+    }
+    if ((size_t)dcmp != capacity) {
+        *err = "bootfs block index does not match block size";
+        return MX_ERR_INVALID_ARGS;
+    }
+    return MX_OK;
+}
+
+mx_status_t bootdata_map(mx_handle_t vmar, mx_handle_t vmo, size_t offset, size_t length,
+                         uintptr_t* map_addr, size_t* map_len, const uint8_t** data,
+                         const char** err) {
+    if (length > SIZE_MAX) {
+        *err = "bootfs VMO too large to map";
+        return MX_ERR_BUFFER_TOO_SMALL;
+    }
+
+    uintptr_t addr = 0;
+    size_t aligned_offset = offset & ~(PAGE_SIZE - 1);
+    size_t align_shift = offset - aligned_offset;
+    length += align_shift;
+    mx_status_t status = mx_vmar_map(vmar, 0, vmo, aligned_offset, length, MX_VM_FLAG_PERM_READ, &addr);
+    if (status < 0) {
+        *err = "mx_vmar_map failed on bootfs vmo";
+        return status;
+    }
+    *map_addr = addr;
+    *map_len = length;
+    *data = (const uint8_t*)(addr + align_shift);
+    return MX_OK;
+}
+
+static mx_status_t decompress_bootfs_vmo(mx_handle_t vmar,
+                                         const uint8_t* data, mx_handle_t* out,
+                                         const char** err) {
+    const bootdata_t* hdr = (bootdata_t*)data;
+
+    // Skip past the bootdata header
+    data += sizeof(bootdata_t);
+
+    if (*(const uint32_t*)data != MX_LZ4_MAGIC) {
+        *err = "bad magic number for compressed bootfs";
+        return MX_ERR_INVALID_ARGS;
+    }
+    data += sizeof(uint32_t);
+
+    check_lz4_frame((const lz4_frame_desc*)data, hdr->extra - sizeof(bootdata_t), err);
+    data += sizeof(lz4_frame_desc);
+
+    mx_handle_t dst_vmo;
+    uintptr_t dst_addr;
+    size_t newsize;
+    mx_status_t status = bootfs_create_dst_vmo(vmar, hdr, &dst_vmo, &dst_addr, &newsize, err);
+    if (status < 0) {
+        return status;
+    }
+
+    size_t remaining = newsize;
+    uint8_t* dst = (uint8_t*)dst_addr + sizeof(bootdata_t);
     remaining -= sizeof(bootdata_t);
 
     // Read each LZ4 block and decompress it. Block sizes are 32 bits.
@@ -194,28 +363,19 @@ mx_status_t decompress_bootdata(mx_handle_t vmar, mx_handle_t vmo,
                                 mx_handle_t* out, const char** err) {
     *err = "none";
 
-    if (length > SIZE_MAX) {
-        *err = "bootfs VMO too large to map";
-        return MX_ERR_BUFFER_TOO_SMALL;
-    }
-
-    uintptr_t addr = 0;
-    size_t aligned_offset = offset & ~(PAGE_SIZE - 1);
-    size_t align_shift = offset - aligned_offset;
-    length += align_shift;
-    mx_status_t status = mx_vmar_map(vmar, 0, vmo, aligned_offset, length, MX_VM_FLAG_PERM_READ, &addr);
+    uintptr_t addr;
+    const uint8_t* data;
+    mx_status_t status = bootdata_map(vmar, vmo, offset, length, &addr, &length, &data, err);
     if (status < 0) {
-        *err = "mx_vmar_map failed on bootfs vmo";
         return status;
     }
-    uintptr_t bootdata_addr = addr + align_shift;
 
-    const bootdata_t* hdr = (bootdata_t*)bootdata_addr;
+    const bootdata_t* hdr = (const bootdata_t*)data;
     switch (hdr->type) {
     case BOOTDATA_BOOTFS_BOOT:
     case BOOTDATA_BOOTFS_SYSTEM:
         if (hdr->flags & BOOTDATA_BOOTFS_FLAG_COMPRESSED) {
-            status = decompress_bootfs_vmo(vmar, (const uint8_t*)bootdata_addr, out, err);
+            status = decompress_bootfs_vmo(vmar, data, out, err);
         }
         break;
     default:
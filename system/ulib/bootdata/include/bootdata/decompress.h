@@ -7,8 +7,11 @@
 
 #pragma GCC visibility push(hidden)
 
+#include <magenta/compiler.h>
 #include <magenta/types.h>
 
+__BEGIN_CDECLS
+
 // Decompress bootdata at offset of total size length into a new VMO
 // On failure, errmsg is a human readable error description to provide
 // more precise debug information.
@@ -16,4 +19,31 @@ mx_status_t decompress_bootdata(mx_handle_t vmar, mx_handle_t vmo,
                                 size_t offset, size_t length,
                                 mx_handle_t* out, const char** errmsg);
 
+// Like decompress_bootdata, but if the bootfs carries a block index its
+// blocks are decompressed on up to nthreads threads. Bootfs images without
+// an index are decompressed serially.
+mx_status_t decompress_bootdata_parallel(mx_handle_t vmar, mx_handle_t vmo,
+                                         size_t offset, size_t length,
+                                         uint32_t nthreads,
+                                         mx_handle_t* out, const char** errmsg);
+
+typedef struct bootdata_lazy bootdata_lazy_t;
+
+// Prepare an indexed, compressed bootfs for decompression on demand.
+// The VMO returned in out initially holds only the bootdata header and
+// the bootfs directory; any other range must be populated with
+// bootdata_lazy_populate before it is read.
+// Returns MX_ERR_NOT_SUPPORTED if the bootfs has no block index.
+mx_status_t decompress_bootdata_lazy(mx_handle_t vmar, mx_handle_t vmo,
+                                     size_t offset, size_t length,
+                                     bootdata_lazy_t** lazy, mx_handle_t* out,
+                                     const char** errmsg);
+
+// Decompress the blocks covering [offset, offset + length) of the VMO
+// returned by decompress_bootdata_lazy, if they are not already present.
+// Safe to call from multiple threads.
+mx_status_t bootdata_lazy_populate(bootdata_lazy_t* lazy, size_t offset, size_t length);
+
+__END_CDECLS
+
 #pragma GCC visibility pop
@@ -8,7 +8,9 @@
 #include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <magenta/driver/binding.h>
@@ -129,6 +131,74 @@ mx_status_t di_read_driver_info(int fd, void *cookie,
                          data, sizeof(data), callback, &ctx);
 }
 
+mx_status_t di_read_driver_manifest(int fd, void* cookie,
+                                    void (*func)(
+                                        const char* libname,
+                                        magenta_driver_note_payload_t* note,
+                                        const mx_bind_inst_t* binding,
+                                        void* cookie)) {
+    struct stat s;
+    if (fstat(fd, &s) < 0) {
+        return MX_ERR_IO;
+    }
+    if ((s.st_size < (off_t)sizeof(di_manifest_header_t)) || (s.st_size > (1 << 24))) {
+        return MX_ERR_INTERNAL;
+    }
+    size_t size = s.st_size;
+    uint8_t* data = malloc(size);
+    if (data == NULL) {
+        return MX_ERR_NO_MEMORY;
+    }
+    mx_status_t status = MX_OK;
+    if (pread(fd, data, size, 0) != (ssize_t)size) {
+        status = MX_ERR_IO;
+        goto done;
+    }
+
+    const di_manifest_header_t* hdr = (const void*)data;
+    if ((hdr->magic != DI_MANIFEST_MAGIC) || (hdr->version != DI_MANIFEST_VERSION)) {
+        status = MX_ERR_INTERNAL;
+        goto done;
+    }
+
+    // check every record before reporting any, so that a bad manifest
+    // reports no drivers rather than some of them
+    for (int pass = 0; pass < 2; pass++) {
+        size_t off = sizeof(di_manifest_header_t);
+        for (uint32_t n = 0; n < hdr->count; n++) {
+            const size_t min = sizeof(di_manifest_record_t) +
+                               sizeof(magenta_driver_note_payload_t);
+            if ((size - off) < min) {
+                status = MX_ERR_INTERNAL;
+                goto done;
+            }
+            di_manifest_record_t* rec = (void*)(data + off);
+            magenta_driver_note_payload_t* note = (void*)(rec + 1);
+            size_t bindlen = note->bindcount * sizeof(mx_bind_inst_t);
+            if ((rec->size < min) || (rec->size > (size - off)) || (rec->size & 3) ||
+                (note->bindcount > (rec->size - min) / sizeof(mx_bind_inst_t)) ||
+                (rec->pathlen == 0) || (rec->pathlen > (rec->size - min - bindlen))) {
+                status = MX_ERR_INTERNAL;
+                goto done;
+            }
+            const mx_bind_inst_t* binding = (const void*)(note + 1);
+            char* libname = (char*)binding + bindlen;
+            if (libname[rec->pathlen - 1] != 0) {
+                status = MX_ERR_INTERNAL;
+                goto done;
+            }
+            if (pass == 1) {
+                func(libname, note, binding, cookie);
+            }
+            off += rec->size;
+        }
+    }
+
+done:
+    free(data);
+    return status;
+}
+
 const char* di_bind_param_name(uint32_t param_num) {
     switch (param_num) {
     case BIND_FLAGS:                  return "Flags";
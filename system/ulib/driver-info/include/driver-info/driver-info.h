@@ -16,6 +16,39 @@ mx_status_t di_read_driver_info(int fd, void *cookie,
                                     const mx_bind_inst_t* binding,
                                     void *cookie));
 
+// A driver manifest holds the driver info of a set of drivers, so that it can
+// be read without opening each of them.  The build makes one of the drivers
+// in bootfs, with the driver-manifest host tool.
+//
+// It is a di_manifest_header_t followed by |count| records.  A record is a
+// di_manifest_record_t, then the driver's note payload, its binding program
+// and its path including the terminating nul, then padding to 4 bytes.
+#define DI_MANIFEST_MAGIC 0x4e414d44 // "DMAN"
+#define DI_MANIFEST_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} di_manifest_header_t;
+
+typedef struct {
+    // size of the record, including this header and the padding
+    uint32_t size;
+    // size of the path, including its nul
+    uint32_t pathlen;
+} di_manifest_record_t;
+
+// Calls |func| with the path and driver info of each driver in the driver
+// manifest read from |fd|, in order.
+mx_status_t di_read_driver_manifest(int fd, void* cookie,
+                                    void (*func)(
+                                        const char* libname,
+                                        magenta_driver_note_payload_t* note,
+                                        const mx_bind_inst_t* binding,
+                                        void* cookie));
+
 // Lookup the human readable name of a bind program parameter, or return NULL if
 // the name is not known.  Used by debug code to do things like dump the
 // published parameters of a device, or dump the bind program of a driver.
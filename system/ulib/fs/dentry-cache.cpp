@@ -0,0 +1,107 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <fs/dentry-cache.h>
+#include <fs/vfs.h>
+#include <magenta/assert.h>
+#include <mxalloc/new.h>
+#include <mxtl/auto_lock.h>
+
+namespace fs {
+
+size_t DentryCache::HashTraits::GetHash(const Key& key) {
+    // FNV-1a over the name, seeded with the parent's address.
+    uint64_t hash = 14695981039346656037ULL ^ reinterpret_cast<uintptr_t>(key.parent);
+    for (size_t i = 0; i < key.len; i++) {
+        hash ^= static_cast<uint8_t>(key.name[i]);
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash % kNumBuckets);
+}
+
+DentryCache::~DentryCache() {
+    Flush();
+}
+
+bool DentryCache::Lookup(Vnode* parent, const char* name, size_t len,
+                         mxtl::RefPtr<Vnode>* out) {
+    mxtl::AutoLock lock(&lock_);
+    auto iter = hash_.find(Key{parent, name, len});
+    if (!iter.IsValid()) {
+        return false;
+    }
+    // Move the entry to the front of the LRU list.
+    mxtl::unique_ptr<Dentry> dentry = lru_.erase(*iter);
+    *out = dentry->child;
+    lru_.push_front(mxtl::move(dentry));
+    return true;
+}
+
+uint64_t DentryCache::Generation() {
+    mxtl::AutoLock lock(&lock_);
+    return generation_;
+}
+
+void DentryCache::Insert(uint64_t generation, mxtl::RefPtr<Vnode> parent, const char* name,
+                         size_t len, mxtl::RefPtr<Vnode> child) {
+    if (len > NAME_MAX) {
+        return;
+    }
+
+    AllocChecker ac;
+    mxtl::unique_ptr<Dentry> dentry(new (&ac) Dentry());
+    if (!ac.check()) {
+        return;
+    }
+    dentry->parent = mxtl::move(parent);
+    dentry->child = mxtl::move(child);
+    dentry->len = len;
+    memcpy(dentry->name, name, len);
+    dentry->name[len] = 0;
+
+    // Declared before the lock, so that any vnode references held by the
+    // replaced or evicted entry are dropped after it is released.
+    mxtl::unique_ptr<Dentry> old;
+    mxtl::AutoLock lock(&lock_);
+    if (generation != generation_) {
+        return;
+    }
+    auto iter = hash_.find(dentry->GetKey());
+    if (iter.IsValid()) {
+        old = RemoveLocked(&*iter);
+    } else if (hash_.size() >= kMaxEntries) {
+        old = RemoveLocked(&lru_.back());
+    }
+    hash_.insert(dentry.get());
+    lru_.push_front(mxtl::move(dentry));
+}
+
+void DentryCache::Invalidate(Vnode* parent, const char* name, size_t len) {
+    mxtl::unique_ptr<Dentry> old;
+    mxtl::AutoLock lock(&lock_);
+    // A lookup of this name which is already under way may have seen the
+    // namespace as it was before; stop it from caching that.
+    generation_++;
+    auto iter = hash_.find(Key{parent, name, len});
+    if (iter.IsValid()) {
+        old = RemoveLocked(&*iter);
+    }
+}
+
+void DentryCache::Flush() {
+    LruList entries;
+    mxtl::AutoLock lock(&lock_);
+    generation_++;
+    hash_.clear();
+    entries.swap(lru_);
+}
+
+mxtl::unique_ptr<DentryCache::Dentry> DentryCache::RemoveLocked(Dentry* dentry) {
+    hash_.erase(*dentry);
+    return lru_.erase(*dentry);
+}
+
+} // namespace fs
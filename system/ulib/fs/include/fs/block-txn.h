@@ -8,6 +8,16 @@
 #include <mxtl/algorithm.h>
 #include <mxtl/macros.h>
 
+#ifdef __Fuchsia__
+#include <block-client/client.h>
+#include <mxalloc/new.h>
+#include <mxtl/auto_lock.h>
+#include <mxtl/intrusive_single_list.h>
+#include <mxtl/intrusive_wavl_tree.h>
+#include <mxtl/mutex.h>
+#include <mxtl/unique_ptr.h>
+#endif
+
 #include <fs/vfs.h>
 
 namespace fs {
@@ -20,90 +30,354 @@ void* GetBlock(const void* data, uint64_t blkno) {
     return (void*)((uintptr_t)(data) + (uintptr_t)(BlockSize * blkno));
 }
 
-// Enqueue multiple writes (or reads) to the underlying block device
-// by shoving them into a simple array, to avoid duplicated ops
-// within a single operation.
+// Enqueue multiple writes (or reads) to the underlying block device,
+// combining overlapping and adjacent ranges within a single operation.
+//
+// On Fuchsia, pending requests are kept ordered by (vmoid, vmo offset), so
+// that each Enqueue finds its neighbours in O(log n), and up to
+// |kMaxPendingRequests| disjoint ranges are buffered before the queue is
+// flushed. Transactions live on the stack, so the buffer comes from the
+// handler's TxnRequestPool; should none be available, each range is sent by
+// itself.
+//
+// Writes are flushed asynchronously through the handler, which may keep
+// several transactions in flight on the block fifo (see TxnQueue). Flush
+// only reports failures to send a write: an error from the device shows up
+// on a later operation of the handler which waits for the queue (such as a
+// read or a sync), which may have nothing to do with this transaction.
+// Reads are flushed synchronously, since the caller needs their data.
+//
+// A handler must provide:
+//   TxnRequestPool* RequestPool();
+// A WriteTxn handler must also provide:
+//   mx_status_t TxnAsync(block_fifo_request_t* requests, size_t count);
+// A ReadTxn handler must also provide:
+//   mx_status_t Txn(block_fifo_request_t* requests, size_t count);
+//   txnid_t TxnId() const;
 //
-// TODO(smklein): This obviously has plenty of room for
-// improvement, including:
-// - Sorting blocks, combining ranges
-// - Writing from multiple buffers (instead of one)
+// TODO(smklein): This still has room for improvement, including:
 // - Cross-operation writeback delays
 template <typename IdType, bool Write, size_t BlockSize, typename TxnHandler>
 class BlockTxn;
 
 #ifdef __Fuchsia__
 
+// A pool of txnids allowing a filesystem to keep several asynchronous
+// transactions in flight on a single block fifo client. Transactions are
+// issued round-robin across the pool; once every txnid is in use, Issue
+// blocks until the oldest transaction completes.
+class TxnQueue {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(TxnQueue);
+    static constexpr size_t kMaxInFlight = 8;
+
+    TxnQueue() = default;
+    ~TxnQueue() {
+        MX_DEBUG_ASSERT(count_ == 0);
+    }
+
+    // Allocates txnids for the block device 'fd'. At least one txnid must be
+    // available; up to kMaxInFlight are used.
+    mx_status_t Init(int fd, fifo_client_t* client) {
+        client_ = client;
+        while (count_ < kMaxInFlight) {
+            ssize_t r = ioctl_block_alloc_txn(fd, &txnids_[count_]);
+            if (r < 0) {
+                if (count_ == 0) {
+                    return static_cast<mx_status_t>(r);
+                }
+                break;
+            }
+            busy_[count_++] = false;
+        }
+        return MX_OK;
+    }
+
+    // Waits for all outstanding transactions, and frees the txnids.
+    void Release(int fd) {
+        Wait();
+        mxtl::AutoLock lock(&lock_);
+        while (count_ > 0) {
+            ioctl_block_free_txn(fd, &txnids_[--count_]);
+        }
+    }
+
+    // Sends 'requests' without waiting for them to complete. The txnid of
+    // each request is overwritten.
+    mx_status_t Issue(block_fifo_request_t* requests, size_t count) {
+        mxtl::AutoLock lock(&lock_);
+        size_t slot = next_;
+        if (busy_[slot]) {
+            RecordLocked(block_fifo_txn_wait(client_, txnids_[slot]));
+            busy_[slot] = false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            requests[i].txnid = txnids_[slot];
+        }
+        mx_status_t status = block_fifo_txn_async(client_, requests, count, nullptr, nullptr);
+        if (status != MX_OK) {
+            return status;
+        }
+        busy_[slot] = true;
+        next_ = (next_ + 1) % count_;
+        return MX_OK;
+    }
+
+    // Waits for every transaction issued so far to complete. Returns the
+    // first error any of them encountered since the previous call to Wait.
+    mx_status_t Wait() {
+        mxtl::AutoLock lock(&lock_);
+        for (size_t i = 0; i < count_; i++) {
+            if (busy_[i]) {
+                RecordLocked(block_fifo_txn_wait(client_, txnids_[i]));
+                busy_[i] = false;
+            }
+        }
+        mx_status_t status = status_;
+        status_ = MX_OK;
+        return status;
+    }
+
+private:
+    void RecordLocked(mx_status_t status) TA_REQ(lock_) {
+        if (status_ == MX_OK) {
+            status_ = status;
+        }
+    }
+
+    mxtl::Mutex lock_;
+    fifo_client_t* client_ = nullptr;
+    txnid_t txnids_[kMaxInFlight];
+    bool busy_[kMaxInFlight] TA_GUARDED(lock_);
+    size_t count_ = 0;
+    size_t next_ TA_GUARDED(lock_) = 0;
+    mx_status_t status_ TA_GUARDED(lock_) = MX_OK;
+};
+
+// A range of blocks queued by a BlockTxn.
+struct BlockTxnRequest : public mxtl::WAVLTreeContainable<BlockTxnRequest*> {
+    struct Key {
+        Key(vmoid_t vmoid, uint64_t offset) : vmoid(vmoid), offset(offset) {}
+        bool operator<(const Key& other) const {
+            return (vmoid < other.vmoid) || ((vmoid == other.vmoid) && (offset < other.offset));
+        }
+        bool operator==(const Key& other) const {
+            return (vmoid == other.vmoid) && (offset == other.offset);
+        }
+        vmoid_t vmoid;
+        uint64_t offset;
+    };
+
+    Key GetKey() const { return Key(request.vmoid, request.vmo_offset); }
+    uint64_t end() const { return request.vmo_offset + request.length; }
+    void Extend(uint64_t new_end) {
+        if (new_end > end()) {
+            request.length = new_end - request.vmo_offset;
+        }
+    }
+    block_fifo_request_t request;
+    BlockTxnRequest* next_free = nullptr;
+};
+
+// Keeps the request buffers of finished transactions for the next ones, so
+// that a transaction does not allocate one. A handler owns one pool, which
+// holds as many buffers as it has ever had transactions open at once.
+class TxnRequestPool {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(TxnRequestPool);
+    static constexpr size_t kRequestsPerBuffer = MAX_TXN_MESSAGES * 8;
+
+    struct Buffer : public mxtl::SinglyLinkedListable<mxtl::unique_ptr<Buffer>> {
+        BlockTxnRequest requests[kRequestsPerBuffer];
+    };
+
+    TxnRequestPool() = default;
+
+    // Returns a buffer for one transaction, or nullptr if there is none to
+    // reuse and one cannot be allocated.
+    mxtl::unique_ptr<Buffer> Acquire() {
+        {
+            mxtl::AutoLock lock(&lock_);
+            if (!free_.is_empty()) {
+                return free_.pop_front();
+            }
+        }
+        AllocChecker ac;
+        mxtl::unique_ptr<Buffer> buffer(new (&ac) Buffer());
+        if (!ac.check()) {
+            return nullptr;
+        }
+        return buffer;
+    }
+
+    void Release(mxtl::unique_ptr<Buffer> buffer) {
+        mxtl::AutoLock lock(&lock_);
+        free_.push_front(mxtl::move(buffer));
+    }
+
+private:
+    mxtl::Mutex lock_;
+    mxtl::SinglyLinkedList<mxtl::unique_ptr<Buffer>> free_ TA_GUARDED(lock_);
+};
+
 template <bool Write, size_t BlockSize, typename TxnHandler>
 class BlockTxn <vmoid_t, Write, BlockSize, TxnHandler> {
 public:
-    DISALLOW_COPY_AND_ASSIGN_ALLOW_MOVE(BlockTxn);
-    explicit BlockTxn(TxnHandler* handler) : handler_(handler), count_(0) {}
+    DISALLOW_COPY_ASSIGN_AND_MOVE(BlockTxn);
+    static constexpr size_t kMaxPendingRequests = TxnRequestPool::kRequestsPerBuffer;
+
+    explicit BlockTxn(TxnHandler* handler) : handler_(handler) {
+        buffer_ = handler_->RequestPool()->Acquire();
+        if (buffer_ == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < kMaxPendingRequests; i++) {
+            Release(&buffer_->requests[i]);
+        }
+    }
     ~BlockTxn() {
         Flush();
+        if (buffer_ != nullptr) {
+            handler_->RequestPool()->Release(mxtl::move(buffer_));
+        }
     }
 
     // Identify that a block should be written to disk
     // as a later point in time.
     void Enqueue(vmoid_t id, uint64_t relative_block, uint64_t absolute_block, uint64_t nblocks) {
-        for (size_t i = 0; i < count_; i++) {
-            if (requests_[i].vmoid != id) {
-                continue;
-            }
-
-            if (requests_[i].vmo_offset == relative_block) {
-                // Take the longer of the operations (if operating on the same
-                // blocks).
-                requests_[i].length = (requests_[i].length > nblocks) ? requests_[i].length : nblocks;
-                return;
-            } else if ((requests_[i].vmo_offset + requests_[i].length == relative_block) &&
-                       (requests_[i].dev_offset + requests_[i].length == absolute_block)) {
-                // Combine with the previous request, if immediately following.
-                requests_[i].length += nblocks;
+        // NOTE: It's easier to compare everything when dealing
+        // with blocks (not offsets!) so the following are described in
+        // terms of blocks until we Flush().
+        Key key(id, relative_block);
+        auto next = pending_.upper_bound(key);
+        if (next != pending_.begin()) {
+            // Extend the preceding request if the new range overlaps it, or
+            // immediately follows it, on both the VMO and the device.
+            auto prev = next;
+            --prev;
+            if (Mergeable(*prev, id, relative_block, absolute_block) &&
+                (relative_block <= prev->end())) {
+                prev->Extend(relative_block + nblocks);
+                Absorb(prev);
                 return;
+            } else if (prev->GetKey() == key) {
+                // These VMO blocks are already queued for other device
+                // blocks; send them before queueing the new range.
+                Flush();
+                next = pending_.end();
             }
         }
+        if (next.IsValid() && Mergeable(*next, id, relative_block, absolute_block) &&
+            (next->request.vmo_offset <= relative_block + nblocks)) {
+            // The new range precedes (and overlaps, or abuts) the following
+            // request; grow that one backwards.
+            Request* req = pending_.erase(next);
+            uint64_t end = mxtl::max(req->end(), relative_block + nblocks);
+            req->request.vmo_offset = relative_block;
+            req->request.dev_offset = absolute_block;
+            req->request.length = end - relative_block;
+            pending_.insert(req);
+            return;
+        }
 
-        requests_[count_].txnid = handler_->TxnId();
-        requests_[count_].vmoid = id;
-        // NOTE: It's easier to compare everything when dealing
-        // with blocks (not offsets!) so the following are described in
-        // terms of blocks until we Flush().
-        requests_[count_].vmo_offset = relative_block;
-        requests_[count_].dev_offset = absolute_block;
-        requests_[count_].length = nblocks;
-        count_++;
-
-        if (count_ == MAX_TXN_MESSAGES) {
-            // TODO(smklein): Maybe panic (on write) instead, for metadata?
-            // TODO(smklein): We could buffer more messages than this -- just
-            // send then in MAX_TXN_MESSAGES increments.
+        if (free_ == nullptr) {
+            Flush();
+        }
+        Request single;
+        Request* req = &single;
+        if (free_ != nullptr) {
+            req = free_;
+            free_ = req->next_free;
+        }
+        req->request.vmoid = id;
+        req->request.vmo_offset = relative_block;
+        req->request.dev_offset = absolute_block;
+        req->request.length = nblocks;
+        pending_.insert(req);
+        if (req == &single) {
+            // There is no pool to buffer it in.
             Flush();
         }
     }
 
-    // Activate the transaction
+    // Activate the transaction. For a write, only a failure to send the
+    // requests is reported here; see above.
     mx_status_t Flush();
 
 private:
+    using Key = BlockTxnRequest::Key;
+    using Request = BlockTxnRequest;
+    using RequestTree = mxtl::WAVLTree<Key, Request*>;
+
+    // True if the range starting at (relative_block, absolute_block) in 'id'
+    // maps the VMO onto the device at the same displacement as 'req'.
+    static bool Mergeable(const Request& req, vmoid_t id, uint64_t relative_block,
+                          uint64_t absolute_block) {
+        return (req.request.vmoid == id) &&
+               (req.request.dev_offset - req.request.vmo_offset ==
+                absolute_block - relative_block);
+    }
+
+    // Having grown 'req', fold in any following requests it now overlaps or
+    // abuts.
+    void Absorb(typename RequestTree::iterator req) {
+        auto next = req;
+        ++next;
+        while (next.IsValid() &&
+               Mergeable(*req, next->request.vmoid, next->request.vmo_offset,
+                         next->request.dev_offset) &&
+               (next->request.vmo_offset <= req->end())) {
+            req->Extend(next->end());
+            Release(pending_.erase(next++));
+        }
+    }
+
+    // Returns 'req' to the free list, unless it is not from the buffer.
+    void Release(Request* req) {
+        if (buffer_ != nullptr) {
+            req->next_free = free_;
+            free_ = req;
+        }
+    }
+
     TxnHandler* handler_;
-    size_t count_;
-    block_fifo_request_t requests_[MAX_TXN_MESSAGES];
+    RequestTree pending_;
+    mxtl::unique_ptr<TxnRequestPool::Buffer> buffer_;
+    Request* free_ = nullptr;
 };
 
 template <bool Write, size_t BlockSize, typename TxnHandler>
 inline mx_status_t BlockTxn<vmoid_t, Write, BlockSize, TxnHandler>::Flush() {
-    for (size_t i = 0; i < count_; i++) {
-        requests_[i].opcode = Write ? BLOCKIO_WRITE : BLOCKIO_READ;
-        requests_[i].vmo_offset *= BlockSize;
-        requests_[i].dev_offset *= BlockSize;
-        requests_[i].length *= BlockSize;
-    }
+    block_fifo_request_t requests[MAX_TXN_MESSAGES];
+    size_t count = 0;
     mx_status_t status = MX_OK;
-    if (count_ != 0) {
-        status = handler_->Txn(requests_, count_);
+    auto send = [&]() {
+        mx_status_t s = Write ? handler_->TxnAsync(requests, count) :
+                                handler_->Txn(requests, count);
+        if (status == MX_OK) {
+            status = s;
+        }
+        count = 0;
+    };
+
+    // Requests are sent in order of VMO offset, which for a single VMO is
+    // usually also the order of the device offsets.
+    while (!pending_.is_empty()) {
+        Request* req = pending_.pop_front();
+        requests[count] = req->request;
+        requests[count].txnid = Write ? 0 : handler_->TxnId();
+        requests[count].opcode = Write ? BLOCKIO_WRITE : BLOCKIO_READ;
+        requests[count].vmo_offset *= BlockSize;
+        requests[count].dev_offset *= BlockSize;
+        requests[count].length *= BlockSize;
+        Release(req);
+        if (++count == MAX_TXN_MESSAGES) {
+            send();
+        }
+    }
+    if (count != 0) {
+        send();
     }
-    count_ = 0;
     return status;
 }
 
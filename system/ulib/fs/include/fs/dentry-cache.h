@@ -0,0 +1,114 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <magenta/thread_annotations.h>
+#include <mxtl/intrusive_double_list.h>
+#include <mxtl/intrusive_hash_table.h>
+#include <mxtl/macros.h>
+#include <mxtl/mutex.h>
+#include <mxtl/ref_ptr.h>
+#include <mxtl/unique_ptr.h>
+
+namespace fs {
+
+class Vnode;
+
+// DentryCache remembers the results of Vnode::Lookup, keyed by the parent
+// vnode and the name which was looked up. Both positive entries (which hold
+// a reference to the child) and negative entries (the name did not exist)
+// are cached.
+//
+// The cache is bounded; the least recently used entry is evicted when it is
+// full. Entries are invalidated individually when the VFS creates, unlinks,
+// renames or links a name, and the whole cache may be flushed when a
+// filesystem changes its namespace by other means. Each invalidation or
+// flush advances a generation counter, so that a lookup which raced with
+// either is not inserted.
+class DentryCache {
+public:
+    static constexpr size_t kMaxEntries = 256;
+
+    DentryCache() = default;
+    ~DentryCache();
+    DISALLOW_COPY_ASSIGN_AND_MOVE(DentryCache);
+
+    // Returns true if (parent, name) is cached. On a hit, |out| is set to the
+    // cached child, or to nullptr if the name is known not to exist.
+    bool Lookup(Vnode* parent, const char* name, size_t len, mxtl::RefPtr<Vnode>* out);
+
+    // Returns the current generation. Callers should sample it before looking
+    // up a name in the filesystem, and pass it back to Insert.
+    uint64_t Generation();
+
+    // Caches the result of looking up (parent, name). A null |child| records
+    // a negative entry. Ignored if anything was invalidated or flushed since
+    // |generation| was sampled.
+    void Insert(uint64_t generation, mxtl::RefPtr<Vnode> parent, const char* name, size_t len,
+                mxtl::RefPtr<Vnode> child);
+
+    // Drops any cached lookup of (parent, name).
+    void Invalidate(Vnode* parent, const char* name, size_t len);
+
+    // Drops every cached lookup.
+    void Flush();
+
+private:
+    struct Key {
+        const Vnode* parent;
+        const char* name;
+        size_t len;
+    };
+
+    struct Dentry : public mxtl::DoublyLinkedListable<mxtl::unique_ptr<Dentry>> {
+        Key GetKey() const { return Key{parent.get(), name, len}; }
+
+        mxtl::DoublyLinkedListNodeState<Dentry*> hash_node;
+        mxtl::RefPtr<Vnode> parent;
+        mxtl::RefPtr<Vnode> child;
+        size_t len;
+        char name[NAME_MAX + 1];
+    };
+
+    struct KeyTraits {
+        static Key GetKey(const Dentry& dentry) { return dentry.GetKey(); }
+        static bool EqualTo(const Key& k1, const Key& k2) {
+            return (k1.parent == k2.parent) && (k1.len == k2.len) &&
+                   (memcmp(k1.name, k2.name, k1.len) == 0);
+        }
+    };
+
+    struct HashTraits {
+        static size_t GetHash(const Key& key);
+    };
+
+    struct HashNodeTraits {
+        static mxtl::DoublyLinkedListNodeState<Dentry*>& node_state(Dentry& dentry) {
+            return dentry.hash_node;
+        }
+    };
+
+    static constexpr size_t kNumBuckets = 211;
+    using HashBucket = mxtl::DoublyLinkedList<Dentry*, HashNodeTraits>;
+    using HashTable = mxtl::HashTable<Key, Dentry*, HashBucket, size_t, kNumBuckets,
+                                      KeyTraits, HashTraits>;
+    using LruList = mxtl::DoublyLinkedList<mxtl::unique_ptr<Dentry>>;
+
+    // Removes |dentry| from the cache, returning ownership of it so that the
+    // vnode references it holds may be dropped without holding the lock.
+    mxtl::unique_ptr<Dentry> RemoveLocked(Dentry* dentry) __TA_REQUIRES(lock_);
+
+    mxtl::Mutex lock_;
+    HashTable hash_ __TA_GUARDED(lock_);
+    LruList lru_ __TA_GUARDED(lock_);
+    uint64_t generation_ __TA_GUARDED(lock_) = 0;
+};
+
+} // namespace fs
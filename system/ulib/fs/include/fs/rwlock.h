@@ -0,0 +1,57 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <pthread.h>
+
+#include <mxtl/macros.h>
+
+namespace fs {
+
+// RwLock is a thin wrapper around a pthread reader/writer lock, used by the
+// VFS RPC layer to let operations which only read a vnode run concurrently.
+class RwLock {
+public:
+    constexpr RwLock() : lock_(PTHREAD_RWLOCK_INITIALIZER) {}
+    ~RwLock() { pthread_rwlock_destroy(&lock_); }
+
+    void AcquireShared() { pthread_rwlock_rdlock(&lock_); }
+    void Acquire() { pthread_rwlock_wrlock(&lock_); }
+    void Release() { pthread_rwlock_unlock(&lock_); }
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(RwLock);
+
+private:
+    pthread_rwlock_t lock_;
+};
+
+// Holds an RwLock, either shared or exclusively, for the lifetime of the
+// object. A null lock is accepted and ignored.
+class AutoRwLock {
+public:
+    AutoRwLock(RwLock* lock, bool exclusive) : lock_(lock) {
+        if (lock_ == nullptr) {
+            return;
+        }
+        if (exclusive) {
+            lock_->Acquire();
+        } else {
+            lock_->AcquireShared();
+        }
+    }
+
+    ~AutoRwLock() {
+        if (lock_ != nullptr) {
+            lock_->Release();
+        }
+    }
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(AutoRwLock);
+
+private:
+    RwLock* lock_;
+};
+
+} // namespace fs
@@ -43,7 +43,9 @@ __END_CDECLS
 #ifdef __cplusplus
 
 #ifdef __Fuchsia__
+#include <fs/dentry-cache.h>
 #include <fs/dispatcher.h>
+#include <fs/rwlock.h>
 #include <mx/channel.h>
 #include <mxtl/mutex.h>
 #endif  // __Fuchsia__
@@ -151,6 +153,17 @@ inline bool vfs_valid_name(const char* name, size_t len) {
 // The lower half of flags (V_FLAG_RESERVED_MASK) is reserved
 // for usage by fs::Vnode, but the upper half of flags may
 // be used by subclasses of Vnode.
+//
+// When served by a multi-threaded dispatcher, the VFS RPC layer may invoke
+// Read, Readdir, Getattr and Mmap concurrently on the same vnode, and Read,
+// Readdir, Write, Getattr, Setattr, Truncate, Sync and Mmap concurrently on
+// distinct vnodes. Lookup and Open (without O_CREAT or O_TRUNC) may run
+// alongside all of those, though only one at a time, and the last reference
+// to a vnode may be dropped alongside them too. Create, Unlink, Rename, Link
+// and Ioctl are serialized against every operation on the filesystem.
+// Filesystems must protect any state which is shared between vnodes
+// (allocation maps, the table of live vnodes, block device clients) or
+// lazily initialized by those concurrent operations.
 class Vnode : public mxtl::RefCounted<Vnode> {
 public:
 #ifdef __Fuchsia__
@@ -295,11 +308,21 @@ public:
         flags_ |= V_FLAG_DEVICE_DETACHED;
     }
     bool IsDetachedDevice() const { return (flags_ & V_FLAG_DEVICE_DETACHED); }
+
+#ifdef __Fuchsia__
+    // Serializes RPCs which target this vnode (see vfs_handler).
+    RwLock* RpcLock() { return &rpc_lock_; }
+#endif
 protected:
     DISALLOW_COPY_ASSIGN_AND_MOVE(Vnode);
     Vnode() : flags_(0) {};
 
     uint32_t flags_;
+
+#ifdef __Fuchsia__
+private:
+    RwLock rpc_lock_;
+#endif
 };
 
 // Non-intrusive node in linked list of vnodes acting as mount points
@@ -354,6 +377,15 @@ public:
     ssize_t Ioctl(mxtl::RefPtr<Vnode> vn, uint32_t op, const void* in_buf, size_t in_len,
                   void* out_buf, size_t out_len);
 
+    // Enables caching of name lookups (see DentryCache). Only filesystems which
+    // modify their namespace exclusively through this object, or which report
+    // other modifications with InvalidateDentry, may enable the cache.
+    void EnableDentryCache() { dentry_cache_enabled_ = true; }
+    // Drops any cached lookup of |name| within |parent|.
+    void InvalidateDentry(Vnode* parent, const char* name, size_t len);
+    // Drops every cached lookup.
+    void FlushDentryCache();
+
 #ifdef __Fuchsia__
     Vfs(Dispatcher* dispatcher);
 
@@ -380,7 +412,25 @@ public:
     // TODO(smklein): Encapsulate the lock; make it private.
     mtx_t vfs_lock_{};
 
+    // Held shared by RPCs which only touch the vnode they target (including
+    // plain opens and closes), and exclusively by RPCs which may modify the
+    // namespace or other vnodes.
+    // Acquired before any Vnode::RpcLock() and before vfs_lock_.
+    RwLock rpc_lock_;
+#endif  // ifdef __Fuchsia__
+
 private:
+    // Looks up |name| within |vn|, consulting the dentry cache if enabled.
+    // Positive results are only cached if |cache_positive| is set, since
+    // cached entries keep their vnodes alive.
+    mx_status_t Lookup(mxtl::RefPtr<Vnode> vn, mxtl::RefPtr<Vnode>* out,
+                       const char* name, size_t len, bool cache_positive);
+
+    bool dentry_cache_enabled_ = false;
+
+#ifdef __Fuchsia__
+    DentryCache dentry_cache_;
+
     // The mount list is a global static variable, but it only uses
     // constexpr constructors during initialization. As a consequence,
     // the .init_array section of the compiled vfs-mount object file is
@@ -9,6 +9,7 @@ MODULE := $(LOCAL_DIR)
 MODULE_TYPE := userlib
 
 MODULE_SRCS += \
+    $(LOCAL_DIR)/dentry-cache.cpp \
     $(LOCAL_DIR)/mapped-vmo.cpp \
     $(LOCAL_DIR)/mxio-dispatcher.cpp \
     $(LOCAL_DIR)/vfs.cpp \
@@ -597,15 +597,64 @@ static mx_status_t vfs_handler_vn(mxrio_msg_t* msg, mxtl::RefPtr<fs::Vnode> vn,
     }
 }
 
-// TODO(orr): temporary; prevent multithread weirdness while we
-// make locking more fine grained
-static mtx_t vfs_big_lock = MTX_INIT;
+namespace {
+
+// Describes how an RPC is serialized against other RPCs on the same filesystem.
+enum class RpcLockType {
+    // Only reads state of the target vnode (or, for a plain open, looks up
+    // names under it while holding vfs_lock_).
+    kVnodeShared,
+    // Only modifies state of the target vnode, or drops the iostate's
+    // reference to it.
+    kVnodeExclusive,
+    // May modify the namespace, mounts, or any other vnode.
+    kVfsExclusive,
+};
+
+RpcLockType rpc_lock_type(const mxrio_msg_t* msg) {
+    switch (MXRIO_OP(msg->op)) {
+    case MXRIO_OPEN:
+        // Creating or truncating the target modifies a vnode other than the
+        // one the RPC was sent to.
+        if (msg->arg & (O_CREAT | O_TRUNC)) {
+            return RpcLockType::kVfsExclusive;
+        }
+        return RpcLockType::kVnodeShared;
+    case MXRIO_CLONE:
+    case MXRIO_READDIR:
+    case MXRIO_READ:
+    case MXRIO_READ_AT:
+    case MXRIO_SEEK:
+    case MXRIO_STAT:
+    case MXRIO_FCNTL:
+    case MXRIO_MMAP:
+        return RpcLockType::kVnodeShared;
+    case MXRIO_CLOSE:
+    case MXRIO_WRITE:
+    case MXRIO_WRITE_AT:
+    case MXRIO_SETATTR:
+    case MXRIO_TRUNCATE:
+    case MXRIO_SYNC:
+        return RpcLockType::kVnodeExclusive;
+    default:
+        // unlink, rename, link, and ioctls (which include mounting).
+        return RpcLockType::kVfsExclusive;
+    }
+}
+
+} // namespace
 
 mx_status_t vfs_handler(mxrio_msg_t* msg, void* cookie) {
     vfs_iostate_t* ios = static_cast<vfs_iostate_t*>(cookie);
 
-    mxtl::AutoLock lock(&vfs_big_lock);
+    RpcLockType type = rpc_lock_type(msg);
+    fs::AutoRwLock vfs_lock(&ios->vfs->rpc_lock_, type == RpcLockType::kVfsExclusive);
+    // Close drops the iostate's reference; this one keeps the vnode (and its
+    // RpcLock) alive until the vnode lock is released. If it is the last
+    // reference, the vnode is destroyed with the filesystem lock still held.
     mxtl::RefPtr<fs::Vnode> vn = ios->vn;
-    mx_status_t status = vfs_handler_vn(msg, mxtl::move(vn), ios);
+    fs::AutoRwLock vnode_lock(type == RpcLockType::kVfsExclusive ? nullptr : vn->RpcLock(),
+                              type == RpcLockType::kVnodeExclusive);
+    mx_status_t status = vfs_handler_vn(msg, vn, ios);
     return status;
 }
@@ -180,10 +180,11 @@ mx_status_t Vfs::Open(mxtl::RefPtr<Vnode> vndir, mxtl::RefPtr<Vnode>* out, const
             }
             return r;
         }
+        InvalidateDentry(vndir.get(), path, len);
         vndir->Notify(path, len, VFS_WATCH_EVT_ADDED);
     } else {
     try_open:
-        r = vfs_lookup(mxtl::move(vndir), &vn, path, len);
+        r = Lookup(mxtl::move(vndir), &vn, path, len, false);
         if (r < 0) {
             return r;
         }
@@ -227,7 +228,11 @@ mx_status_t Vfs::Unlink(mxtl::RefPtr<Vnode> vndir, const char* path, size_t len)
         return MX_ERR_INVALID_ARGS;
     }
 
-    return vndir->Unlink(path, len, must_be_dir);
+    if ((r = vndir->Unlink(path, len, must_be_dir)) != MX_OK) {
+        return r;
+    }
+    InvalidateDentry(vndir.get(), path, len);
+    return MX_OK;
 }
 
 mx_status_t Vfs::Link(mxtl::RefPtr<Vnode> oldparent, mxtl::RefPtr<Vnode> newparent,
@@ -265,6 +270,7 @@ mx_status_t Vfs::Link(mxtl::RefPtr<Vnode> oldparent, mxtl::RefPtr<Vnode> newpare
     if (r != MX_OK) {
         return r;
     }
+    InvalidateDentry(newparent.get(), newname, newlen);
     newparent->Notify(newname, newlen, VFS_WATCH_EVT_ADDED);
     return MX_OK;
 }
@@ -297,6 +303,8 @@ mx_status_t Vfs::Rename(mxtl::RefPtr<Vnode> oldparent, mxtl::RefPtr<Vnode> newpa
     if (r != MX_OK) {
         return r;
     }
+    InvalidateDentry(oldparent.get(), oldname, oldlen);
+    InvalidateDentry(newparent.get(), newname, newlen);
     newparent->Notify(newname, newlen, VFS_WATCH_EVT_ADDED);
     return MX_OK;
 }
@@ -377,6 +385,9 @@ ssize_t Vfs::Ioctl(mxtl::RefPtr<Vnode> vn, uint32_t op, const void* in_buf, size
         return Vfs::UninstallRemoteLocked(vn, h);
     }
     case IOCTL_VFS_UNMOUNT_FS: {
+        // Drop the vnode references held by the cache before the filesystem
+        // tears down.
+        FlushDentryCache();
         Vfs::UninstallAll(MX_TIME_INFINITE);
         vn->Ioctl(op, in_buf, in_len, out_buf, out_len);
         exit(0);
@@ -387,6 +398,50 @@ ssize_t Vfs::Ioctl(mxtl::RefPtr<Vnode> vn, uint32_t op, const void* in_buf, size
     }
 }
 
+mx_status_t Vfs::Lookup(mxtl::RefPtr<Vnode> vn, mxtl::RefPtr<Vnode>* out,
+                        const char* name, size_t len, bool cache_positive) {
+#ifdef __Fuchsia__
+    if (!dentry_cache_enabled_ || is_dot_or_dot_dot(name, len)) {
+        return vfs_lookup(mxtl::move(vn), out, name, len);
+    }
+    mxtl::RefPtr<Vnode> cached;
+    if (dentry_cache_.Lookup(vn.get(), name, len, &cached)) {
+        if (cached == nullptr) {
+            return MX_ERR_NOT_FOUND;
+        }
+        *out = mxtl::move(cached);
+        return MX_OK;
+    }
+    uint64_t generation = dentry_cache_.Generation();
+    mxtl::RefPtr<Vnode> parent = vn;
+    mx_status_t r = vfs_lookup(mxtl::move(vn), out, name, len);
+    if (r == MX_ERR_NOT_FOUND) {
+        dentry_cache_.Insert(generation, mxtl::move(parent), name, len, nullptr);
+    } else if (r == MX_OK && cache_positive) {
+        dentry_cache_.Insert(generation, mxtl::move(parent), name, len, *out);
+    }
+    return r;
+#else
+    return vfs_lookup(mxtl::move(vn), out, name, len);
+#endif
+}
+
+void Vfs::InvalidateDentry(Vnode* parent, const char* name, size_t len) {
+#ifdef __Fuchsia__
+    if (dentry_cache_enabled_) {
+        dentry_cache_.Invalidate(parent, name, len);
+    }
+#endif
+}
+
+void Vfs::FlushDentryCache() {
+#ifdef __Fuchsia__
+    if (dentry_cache_enabled_) {
+        dentry_cache_.Flush();
+    }
+#endif
+}
+
 mx_status_t Vnode::Close() {
     return MX_OK;
 }
@@ -460,7 +515,7 @@ mx_status_t Vfs::Walk(mxtl::RefPtr<Vnode> vn, mxtl::RefPtr<Vnode>* out,
             // traverse to the next segment
             size_t len = nextpath - path;
             nextpath++;
-            if ((r = vfs_lookup(mxtl::move(vn), &vn, path, len)) < 0) {
+            if ((r = Lookup(mxtl::move(vn), &vn, path, len, true)) < 0) {
                 return r;
             }
             path = nextpath;
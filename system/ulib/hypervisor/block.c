@@ -3,12 +3,18 @@
 // found in the LICENSE file.
 
 #include <limits.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
+#include <threads.h>
 #include <unistd.h>
 
+#include <block-client/client.h>
 #include <hypervisor/block.h>
 #include <hypervisor/vcpu.h>
+#include <magenta/device/block.h>
 #include <magenta/syscalls.h>
 #include <virtio/block.h>
 #include <virtio/virtio.h>
@@ -19,8 +25,6 @@
 #define PCI_INTERRUPT_VIRTIO_BLOCK  33u
 #define PCI_ALIGN(n)                ((((uintptr_t)n) + 4095) & ~4095)
 
-typedef mx_status_t (* virtio_req_fn_t)(void* ctx, void* req, void* addr, uint32_t len);
-
 mx_status_t handle_virtio_block_read(guest_state_t* guest_state, uint16_t port,
                                      uint8_t access_size, io_packet_t* io_packet) {
     switch (port) {
@@ -110,6 +114,10 @@ mx_status_t handle_virtio_block_write(vcpu_context_t* vcpu_context, uint16_t por
             fprintf(stderr, "Only one queue per device is supported\n");
             return MX_ERR_NOT_SUPPORTED;
         }
+        if (vcpu_context->guest_state->block_async != NULL) {
+            block_async_kick(vcpu_context->guest_state->block_async);
+            return MX_OK;
+        }
         mx_status_t status;
         if (block_fd < 0) {
             status = null_block_device(queue, mem_addr, mem_size);
@@ -130,127 +138,555 @@ mx_status_t handle_virtio_block_write(vcpu_context_t* vcpu_context, uint16_t por
     return MX_ERR_NOT_SUPPORTED;
 }
 
+mx_status_t virtio_block_interrupt(void* ctx) {
+    vcpu_context_t* vcpu_context = ctx;
+    mtx_lock(&vcpu_context->guest_state->mutex);
+    uint32_t interrupt = irq_redirect(&vcpu_context->guest_state->io_apic_state,
+                                      PCI_INTERRUPT_VIRTIO_BLOCK);
+    mtx_unlock(&vcpu_context->guest_state->mutex);
+    return mx_hypervisor_op(vcpu_context->vcpu, MX_HYPERVISOR_OP_VCPU_INTERRUPT,
+                            &interrupt, sizeof(interrupt), NULL, 0);
+}
+
 // Returns a circular index into a Virtio ring.
 static uint32_t ring_index(virtio_queue_t* queue, uint32_t index) {
     return index % queue->size;
 }
 
-static mx_status_t handle_virtio_queue(virtio_queue_t* queue, void* mem_addr, size_t mem_size,
-                                       uint32_t hdr_size, void* ctx, virtio_req_fn_t req_fn) {
-    for (; queue->index < queue->avail->idx; queue->index++, queue->used->idx++) {
+// The most requests collected from the avail ring before they are executed.
+#define BLOCK_MAX_REQUESTS          VIRTIO_QUEUE_SIZE
+// The most payload segments in a batch. A descriptor chain is never longer
+// than VIRTIO_QUEUE_SIZE, so any single request fits in an empty batch.
+#define BLOCK_MAX_SEGMENTS          (VIRTIO_QUEUE_SIZE * 2)
+// The most segments joined into a single preadv or pwritev.
+#define BLOCK_MAX_IOVECS            64u
+// The most block FIFO transactions outstanding at once.
+#define BLOCK_MAX_TXNS              4u
+
+typedef struct block_segment {
+    void* addr;
+    uint32_t len;
+} block_segment_t;
+
+typedef struct block_request {
+    uint16_t head;
+    uint32_t type;
+    uint64_t sector;
+    size_t first_segment;
+    size_t num_segments;
+    volatile uint8_t* status;
+    uint8_t blk_status;
+} block_request_t;
+
+typedef struct block_batch {
+    size_t num_requests;
+    size_t num_segments;
+    block_request_t requests[BLOCK_MAX_REQUESTS];
+    block_segment_t segments[BLOCK_MAX_SEGMENTS];
+} block_batch_t;
+
+// Describes where the requests of a batch are executed.
+typedef struct block_backend {
+    void* mem_addr;
+    // Backing file, or -1 for a device that reads zeros and discards writes.
+    int fd;
+    // If set, reads and writes are issued as transactions on the block
+    // device's FIFO, against guest memory attached as vmoid.
+    fifo_client_t* fifo_client;
+    vmoid_t vmoid;
+    size_t num_txnids;
+    txnid_t txnids[BLOCK_MAX_TXNS];
+} block_backend_t;
+
+// Parses the descriptor chains made available by the guest into batch, until
+// the avail ring is empty or the batch is full. A malformed chain ends the
+// batch and its error is returned, but the chains before it are kept in the
+// batch, and must still be completed.
+static mx_status_t collect_batch(virtio_queue_t* queue, void* mem_addr, size_t mem_size,
+                                 block_batch_t* batch) {
+    batch->num_requests = 0;
+    batch->num_segments = 0;
+
+    const uint16_t avail_idx = queue->avail->idx;
+    // Read the ring entries only after the index that published them.
+    atomic_thread_fence(memory_order_acquire);
+    for (; queue->index != avail_idx && batch->num_requests < BLOCK_MAX_REQUESTS;
+         queue->index++) {
         uint16_t desc_index = queue->avail->ring[ring_index(queue, queue->index)];
         if (desc_index >= queue->size)
             return MX_ERR_OUT_OF_RANGE;
-        volatile struct vring_used_elem* used =
-            &queue->used->ring[ring_index(queue, queue->used->idx)];
-        used->id = desc_index;
-
-        void* req = NULL;
-        bool has_payload = false;
-        uint8_t blk_status = VIRTIO_BLK_S_OK;
-        while (true) {
+
+        block_request_t* req = &batch->requests[batch->num_requests];
+        req->head = desc_index;
+        req->first_segment = batch->num_segments;
+        req->num_segments = 0;
+        req->blk_status = VIRTIO_BLK_S_OK;
+
+        bool has_header = false;
+        for (uint32_t count = 0; ; count++) {
+            if (count >= queue->size || desc_index >= queue->size)
+                return MX_ERR_OUT_OF_RANGE;
             struct vring_desc desc = queue->desc[desc_index];
             const uint64_t end = desc.addr + desc.len;
             if (end < desc.addr || end > mem_size)
                 return MX_ERR_OUT_OF_RANGE;
-            if (req == NULL) {
+            if (!has_header) {
                 // Header.
-                if (desc.len != hdr_size)
+                if (desc.len != sizeof(virtio_blk_req_t) || !(desc.flags & VRING_DESC_F_NEXT))
                     return MX_ERR_INVALID_ARGS;
-                req = mem_addr + desc.addr;
+                const virtio_blk_req_t* blk_req = mem_addr + desc.addr;
+                req->type = blk_req->type;
+                req->sector = blk_req->sector;
+                has_header = true;
             } else if (desc.flags & VRING_DESC_F_NEXT) {
                 // Payload.
-                has_payload = true;
-                mx_status_t status = req_fn(ctx, req, mem_addr + desc.addr, desc.len);
-                if (status != MX_OK) {
-                    fprintf(stderr, "Virtio request (%#lx, %u) failed %d\n",
-                            desc.addr, desc.len, status);
-                    blk_status = VIRTIO_BLK_S_IOERR;
-                } else {
-                    used->len += desc.len;
+                if (batch->num_segments == BLOCK_MAX_SEGMENTS) {
+                    if (batch->num_requests == 0)
+                        return MX_ERR_OUT_OF_RANGE;
+                    // Leave this request for the next batch.
+                    batch->num_segments = req->first_segment;
+                    return MX_OK;
                 }
+                block_segment_t* seg = &batch->segments[batch->num_segments++];
+                seg->addr = mem_addr + desc.addr;
+                seg->len = desc.len;
+                req->num_segments++;
             } else {
                 // Status.
                 if (desc.len != sizeof(uint8_t))
                     return MX_ERR_INVALID_ARGS;
-                // If there was no payload, call the request function once.
-                if (!has_payload) {
-                    mx_status_t status = req_fn(ctx, req, NULL, 0);
-                    if (status != MX_OK)
-                        blk_status = VIRTIO_BLK_S_IOERR;
-                }
-                uint8_t* virtio_status = mem_addr + desc.addr;
-                *virtio_status = blk_status;
+                req->status = mem_addr + desc.addr;
                 break;
             }
             desc_index = desc.next;
-        };
+        }
+        batch->num_requests++;
     }
     return MX_OK;
 }
 
-mx_status_t null_req(void* ctx, void* req, void* addr, uint32_t len) {
-    virtio_blk_req_t* blk_req = req;
-    switch (blk_req->type) {
-    case VIRTIO_BLK_T_IN:
-        memset(addr, 0, len);
-        /* fallthrough */
-    case VIRTIO_BLK_T_OUT:
-        return MX_OK;
-    case VIRTIO_BLK_T_FLUSH:
-        // See note in file_req.
-        if (blk_req->sector != 0)
-            return MX_ERR_IO_DATA_INTEGRITY;
-        return MX_OK;
+// From VIRTIO Version 1.0: A driver MUST set sector to 0 for a
+// VIRTIO_BLK_T_FLUSH request. A driver SHOULD NOT include any data in a
+// VIRTIO_BLK_T_FLUSH request.
+static bool valid_flush(const block_request_t* req) {
+    return req->sector == 0;
+}
+
+// Returns whether req is a read or write of a valid range of the device.
+static bool valid_transfer(const block_request_t* req) {
+    return (req->type == VIRTIO_BLK_T_IN || req->type == VIRTIO_BLK_T_OUT) &&
+           req->sector <= INT64_MAX / SECTOR_SIZE;
+}
+
+static void execute_null(block_batch_t* batch) {
+    for (size_t i = 0; i < batch->num_requests; i++) {
+        block_request_t* req = &batch->requests[i];
+        switch (req->type) {
+        case VIRTIO_BLK_T_IN:
+            for (size_t j = 0; j < req->num_segments; j++) {
+                block_segment_t* seg = &batch->segments[req->first_segment + j];
+                memset(seg->addr, 0, seg->len);
+            }
+            break;
+        case VIRTIO_BLK_T_OUT:
+            break;
+        case VIRTIO_BLK_T_FLUSH:
+            if (!valid_flush(req))
+                req->blk_status = VIRTIO_BLK_S_IOERR;
+            break;
+        default:
+            req->blk_status = VIRTIO_BLK_S_IOERR;
+            break;
+        }
     }
-    return MX_ERR_INVALID_ARGS;
 }
 
-mx_status_t null_block_device(virtio_queue_t* queue, void* mem_addr, size_t mem_size) {
-    return handle_virtio_queue(queue, mem_addr, mem_size, sizeof(virtio_blk_req_t), NULL, null_req);
+// Marks the requests in [first, last] as failed.
+static void fail_requests(block_batch_t* batch, size_t first, size_t last) {
+    for (size_t i = first; i <= last; i++)
+        batch->requests[i].blk_status = VIRTIO_BLK_S_IOERR;
 }
 
-typedef struct file_state {
-    int fd;
+// A run of segments which are contiguous on the device, and are transferred
+// in the same direction.
+typedef struct file_run {
+    uint32_t type;
     off_t off;
-} file_state_t;
-
-mx_status_t file_req(void* ctx, void* req, void* addr, uint32_t len) {
-    file_state_t* state = ctx;
-    virtio_blk_req_t* blk_req = req;
-
-    off_t ret;
-    if (blk_req->type != VIRTIO_BLK_T_FLUSH) {
-        off_t off = blk_req->sector * SECTOR_SIZE + state->off;
-        state->off += len;
-        ret = lseek(state->fd, off, SEEK_SET);
-        if (ret < 0)
-            return MX_ERR_IO;
+    size_t len;
+    int iovcnt;
+    struct iovec iov[BLOCK_MAX_IOVECS];
+    size_t first_request;
+    size_t last_request;
+} file_run_t;
+
+static void file_run_flush(const block_backend_t* backend, block_batch_t* batch,
+                           file_run_t* run) {
+    if (run->iovcnt == 0)
+        return;
+    ssize_t ret;
+    if (run->type == VIRTIO_BLK_T_IN) {
+        ret = preadv(backend->fd, run->iov, run->iovcnt, run->off);
+    } else {
+        ret = pwritev(backend->fd, run->iov, run->iovcnt, run->off);
+    }
+    if (ret < 0 || (size_t)ret != run->len) {
+        fprintf(stderr, "Block %s (%#lx, %zu) failed %zd\n",
+                run->type == VIRTIO_BLK_T_IN ? "read" : "write", (uint64_t)run->off, run->len,
+                ret);
+        fail_requests(batch, run->first_request, run->last_request);
     }
+    run->iovcnt = 0;
+    run->len = 0;
+}
 
-    switch (blk_req->type) {
-    case VIRTIO_BLK_T_IN:
-        ret = read(state->fd, addr, len);
-        break;
-    case VIRTIO_BLK_T_OUT:
-        ret = write(state->fd, addr, len);
-        break;
-    case VIRTIO_BLK_T_FLUSH:
-        // From VIRTIO Version 1.0: A driver MUST set sector to 0 for a
-        // VIRTIO_BLK_T_FLUSH request. A driver SHOULD NOT include any data in a
-        // VIRTIO_BLK_T_FLUSH request.
-        if (blk_req->sector != 0)
-            return MX_ERR_IO_DATA_INTEGRITY;
-        len = 0;
-        ret = fsync(state->fd);
-        break;
-    default:
-        return MX_ERR_INVALID_ARGS;
+// Executes a batch with positional reads and writes on the backing file,
+// joining the segments of consecutive requests which are contiguous on the
+// device into a single call.
+static void execute_file(const block_backend_t* backend, block_batch_t* batch) {
+    file_run_t run = { .iovcnt = 0, .len = 0 };
+    for (size_t i = 0; i < batch->num_requests; i++) {
+        block_request_t* req = &batch->requests[i];
+        if (req->type == VIRTIO_BLK_T_FLUSH) {
+            // Everything before the flush must have reached the file.
+            file_run_flush(backend, batch, &run);
+            if (!valid_flush(req) || fsync(backend->fd) != 0)
+                req->blk_status = VIRTIO_BLK_S_IOERR;
+            continue;
+        }
+        if (!valid_transfer(req)) {
+            req->blk_status = VIRTIO_BLK_S_IOERR;
+            continue;
+        }
+        off_t off = req->sector * SECTOR_SIZE;
+        for (size_t j = 0; j < req->num_segments; j++) {
+            block_segment_t* seg = &batch->segments[req->first_segment + j];
+            if (run.iovcnt > 0 && (run.type != req->type || run.off + (off_t)run.len != off ||
+                                   run.iovcnt == BLOCK_MAX_IOVECS)) {
+                file_run_flush(backend, batch, &run);
+            }
+            if (run.iovcnt == 0) {
+                run.type = req->type;
+                run.off = off;
+                run.first_request = i;
+            }
+            run.iov[run.iovcnt].iov_base = seg->addr;
+            run.iov[run.iovcnt].iov_len = seg->len;
+            run.iovcnt++;
+            run.len += seg->len;
+            run.last_request = i;
+            off += seg->len;
+        }
+    }
+    file_run_flush(backend, batch, &run);
+}
+
+// A block FIFO transaction and the requests it carries.
+typedef struct fifo_txn {
+    size_t count;
+    block_fifo_request_t requests[MAX_TXN_MESSAGES];
+    size_t first_request;
+    size_t last_request;
+} fifo_txn_t;
+
+typedef struct fifo_state {
+    // Transactions are sent round-robin over the backend's txnids. A txnid
+    // is waited upon before it is reused, or at the end of the batch.
+    size_t next;
+    bool pending[BLOCK_MAX_TXNS];
+    size_t first_request[BLOCK_MAX_TXNS];
+    size_t last_request[BLOCK_MAX_TXNS];
+    fifo_txn_t txn;
+} fifo_state_t;
+
+static void fifo_wait(const block_backend_t* backend, block_batch_t* batch, fifo_state_t* state,
+                      size_t slot) {
+    if (!state->pending[slot])
+        return;
+    mx_status_t status = block_fifo_txn_wait(backend->fifo_client, backend->txnids[slot]);
+    if (status != MX_OK) {
+        fprintf(stderr, "Block transaction failed %d\n", status);
+        fail_requests(batch, state->first_request[slot], state->last_request[slot]);
+    }
+    state->pending[slot] = false;
+}
+
+static void fifo_wait_all(const block_backend_t* backend, block_batch_t* batch,
+                          fifo_state_t* state) {
+    for (size_t slot = 0; slot < backend->num_txnids; slot++)
+        fifo_wait(backend, batch, state, slot);
+}
+
+static void fifo_send(const block_backend_t* backend, block_batch_t* batch, fifo_state_t* state) {
+    fifo_txn_t* txn = &state->txn;
+    if (txn->count == 0)
+        return;
+    size_t slot = state->next;
+    state->next = (state->next + 1) % backend->num_txnids;
+    fifo_wait(backend, batch, state, slot);
+
+    for (size_t i = 0; i < txn->count; i++)
+        txn->requests[i].txnid = backend->txnids[slot];
+    mx_status_t status = block_fifo_txn_async(backend->fifo_client, txn->requests, txn->count,
+                                              NULL, NULL);
+    if (status != MX_OK) {
+        fprintf(stderr, "Failed to send block transaction %d\n", status);
+        fail_requests(batch, txn->first_request, txn->last_request);
+    } else {
+        state->pending[slot] = true;
+        state->first_request[slot] = txn->first_request;
+        state->last_request[slot] = txn->last_request;
+    }
+    txn->count = 0;
+}
+
+// Executes a batch as transactions on the block device's FIFO. Guest memory
+// is attached to the device, so requests transfer directly to and from the
+// guest's buffers, and several transactions are kept in flight.
+static void execute_fifo(const block_backend_t* backend, block_batch_t* batch) {
+    fifo_state_t state;
+    memset(&state, 0, sizeof(state));
+    fifo_txn_t* txn = &state.txn;
+    for (size_t i = 0; i < batch->num_requests; i++) {
+        block_request_t* req = &batch->requests[i];
+        if (req->type == VIRTIO_BLK_T_FLUSH) {
+            fifo_send(backend, batch, &state);
+            fifo_wait_all(backend, batch, &state);
+            if (!valid_flush(req) || fsync(backend->fd) != 0)
+                req->blk_status = VIRTIO_BLK_S_IOERR;
+            continue;
+        }
+        if (!valid_transfer(req)) {
+            req->blk_status = VIRTIO_BLK_S_IOERR;
+            continue;
+        }
+        uint16_t opcode = req->type == VIRTIO_BLK_T_IN ? BLOCKIO_READ : BLOCKIO_WRITE;
+        uint64_t dev_offset = req->sector * SECTOR_SIZE;
+        for (size_t j = 0; j < req->num_segments; j++) {
+            block_segment_t* seg = &batch->segments[req->first_segment + j];
+            uint64_t vmo_offset = seg->addr - backend->mem_addr;
+            block_fifo_request_t* last = txn->count > 0 ? &txn->requests[txn->count - 1] : NULL;
+            if (last != NULL && last->opcode == opcode &&
+                last->dev_offset + last->length == dev_offset &&
+                last->vmo_offset + last->length == vmo_offset) {
+                last->length += seg->len;
+            } else {
+                if (txn->count == MAX_TXN_MESSAGES)
+                    fifo_send(backend, batch, &state);
+                if (txn->count == 0)
+                    txn->first_request = i;
+                txn->requests[txn->count++] = (block_fifo_request_t){
+                    .vmoid = backend->vmoid,
+                    .opcode = opcode,
+                    .length = seg->len,
+                    .vmo_offset = vmo_offset,
+                    .dev_offset = dev_offset,
+                };
+            }
+            txn->last_request = i;
+            dev_offset += seg->len;
+        }
     }
-    return ret != len ? MX_ERR_IO : MX_OK;
+    fifo_send(backend, batch, &state);
+    fifo_wait_all(backend, batch, &state);
+}
+
+// Writes the status of every request in the batch, and returns them to the
+// guest with a single update of the used ring's index.
+static void complete_batch(virtio_queue_t* queue, block_batch_t* batch) {
+    uint16_t used_idx = queue->used->idx;
+    for (size_t i = 0; i < batch->num_requests; i++) {
+        block_request_t* req = &batch->requests[i];
+        uint32_t len = 0;
+        if (req->blk_status == VIRTIO_BLK_S_OK) {
+            for (size_t j = 0; j < req->num_segments; j++)
+                len += batch->segments[req->first_segment + j].len;
+        }
+        *req->status = req->blk_status;
+        volatile struct vring_used_elem* used = &queue->used->ring[ring_index(queue, used_idx++)];
+        used->id = req->head;
+        used->len = len;
+    }
+    // The guest must observe the used elements before the index.
+    atomic_thread_fence(memory_order_release);
+    queue->used->idx = used_idx;
+}
+
+// Services every request available on the queue, one batch at a time. Sets
+// completed if any requests were returned to the guest.
+static mx_status_t process_queue(virtio_queue_t* queue, void* mem_addr, size_t mem_size,
+                                 const block_backend_t* backend, block_batch_t* batch,
+                                 bool* completed) {
+    mx_status_t status;
+    do {
+        status = collect_batch(queue, mem_addr, mem_size, batch);
+        if (batch->num_requests == 0)
+            break;
+        if (backend->fd < 0) {
+            execute_null(batch);
+        } else if (backend->fifo_client != NULL) {
+            execute_fifo(backend, batch);
+        } else {
+            execute_file(backend, batch);
+        }
+        complete_batch(queue, batch);
+        *completed = true;
+    } while (status == MX_OK);
+    return status;
+}
+
+static mx_status_t process_queue_sync(virtio_queue_t* queue, void* mem_addr, size_t mem_size,
+                                      int fd) {
+    block_batch_t* batch = malloc(sizeof(block_batch_t));
+    if (batch == NULL)
+        return MX_ERR_NO_MEMORY;
+    block_backend_t backend = { .mem_addr = mem_addr, .fd = fd };
+    bool completed = false;
+    mx_status_t status = process_queue(queue, mem_addr, mem_size, &backend, batch, &completed);
+    free(batch);
+    return status;
+}
+
+mx_status_t null_block_device(virtio_queue_t* queue, void* mem_addr, size_t mem_size) {
+    return process_queue_sync(queue, mem_addr, mem_size, -1);
 }
 
 mx_status_t file_block_device(virtio_queue_t* queue, void* mem_addr, size_t mem_size, int fd) {
-    file_state_t state = { fd, 0 };
-    return handle_virtio_queue(queue, mem_addr, mem_size, sizeof(virtio_blk_req_t), &state, file_req);
+    return process_queue_sync(queue, mem_addr, mem_size, fd);
+}
+
+struct block_async {
+    mtx_t mutex;
+    cnd_t cnd;
+    bool kicked;
+    bool stopping;
+    thrd_t thread;
+
+    virtio_queue_t* queue;
+    void* mem_addr;
+    size_t mem_size;
+    int fd;
+    block_backend_t backend;
+    block_batch_t batch;
+
+    block_notify_fn_t notify;
+    void* notify_ctx;
+};
+
+static int block_async_thread(void* arg) {
+    block_async_t* async = arg;
+    mtx_lock(&async->mutex);
+    while (true) {
+        while (!async->kicked && !async->stopping)
+            cnd_wait(&async->cnd, &async->mutex);
+        if (async->stopping)
+            break;
+        async->kicked = false;
+        mtx_unlock(&async->mutex);
+
+        bool completed = false;
+        mx_status_t status = process_queue(async->queue, async->mem_addr, async->mem_size,
+                                           &async->backend, &async->batch, &completed);
+        if (status != MX_OK)
+            fprintf(stderr, "Block device operation failed %d\n", status);
+        if (completed) {
+            status = async->notify(async->notify_ctx);
+            if (status != MX_OK)
+                fprintf(stderr, "Failed to notify block completion %d\n", status);
+        }
+
+        mtx_lock(&async->mutex);
+    }
+    mtx_unlock(&async->mutex);
+    return 0;
+}
+
+// Sets up the backend to issue requests on the block device's FIFO. Returns
+// an error if fd is not a block device, in which case the backend is left to
+// use positional reads and writes.
+static mx_status_t block_fifo_init(block_backend_t* backend, int fd, mx_handle_t mem_vmo) {
+    mx_handle_t fifo;
+    if (ioctl_block_get_fifos(fd, &fifo) < 0)
+        return MX_ERR_NOT_SUPPORTED;
+
+    mx_handle_t vmo;
+    mx_status_t status = mx_handle_duplicate(mem_vmo, MX_RIGHT_SAME_RIGHTS, &vmo);
+    if (status != MX_OK)
+        goto fail;
+    if (ioctl_block_attach_vmo(fd, &vmo, &backend->vmoid) < 0) {
+        status = MX_ERR_IO;
+        goto fail;
+    }
+    for (; backend->num_txnids < BLOCK_MAX_TXNS; backend->num_txnids++) {
+        if (ioctl_block_alloc_txn(fd, &backend->txnids[backend->num_txnids]) < 0)
+            break;
+    }
+    if (backend->num_txnids == 0) {
+        status = MX_ERR_NO_RESOURCES;
+        goto fail;
+    }
+    if ((status = block_fifo_create_client(fifo, &backend->fifo_client)) != MX_OK)
+        goto fail;
+    return MX_OK;
+
+fail:
+    // Closing the FIFO also releases the attached VMO and transactions.
+    mx_handle_close(fifo);
+    ioctl_block_fifo_close(fd);
+    backend->num_txnids = 0;
+    return status;
+}
+
+static void block_async_destroy_backend(block_async_t* async) {
+    if (async->backend.fifo_client != NULL) {
+        block_fifo_release_client(async->backend.fifo_client);
+        ioctl_block_fifo_close(async->fd);
+    }
+    cnd_destroy(&async->cnd);
+    mtx_destroy(&async->mutex);
+    free(async);
+}
+
+mx_status_t block_async_create(virtio_queue_t* queue, void* mem_addr, size_t mem_size, int fd,
+                               mx_handle_t mem_vmo, block_notify_fn_t notify, void* notify_ctx,
+                               block_async_t** out) {
+    block_async_t* async = calloc(1, sizeof(block_async_t));
+    if (async == NULL)
+        return MX_ERR_NO_MEMORY;
+    mtx_init(&async->mutex, mtx_plain);
+    cnd_init(&async->cnd);
+    async->queue = queue;
+    async->mem_addr = mem_addr;
+    async->mem_size = mem_size;
+    async->fd = fd;
+    async->backend.mem_addr = mem_addr;
+    async->backend.fd = fd;
+    async->notify = notify;
+    async->notify_ctx = notify_ctx;
+
+    if (fd >= 0 && mem_vmo != MX_HANDLE_INVALID)
+        block_fifo_init(&async->backend, fd, mem_vmo);
+
+    if (thrd_create_with_name(&async->thread, block_async_thread, async,
+                              "virtio-block") != thrd_success) {
+        block_async_destroy_backend(async);
+        return MX_ERR_NO_RESOURCES;
+    }
+    *out = async;
+    return MX_OK;
+}
+
+void block_async_kick(block_async_t* async) {
+    mtx_lock(&async->mutex);
+    async->kicked = true;
+    cnd_signal(&async->cnd);
+    mtx_unlock(&async->mutex);
+}
+
+void block_async_destroy(block_async_t* async) {
+    mtx_lock(&async->mutex);
+    async->stopping = true;
+    cnd_signal(&async->cnd);
+    mtx_unlock(&async->mutex);
+    thrd_join(async->thread, NULL);
+    block_async_destroy_backend(async);
 }
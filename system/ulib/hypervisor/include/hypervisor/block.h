@@ -8,6 +8,7 @@
 
 #define SECTOR_SIZE     0x200   // Sector size, 512 bytes
 
+typedef struct block_async block_async_t;
 typedef struct guest_state guest_state_t;
 typedef union io_packet io_packet_t;
 typedef struct vcpu_context vcpu_context_t;
@@ -20,3 +21,33 @@ mx_status_t handle_virtio_block_write(vcpu_context_t* context, uint16_t port,
 
 mx_status_t null_block_device(virtio_queue_t* queue, void* mem_addr, size_t mem_size);
 mx_status_t file_block_device(virtio_queue_t* queue, void* mem_addr, size_t mem_size, int fd);
+
+/* Raises the block device's interrupt on the VCPU of ctx, a vcpu_context_t.
+ *
+ * This may be called from any thread, and is suitable as the notify function
+ * of block_async_create.
+ */
+mx_status_t virtio_block_interrupt(void* ctx);
+
+/* Called by an asynchronous block device after returning a batch of
+ * requests to the guest.
+ */
+typedef mx_status_t (*block_notify_fn_t)(void* ctx);
+
+/* Creates a block device which services queue on a dedicated thread.
+ *
+ * Each time the device is kicked, the thread drains the queue in batches and
+ * calls notify once the requests have been returned to the guest. Requests
+ * are issued as transactions on the block FIFO of fd if it is a block device
+ * and mem_vmo (the VMO backing guest memory) is valid, as positional reads
+ * and writes of fd otherwise, or against a null device if fd is negative.
+ */
+mx_status_t block_async_create(virtio_queue_t* queue, void* mem_addr, size_t mem_size, int fd,
+                               mx_handle_t mem_vmo, block_notify_fn_t notify, void* notify_ctx,
+                               block_async_t** out);
+
+/* Wakes the thread of an asynchronous block device to service its queue. */
+void block_async_kick(block_async_t* async);
+
+/* Stops the thread of an asynchronous block device, and frees the device. */
+void block_async_destroy(block_async_t* async);
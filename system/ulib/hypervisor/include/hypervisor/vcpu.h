@@ -93,6 +93,8 @@ typedef struct guest_state {
     int block_fd;
     uint64_t block_size;
     virtio_queue_t block_queue;
+    // If set, the block queue is serviced by this device's own thread.
+    struct block_async* block_async;
 
     io_apic_state_t io_apic_state;
     io_port_state_t io_port_state;
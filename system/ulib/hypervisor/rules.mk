@@ -30,6 +30,7 @@ MODULE_LIBS := \
     system/ulib/mxio \
 
 MODULE_STATIC_LIBS := \
+    system/ulib/block-client \
     system/ulib/ddk \
     system/ulib/virtio \
     third_party/ulib/acpica \
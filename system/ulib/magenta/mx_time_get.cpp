@@ -0,0 +1,48 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/fixed_point.h>
+#include <magenta/syscalls.h>
+
+#include "private.h"
+
+// This must read the same counter the kernel's current_time() does, which
+// is not always the one mx_ticks_get uses.
+static inline uint64_t read_counter(void) {
+#if __aarch64__
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#elif __x86_64__
+    uint32_t ticks_low;
+    uint32_t ticks_high;
+    __asm__ volatile("rdtsc" : "=a" (ticks_low), "=d" (ticks_high));
+    return ((uint64_t)ticks_high << 32) | ticks_low;
+#else
+#error Unsupported architecture
+#endif
+}
+
+mx_time_t _mx_time_get(uint32_t clock_id) {
+    const struct fp_32_64 ns_per_tick = {
+        DATA_CONSTANTS.ns_per_tick_l0,
+        DATA_CONSTANTS.ns_per_tick_l32,
+        DATA_CONSTANTS.ns_per_tick_l64,
+    };
+    bool counter_usable = (ns_per_tick.l0 | ns_per_tick.l32 | ns_per_tick.l64) != 0;
+
+    if (likely(counter_usable)) {
+        switch (clock_id) {
+        case MX_CLOCK_MONOTONIC:
+            return u64_mul_u64_fp32_64(read_counter(), ns_per_tick);
+        case MX_CLOCK_UTC:
+            return u64_mul_u64_fp32_64(read_counter(), ns_per_tick) +
+                __atomic_load_n(&DATA_UTC.offset, __ATOMIC_RELAXED);
+        }
+    }
+
+    return SYSCALL_mx_time_get_kernel(clock_id);
+}
+
+VDSO_INTERFACE_FUNCTION(mx_time_get);
@@ -12,6 +12,10 @@
 
 extern __LOCAL const struct vdso_constants DATA_CONSTANTS;
 
+// Unlike DATA_CONSTANTS, this is updated by the kernel at runtime and must
+// be read atomically.
+extern __LOCAL const struct vdso_utc DATA_UTC;
+
 extern "C" {
 
 // This declares the VDSO_mx_* aliases for the vDSO entry points.
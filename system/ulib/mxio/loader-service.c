@@ -24,6 +24,7 @@
 #include <magenta/compiler.h>
 #include <magenta/device/dmctl.h>
 #include <magenta/device/vfs.h>
+#include <magenta/listnode.h>
 #include <magenta/processargs.h>
 #include <magenta/status.h>
 #include <magenta/syscalls.h>
@@ -55,8 +56,31 @@ struct mxio_multiloader {
 
     char config_prefix[32];
     bool config_exclusive;
+
+    // Cache of library VMOs, most recently used first.
+    mtx_t cache_lock;
+    list_node_t cache;
+    size_t cache_count;
 };
 
+// Library objects are cached by path, so that launching many processes
+// which share the same libraries does not re-read (or, when the filesystem
+// can't hand out a VMO, re-copy) the whole file each time.  The cache
+// holds an immutable master VMO and hands out copy-on-write clones of it.
+// An entry is revalidated against the file's inode, size and modification
+// time on every lookup, so replacing a library on disk invalidates it.
+#define LIB_CACHE_MAX_ENTRIES 64
+
+typedef struct lib_cache_entry {
+    list_node_t node;
+    mx_handle_t vmo;
+    uint64_t size;
+    ino_t ino;
+    off_t file_size;
+    struct timespec mtime;
+    char path[];
+} lib_cache_entry_t;
+
 static const char* const libpaths[] = {
     "/system/lib",
     "/boot/lib",
@@ -71,6 +95,120 @@ static mx_handle_t load_object_fd(int fd, const char* fn, mx_handle_t* out) {
     return status;
 }
 
+static bool lib_cache_entry_matches(const lib_cache_entry_t* entry,
+                                    const struct stat* st) {
+    return entry->ino == st->st_ino &&
+           entry->file_size == st->st_size &&
+           entry->mtime.tv_sec == st->st_mtim.tv_sec &&
+           entry->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static void lib_cache_entry_free(lib_cache_entry_t* entry) {
+    mx_handle_close(entry->vmo);
+    free(entry);
+}
+
+static mx_status_t lib_cache_clone(lib_cache_entry_t* entry,
+                                   const char* fn, mx_handle_t* out) {
+    mx_status_t status = mx_vmo_clone(entry->vmo, MX_VMO_CLONE_COPY_ON_WRITE,
+                                      0, entry->size, out);
+    if (status == MX_OK)
+        mx_object_set_property(*out, MX_PROP_NAME, fn, strlen(fn));
+    return status;
+}
+
+// Returns MX_OK and a fresh clone in |out| if |path| is cached and the
+// cached copy still matches |st|.  Stale entries are dropped.
+static mx_status_t lib_cache_lookup(mxio_multiloader_t* ml, const char* path,
+                                    const struct stat* st, const char* fn,
+                                    mx_handle_t* out) {
+    mx_status_t status = MX_ERR_NOT_FOUND;
+    mtx_lock(&ml->cache_lock);
+    lib_cache_entry_t* entry;
+    list_for_every_entry(&ml->cache, entry, lib_cache_entry_t, node) {
+        if (strcmp(entry->path, path) != 0)
+            continue;
+        list_delete(&entry->node);
+        if (!lib_cache_entry_matches(entry, st)) {
+            ml->cache_count--;
+            lib_cache_entry_free(entry);
+            break;
+        }
+        list_add_head(&ml->cache, &entry->node);
+        status = lib_cache_clone(entry, fn, out);
+        break;
+    }
+    mtx_unlock(&ml->cache_lock);
+    return status;
+}
+
+// Takes ownership of |vmo|.  On success, |vmo| becomes the cached master
+// copy and |out| receives a clone of it.  If the object can't be cached,
+// |vmo| itself is handed back in |out|.
+static void lib_cache_insert(mxio_multiloader_t* ml, const char* path,
+                             const struct stat* st, const char* fn,
+                             mx_handle_t vmo, mx_handle_t* out) {
+    *out = vmo;
+
+    size_t len = strlen(path) + 1;
+    lib_cache_entry_t* entry = malloc(sizeof(*entry) + len);
+    if (entry == NULL)
+        return;
+    if (mx_vmo_get_size(vmo, &entry->size) != MX_OK) {
+        free(entry);
+        return;
+    }
+    entry->vmo = vmo;
+    entry->ino = st->st_ino;
+    entry->file_size = st->st_size;
+    entry->mtime = st->st_mtim;
+    memcpy(entry->path, path, len);
+    if (lib_cache_clone(entry, fn, out) != MX_OK) {
+        *out = vmo;
+        free(entry);
+        return;
+    }
+
+    mtx_lock(&ml->cache_lock);
+    lib_cache_entry_t* old;
+    list_for_every_entry(&ml->cache, old, lib_cache_entry_t, node) {
+        if (strcmp(old->path, path) == 0) {
+            list_delete(&old->node);
+            ml->cache_count--;
+            lib_cache_entry_free(old);
+            break;
+        }
+    }
+    list_add_head(&ml->cache, &entry->node);
+    if (++ml->cache_count > LIB_CACHE_MAX_ENTRIES) {
+        old = list_remove_tail_type(&ml->cache, lib_cache_entry_t, node);
+        ml->cache_count--;
+        lib_cache_entry_free(old);
+    }
+    mtx_unlock(&ml->cache_lock);
+}
+
+// Like load_object_fd, but serves the object from the multiloader's
+// library cache when possible.  Always consumes the fd.
+static mx_status_t load_library_fd(mxio_multiloader_t* ml, int fd,
+                                   const char* path, const char* fn,
+                                   mx_handle_t* out) {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return load_object_fd(fd, fn, out);
+    if (lib_cache_lookup(ml, path, &st, fn, out) == MX_OK) {
+        close(fd);
+        return MX_OK;
+    }
+
+    mx_handle_t vmo;
+    mx_status_t status = load_object_fd(fd, fn, &vmo);
+    if (status != MX_OK)
+        return status;
+    lib_cache_insert(ml, path, &st, fn, vmo, out);
+    return MX_OK;
+}
+
 // For now, just publish data-sink VMOs as files under /tmp/<sink-name>/.
 // The individual file is named by its VMO's name.
 static mx_status_t publish_data_sink(mx_handle_t vmo, const char* sink_name) {
@@ -138,11 +276,12 @@ static mx_status_t publish_data_sink(mx_handle_t vmo, const char* sink_name) {
 }
 
 // When loading a library object, search in the hard-coded locations.
-static int open_from_libpath(const char* prefix, const char* fn) {
+// The path that was opened is left in |path|.
+static int open_from_libpath(const char* prefix, const char* fn,
+                             char path[PATH_MAX]) {
     int fd = -1;
     for (size_t n = 0; fd < 0 && n < countof(libpaths); ++n) {
-        char path[PATH_MAX];
-        snprintf(path, sizeof(path), "%s/%s%s", libpaths[n], prefix, fn);
+        snprintf(path, PATH_MAX, "%s/%s%s", libpaths[n], prefix, fn);
         fd = open(path, O_RDONLY);
     }
     return fd;
@@ -180,13 +319,14 @@ static mx_status_t default_load_object(void* cookie,
         return MX_OK;
     }
     case LOADER_SVC_OP_LOAD_OBJECT: {
+        char path[PATH_MAX];
         int fd = -1;
         if (ml->config_prefix[0] != '\0')
-            fd = open_from_libpath(ml->config_prefix, fn);
+            fd = open_from_libpath(ml->config_prefix, fn, path);
         if (fd < 0 && !ml->config_exclusive)
-            fd = open_from_libpath("", fn);
+            fd = open_from_libpath("", fn, path);
         if (fd >= 0)
-            return load_object_fd(fd, fn, out);
+            return load_library_fd(ml, fd, path, fn, out);
         break;
     }
     case LOADER_SVC_OP_LOAD_SCRIPT_INTERP:
@@ -331,6 +471,8 @@ mx_status_t mxio_multiloader_create(const char* name,
     }
 
     strncpy(ml->name, name, sizeof(ml->name) - 1);
+    mtx_init(&ml->cache_lock, mtx_plain);
+    list_initialize(&ml->cache);
     *ml_out = ml;
 
     return MX_OK;
@@ -412,7 +554,9 @@ static mx_handle_t get_system_loader_service(void) {
 
 // In-process multiloader
 static mxio_multiloader_t local_multiloader = {
-    .name = "local-multiloader"
+    .name = "local-multiloader",
+    .cache_lock = MTX_INIT,
+    .cache = LIST_INITIAL_VALUE(local_multiloader.cache),
 };
 
 mx_status_t mxio_loader_service(mxio_loader_service_function_t loader,
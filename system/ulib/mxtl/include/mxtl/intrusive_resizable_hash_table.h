@@ -0,0 +1,645 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <magenta/assert.h>
+#include <mxalloc/new.h>
+#include <mxtl/intrusive_container_utils.h>
+#include <mxtl/intrusive_pointer_traits.h>
+#include <mxtl/intrusive_single_list.h>
+#include <mxtl/macros.h>
+
+// Usage Notes:
+//
+// mxtl::ResizableHashTable<> is an intrusive hash table which, unlike
+// mxtl::HashTable<>, does not have a fixed number of buckets.  It keeps the
+// average bucket no longer than a single element by growing as elements are
+// inserted, and gives memory back by shrinking as they are erased.
+//
+// Resizing is incremental (linear hashing): each insert or erase which crosses
+// the load threshold splits or merges exactly one bucket, so no operation ever
+// has to rehash the whole table.  Bucket arrays are allocated in segments which
+// double in size, and are never moved once allocated.  The first segment is
+// part of the table itself, so small tables never allocate, and a failure to
+// allocate a segment leaves the table working with longer buckets.
+//
+// Every element caches the full hash of its key in its node state.  Lookups
+// compare the cached hash before the key, and splitting a bucket never has to
+// fetch keys or compute hashes.
+//
+// Because linear hashing indexes buckets by the low bits of the hash, the hash
+// function must produce well distributed low bits, but it is not reduced to a
+// bucket index by the user; see DefaultResizableHashTraits.
+//
+// Since inserting or erasing an element may move other elements between
+// buckets, both invalidate all iterators into the table.
+//
+// Example:
+//
+// class Foo : public mxtl::ResizableHashTableable<Foo*> {
+// public:
+//     uint32_t GetKey() const { return id_; }
+//     static size_t GetHash(uint32_t key) { return key; }
+//     ...
+// };
+//
+// mxtl::ResizableHashTable<uint32_t, Foo*> table;
+
+namespace mxtl {
+
+// ResizableHashTableNodeState<T>
+//
+// The state needed to be a member of a ResizableHashTable<T>: the bucket list
+// linkage, and the cached hash of the element's key.
+template <typename T>
+struct ResizableHashTableNodeState {
+    constexpr ResizableHashTableNodeState() { }
+
+    bool IsValid() const     { return bucket_state_.IsValid(); }
+    bool InContainer() const { return bucket_state_.InContainer(); }
+
+    SinglyLinkedListNodeState<T> bucket_state_;
+    size_t hash_ = 0;
+};
+
+// DefaultResizableHashTableTraits<T>
+//
+// The default implementation of traits needed to be a member of a resizable
+// hash table.  To use the default traits, an object may...
+//
+// 1) Be friends with DefaultResizableHashTableTraits<T> and have a private
+//    rht_node_state_ member.
+// 2) Derive from ResizableHashTableable<T> (easiest)
+template <typename T>
+struct DefaultResizableHashTableTraits {
+    using PtrTraits = internal::ContainerPtrTraits<T>;
+    static ResizableHashTableNodeState<T>& node_state(typename PtrTraits::RefType obj) {
+        return obj.rht_node_state_;
+    }
+};
+
+// ResizableHashTableable<T>
+//
+// A helper class which makes it simple to exist in a resizable hash table.
+template <typename T>
+struct ResizableHashTableable {
+public:
+    bool InContainer() const { return rht_node_state_.InContainer(); }
+
+private:
+    friend struct DefaultResizableHashTableTraits<T>;
+    ResizableHashTableNodeState<T> rht_node_state_;
+};
+
+// DefaultResizableHashTraits
+//
+// Takes the hash of a key from a static GetHash method of ObjType.  Unlike
+// DefaultHashTraits, the full hash is used; the table reduces it to a bucket
+// index itself.
+template <typename KeyType, typename ObjType>
+struct DefaultResizableHashTraits {
+    static size_t GetHash(const KeyType& key) {
+        return static_cast<size_t>(ObjType::GetHash(key));
+    }
+};
+
+template <typename  _KeyType,
+          typename  _PtrType,
+          typename  _NodeTraits = DefaultResizableHashTableTraits<_PtrType>,
+          typename  _KeyTraits  = DefaultKeyedObjectTraits<
+                                    _KeyType,
+                                    typename internal::ContainerPtrTraits<_PtrType>::ValueType>,
+          typename  _HashTraits = DefaultResizableHashTraits<
+                                    _KeyType,
+                                    typename internal::ContainerPtrTraits<_PtrType>::ValueType>>
+class ResizableHashTable {
+private:
+    // Private fwd decls of the iterator implementation.
+    template <typename IterTraits> class iterator_impl;
+    struct iterator_traits;
+    struct const_iterator_traits;
+    struct BucketTraits;
+
+public:
+    // Pointer types/traits
+    using PtrType      = _PtrType;
+    using PtrTraits    = internal::ContainerPtrTraits<PtrType>;
+    using ValueType    = typename PtrTraits::ValueType;
+
+    // Key, hash and node types/traits
+    using KeyType      = _KeyType;
+    using KeyTraits    = _KeyTraits;
+    using HashTraits   = _HashTraits;
+    using NodeTraits   = _NodeTraits;
+    using BucketType   = SinglyLinkedList<PtrType, BucketTraits>;
+
+    // Declarations of the standard iterator types.
+    using iterator       = iterator_impl<iterator_traits>;
+    using const_iterator = iterator_impl<const_iterator_traits>;
+
+    using ContainerType = ResizableHashTable<_KeyType, _PtrType, _NodeTraits,
+                                             _KeyTraits, _HashTraits>;
+
+    // The number of buckets in an empty table, all of which are part of the
+    // table itself.
+    static constexpr size_t kMinBucketsShift = 4;
+    static constexpr size_t kMinBuckets = static_cast<size_t>(1) << kMinBucketsShift;
+
+    // The number of separately allocated bucket segments.  Segment N holds
+    // kMinBuckets << N buckets, so the table stops growing at
+    // kMinBuckets << kMaxSegments buckets.
+    static constexpr size_t kMaxSegments = 28;
+
+    static constexpr bool SupportsConstantOrderErase = false;
+    static constexpr bool SupportsConstantOrderSize = true;
+    static constexpr bool IsAssociative = true;
+    static constexpr bool IsSequenced = false;
+
+    constexpr ResizableHashTable() { }
+
+    ~ResizableHashTable() {
+        MX_DEBUG_ASSERT(PtrTraits::IsManaged || is_empty());
+        clear();
+    }
+
+    // Standard begin/end, cbegin/cend iterator accessors.
+    iterator begin()              { return       iterator(this,       iterator::BEGIN); }
+    const_iterator begin()  const { return const_iterator(this, const_iterator::BEGIN); }
+    const_iterator cbegin() const { return const_iterator(this, const_iterator::BEGIN); }
+
+    iterator end()              { return       iterator(this,       iterator::END); }
+    const_iterator end()  const { return const_iterator(this, const_iterator::END); }
+    const_iterator cend() const { return const_iterator(this, const_iterator::END); }
+
+    // make_iterator : construct an iterator out of a reference to an object.
+    iterator make_iterator(ValueType& obj) {
+        size_t ndx = GetBucketIndex(NodeTraits::node_state(obj).hash_);
+        return iterator(this, ndx, GetBucket(ndx).make_iterator(obj));
+    }
+
+    void insert(const PtrType& ptr) { insert(PtrType(ptr)); }
+    void insert(PtrType&& ptr) {
+        MX_DEBUG_ASSERT(ptr != nullptr);
+        const KeyType key = KeyTraits::GetKey(*ptr);
+        const size_t hash = HashTraits::GetHash(key);
+
+        // Duplicate keys are disallowed.  Use insert_or_find() if there might
+        // be one.
+        MX_DEBUG_ASSERT(FindInBucket(GetBucket(GetBucketIndex(hash)), key, hash).IsValid() ==
+                        false);
+
+        InsertHashed(mxtl::move(ptr), hash);
+    }
+
+    // insert_or_find
+    //
+    // Insert the element pointed to by ptr if it is not already in the
+    // table, or find the element that the ptr collided with instead.
+    //
+    // 'iter' is an optional out parameter pointer to an iterator which
+    // will reference either the newly inserted item, or the item whose key
+    // collided with ptr.
+    //
+    // insert_or_find returns true if there was no collision and the item was
+    // successfully inserted, otherwise it returns false.
+    bool insert_or_find(const PtrType& ptr, iterator* iter = nullptr) {
+        return insert_or_find(PtrType(ptr), iter);
+    }
+
+    bool insert_or_find(PtrType&& ptr, iterator* iter = nullptr) {
+        MX_DEBUG_ASSERT(ptr != nullptr);
+        const KeyType key = KeyTraits::GetKey(*ptr);
+        const size_t hash = HashTraits::GetHash(key);
+        size_t ndx = GetBucketIndex(hash);
+        auto bucket_iter = FindInBucket(GetBucket(ndx), key, hash);
+
+        if (bucket_iter.IsValid()) {
+            if (iter) *iter = iterator(this, ndx, bucket_iter);
+            return false;
+        }
+
+        ValueType& obj = *ptr;
+        InsertHashed(mxtl::move(ptr), hash);
+        if (iter) *iter = make_iterator(obj);
+        return true;
+    }
+
+    iterator find(const KeyType& key) {
+        const size_t hash = HashTraits::GetHash(key);
+        size_t ndx = GetBucketIndex(hash);
+        auto bucket_iter = FindInBucket(GetBucket(ndx), key, hash);
+
+        return bucket_iter.IsValid() ? iterator(this, ndx, bucket_iter)
+                                     : iterator(this, iterator::END);
+    }
+
+    const_iterator find(const KeyType& key) const {
+        const size_t hash = HashTraits::GetHash(key);
+        size_t ndx = GetBucketIndex(hash);
+        auto bucket_iter = FindInBucket(GetBucket(ndx), key, hash);
+
+        return bucket_iter.IsValid() ? const_iterator(this, ndx, bucket_iter)
+                                     : const_iterator(this, const_iterator::END);
+    }
+
+    PtrType erase(const KeyType& key) {
+        const size_t hash = HashTraits::GetHash(key);
+        return EraseFromBucket(GetBucket(GetBucketIndex(hash)),
+            [&key, hash](const ValueType& other) -> bool {
+                return (HashOf(other) == hash) &&
+                       KeyTraits::EqualTo(key, KeyTraits::GetKey(other));
+            });
+    }
+
+    PtrType erase(const iterator& iter) {
+        if (!iter.IsValid())
+            return PtrType(nullptr);
+
+        return erase(*iter);
+    }
+
+    PtrType erase(ValueType& obj) {
+        return EraseFromBucket(GetBucket(GetBucketIndex(HashOf(obj))),
+            [&obj](const ValueType& other) -> bool {
+                return &obj == &other;
+            });
+    }
+
+    // clear
+    //
+    // Clear out all of the buckets and free the bucket segments.  For managed
+    // pointer types, this will release all references held by the table to
+    // the objects which were in it.
+    void clear() {
+        for (size_t i = 0; i < bucket_count(); ++i)
+            GetBucket(i).clear();
+        FreeSegments();
+    }
+
+    // clear_unsafe
+    //
+    // Perform a clear_unsafe on all buckets and reset the table to its initial
+    // size.  See comments in mxtl/intrusive_single_list.h
+    // Think carefully before calling this!
+    void clear_unsafe() {
+        static_assert(PtrTraits::IsManaged == false,
+                     "clear_unsafe is not allowed for containers of managed pointers");
+
+        for (size_t i = 0; i < bucket_count(); ++i)
+            GetBucket(i).clear_unsafe();
+        FreeSegments();
+    }
+
+    size_t size()         const { return count_; }
+    bool   is_empty()     const { return count_ == 0; }
+
+    // The number of buckets currently in use.
+    size_t bucket_count() const { return BaseBuckets() + split_; }
+
+    // erase_if
+    //
+    // Find the first member of the table which satisfies the predicate given
+    // by 'fn' and erase it from the table, returning a referenced pointer to
+    // the removed element.  Return nullptr if no member satisfies the
+    // predicate.
+    template <typename UnaryFn>
+    PtrType erase_if(UnaryFn fn) {
+        for (size_t i = 0; !is_empty() && (i < bucket_count()); ++i) {
+            PtrType ret = EraseFromBucket(GetBucket(i), fn);
+            if (ret != nullptr)
+                return ret;
+        }
+
+        return PtrType(nullptr);
+    }
+
+    // find_if
+    //
+    // Find the first member of the table which satisfies the predicate given
+    // by 'fn' and return an iterator to it.  Return end() if no member
+    // satisfies the predicate.
+    template <typename UnaryFn>
+    const_iterator find_if(UnaryFn fn) const {
+        for (auto iter = begin(); iter.IsValid(); ++iter)
+            if (fn(*iter))
+                return iter;
+
+        return end();
+    }
+
+    template <typename UnaryFn>
+    iterator find_if(UnaryFn fn) {
+        for (auto iter = begin(); iter.IsValid(); ++iter)
+            if (fn(*iter))
+                return iter;
+
+        return end();
+    }
+
+private:
+    // The bucket lists link elements through the bucket state within their
+    // node state.
+    struct BucketTraits {
+        static SinglyLinkedListNodeState<PtrType>& node_state(ValueType& obj) {
+            return NodeTraits::node_state(obj).bucket_state_;
+        }
+    };
+
+    // The traits of a non-const iterator
+    struct iterator_traits {
+        using RefType    = typename PtrTraits::RefType;
+        using RawPtrType = typename PtrTraits::RawPtrType;
+        using IterType   = typename BucketType::iterator;
+
+        static IterType BucketBegin(BucketType& bucket) { return bucket.begin(); }
+        static IterType BucketEnd  (BucketType& bucket) { return bucket.end(); }
+    };
+
+    // The traits of a const iterator
+    struct const_iterator_traits {
+        using RefType    = typename PtrTraits::ConstRefType;
+        using RawPtrType = typename PtrTraits::ConstRawPtrType;
+        using IterType   = typename BucketType::const_iterator;
+
+        static IterType BucketBegin(const BucketType& bucket) { return bucket.cbegin(); }
+        static IterType BucketEnd  (const BucketType& bucket) { return bucket.cend(); }
+    };
+
+    // The shared implementation of the iterator
+    template <class IterTraits>
+    class iterator_impl {
+    public:
+        iterator_impl() { }
+        iterator_impl(const iterator_impl& other) {
+            hash_table_ = other.hash_table_;
+            bucket_ndx_ = other.bucket_ndx_;
+            iter_       = other.iter_;
+        }
+
+        iterator_impl& operator=(const iterator_impl& other) {
+            hash_table_ = other.hash_table_;
+            bucket_ndx_ = other.bucket_ndx_;
+            iter_       = other.iter_;
+            return *this;
+        }
+
+        bool IsValid() const { return iter_.IsValid(); }
+        bool operator==(const iterator_impl& other) const { return iter_ == other.iter_; }
+        bool operator!=(const iterator_impl& other) const { return iter_ != other.iter_; }
+
+        // Prefix
+        iterator_impl& operator++() {
+            if (!IsValid()) return *this;
+            MX_DEBUG_ASSERT(hash_table_);
+
+            // Bump the bucket iterator and go looking for a new bucket if the
+            // iterator has become invalid.
+            ++iter_;
+            advance_if_invalid_iter();
+
+            return *this;
+        }
+
+        // Postfix
+        iterator_impl operator++(int) {
+            iterator_impl ret(*this);
+            ++(*this);
+            return ret;
+        }
+
+        typename PtrTraits::PtrType CopyPointer()          { return iter_.CopyPointer(); }
+        typename IterTraits::RefType operator*()     const { return iter_.operator*(); }
+        typename IterTraits::RawPtrType operator->() const { return iter_.operator->(); }
+
+    private:
+        friend ContainerType;
+        using IterType = typename IterTraits::IterType;
+
+        enum BeginTag { BEGIN };
+        enum EndTag { END };
+
+        iterator_impl(const ContainerType* hash_table, BeginTag)
+            : hash_table_(hash_table),
+              bucket_ndx_(0),
+              iter_(IterTraits::BucketBegin(GetBucket(0))) {
+            advance_if_invalid_iter();
+        }
+
+        iterator_impl(const ContainerType* hash_table, EndTag)
+            : hash_table_(hash_table),
+              bucket_ndx_(hash_table->bucket_count() - 1),
+              iter_(IterTraits::BucketEnd(GetBucket(bucket_ndx_))) { }
+
+        iterator_impl(const ContainerType* hash_table, size_t bucket_ndx, const IterType& iter)
+            : hash_table_(hash_table),
+              bucket_ndx_(bucket_ndx),
+              iter_(iter) { }
+
+        BucketType& GetBucket(size_t ndx) {
+            return const_cast<ContainerType*>(hash_table_)->GetBucket(ndx);
+        }
+
+        void advance_if_invalid_iter() {
+            // If the iterator has run off the end of its current bucket, then
+            // check to see if there are nodes in any of the remaining buckets.
+            const size_t last = hash_table_->bucket_count() - 1;
+            if (!iter_.IsValid()) {
+                while (bucket_ndx_ < last) {
+                    ++bucket_ndx_;
+                    auto& bucket = GetBucket(bucket_ndx_);
+
+                    if (!bucket.is_empty()) {
+                        iter_ = IterTraits::BucketBegin(bucket);
+                        MX_DEBUG_ASSERT(iter_.IsValid());
+                        break;
+                    } else if (bucket_ndx_ == last) {
+                        iter_ = IterTraits::BucketEnd(bucket);
+                    }
+                }
+            }
+        }
+
+        const ContainerType* hash_table_ = nullptr;
+        size_t bucket_ndx_ = 0;
+        IterType iter_;
+    };
+
+    static size_t HashOf(const ValueType& obj) {
+        return NodeTraits::node_state(const_cast<ValueType&>(obj)).hash_;
+    }
+
+    // The number of buckets at the start of the current round of splits.
+    size_t BaseBuckets() const { return kMinBuckets << level_; }
+
+    // Buckets below split_ have already been split this round, so are indexed
+    // with one more bit of the hash.
+    size_t GetBucketIndex(size_t hash) const {
+        size_t ndx = hash & (BaseBuckets() - 1);
+        if (ndx < split_)
+            ndx = hash & ((BaseBuckets() << 1) - 1);
+        return ndx;
+    }
+
+    BucketType& GetBucket(size_t ndx) {
+        return const_cast<BucketType&>(static_cast<const ContainerType*>(this)->GetBucket(ndx));
+    }
+
+    const BucketType& GetBucket(size_t ndx) const {
+        MX_DEBUG_ASSERT(ndx < bucket_count());
+        if (ndx < kMinBuckets)
+            return initial_buckets_[ndx];
+
+        // Segment N starts at kMinBuckets << N.
+        size_t segment = (sizeof(unsigned long) * 8 - 1) -
+                         static_cast<size_t>(__builtin_clzl(ndx)) - kMinBucketsShift;
+        return segments_[segment][ndx - (kMinBuckets << segment)];
+    }
+
+    static typename BucketType::iterator FindInBucket(BucketType& bucket,
+                                                      const KeyType& key, size_t hash) {
+        return bucket.find_if(
+            [&key, hash](const ValueType& other) -> bool {
+                return (HashOf(other) == hash) &&
+                       KeyTraits::EqualTo(key, KeyTraits::GetKey(other));
+            });
+    }
+
+    static typename BucketType::const_iterator FindInBucket(const BucketType& bucket,
+                                                            const KeyType& key, size_t hash) {
+        return bucket.find_if(
+            [&key, hash](const ValueType& other) -> bool {
+                return (HashOf(other) == hash) &&
+                       KeyTraits::EqualTo(key, KeyTraits::GetKey(other));
+            });
+    }
+
+    void InsertHashed(PtrType&& ptr, size_t hash) {
+        NodeTraits::node_state(*ptr).hash_ = hash;
+        GetBucket(GetBucketIndex(hash)).push_front(mxtl::move(ptr));
+        ++count_;
+
+        if (count_ > bucket_count())
+            Grow();
+    }
+
+    template <typename UnaryFn>
+    PtrType EraseFromBucket(BucketType& bucket, UnaryFn fn) {
+        PtrType ret = bucket.erase_if(fn);
+        if (ret == nullptr)
+            return ret;
+
+        // Merging one bucket per erase lags behind the element count, so
+        // give all of the segments back at once when the table empties.
+        if (--count_ == 0) {
+            FreeSegments();
+        } else if ((count_ * 2 < bucket_count()) && (bucket_count() > kMinBuckets)) {
+            Shrink();
+        }
+
+        return ret;
+    }
+
+    // Split bucket split_ into itself and a new bucket at the end of the
+    // table.
+    void Grow() {
+        const size_t base = BaseBuckets();
+        if (split_ == 0) {
+            if (level_ == kMaxSegments)
+                return;
+
+            // Starting a new round of splits, which need a segment of the
+            // same size as the table so far.
+            if (segments_[level_] == nullptr) {
+                AllocChecker ac;
+                segments_[level_] = new (&ac) BucketType[base];
+                if (!ac.check()) {
+                    segments_[level_] = nullptr;
+                    return;
+                }
+            }
+        }
+
+        BucketType& from = GetBucket(split_);
+        BucketType& to = segments_[level_][split_];
+        BucketType stay;
+        while (!from.is_empty()) {
+            PtrType ptr = from.pop_front();
+            if (HashOf(*ptr) & base) {
+                to.push_front(mxtl::move(ptr));
+            } else {
+                stay.push_front(mxtl::move(ptr));
+            }
+        }
+        from.swap(stay);
+
+        if (++split_ == base) {
+            ++level_;
+            split_ = 0;
+        }
+    }
+
+    // Merge the last bucket back into the one it was split from.
+    void Shrink() {
+        if (split_ == 0) {
+            --level_;
+            split_ = BaseBuckets();
+        }
+        --split_;
+
+        BucketType& from = segments_[level_][split_];
+        BucketType& to = GetBucket(split_);
+        while (!from.is_empty())
+            to.push_front(from.pop_front());
+
+        // The last segment is empty once its first bucket is merged.
+        if (split_ == 0) {
+            delete[] segments_[level_];
+            segments_[level_] = nullptr;
+        }
+    }
+
+    // Frees all segments and resets the table to its initial size.  All of
+    // the buckets must be empty.
+    void FreeSegments() {
+        for (size_t i = 0; i < kMaxSegments; ++i) {
+            delete[] segments_[i];
+            segments_[i] = nullptr;
+        }
+        level_ = 0;
+        split_ = 0;
+        count_ = 0;
+    }
+
+    // Iterators need to access our buckets in order to iterate.
+    friend iterator;
+    friend const_iterator;
+
+    // Hash tables may not currently be copied, assigned or moved.
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ResizableHashTable);
+
+    size_t count_ = 0UL;
+    size_t level_ = 0UL;
+    size_t split_ = 0UL;
+    BucketType initial_buckets_[kMinBuckets];
+    BucketType* segments_[kMaxSegments] = { };
+};
+
+// Explicit declaration of constexpr storage.
+#define RESIZABLE_HASH_TABLE_PROP(_type, _name) \
+template <typename KeyType, typename PtrType, typename NodeTraits, typename KeyTraits, \
+          typename HashTraits> \
+constexpr _type ResizableHashTable<KeyType, PtrType, NodeTraits, KeyTraits, HashTraits>::_name
+
+RESIZABLE_HASH_TABLE_PROP(size_t, kMinBucketsShift);
+RESIZABLE_HASH_TABLE_PROP(size_t, kMinBuckets);
+RESIZABLE_HASH_TABLE_PROP(size_t, kMaxSegments);
+RESIZABLE_HASH_TABLE_PROP(bool, SupportsConstantOrderErase);
+RESIZABLE_HASH_TABLE_PROP(bool, SupportsConstantOrderSize);
+RESIZABLE_HASH_TABLE_PROP(bool, IsAssociative);
+RESIZABLE_HASH_TABLE_PROP(bool, IsSequenced);
+
+#undef RESIZABLE_HASH_TABLE_PROP
+
+}  // namespace mxtl
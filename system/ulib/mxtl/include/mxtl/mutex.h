@@ -28,6 +28,9 @@
 class __TA_CAPABILITY("mutex") Mutex {
 public:
     constexpr Mutex() : mutex_(MUTEX_INITIAL_VALUE(mutex_)) { }
+    // Accounts the mutex to a lock class; see kernel/lockstat.h.
+    explicit constexpr Mutex(lockstat_class_t* lockstat_class)
+        : mutex_(MUTEX_INITIAL_VALUE_CLASS(mutex_, lockstat_class)) { }
     ~Mutex() { mutex_destroy(&mutex_); }
     void Acquire() __TA_ACQUIRE() { mutex_acquire(&mutex_); }
     void Release() __TA_RELEASE() { mutex_release(&mutex_); }
@@ -84,6 +84,21 @@ protected:
             MX_DEBUG_ASSERT_MSG(rc >= 1, "count %d < 1\n", rc);
         }
     }
+    // Adds a reference unless the count has already dropped to zero, in which
+    // case the object is being destroyed and this returns false. The caller
+    // must keep the memory valid by other means; typically by holding a lock
+    // which the destructor acquires to remove the object from a container.
+    bool AddRefMaybeInDestructor() __WARN_UNUSED_RESULT {
+        adoption_validator_.ValidateAddRef();
+        int rc = ref_count_.load(memory_order_relaxed);
+        do {
+            if (rc < 1) {
+                return false;
+            }
+        } while (!ref_count_.compare_exchange_weak(&rc, rc + 1, memory_order_relaxed,
+                                                   memory_order_relaxed));
+        return true;
+    }
     // Returns true if the object should self-delete.
     bool Release() __WARN_UNUSED_RESULT {
         adoption_validator_.ValidateRelease();
@@ -244,6 +244,19 @@ inline RefPtr<T> WrapRefPtr(T* ptr) {
     return RefPtr<T>(ptr);
 }
 
+// Constructs a RefPtr from a raw pointer to an object which may have dropped
+// its last reference, but which cannot finish being destroyed while the caller
+// holds some lock; e.g. an object which removes itself from a container
+// guarded by that lock in its destructor. Returns a null RefPtr if the object
+// is being destroyed.
+template <typename T>
+inline RefPtr<T> MakeRefPtrUpgradeFromRaw(T* ptr) {
+    if (!ptr->AddRefMaybeInDestructor()) {
+        return nullptr;
+    }
+    return internal::MakeRefPtrNoAdopt(ptr);
+}
+
 namespace internal {
 // Constructs a RefPtr from a T* without attempt to either AddRef or Adopt the
 // pointer.  Used by the internals of some intrusive container classes to store
@@ -0,0 +1,177 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <magenta/compiler.h>
+#include <magenta/syscalls.h>
+#include <mxalloc/new.h>
+#include <mxtl/macros.h>
+
+// A framework for microbenchmarks of the kernel's primitives.
+//
+// A test is a function which repeats the operation being measured for as
+// long as RepeatState::KeepRunning() returns true, and returns whether it
+// succeeded:
+//
+//     bool EventSignalTest(perftest::RepeatState* state) {
+//         mx_handle_t event;
+//         if (mx_event_create(0, &event) != MX_OK)
+//             return false;
+//         while (state->KeepRunning()) {
+//             if (mx_object_signal(event, 0, MX_EVENT_SIGNALED) != MX_OK)
+//                 return false;
+//         }
+//         mx_handle_close(event);
+//         return true;
+//     }
+//
+//     PERFTEST_CTOR(RegisterTests)
+//     static void RegisterTests() {
+//         perftest::RegisterTest("Event/Signal", EventSignalTest);
+//     }
+//
+// Each run of the loop body is timed separately, so setup before the loop
+// and teardown after it are not measured.  The runner first calls the test
+// for a number of warm-up runs, whose times are discarded, then calls it
+// again for the measured runs, and reports the distribution of their times.
+//
+// PerfTestMain() implements the command line of a benchmark binary; see its
+// -h output.
+
+namespace perftest {
+
+class RepeatState {
+public:
+    // |timestamps| must have room for |runs| + 1 entries.
+    RepeatState(uint32_t runs, uint64_t* timestamps)
+        : runs_(runs), timestamps_(timestamps) {}
+
+    // Returns whether to do another run.  Each call records the time at
+    // which the previous run finished and the next one starts.
+    bool KeepRunning() {
+        if (unlikely(next_ > runs_))
+            return false;
+        timestamps_[next_] = mx_ticks_get();
+        return next_++ < runs_;
+    }
+
+    // Whether the test ran to completion.
+    bool finished() const { return next_ > runs_; }
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(RepeatState);
+
+private:
+    const uint32_t runs_;
+    uint32_t next_ = 0;
+    uint64_t* const timestamps_;
+};
+
+typedef bool TestFunc(RepeatState* state);
+
+namespace internal {
+
+class TestCase {
+public:
+    explicit TestCase(const char* name);
+    virtual ~TestCase() {}
+
+    virtual bool Run(RepeatState* state) = 0;
+
+    const char* name() const { return name_; }
+    TestCase* next() const { return next_; }
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(TestCase);
+
+private:
+    friend void AddTest(TestCase* test, bool allocated);
+
+    char name_[64];
+    TestCase* next_ = nullptr;
+};
+
+// Appends |test| to the list of registered tests, taking ownership of it.
+// |allocated| is the result of the AllocChecker used to allocate |test|; if
+// it is false, registration cannot go on and the program aborts.
+void AddTest(TestCase* test, bool allocated);
+
+// Returns the first registered test, in order of registration.
+TestCase* FirstTest();
+
+class PlainTestCase final : public TestCase {
+public:
+    PlainTestCase(const char* name, TestFunc* func)
+        : TestCase(name), func_(func) {}
+
+    bool Run(RepeatState* state) override { return func_(state); }
+
+private:
+    TestFunc* const func_;
+};
+
+// Keeps |arg| from taking part in deducing Arg below, so that it can be a
+// literal which would deduce differently from the test's parameter type.
+template <typename T>
+struct NonDeduced {
+    typedef T type;
+};
+
+template <typename Arg>
+class ArgTestCase final : public TestCase {
+public:
+    ArgTestCase(const char* name, bool (*func)(RepeatState*, Arg), Arg arg)
+        : TestCase(name), func_(func), arg_(arg) {}
+
+    bool Run(RepeatState* state) override { return func_(state, arg_); }
+
+private:
+    bool (*const func_)(RepeatState*, Arg);
+    const Arg arg_;
+};
+
+} // namespace internal
+
+// Registers a test.  |name| is copied, and by convention is made of
+// components separated by slashes, from the general to the specific, such
+// as "Channel/WriteRead/1024bytes/1handles".
+void RegisterTest(const char* name, TestFunc* func);
+
+// Registers a test which is passed a copy of |arg| on every call, to run
+// the same test with different parameters.
+template <typename Arg>
+void RegisterTest(const char* name, bool (*func)(RepeatState*, Arg),
+                  typename internal::NonDeduced<Arg>::type arg) {
+    AllocChecker ac;
+    auto test = new (&ac) internal::ArgTestCase<Arg>(name, func, arg);
+    internal::AddTest(test, ac.check());
+}
+
+// Summary of the times of the measured runs of a test, in nanoseconds.
+struct Summary {
+    uint32_t runs;
+    uint64_t min;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+    double mean;
+    double std_dev;
+};
+
+// Sorts |times| and summarizes them.  |count| must not be 0.
+void Summarize(uint64_t* times, uint32_t count, Summary* summary);
+
+// Runs the registered tests as directed by the command line, returning the
+// exit status for main().
+int PerfTestMain(int argc, char** argv);
+
+} // namespace perftest
+
+// Runs |func| before main(), to register tests.
+#define PERFTEST_CTOR(func) \
+    static void func(); \
+    __attribute__((constructor)) static void func##_ctor() { func(); }
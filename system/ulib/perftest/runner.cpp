@@ -0,0 +1,279 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <perftest/perftest.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mxtl/algorithm.h>
+#include <mxtl/unique_ptr.h>
+
+namespace perftest {
+namespace internal {
+
+namespace {
+
+// Tests are registered by static constructors, so this list must not need
+// constructing itself.
+TestCase* g_tests = nullptr;
+TestCase** g_tests_tail = &g_tests;
+
+} // namespace
+
+TestCase::TestCase(const char* name) {
+    snprintf(name_, sizeof(name_), "%s", name);
+}
+
+void AddTest(TestCase* test, bool allocated) {
+    if (!allocated) {
+        fprintf(stderr, "perftest: out of memory registering tests\n");
+        abort();
+    }
+    *g_tests_tail = test;
+    g_tests_tail = &test->next_;
+}
+
+TestCase* FirstTest() {
+    return g_tests;
+}
+
+} // namespace internal
+
+void RegisterTest(const char* name, TestFunc* func) {
+    AllocChecker ac;
+    auto test = new (&ac) internal::PlainTestCase(name, func);
+    internal::AddTest(test, ac.check());
+}
+
+namespace {
+
+constexpr uint32_t kDefaultRuns = 1000;
+constexpr uint32_t kDefaultWarmUpRuns = 100;
+
+int CompareTimes(const void* a, const void* b) {
+    uint64_t time_a = *static_cast<const uint64_t*>(a);
+    uint64_t time_b = *static_cast<const uint64_t*>(b);
+    return time_a < time_b ? -1 : time_a > time_b;
+}
+
+// The nearest-rank percentile of |count| sorted times.
+uint64_t Percentile(const uint64_t* sorted, uint32_t count, uint32_t percent) {
+    uint64_t rank = (static_cast<uint64_t>(count) * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+struct Options {
+    uint32_t runs = kDefaultRuns;
+    uint32_t warm_up_runs = kDefaultWarmUpRuns;
+    const char* filter = nullptr;
+    const char* json_path = nullptr;
+    bool list = false;
+};
+
+bool Selected(const internal::TestCase* test, const Options& options) {
+    return !options.filter || strstr(test->name(), options.filter);
+}
+
+// Runs |test| and summarizes the times of its measured runs.  |timestamps|
+// and |times| must have room for enough entries for either kind of runs.
+bool RunTest(internal::TestCase* test, const Options& options,
+             uint64_t* timestamps, uint64_t* times, Summary* summary) {
+    if (options.warm_up_runs > 0) {
+        RepeatState warm_up(options.warm_up_runs, timestamps);
+        if (!test->Run(&warm_up) || !warm_up.finished())
+            return false;
+    }
+
+    RepeatState state(options.runs, timestamps);
+    if (!test->Run(&state))
+        return false;
+    if (!state.finished()) {
+        fprintf(stderr, "%s: test returned before finishing its runs\n", test->name());
+        return false;
+    }
+
+    double ns_per_tick = 1e9 / static_cast<double>(mx_ticks_per_second());
+    for (uint32_t i = 0; i < options.runs; i++) {
+        uint64_t ticks = timestamps[i + 1] - timestamps[i];
+        times[i] = static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick + 0.5);
+    }
+    Summarize(times, options.runs, summary);
+    return true;
+}
+
+void PrintJsonResult(FILE* out, const char* name, const Summary& s, bool first) {
+    fprintf(out, "%s\n  {\"label\": \"%s\", \"unit\": \"ns\", \"runs\": %" PRIu32 ", "
+                 "\"min\": %" PRIu64 ", \"p50\": %" PRIu64 ", \"p90\": %" PRIu64 ", "
+                 "\"p99\": %" PRIu64 ", \"max\": %" PRIu64 ", "
+                 "\"mean\": %.1f, \"std_dev\": %.1f}",
+            first ? "" : ",", name, s.runs, s.min, s.p50, s.p90, s.p99, s.max,
+            s.mean, s.std_dev);
+}
+
+void Usage(const char* argv0) {
+    printf("Usage: %s [options ...]\n"
+           "\n"
+           "Options:\n"
+           "  -h       show help (this)\n"
+           "  -l       list the tests\n"
+           "  -f NAME  run only the tests whose names contain NAME\n"
+           "  -r N     time N runs of each test (default: %" PRIu32 ")\n"
+           "  -w N     do N untimed warm-up runs of each test first (default: %" PRIu32 ")\n"
+           "  -o FILE  also write the results to FILE as JSON\n"
+           "\n"
+           "Times are in nanoseconds.\n",
+           argv0, kDefaultRuns, kDefaultWarmUpRuns);
+}
+
+bool ParseCount(const char* arg, uint32_t* count) {
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (errno != 0 || *end != '\0' || value > UINT32_MAX)
+        return false;
+    *count = static_cast<uint32_t>(value);
+    return true;
+}
+
+} // namespace
+
+void Summarize(uint64_t* times, uint32_t count, Summary* summary) {
+    qsort(times, count, sizeof(times[0]), CompareTimes);
+
+    double sum = 0;
+    for (uint32_t i = 0; i < count; i++)
+        sum += static_cast<double>(times[i]);
+    double mean = sum / count;
+
+    double sum_squares = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        double diff = static_cast<double>(times[i]) - mean;
+        sum_squares += diff * diff;
+    }
+
+    summary->runs = count;
+    summary->min = times[0];
+    summary->p50 = Percentile(times, count, 50);
+    summary->p90 = Percentile(times, count, 90);
+    summary->p99 = Percentile(times, count, 99);
+    summary->max = times[count - 1];
+    summary->mean = mean;
+    summary->std_dev = sqrt(sum_squares / count);
+}
+
+int PerfTestMain(int argc, char** argv) {
+    Options options;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hlf:r:w:o:")) != -1) {
+        switch (opt) {
+        case 'h':
+            Usage(argv[0]);
+            return EXIT_SUCCESS;
+        case 'l':
+            options.list = true;
+            break;
+        case 'f':
+            options.filter = optarg;
+            break;
+        case 'r':
+            if (!ParseCount(optarg, &options.runs) || options.runs == 0) {
+                fprintf(stderr, "%s: invalid run count: %s\n", argv[0], optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w':
+            if (!ParseCount(optarg, &options.warm_up_runs)) {
+                fprintf(stderr, "%s: invalid warm-up run count: %s\n", argv[0], optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            options.json_path = optarg;
+            break;
+        default:
+            fprintf(stderr, "Run with -h for help.\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) {
+        fprintf(stderr, "%s: unexpected argument: %s\n", argv[0], argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.list) {
+        for (auto test = internal::FirstTest(); test; test = test->next()) {
+            if (Selected(test, options))
+                printf("%s\n", test->name());
+        }
+        return EXIT_SUCCESS;
+    }
+
+    FILE* json = nullptr;
+    if (options.json_path) {
+        json = fopen(options.json_path, "w");
+        if (!json) {
+            fprintf(stderr, "%s: cannot open %s: %s\n", argv[0], options.json_path,
+                    strerror(errno));
+            return EXIT_FAILURE;
+        }
+        fprintf(json, "[");
+    }
+
+    uint32_t max_runs = mxtl::max(options.runs, options.warm_up_runs);
+    AllocChecker ac_timestamps;
+    mxtl::unique_ptr<uint64_t[]> timestamps(new (&ac_timestamps) uint64_t[max_runs + 1]);
+    AllocChecker ac_times;
+    mxtl::unique_ptr<uint64_t[]> times(new (&ac_times) uint64_t[options.runs]);
+    if (!ac_timestamps.check() || !ac_times.check()) {
+        fprintf(stderr, "%s: out of memory for %" PRIu32 " runs\n", argv[0], max_runs);
+        if (json)
+            fclose(json);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-48s %10s %10s %10s %10s %10s %10s %10s\n",
+           "test", "mean", "std dev", "min", "p50", "p90", "p99", "max");
+
+    bool ok = true;
+    bool first = true;
+    for (auto test = internal::FirstTest(); test; test = test->next()) {
+        if (!Selected(test, options))
+            continue;
+
+        Summary summary;
+        if (!RunTest(test, options, timestamps.get(), times.get(), &summary)) {
+            printf("%-48s FAILED\n", test->name());
+            ok = false;
+            continue;
+        }
+
+        printf("%-48s %10.0f %10.0f %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+               " %10" PRIu64 " %10" PRIu64 "\n",
+               test->name(), summary.mean, summary.std_dev, summary.min,
+               summary.p50, summary.p90, summary.p99, summary.max);
+        if (json) {
+            PrintJsonResult(json, test->name(), summary, first);
+            first = false;
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n]\n");
+        if (fclose(json) != 0) {
+            fprintf(stderr, "%s: error writing %s\n", argv[0], options.json_path);
+            ok = false;
+        }
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace perftest
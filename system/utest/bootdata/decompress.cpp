@@ -0,0 +1,310 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <bootdata/decompress.h>
+#include <lz4/lz4.h>
+#include <magenta/boot/bootdata.h>
+#include <magenta/process.h>
+#include <magenta/syscalls.h>
+#include <mxalloc/new.h>
+#include <mxtl/unique_ptr.h>
+
+#include <unittest/unittest.h>
+
+namespace {
+
+constexpr uint32_t kLz4Magic = 0x184D2204;
+constexpr size_t kLz4BlockSize = 65536;
+constexpr size_t kMaxBlocks = 16;
+
+// The decompressed bootfs: a directory holding one file, followed by the
+// file's data, which spans several LZ4 blocks.
+constexpr size_t kFileOffset = 4096;
+constexpr size_t kFileSize = 5 * kLz4BlockSize + 123;
+constexpr size_t kContentSize = kFileOffset + kFileSize;
+
+uint8_t content_byte(size_t i) {
+    if (i < kFileOffset) {
+        return 0;
+    }
+    i -= kFileOffset;
+    return static_cast<uint8_t>((i * 7) ^ (i >> 9));
+}
+
+// Writes the directory over the (zeroed) first kFileOffset bytes of content.
+void fill_directory(uint8_t* content) {
+    const uint32_t record[3] = {5, kFileSize, kFileOffset};
+    memcpy(content, record, sizeof(record));
+    memcpy(content + sizeof(record), "file", 5);
+    // The directory ends with an all-zero record, which is already there.
+}
+
+void fill_content(uint8_t* content) {
+    for (size_t i = 0; i < kContentSize; i++) {
+        content[i] = content_byte(i);
+    }
+    fill_directory(content);
+}
+
+struct Image {
+    mxtl::unique_ptr<uint8_t[]> data;
+    size_t size;
+    bootdata_t* hdr;
+    bootdata_lz4_block_t* index;
+    size_t count;
+};
+
+void put32(uint8_t** p, uint32_t val) {
+    memcpy(*p, &val, sizeof(val));
+    *p += sizeof(val);
+}
+
+// Builds an indexed, compressed bootfs as mkbootfs would. Blocks which do
+// not compress are stored uncompressed.
+bool build_image(Image* image) {
+    BEGIN_HELPER;
+
+    AllocChecker ac;
+    mxtl::unique_ptr<uint8_t[]> content(new (&ac) uint8_t[kContentSize]);
+    ASSERT_TRUE(ac.check(), "");
+    fill_content(content.get());
+
+    size_t max = sizeof(bootdata_t) + 64 + kMaxBlocks * (LZ4_compressBound(kLz4BlockSize) + 16);
+    image->data.reset(new (&ac) uint8_t[max]);
+    ASSERT_TRUE(ac.check(), "");
+    memset(image->data.get(), 0, max);
+
+    uint8_t* frame = image->data.get() + sizeof(bootdata_t);
+    uint8_t* p = frame;
+    put32(&p, kLz4Magic);
+    *p++ = (1 << 6) | (1 << 5) | (1 << 3); // version, independent blocks, content size
+    *p++ = (4 << 4); // 64k blocks
+    uint64_t content_size = kContentSize;
+    memcpy(p, &content_size, sizeof(content_size));
+    p += sizeof(content_size);
+    *p++ = 0; // header checksum (unchecked)
+
+    bootdata_lz4_block_t index[kMaxBlocks];
+    size_t count = 0;
+    for (size_t off = 0; off < kContentSize; off += kLz4BlockSize) {
+        ASSERT_LT(count, kMaxBlocks, "");
+        size_t len = kContentSize - off;
+        if (len > kLz4BlockSize) {
+            len = kLz4BlockSize;
+        }
+        index[count].src_offset = static_cast<uint32_t>(p - frame);
+        index[count].dst_offset = static_cast<uint32_t>(off);
+        count++;
+
+        uint8_t* block = p + sizeof(uint32_t);
+        int r = LZ4_compress_default(reinterpret_cast<const char*>(content.get() + off),
+                                     reinterpret_cast<char*>(block), static_cast<int>(len),
+                                     LZ4_compressBound(kLz4BlockSize));
+        if ((r <= 0) || (static_cast<size_t>(r) >= len)) {
+            memcpy(block, content.get() + off, len);
+            put32(&p, static_cast<uint32_t>(len) | 0x80000000);
+            p += len;
+        } else {
+            put32(&p, static_cast<uint32_t>(r));
+            p += r;
+        }
+    }
+    put32(&p, 0); // end mark
+
+    put32(&p, BOOTDATA_LZ4_INDEX_MAGIC);
+    put32(&p, static_cast<uint32_t>(count * sizeof(bootdata_lz4_block_t) + 2 * sizeof(uint32_t)));
+    image->index = reinterpret_cast<bootdata_lz4_block_t*>(p);
+    memcpy(p, index, count * sizeof(bootdata_lz4_block_t));
+    p += count * sizeof(bootdata_lz4_block_t);
+    put32(&p, static_cast<uint32_t>(count));
+    put32(&p, BOOTDATA_LZ4_INDEX_MAGIC);
+    image->count = count;
+
+    image->hdr = reinterpret_cast<bootdata_t*>(image->data.get());
+    image->hdr->type = BOOTDATA_BOOTFS_BOOT;
+    image->hdr->length = static_cast<uint32_t>(p - frame);
+    image->hdr->extra = static_cast<uint32_t>(sizeof(bootdata_t) + kContentSize);
+    image->hdr->flags = BOOTDATA_BOOTFS_FLAG_COMPRESSED | BOOTDATA_BOOTFS_FLAG_INDEXED;
+    image->size = p - image->data.get();
+
+    END_HELPER;
+}
+
+bool image_vmo(const Image& image, mx_handle_t* out) {
+    BEGIN_HELPER;
+    ASSERT_EQ(mx_vmo_create(image.size, 0, out), MX_OK, "");
+    size_t actual;
+    ASSERT_EQ(mx_vmo_write(*out, image.data.get(), 0, image.size, &actual), MX_OK, "");
+    ASSERT_EQ(actual, image.size, "");
+    END_HELPER;
+}
+
+// Checks [start, end) of the decompressed content in a bootfs VMO.
+bool check_content(mx_handle_t vmo, size_t start, size_t end) {
+    BEGIN_HELPER;
+    AllocChecker ac;
+    mxtl::unique_ptr<uint8_t[]> buf(new (&ac) uint8_t[end - start]);
+    ASSERT_TRUE(ac.check(), "");
+    size_t actual;
+    ASSERT_EQ(mx_vmo_read(vmo, buf.get(), sizeof(bootdata_t) + start, end - start, &actual),
+              MX_OK, "");
+    ASSERT_EQ(actual, end - start, "");
+
+    uint8_t expected[kFileOffset] = {};
+    fill_directory(expected);
+    for (size_t i = start; i < end; i++) {
+        uint8_t want = (i < kFileOffset) ? expected[i] : content_byte(i);
+        if (buf[i - start] != want) {
+            ASSERT_EQ(buf[i - start], want, "decompressed data differs");
+        }
+    }
+    END_HELPER;
+}
+
+// Builds an image, lets |corrupt| damage it, and expects the lazy
+// decompressor (which has no fallback) to reject its index with |expected|.
+bool expect_parse_error(void (*corrupt)(Image* image), mx_status_t expected) {
+    BEGIN_HELPER;
+    Image image;
+    ASSERT_TRUE(build_image(&image), "");
+    corrupt(&image);
+    mx_handle_t vmo;
+    ASSERT_TRUE(image_vmo(image, &vmo), "");
+
+    bootdata_lazy_t* lazy;
+    mx_handle_t out;
+    const char* err;
+    EXPECT_EQ(decompress_bootdata_lazy(mx_vmar_root_self(), vmo, 0, image.size,
+                                       &lazy, &out, &err), expected, err);
+    mx_handle_close(vmo);
+    END_HELPER;
+}
+
+bool parse_index_test() {
+    BEGIN_TEST;
+
+    // A length which runs past the end of the item.
+    EXPECT_TRUE(expect_parse_error([](Image* image) { image->hdr->length += 4096; },
+                                   MX_ERR_INVALID_ARGS), "");
+    // An index which does not start at the start of the image.
+    EXPECT_TRUE(expect_parse_error([](Image* image) { image->index[0].dst_offset = 1; },
+                                   MX_ERR_INVALID_ARGS), "");
+    // Blocks which are out of order.
+    EXPECT_TRUE(expect_parse_error([](Image* image) {
+        bootdata_lz4_block_t tmp = image->index[1];
+        image->index[1] = image->index[2];
+        image->index[2] = tmp;
+    }, MX_ERR_INVALID_ARGS), "");
+    // A gap between blocks.
+    EXPECT_TRUE(expect_parse_error([](Image* image) { image->index[2].src_offset += 1; },
+                                   MX_ERR_INVALID_ARGS), "");
+    // A block past the end of the decompressed image.
+    EXPECT_TRUE(expect_parse_error([](Image* image) {
+        image->index[image->count - 1].dst_offset = kContentSize;
+    }, MX_ERR_INVALID_ARGS), "");
+    // A block which is larger than an LZ4 block may be.
+    EXPECT_TRUE(expect_parse_error([](Image* image) { image->index[1].dst_offset -= 1; },
+                                   MX_ERR_INVALID_ARGS), "");
+    // No index at all.
+    EXPECT_TRUE(expect_parse_error([](Image* image) {
+        image->hdr->flags &= ~BOOTDATA_BOOTFS_FLAG_INDEXED;
+    }, MX_ERR_NOT_SUPPORTED), "");
+
+    END_TEST;
+}
+
+bool parallel_test() {
+    BEGIN_TEST;
+
+    Image image;
+    ASSERT_TRUE(build_image(&image), "");
+    mx_handle_t vmo;
+    ASSERT_TRUE(image_vmo(image, &vmo), "");
+
+    for (uint32_t nthreads = 1; nthreads <= 8; nthreads *= 2) {
+        mx_handle_t out;
+        const char* err;
+        ASSERT_EQ(decompress_bootdata_parallel(mx_vmar_root_self(), vmo, 0, image.size,
+                                               nthreads, &out, &err), MX_OK, err);
+        EXPECT_TRUE(check_content(out, 0, kContentSize), "");
+        mx_handle_close(out);
+    }
+
+    mx_handle_close(vmo);
+    END_TEST;
+}
+
+bool parallel_bad_index_test() {
+    BEGIN_TEST;
+
+    // With a bad index, the blocks are still found by walking the frame.
+    Image image;
+    ASSERT_TRUE(build_image(&image), "");
+    image.index[2].src_offset += 1;
+    mx_handle_t vmo;
+    ASSERT_TRUE(image_vmo(image, &vmo), "");
+
+    mx_handle_t out;
+    const char* err;
+    ASSERT_EQ(decompress_bootdata_parallel(mx_vmar_root_self(), vmo, 0, image.size,
+                                           4, &out, &err), MX_OK, err);
+    EXPECT_TRUE(check_content(out, 0, kContentSize), "");
+    mx_handle_close(out);
+
+    mx_handle_close(vmo);
+    END_TEST;
+}
+
+bool lazy_test() {
+    BEGIN_TEST;
+
+    Image image;
+    ASSERT_TRUE(build_image(&image), "");
+    mx_handle_t vmo;
+    ASSERT_TRUE(image_vmo(image, &vmo), "");
+
+    bootdata_lazy_t* lazy;
+    mx_handle_t out;
+    const char* err;
+    ASSERT_EQ(decompress_bootdata_lazy(mx_vmar_root_self(), vmo, 0, image.size,
+                                       &lazy, &out, &err), MX_OK, err);
+
+    // Only the directory (in the first block) is there to begin with.
+    EXPECT_TRUE(check_content(out, 0, kFileOffset), "");
+    uint8_t buf[16];
+    size_t actual;
+    const size_t fourth_block = sizeof(bootdata_t) + 3 * kLz4BlockSize;
+    ASSERT_EQ(mx_vmo_read(out, buf, fourth_block, sizeof(buf), &actual), MX_OK, "");
+    uint8_t zero[sizeof(buf)] = {};
+    EXPECT_EQ(memcmp(buf, zero, sizeof(buf)), 0, "block decompressed before it was needed");
+
+    // A range straddling the third and fourth blocks.
+    const size_t start = 3 * kLz4BlockSize - 100;
+    ASSERT_EQ(bootdata_lazy_populate(lazy, sizeof(bootdata_t) + start, 200), MX_OK, "");
+    EXPECT_TRUE(check_content(out, start, start + 200), "");
+
+    // And then everything, which also removes the lazy mappings.
+    ASSERT_EQ(bootdata_lazy_populate(lazy, 0, sizeof(bootdata_t) + kContentSize), MX_OK, "");
+    EXPECT_TRUE(check_content(out, 0, kContentSize), "");
+
+    mx_handle_close(out);
+    mx_handle_close(vmo);
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(bootdata_decompress_tests)
+RUN_TEST(parse_index_test)
+RUN_TEST(parallel_test)
+RUN_TEST(parallel_bad_index_test)
+RUN_TEST(lazy_test)
+END_TEST_CASE(bootdata_decompress_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
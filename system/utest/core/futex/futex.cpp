@@ -314,6 +314,16 @@ bool test_futex_requeue_same_addr() {
     END_TEST;
 }
 
+// Test that a changed value is reported before bad arguments.
+bool test_futex_requeue_value_checked_first() {
+    BEGIN_TEST;
+    int futex_value = 100;
+    mx_status_t rc = mx_futex_requeue(&futex_value, 1, futex_value + 1,
+                                            &futex_value, 1);
+    ASSERT_EQ(rc, MX_ERR_BAD_STATE, "requeue should have returned bad state");
+    END_TEST;
+}
+
 // Test that futex_requeue() can wake up some threads and requeue others.
 bool test_futex_requeue() {
     BEGIN_TEST;
@@ -423,6 +433,93 @@ static bool test_futex_thread_suspended() {
     END_TEST;
 }
 
+// Stress waits, wakes and requeues across many futexes at once.  Adjacent
+// futexes hash to different buckets of the kernel's futex table, so this
+// moves waiters between buckets, and times some of them out after they
+// have been moved.
+constexpr int kStressFutexes = 16;
+constexpr int kStressWaiters = 8;
+constexpr int kStressWakers = 4;
+constexpr int kStressIterations = 2000;
+
+struct StressThread {
+    mx_futex_t* futexes;
+    volatile bool* stop;
+    int seed;
+    int errors;
+};
+
+static int stress_waiter(void* arg) {
+    StressThread* t = reinterpret_cast<StressThread*>(arg);
+    for (int n = t->seed; !*t->stop; n++) {
+        mx_status_t rc = mx_futex_wait(&t->futexes[n % kStressFutexes], 0,
+                                       mx_deadline_after(MX_MSEC(1)));
+        if ((rc != MX_OK) && (rc != MX_ERR_TIMED_OUT)) {
+            t->errors++;
+        }
+    }
+    return 0;
+}
+
+static int stress_waker(void* arg) {
+    StressThread* t = reinterpret_cast<StressThread*>(arg);
+    for (int n = 0; n < kStressIterations; n++) {
+        int from = (t->seed + n) % kStressFutexes;
+        int to = (from + 1 + n % (kStressFutexes - 1)) % kStressFutexes;
+        mx_status_t rc;
+        if (n % 2) {
+            rc = mx_futex_wake(&t->futexes[from], 1 + n % 3);
+        } else {
+            rc = mx_futex_requeue(&t->futexes[from], 1, 0, &t->futexes[to], 2);
+        }
+        if (rc != MX_OK) {
+            t->errors++;
+        }
+    }
+    return 0;
+}
+
+static bool test_futex_requeue_stress() {
+    BEGIN_TEST;
+
+    mx_futex_t futexes[kStressFutexes] = {};
+    volatile bool stop = false;
+    StressThread waiters[kStressWaiters];
+    StressThread wakers[kStressWakers];
+    thrd_t waiter_threads[kStressWaiters];
+    thrd_t waker_threads[kStressWakers];
+
+    for (int i = 0; i < kStressWaiters; i++) {
+        waiters[i] = {futexes, &stop, i, 0};
+        ASSERT_EQ(thrd_create_with_name(&waiter_threads[i], stress_waiter, &waiters[i],
+                                        "futex_stress_waiter"), thrd_success, "");
+    }
+    for (int i = 0; i < kStressWakers; i++) {
+        wakers[i] = {futexes, &stop, i * 5, 0};
+        ASSERT_EQ(thrd_create_with_name(&waker_threads[i], stress_waker, &wakers[i],
+                                        "futex_stress_waker"), thrd_success, "");
+    }
+
+    for (int i = 0; i < kStressWakers; i++) {
+        ASSERT_EQ(thrd_join(waker_threads[i], NULL), thrd_success, "");
+        EXPECT_EQ(wakers[i].errors, 0, "wake or requeue failed");
+    }
+    // The waiters time out regularly, so they see this soon.
+    stop = true;
+    for (int i = 0; i < kStressWaiters; i++) {
+        ASSERT_EQ(thrd_join(waiter_threads[i], NULL), thrd_success, "");
+        EXPECT_EQ(waiters[i].errors, 0, "wait failed");
+    }
+
+    // Nobody is left waiting on any of the futexes.
+    for (int i = 0; i < kStressFutexes; i++) {
+        EXPECT_EQ(mx_futex_requeue(&futexes[i], 0, 0, &futexes[(i + 1) % kStressFutexes], 1),
+                  MX_OK, "");
+    }
+
+    END_TEST;
+}
+
 // Test that misaligned pointers cause futex syscalls to return a failure.
 static bool test_futex_misaligned() {
     BEGIN_TEST;
@@ -452,6 +549,188 @@ static bool test_futex_misaligned() {
     END_TEST;
 }
 
+// Test that futex_wait_owner() checks its owner before waiting.
+static bool test_futex_wait_owner_bad_owner() {
+    BEGIN_TEST;
+    int futex_value = 123;
+
+    mx_handle_t self = thrd_get_mx_handle(thrd_current());
+    ASSERT_EQ(mx_futex_wait_owner(&futex_value, futex_value, self, 0),
+              MX_ERR_INVALID_ARGS, "a thread cannot wait for itself");
+    ASSERT_EQ(mx_futex_wait_owner(&futex_value, futex_value, MX_HANDLE_INVALID, 0),
+              MX_ERR_BAD_HANDLE, "");
+
+    mx_handle_t event;
+    ASSERT_EQ(mx_event_create(0, &event), MX_OK, "");
+    ASSERT_EQ(mx_futex_wait_owner(&futex_value, futex_value, event, 0),
+              MX_ERR_WRONG_TYPE, "");
+    ASSERT_EQ(mx_handle_close(event), MX_OK, "");
+
+    END_TEST;
+}
+
+struct OwnerArgs {
+    volatile int* futex;
+    volatile int started;
+    volatile int release;
+};
+
+static int owner_thread(void* arg) {
+    OwnerArgs* args = reinterpret_cast<OwnerArgs*>(arg);
+    args->started = 1;
+    while (args->release == 0) {
+        sched_yield();
+    }
+    *args->futex = 0;
+    mx_futex_wake(const_cast<int*>(args->futex), UINT32_MAX);
+    return 0;
+}
+
+// Test that a futex_wait_owner() waiter is woken like any other, and that
+// its owner may exit without affecting it.
+static bool test_futex_wait_owner_wake() {
+    BEGIN_TEST;
+    volatile int futex_value = 1;
+    OwnerArgs args = {&futex_value, 0, 0};
+    thrd_t owner;
+    ASSERT_EQ(thrd_create_with_name(&owner, owner_thread, &args, "futex owner"),
+              thrd_success, "");
+    while (args.started == 0) {
+        sched_yield();
+    }
+
+    args.release = 1;
+    while (futex_value == 1) {
+        mx_status_t rc = mx_futex_wait_owner(const_cast<int*>(&futex_value), 1,
+                                             thrd_get_mx_handle(owner), MX_TIME_INFINITE);
+        ASSERT_TRUE(rc == MX_OK || rc == MX_ERR_BAD_STATE, "wait failed");
+    }
+    ASSERT_EQ(thrd_join(owner, NULL), thrd_success, "");
+
+    END_TEST;
+}
+
+// Priorities as understood by mx_thread_set_priority(). The owner's priority
+// plus its largest wakeup boost is still below the spinners' priority less
+// their largest penalty, so without inheritance the owner never runs.
+constexpr int kLowPriority = 4;
+constexpr int kMediumPriority = 16;
+constexpr int kHighPriority = 24;
+constexpr int kDefaultPriority = 16;
+
+// How long the spinners keep every CPU busy. Without priority inheritance,
+// this is how long the waiter stays blocked.
+constexpr mx_duration_t kSpinTime = MX_MSEC(1000);
+// How long the owner holds the lock once the waiter is blocked.
+constexpr mx_duration_t kCriticalSection = MX_USEC(100);
+constexpr int kInversionIterations = 5;
+
+// mx_thread_set_priority() is experimental, and is only enabled by
+// thread.set.priority.allowed on the kernel command line.
+static mx_status_t set_priority(int priority) {
+    return mx_thread_set_priority(priority);
+}
+
+struct InversionState {
+    volatile int lock;
+    volatile int owner_started;
+    volatile int waiting;
+    volatile int spinners_started;
+    volatile int stop;
+};
+
+static int inversion_owner(void* arg) {
+    InversionState* st = reinterpret_cast<InversionState*>(arg);
+    set_priority(kLowPriority);
+    st->owner_started = 1;
+    // Hold the lock until the waiter is blocked on it, then for a little
+    // longer.  Once the spinners have started, the owner only gets to run
+    // if it inherits the waiter's priority.
+    while (st->waiting == 0) {
+        sched_yield();
+    }
+    mx_time_t deadline = mx_time_get(MX_CLOCK_MONOTONIC) + kCriticalSection;
+    while (mx_time_get(MX_CLOCK_MONOTONIC) < deadline) {
+    }
+    st->lock = 0;
+    mx_futex_wake(const_cast<int*>(&st->lock), UINT32_MAX);
+    return 0;
+}
+
+static int inversion_spinner(void* arg) {
+    InversionState* st = reinterpret_cast<InversionState*>(arg);
+    set_priority(kMediumPriority);
+    __atomic_fetch_add(&st->spinners_started, 1, __ATOMIC_SEQ_CST);
+    mx_time_t deadline = mx_time_get(MX_CLOCK_MONOTONIC) + kSpinTime;
+    while (st->stop == 0 && mx_time_get(MX_CLOCK_MONOTONIC) < deadline) {
+    }
+    return 0;
+}
+
+// Measure the worst-case time a high priority thread stays blocked on a lock
+// held by a low priority thread, while medium priority threads keep every
+// CPU busy.
+static bool test_futex_priority_inversion() {
+    BEGIN_TEST;
+
+    if (set_priority(kHighPriority) != MX_OK) {
+        unittest_printf("thread priorities cannot be set, skipping\n");
+        END_TEST;
+    }
+
+    uint32_t num_spinners = mx_system_get_num_cpus();
+    thrd_t* spinners = static_cast<thrd_t*>(calloc(num_spinners, sizeof(thrd_t)));
+    ASSERT_NONNULL(spinners, "");
+
+    mx_duration_t worst = 0;
+    for (int i = 0; i < kInversionIterations; i++) {
+        InversionState st = {1, 0, 0, 0, 0};
+
+        thrd_t owner;
+        ASSERT_EQ(thrd_create_with_name(&owner, inversion_owner, &st, "inversion owner"),
+                  thrd_success, "");
+        while (st.owner_started == 0) {
+            mx_nanosleep(mx_deadline_after(MX_USEC(100)));
+        }
+        for (uint32_t j = 0; j < num_spinners; j++) {
+            ASSERT_EQ(thrd_create_with_name(&spinners[j], inversion_spinner, &st,
+                                            "inversion spinner"),
+                      thrd_success, "");
+        }
+        while (st.spinners_started < static_cast<int>(num_spinners)) {
+            mx_nanosleep(mx_deadline_after(MX_USEC(100)));
+        }
+
+        mx_time_t start = mx_time_get(MX_CLOCK_MONOTONIC);
+        st.waiting = 1;
+        while (st.lock == 1) {
+            mx_status_t rc = mx_futex_wait_owner(const_cast<int*>(&st.lock), 1,
+                                                 thrd_get_mx_handle(owner), MX_TIME_INFINITE);
+            ASSERT_TRUE(rc == MX_OK || rc == MX_ERR_BAD_STATE, "wait failed");
+        }
+        mx_duration_t latency = mx_time_get(MX_CLOCK_MONOTONIC) - start;
+        if (latency > worst) {
+            worst = latency;
+        }
+
+        st.stop = 1;
+        for (uint32_t j = 0; j < num_spinners; j++) {
+            ASSERT_EQ(thrd_join(spinners[j], NULL), thrd_success, "");
+        }
+        ASSERT_EQ(thrd_join(owner, NULL), thrd_success, "");
+    }
+    free(spinners);
+    set_priority(kDefaultPriority);
+
+    unittest_printf("worst-case inversion latency: %" PRIu64 " us (%u spinners)\n",
+                    worst / 1000, num_spinners);
+    // Without inheritance, the owner would only have run once the spinners
+    // gave up.
+    EXPECT_LT(worst, kSpinTime / 2, "owner did not inherit the waiter's priority");
+
+    END_TEST;
+}
+
 static void log(const char* str) {
     uint64_t now = mx_time_get(MX_CLOCK_MONOTONIC);
     unittest_printf("[%08" PRIu64 ".%08" PRIu64 "]: %s",
@@ -539,11 +818,16 @@ RUN_TEST(test_futex_unqueued_on_timeout_2);
 RUN_TEST(test_futex_unqueued_on_timeout_3);
 RUN_TEST(test_futex_requeue_value_mismatch);
 RUN_TEST(test_futex_requeue_same_addr);
+RUN_TEST(test_futex_requeue_value_checked_first);
 RUN_TEST(test_futex_requeue);
 RUN_TEST(test_futex_requeue_unqueued_on_timeout);
+RUN_TEST(test_futex_requeue_stress);
 RUN_TEST(test_futex_thread_killed);
 RUN_TEST(test_futex_thread_suspended);
 RUN_TEST(test_futex_misaligned);
+RUN_TEST(test_futex_wait_owner_bad_owner);
+RUN_TEST(test_futex_wait_owner_wake);
+RUN_TEST(test_futex_priority_inversion);
 RUN_TEST(test_event_signaling);
 END_TEST_CASE(futex_tests)
 
@@ -71,6 +71,46 @@ bool task_stats_smoke() {
     END_TEST;
 }
 
+uint64_t histogram_total(const uint64_t* hist, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += hist[i];
+    }
+    return total;
+}
+
+// Tests that MX_INFO_THREAD_SCHED_STATS counts the wakeups of a thread.
+bool thread_sched_stats_smoke() {
+    BEGIN_TEST;
+    mx_info_thread_sched_stats_t before;
+    ASSERT_EQ(mx_object_get_info(mx_thread_self(), MX_INFO_THREAD_SCHED_STATS,
+                                 &before, sizeof(before), nullptr, nullptr),
+              MX_OK, "");
+
+    // Each sleep blocks the thread, and so ends a run slice and is followed
+    // by a wakeup.
+    static const int kSleeps = 4;
+    for (int i = 0; i < kSleeps; i++) {
+        ASSERT_EQ(mx_nanosleep(mx_deadline_after(MX_USEC(100))), MX_OK, "");
+    }
+
+    mx_info_thread_sched_stats_t after;
+    ASSERT_EQ(mx_object_get_info(mx_thread_self(), MX_INFO_THREAD_SCHED_STATS,
+                                 &after, sizeof(after), nullptr, nullptr),
+              MX_OK, "");
+
+    EXPECT_GE(histogram_total(after.wakeup_latency, MX_INFO_SCHED_STATS_TIME_BUCKETS) -
+                  histogram_total(before.wakeup_latency, MX_INFO_SCHED_STATS_TIME_BUCKETS),
+              static_cast<uint64_t>(kSleeps), "");
+    EXPECT_GE(histogram_total(after.run_slice, MX_INFO_SCHED_STATS_TIME_BUCKETS) -
+                  histogram_total(before.run_slice, MX_INFO_SCHED_STATS_TIME_BUCKETS),
+              static_cast<uint64_t>(kSleeps), "");
+    EXPECT_GE(histogram_total(after.run_queue_depth, MX_INFO_SCHED_STATS_DEPTH_BUCKETS) -
+                  histogram_total(before.run_queue_depth, MX_INFO_SCHED_STATS_DEPTH_BUCKETS),
+              static_cast<uint64_t>(kSleeps), "");
+    END_TEST;
+}
+
 // Structs to keep track of VMARs/mappings in the test child process.
 typedef struct test_mapping {
     uintptr_t base;
@@ -953,6 +993,13 @@ RUN_SINGLE_ENTRY_TESTS(MX_INFO_THREAD_STATS, mx_info_thread_stats_t, mx_thread_s
 RUN_TEST((wrong_handle_type_fails<MX_INFO_THREAD_STATS, mx_info_thread_t, get_test_job>));
 RUN_TEST((wrong_handle_type_fails<MX_INFO_THREAD_STATS, mx_info_thread_t, get_test_process>));
 
+RUN_TEST(thread_sched_stats_smoke);
+RUN_SINGLE_ENTRY_TESTS(MX_INFO_THREAD_SCHED_STATS, mx_info_thread_sched_stats_t, mx_thread_self);
+RUN_TEST((wrong_handle_type_fails<MX_INFO_THREAD_SCHED_STATS, mx_info_thread_sched_stats_t,
+                                  get_test_job>));
+RUN_TEST((wrong_handle_type_fails<MX_INFO_THREAD_SCHED_STATS, mx_info_thread_sched_stats_t,
+                                  get_test_process>));
+
 // MX_INFO_PROCESS_THREADS tests.
 // TODO(dbort): Use RUN_MULTI_ENTRY_TESTS instead. |short_buffer_succeeds| and
 // |partially_unmapped_buffer_fails| currently fail because those tests expect
@@ -973,6 +1020,7 @@ RUN_TEST((invalid_handle_fails<MX_INFO_THREAD_EXCEPTION_REPORT, mx_exception_rep
 // RUN_MULTI_ENTRY_TESTS(MX_INFO_RESOURCE_CHILDREN, mx_rrec_t, get_root_resource);
 // RUN_MULTI_ENTRY_TESTS(MX_INFO_RESOURCE_RECORDS, mx_rrec_t, get_root_resource);
 // RUN_MULTI_ENTRY_TESTS(MX_INFO_CPU_STATS, mx_info_cpu_stats_t, get_root_resource);
+// RUN_MULTI_ENTRY_TESTS(MX_INFO_CPU_SCHED_STATS, mx_info_cpu_sched_stats_t, get_root_resource);
 // RUN_SINGLE_ENTRY_TESTS(MX_INFO_KMEM_STATS, mx_info_kmem_stats_t, get_root_resource);
 
 END_TEST_CASE(object_info_tests)
@@ -300,6 +300,69 @@ static bool async_wait_event_test_repeat(void) {
     END_TEST;
 }
 
+static bool async_wait_event_test_edge(void) {
+    BEGIN_TEST;
+
+    mx_handle_t port;
+    ASSERT_EQ(mx_port_create(0, &port), MX_OK, "");
+
+    mx_handle_t ev;
+    ASSERT_EQ(mx_event_create(0u, &ev), MX_OK, "");
+
+    const uint64_t key0 = 2211ull;
+
+    EXPECT_EQ(mx_object_wait_async(ev, port, key0, MX_EVENT_SIGNALED, 0xff),
+              MX_ERR_INVALID_ARGS, "");
+    ASSERT_EQ(mx_object_wait_async(ev, port, key0, MX_EVENT_SIGNALED, MX_WAIT_ASYNC_EDGE),
+              MX_OK, "");
+
+    mx_port_packet_t out = {};
+    EXPECT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_ERR_TIMED_OUT, "");
+
+    // A single packet for the signal being asserted.
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    ASSERT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_OK, "");
+    EXPECT_EQ(out.key, key0, "");
+    EXPECT_EQ(out.type, MX_PKT_TYPE_SIGNAL_EDGE, "");
+    EXPECT_EQ(out.signal.trigger, MX_EVENT_SIGNALED, "");
+    EXPECT_EQ(out.signal.observed, MX_EVENT_SIGNALED | MX_SIGNAL_LAST_HANDLE, "");
+    EXPECT_EQ(out.signal.count, 1u, "");
+
+    // Other signals changing while the trigger stays asserted are not edges.
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_USER_SIGNAL_2), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev, MX_USER_SIGNAL_2, 0u), MX_OK, "");
+    EXPECT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_ERR_TIMED_OUT, "");
+
+    // Edges which happen before the packet is dequeued are coalesced into it.
+    for (int ix = 0; ix != 5; ++ix) {
+        EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+        EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    }
+    ASSERT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_OK, "");
+    EXPECT_EQ(out.type, MX_PKT_TYPE_SIGNAL_EDGE, "");
+    EXPECT_EQ(out.signal.count, 5u, "");
+    EXPECT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_ERR_TIMED_OUT, "");
+
+    // The wait stays armed without being issued again.
+    EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    ASSERT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_OK, "");
+    EXPECT_EQ(out.signal.count, 1u, "");
+
+    // Canceling removes the queued packet and ends the wait.
+    EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(mx_port_cancel(port, ev, key0), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev, MX_EVENT_SIGNALED, 0u), MX_OK, "");
+    EXPECT_EQ(mx_object_signal(ev, 0u, MX_EVENT_SIGNALED), MX_OK, "");
+    EXPECT_EQ(mx_port_wait(port, 0ull, &out, 0u), MX_ERR_TIMED_OUT, "");
+
+    EXPECT_EQ(mx_handle_close(port), MX_OK, "");
+    EXPECT_EQ(mx_handle_close(ev), MX_OK, "");
+
+    END_TEST;
+}
+
 static bool pre_writes_channel_test(uint32_t mode) {
     BEGIN_TEST;
     mx_status_t status;
@@ -549,6 +612,7 @@ RUN_TEST(queue_and_close_test)
 RUN_TEST(async_wait_channel_test)
 RUN_TEST(async_wait_event_test_single)
 RUN_TEST(async_wait_event_test_repeat)
+RUN_TEST(async_wait_event_test_edge)
 RUN_TEST(async_wait_close_order_1)
 RUN_TEST(async_wait_close_order_2)
 RUN_TEST(async_wait_close_order_3)
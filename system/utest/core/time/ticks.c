@@ -25,8 +25,23 @@ static bool elapsed_time_using_ticks(void) {
     END_TEST;
 }
 
+// The vDSO may compute the time itself; it must never be behind the kernel.
+static bool monotonic_time_matches_kernel(void) {
+    BEGIN_TEST;
+
+    for (int i = 0; i < 100; i++) {
+        mx_time_t deadline = mx_deadline_after(MX_USEC(100));
+        ASSERT_EQ(mx_nanosleep(deadline), MX_OK, "");
+        mx_time_t now = mx_time_get(MX_CLOCK_MONOTONIC);
+        ASSERT_GE(now, deadline, "Woke up before the deadline");
+    }
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(ticks_tests)
 RUN_TEST(elapsed_time_using_ticks)
+RUN_TEST(monotonic_time_matches_kernel)
 END_TEST_CASE(ticks_tests)
 
 #ifndef BUILD_COMBINED_TESTS
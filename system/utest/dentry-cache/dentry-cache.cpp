@@ -0,0 +1,86 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <fs/dentry-cache.h>
+#include <fs/vfs.h>
+#include <mxalloc/new.h>
+#include <mxtl/ref_ptr.h>
+
+#include <unittest/unittest.h>
+
+namespace {
+
+class TestVnode : public fs::Vnode {
+public:
+    mx_status_t Open(uint32_t flags) final { return MX_OK; }
+};
+
+mxtl::RefPtr<fs::Vnode> MakeVnode() {
+    AllocChecker ac;
+    mxtl::RefPtr<fs::Vnode> vn = mxtl::AdoptRef(new (&ac) TestVnode());
+    return ac.check() ? vn : nullptr;
+}
+
+bool insert_and_lookup() {
+    BEGIN_TEST;
+
+    fs::DentryCache cache;
+    auto parent = MakeVnode();
+    auto child = MakeVnode();
+    ASSERT_NONNULL(parent.get(), "");
+    ASSERT_NONNULL(child.get(), "");
+
+    cache.Insert(cache.Generation(), parent, "file", 4, child);
+    cache.Insert(cache.Generation(), parent, "missing", 7, nullptr);
+
+    mxtl::RefPtr<fs::Vnode> out;
+    ASSERT_TRUE(cache.Lookup(parent.get(), "file", 4, &out), "");
+    EXPECT_EQ(out.get(), child.get(), "");
+    ASSERT_TRUE(cache.Lookup(parent.get(), "missing", 7, &out), "");
+    EXPECT_NULL(out.get(), "");
+    EXPECT_FALSE(cache.Lookup(parent.get(), "other", 5, &out), "");
+
+    cache.Invalidate(parent.get(), "file", 4);
+    EXPECT_FALSE(cache.Lookup(parent.get(), "file", 4, &out), "");
+
+    END_TEST;
+}
+
+// A lookup which started before a name was invalidated may have seen the
+// old namespace, and must not be cached.
+bool insert_after_invalidate_rejected() {
+    BEGIN_TEST;
+
+    fs::DentryCache cache;
+    auto parent = MakeVnode();
+    ASSERT_NONNULL(parent.get(), "");
+
+    uint64_t generation = cache.Generation();
+    cache.Invalidate(parent.get(), "file", 4);
+    cache.Insert(generation, parent, "file", 4, nullptr);
+
+    mxtl::RefPtr<fs::Vnode> out;
+    EXPECT_FALSE(cache.Lookup(parent.get(), "file", 4, &out), "stale entry was cached");
+
+    // the same goes for a flush
+    generation = cache.Generation();
+    cache.Flush();
+    cache.Insert(generation, parent, "file", 4, nullptr);
+    EXPECT_FALSE(cache.Lookup(parent.get(), "file", 4, &out), "stale entry was cached");
+
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(dentry_cache_tests)
+RUN_TEST(insert_and_lookup)
+RUN_TEST(insert_after_invalidate_rejected)
+END_TEST_CASE(dentry_cache_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
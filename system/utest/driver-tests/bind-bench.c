@@ -0,0 +1,285 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks devmgr's driver bind index against running every driver's binding
+// program, and times both over a boot-sized set of drivers and devices.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ddk/binding.h>
+#include <ddk/driver.h>
+#include <magenta/syscalls.h>
+#include <unittest/unittest.h>
+
+#include "devcoordinator.h"
+
+#define NUM_DRIVERS 400
+#define NUM_DEVICES 4000
+#define MAX_BINDING 8
+#define MAX_PROPS 4
+
+typedef struct {
+    uint32_t protocol_id;
+    uint32_t prop_count;
+    mx_device_prop_t props[MAX_PROPS];
+} test_device_t;
+
+static const uint32_t protocols[] = {
+    MX_PROTOCOL_BLOCK, MX_PROTOCOL_BLOCK_CORE, MX_PROTOCOL_CONSOLE,
+    MX_PROTOCOL_DISPLAY, MX_PROTOCOL_ETHERNET, MX_PROTOCOL_ETHERMAC,
+    MX_PROTOCOL_HIDBUS, MX_PROTOCOL_INPUT, MX_PROTOCOL_PCI, MX_PROTOCOL_USB,
+    MX_PROTOCOL_USB_HCI, MX_PROTOCOL_USB_BUS, MX_PROTOCOL_AUDIO,
+    MX_PROTOCOL_ACPI, MX_PROTOCOL_SDHCI, MX_PROTOCOL_SDMMC,
+};
+#define NUM_PROTOCOLS countof(protocols)
+
+static driver_t drivers[NUM_DRIVERS];
+static mx_bind_inst_t bindings[NUM_DRIVERS][MAX_BINDING];
+static test_device_t devices[NUM_DEVICES];
+
+static list_node_t list_drivers = LIST_INITIAL_VALUE(list_drivers);
+static bind_index_t bind_index;
+
+static uint32_t rand_state = 1;
+
+// xorshift, so that every run sees the same drivers and devices
+static uint32_t next_rand(void) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+static uint32_t rand_protocol(void) {
+    return protocols[next_rand() % NUM_PROTOCOLS];
+}
+
+// Builds binding programs in the shapes real drivers use, which mostly
+// check the protocol first.
+static size_t make_binding(mx_bind_inst_t* bi, size_t n) {
+    static const int kinds[10] = { 0, 0, 0, 1, 1, 2, 2, 3, 3, 4 };
+    uint32_t id = (uint32_t)n;
+    int kind = kinds[n % 10];
+    if ((kind == 4) && ((n / 10) % 2)) {
+        kind = 5;
+    }
+    switch (kind) {
+    case 0: {
+        // a PCI device driver
+        mx_bind_inst_t b[] = {
+            BI_ABORT_IF(NE, BIND_PROTOCOL, MX_PROTOCOL_PCI),
+            BI_ABORT_IF(NE, BIND_PCI_VID, 0x8000 + (id % 16)),
+            BI_MATCH_IF(EQ, BIND_PCI_DID, id),
+            BI_ABORT(),
+        };
+        memcpy(bi, b, sizeof(b));
+        return countof(b);
+    }
+    case 1: {
+        // a USB class driver
+        mx_bind_inst_t b[] = {
+            BI_ABORT_IF(NE, BIND_PROTOCOL, MX_PROTOCOL_USB),
+            BI_ABORT_IF(NE, BIND_USB_CLASS, id % 32),
+            BI_MATCH(),
+        };
+        memcpy(bi, b, sizeof(b));
+        return countof(b);
+    }
+    case 2: {
+        // a driver for either of two protocols
+        mx_bind_inst_t b[] = {
+            BI_MATCH_IF(EQ, BIND_PROTOCOL, rand_protocol()),
+            BI_MATCH_IF(EQ, BIND_PROTOCOL, rand_protocol()),
+            BI_ABORT(),
+        };
+        memcpy(bi, b, sizeof(b));
+        return countof(b);
+    }
+    case 3: {
+        // a driver which is only bound on request
+        mx_bind_inst_t b[] = {
+            BI_ABORT_IF_AUTOBIND,
+            BI_SET(1),
+            BI_ABORT_IF(NE, BIND_PROTOCOL, rand_protocol()),
+            BI_MATCH(),
+        };
+        memcpy(bi, b, sizeof(b));
+        return countof(b);
+    }
+    case 4: {
+        // a program the index can't follow
+        mx_bind_inst_t b[] = {
+            BI_GOTO_IF(EQ, BIND_PROTOCOL, MX_PROTOCOL_ACPI, 1),
+            BI_ABORT(),
+            BI_LABEL(1),
+            BI_MATCH_IF(EQ, BIND_ACPI_HID_0_3, id),
+            BI_ABORT(),
+        };
+        memcpy(bi, b, sizeof(b));
+        return countof(b);
+    }
+    default: {
+        // a program which checks something else first
+        mx_bind_inst_t b[] = {
+            BI_MATCH_IF(EQ, BIND_PCI_CLASS, id % 8),
+            BI_ABORT_IF(NE, BIND_PROTOCOL, rand_protocol()),
+            BI_MATCH(),
+        };
+        memcpy(bi, b, sizeof(b));
+        return countof(b);
+    }
+    }
+}
+
+static void make_device(test_device_t* dev) {
+    dev->protocol_id = rand_protocol();
+    dev->prop_count = 0;
+    switch (next_rand() % 4) {
+    case 0:
+        dev->protocol_id = MX_PROTOCOL_PCI;
+        dev->props[dev->prop_count++] = (mx_device_prop_t){ BIND_PCI_VID, 0, 0x8000 + next_rand() % 16 };
+        dev->props[dev->prop_count++] = (mx_device_prop_t){ BIND_PCI_DID, 0, next_rand() % NUM_DRIVERS };
+        dev->props[dev->prop_count++] = (mx_device_prop_t){ BIND_PCI_CLASS, 0, next_rand() % 8 };
+        break;
+    case 1:
+        dev->protocol_id = MX_PROTOCOL_USB;
+        dev->props[dev->prop_count++] = (mx_device_prop_t){ BIND_USB_CLASS, 0, next_rand() % 32 };
+        break;
+    case 2:
+        // a protocol property overrides the protocol the device was added with
+        dev->props[dev->prop_count++] = (mx_device_prop_t){ BIND_PROTOCOL, 0, rand_protocol() };
+        dev->props[dev->prop_count++] = (mx_device_prop_t){ BIND_ACPI_HID_0_3, 0, next_rand() % NUM_DRIVERS };
+        break;
+    default:
+        break;
+    }
+}
+
+static void setup(void) {
+    static bool done = false;
+    if (done) {
+        return;
+    }
+    done = true;
+
+    dc_bind_index_init(&bind_index);
+    for (size_t n = 0; n < NUM_DRIVERS; n++) {
+        driver_t* drv = &drivers[n];
+        size_t count = make_binding(bindings[n], n);
+        drv->name = "test";
+        drv->libname = "test.so";
+        drv->binding = bindings[n];
+        drv->binding_size = count * sizeof(mx_bind_inst_t);
+        dc_compile_binding(drv);
+
+        // like devmgr, put some drivers ahead of those already added
+        bool at_head = (n % 7) == 0;
+        if (at_head) {
+            list_add_head(&list_drivers, &drv->node);
+        } else {
+            list_add_tail(&list_drivers, &drv->node);
+        }
+        dc_bind_index_add(&bind_index, drv, at_head);
+    }
+    for (size_t n = 0; n < NUM_DEVICES; n++) {
+        make_device(&devices[n]);
+    }
+}
+
+// Runs the binding program of every driver in |list_drivers| against |dev|,
+// and records which ones match, as devmgr used to.
+static size_t linear_matches(test_device_t* dev, bool autobind, driver_t** out) {
+    size_t count = 0;
+    driver_t* drv;
+    list_for_every_entry (&list_drivers, drv, driver_t, node) {
+        if (dc_is_bindable(drv, dev->protocol_id, dev->props, dev->prop_count, autobind)) {
+            out[count++] = drv;
+        }
+    }
+    return count;
+}
+
+// Does the same with only the candidate drivers from the bind index.
+static size_t indexed_matches(test_device_t* dev, bool autobind, driver_t** out) {
+    size_t count = 0;
+    uint32_t protocol_id = dc_device_protocol(dev->protocol_id, dev->props, dev->prop_count);
+    bind_index_cursor_t cursor;
+    for (driver_t* drv = dc_bind_index_first(&bind_index, protocol_id, &cursor);
+         drv != NULL; drv = dc_bind_index_next(&cursor)) {
+        if (dc_is_bindable(drv, dev->protocol_id, dev->props, dev->prop_count, autobind)) {
+            out[count++] = drv;
+        }
+    }
+    return count;
+}
+
+static bool index_matches_linear_scan(void) {
+    BEGIN_TEST;
+    setup();
+
+    static driver_t* expected[NUM_DRIVERS];
+    static driver_t* actual[NUM_DRIVERS];
+    size_t total = 0;
+    for (size_t n = 0; n < NUM_DEVICES; n++) {
+        for (int autobind = 0; autobind < 2; autobind++) {
+            size_t expected_count = linear_matches(&devices[n], autobind, expected);
+            size_t actual_count = indexed_matches(&devices[n], autobind, actual);
+            ASSERT_EQ(actual_count, expected_count, "index found different drivers");
+            for (size_t i = 0; i < expected_count; i++) {
+                ASSERT_EQ(actual[i], expected[i], "index found drivers out of order");
+            }
+            total += expected_count;
+        }
+    }
+    // make sure the programs matched something
+    EXPECT_GT(total, 0u, "");
+
+    END_TEST;
+}
+
+static bool index_benchmark(void) {
+    BEGIN_TEST;
+    setup();
+
+    // binds at boot want every match for multi-bind devices, so find them all
+    static driver_t* matches[NUM_DRIVERS];
+    size_t linear_total = 0;
+    uint64_t start = mx_ticks_get();
+    for (size_t n = 0; n < NUM_DEVICES; n++) {
+        linear_total += linear_matches(&devices[n], true, matches);
+    }
+    uint64_t linear_ticks = mx_ticks_get() - start;
+
+    size_t indexed_total = 0;
+    start = mx_ticks_get();
+    for (size_t n = 0; n < NUM_DEVICES; n++) {
+        indexed_total += indexed_matches(&devices[n], true, matches);
+    }
+    uint64_t indexed_ticks = mx_ticks_get() - start;
+
+    EXPECT_EQ(indexed_total, linear_total, "");
+
+    uint64_t ticks_per_usec = mx_ticks_per_second() / 1000000;
+    if (ticks_per_usec == 0) {
+        ticks_per_usec = 1;
+    }
+    unittest_printf_critical(
+        "\nbinding %d devices against %d drivers: %" PRIu64 " us scanning every driver, "
+        "%" PRIu64 " us with the bind index\n",
+        NUM_DEVICES, NUM_DRIVERS, linear_ticks / ticks_per_usec, indexed_ticks / ticks_per_usec);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(bind_index_tests)
+RUN_TEST(index_matches_linear_scan)
+RUN_TEST(index_benchmark)
+END_TEST_CASE(bind_index_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
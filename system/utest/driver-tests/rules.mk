@@ -18,3 +18,24 @@ MODULE_NAME := driver-tests
 MODULE_LIBS := system/ulib/mxio system/ulib/c system/ulib/magenta system/ulib/unittest
 
 include make/module.mk
+
+MODULE := $(LOCAL_DIR).bind-bench
+
+MODULE_TYPE := usertest
+
+MODULE_USERTEST_GROUP := ddk
+
+# exercises devmgr's bind index directly, so builds its source here
+MODULE_SRCS += \
+    $(LOCAL_DIR)/bind-bench.c \
+    system/core/devmgr/devmgr-binding.c
+
+MODULE_NAME := driver-bind-bench
+
+MODULE_COMPILEFLAGS += -Isystem/core/devmgr
+
+MODULE_HEADER_DEPS := system/ulib/ddk system/ulib/port
+
+MODULE_LIBS := system/ulib/mxio system/ulib/c system/ulib/magenta system/ulib/unittest
+
+include make/module.mk
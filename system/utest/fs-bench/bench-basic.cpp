@@ -191,6 +191,52 @@ bool benchmark_path_walk(void) {
     END_TEST;
 }
 
+// Create, look up, and remove many entries within a single directory, which
+// stresses the cost of name lookup as directories grow.
+template <size_t NumFiles>
+bool benchmark_wide_directory(void) {
+    BEGIN_TEST;
+    printf("\nBenchmarking Wide directory (%lu entries)\n", NumFiles);
+    ASSERT_EQ(mkdir(MOUNT_POINT "/wide", 0666), 0, "");
+    char path[PATH_MAX];
+    uint64_t start;
+
+    start = mx_ticks_get();
+    for (size_t i = 0; i < NumFiles; i++) {
+        snprintf(path, sizeof(path), MOUNT_POINT "/wide/file-%lu", i);
+        int fd = open(path, O_CREAT | O_EXCL | O_RDWR, 0644);
+        ASSERT_GT(fd, 0, "Could not create file");
+        ASSERT_EQ(close(fd), 0, "");
+    }
+    time_end("create", start);
+
+    start = mx_ticks_get();
+    for (size_t i = 0; i < NumFiles; i++) {
+        struct stat buf;
+        snprintf(path, sizeof(path), MOUNT_POINT "/wide/file-%lu", i);
+        ASSERT_EQ(stat(path, &buf), 0, "Could not stat file");
+    }
+    time_end("stat", start);
+
+    start = mx_ticks_get();
+    for (size_t i = 0; i < NumFiles; i++) {
+        struct stat buf;
+        snprintf(path, sizeof(path), MOUNT_POINT "/wide/missing-%lu", i);
+        ASSERT_EQ(stat(path, &buf), -1, "Unexpectedly found file");
+    }
+    time_end("stat (missing)", start);
+
+    start = mx_ticks_get();
+    for (size_t i = 0; i < NumFiles; i++) {
+        snprintf(path, sizeof(path), MOUNT_POINT "/wide/file-%lu", i);
+        ASSERT_EQ(unlink(path), 0, "Could not unlink file");
+    }
+    time_end("unlink", start);
+
+    ASSERT_EQ(rmdir(MOUNT_POINT "/wide"), 0, "");
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(basic_benchmarks)
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 1024>))
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 2048>))
@@ -201,4 +247,6 @@ RUN_TEST_PERFORMANCE((benchmark_path_walk<125>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<250>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<500>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<1000>))
+RUN_TEST_PERFORMANCE((benchmark_wide_directory<1000>))
+RUN_TEST_PERFORMANCE((benchmark_wide_directory<10000>))
 END_TEST_CASE(basic_benchmarks)
@@ -0,0 +1,223 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include <magenta/syscalls.h>
+#include <mxalloc/new.h>
+#include <mxtl/unique_ptr.h>
+#include <unittest/unittest.h>
+
+#define MOUNT_POINT "/benchmark"
+
+namespace {
+
+constexpr size_t kFileSize = (1 << 20);
+constexpr size_t kChunkSize = (8 << 10);
+constexpr int kReadPasses = 16;
+constexpr int kMaxThreads = 8;
+
+struct Worker {
+    int fd;
+    int id;
+    bool ok;
+};
+
+// Repeatedly reads the whole of a file which belongs to this worker alone.
+int read_worker(void* arg) {
+    Worker* worker = static_cast<Worker*>(arg);
+    uint8_t buf[kChunkSize];
+    worker->ok = true;
+    for (int pass = 0; pass < kReadPasses; pass++) {
+        for (size_t off = 0; off < kFileSize; off += kChunkSize) {
+            if (pread(worker->fd, buf, kChunkSize, off) != kChunkSize) {
+                worker->ok = false;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Measures read throughput when |NumThreads| clients each read an
+// independent file. On a filesystem which serves independent vnodes
+// concurrently, the aggregate throughput should scale with the thread
+// count (up to the number of server threads and CPUs).
+template <int NumThreads>
+bool benchmark_concurrent_read(void) {
+    static_assert(NumThreads <= kMaxThreads, "Too many threads");
+    BEGIN_TEST;
+
+    AllocChecker ac;
+    mxtl::unique_ptr<uint8_t[]> data(new (&ac) uint8_t[kFileSize]);
+    ASSERT_EQ(ac.check(), true, "");
+    memset(data.get(), 0xee, kFileSize);
+
+    Worker workers[NumThreads];
+    for (int i = 0; i < NumThreads; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), MOUNT_POINT "/concurrent-%d", i);
+        workers[i].fd = open(path, O_CREAT | O_RDWR, 0644);
+        ASSERT_GT(workers[i].fd, 0, "Cannot create file (FS benchmarks assume mounted FS "
+                  "exists at '/benchmark')");
+        ASSERT_EQ(write(workers[i].fd, data.get(), kFileSize), kFileSize, "");
+    }
+
+    uint64_t start = mx_ticks_get();
+    thrd_t threads[NumThreads];
+    for (int i = 0; i < NumThreads; i++) {
+        ASSERT_EQ(thrd_create(&threads[i], read_worker, &workers[i]), thrd_success, "");
+    }
+    for (int i = 0; i < NumThreads; i++) {
+        ASSERT_EQ(thrd_join(threads[i], nullptr), thrd_success, "");
+    }
+    uint64_t ticks = mx_ticks_get() - start;
+
+    uint64_t ticks_per_msec = mx_ticks_per_second() / 1000;
+    uint64_t msec = ticks / ticks_per_msec;
+    uint64_t total_mb = (kFileSize * kReadPasses * NumThreads) >> 20;
+    printf("\nBenchmark concurrent read (%d threads): [%10lu] msec, [%6lu] MB/s\n",
+           NumThreads, msec, msec ? (total_mb * 1000) / msec : 0);
+
+    for (int i = 0; i < NumThreads; i++) {
+        EXPECT_TRUE(workers[i].ok, "Worker failed to read");
+        ASSERT_EQ(close(workers[i].fd), 0, "");
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), MOUNT_POINT "/concurrent-%d", i);
+        ASSERT_EQ(unlink(path), 0, "");
+    }
+
+    END_TEST;
+}
+
+constexpr int kCreatesPerPass = 64;
+
+// Rewrites a file which belongs to this worker alone, truncating it first so
+// that every pass frees and allocates blocks.
+int write_worker(void* arg) {
+    Worker* worker = static_cast<Worker*>(arg);
+    uint8_t buf[kChunkSize];
+    memset(buf, 0xab, sizeof(buf));
+    worker->ok = true;
+    for (int pass = 0; pass < kReadPasses; pass++) {
+        if (ftruncate(worker->fd, 0) != 0) {
+            worker->ok = false;
+            return -1;
+        }
+        for (size_t off = 0; off < kFileSize; off += kChunkSize) {
+            if (pwrite(worker->fd, buf, kChunkSize, off) != kChunkSize) {
+                worker->ok = false;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Creates, writes and unlinks small files in the benchmark directory.
+int create_worker(void* arg) {
+    Worker* worker = static_cast<Worker*>(arg);
+    uint8_t buf[kChunkSize];
+    memset(buf, 0xcd, sizeof(buf));
+    worker->ok = true;
+    for (int pass = 0; pass < kReadPasses; pass++) {
+        for (int i = 0; i < kCreatesPerPass; i++) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), MOUNT_POINT "/create-%d-%d", worker->id, i);
+            int fd = open(path, O_CREAT | O_RDWR | O_EXCL, 0644);
+            if (fd < 0) {
+                worker->ok = false;
+                return -1;
+            }
+            bool written = write(fd, buf, sizeof(buf)) == sizeof(buf);
+            if (close(fd) != 0 || unlink(path) != 0 || !written) {
+                worker->ok = false;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Measures a mix of clients: one third read independent files, one third
+// rewrite independent files, and one third create and unlink files. Reads
+// and writes of distinct files may be served concurrently; creates and
+// unlinks modify the namespace, and are serialized against everything else.
+template <int NumThreads>
+bool benchmark_concurrent_mixed(void) {
+    static_assert(NumThreads <= kMaxThreads, "Too many threads");
+    static_assert(NumThreads % 3 == 0, "Threads are split evenly between roles");
+    BEGIN_TEST;
+
+    AllocChecker ac;
+    mxtl::unique_ptr<uint8_t[]> data(new (&ac) uint8_t[kFileSize]);
+    ASSERT_EQ(ac.check(), true, "");
+    memset(data.get(), 0xee, kFileSize);
+
+    thrd_start_t roles[] = {read_worker, write_worker, create_worker};
+    Worker workers[NumThreads];
+    for (int i = 0; i < NumThreads; i++) {
+        workers[i].id = i;
+        workers[i].fd = -1;
+        if (roles[i % 3] == create_worker) {
+            continue;
+        }
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), MOUNT_POINT "/concurrent-%d", i);
+        workers[i].fd = open(path, O_CREAT | O_RDWR, 0644);
+        ASSERT_GT(workers[i].fd, 0, "Cannot create file (FS benchmarks assume mounted FS "
+                  "exists at '/benchmark')");
+        ASSERT_EQ(write(workers[i].fd, data.get(), kFileSize), kFileSize, "");
+    }
+
+    uint64_t start = mx_ticks_get();
+    thrd_t threads[NumThreads];
+    for (int i = 0; i < NumThreads; i++) {
+        ASSERT_EQ(thrd_create(&threads[i], roles[i % 3], &workers[i]), thrd_success, "");
+    }
+    for (int i = 0; i < NumThreads; i++) {
+        ASSERT_EQ(thrd_join(threads[i], nullptr), thrd_success, "");
+    }
+    uint64_t ticks = mx_ticks_get() - start;
+
+    uint64_t ticks_per_msec = mx_ticks_per_second() / 1000;
+    uint64_t msec = ticks / ticks_per_msec;
+    uint64_t per_role = NumThreads / 3;
+    // Bytes read plus bytes written.
+    uint64_t total_mb = (2 * kFileSize * kReadPasses * per_role) >> 20;
+    uint64_t total_creates = kCreatesPerPass * kReadPasses * per_role;
+    printf("\nBenchmark concurrent mixed (%d threads): [%10lu] msec, [%6lu] MB/s, "
+           "[%6lu] creates/s\n", NumThreads, msec, msec ? (total_mb * 1000) / msec : 0,
+           msec ? (total_creates * 1000) / msec : 0);
+
+    for (int i = 0; i < NumThreads; i++) {
+        EXPECT_TRUE(workers[i].ok, "Worker failed");
+        if (workers[i].fd < 0) {
+            continue;
+        }
+        ASSERT_EQ(close(workers[i].fd), 0, "");
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), MOUNT_POINT "/concurrent-%d", i);
+        ASSERT_EQ(unlink(path), 0, "");
+    }
+
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(concurrent_benchmarks)
+RUN_TEST_PERFORMANCE((benchmark_concurrent_read<1>))
+RUN_TEST_PERFORMANCE((benchmark_concurrent_read<2>))
+RUN_TEST_PERFORMANCE((benchmark_concurrent_read<4>))
+RUN_TEST_PERFORMANCE((benchmark_concurrent_read<8>))
+RUN_TEST_PERFORMANCE((benchmark_concurrent_mixed<3>))
+RUN_TEST_PERFORMANCE((benchmark_concurrent_mixed<6>))
+END_TEST_CASE(concurrent_benchmarks)
@@ -5,6 +5,7 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include <hypervisor/block.h>
@@ -464,6 +465,119 @@ static bool file_block_device_flush_data(void) {
     END_TEST;
 }
 
+#define BATCH_SIZE  3u
+
+typedef struct virtio_batch_mem {
+    struct vring_desc desc[BATCH_SIZE * 3];
+    uint8_t avail_buf[sizeof(struct vring_avail) + sizeof(uint16_t) * BATCH_SIZE * 3];
+    uint8_t used_buf[sizeof(struct vring_used) +
+                     sizeof(struct vring_used_elem) * BATCH_SIZE * 3];
+    virtio_blk_req_t req[BATCH_SIZE];
+    uint8_t data[BATCH_SIZE][SECTOR_SIZE];
+    uint8_t status[BATCH_SIZE];
+} virtio_batch_mem_t;
+
+typedef struct notify_state {
+    mtx_t mutex;
+    cnd_t cnd;
+    uint32_t count;
+} notify_state_t;
+
+static mx_status_t count_notify(void* ctx) {
+    notify_state_t* state = ctx;
+    mtx_lock(&state->mutex);
+    state->count++;
+    cnd_signal(&state->cnd);
+    mtx_unlock(&state->mutex);
+    return MX_OK;
+}
+
+static bool block_async_write_batch(void) {
+    BEGIN_TEST;
+
+    virtio_batch_mem_t mem;
+    memset(&mem, 0, sizeof(mem));
+    virtio_queue_t queue = {
+        .size = BATCH_SIZE * 3,
+        .index = 0,
+        .desc = mem.desc,
+        .avail = (struct vring_avail*)mem.avail_buf,
+        .used_event = NULL,
+        .used = (struct vring_used*)mem.used_buf,
+        .avail_event = NULL,
+    };
+
+    // Write consecutive sectors, so that the requests are joined.
+    for (uint16_t i = 0; i < BATCH_SIZE; i++) {
+        mem.req[i].type = VIRTIO_BLK_T_OUT;
+        mem.req[i].sector = i;
+        memset(mem.data[i], i + 1, SECTOR_SIZE);
+        mem.status[i] = UINT8_MAX;
+
+        struct vring_desc* desc = &mem.desc[i * 3];
+        desc[0] = (struct vring_desc){
+            .addr = offsetof(virtio_batch_mem_t, req) + i * sizeof(virtio_blk_req_t),
+            .len = sizeof(virtio_blk_req_t),
+            .flags = VRING_DESC_F_NEXT,
+            .next = i * 3 + 1,
+        };
+        desc[1] = (struct vring_desc){
+            .addr = offsetof(virtio_batch_mem_t, data) + i * SECTOR_SIZE,
+            .len = SECTOR_SIZE,
+            .flags = VRING_DESC_F_NEXT,
+            .next = i * 3 + 2,
+        };
+        desc[2] = (struct vring_desc){
+            .addr = offsetof(virtio_batch_mem_t, status) + i,
+            .len = sizeof(uint8_t),
+        };
+        queue.avail->ring[i] = i * 3;
+    }
+    queue.avail->idx = BATCH_SIZE;
+
+    char path[] = "/tmp/block-async-write-batch.XXXXXX";
+    int fd = mkblk(path);
+    ASSERT_GE(fd, 0, "");
+
+    notify_state_t state = { .count = 0 };
+    ASSERT_EQ(mtx_init(&state.mutex, mtx_plain), thrd_success, "");
+    ASSERT_EQ(cnd_init(&state.cnd), thrd_success, "");
+
+    block_async_t* async;
+    ASSERT_EQ(block_async_create(&queue, &mem, sizeof(mem), fd, MX_HANDLE_INVALID,
+                                 count_notify, &state, &async), MX_OK, "");
+    block_async_kick(async);
+
+    mtx_lock(&state.mutex);
+    while (state.count == 0)
+        cnd_wait(&state.cnd, &state.mutex);
+    mtx_unlock(&state.mutex);
+    block_async_destroy(async);
+
+    // All requests are returned to the guest with a single notification.
+    ASSERT_EQ(state.count, 1u, "");
+    ASSERT_EQ(queue.used->idx, BATCH_SIZE, "");
+    for (uint16_t i = 0; i < BATCH_SIZE; i++) {
+        ASSERT_EQ(queue.used->ring[i].id, i * 3u, "");
+        ASSERT_EQ(queue.used->ring[i].len, SECTOR_SIZE, "");
+        ASSERT_EQ(mem.status[i], VIRTIO_BLK_S_OK, "");
+    }
+
+    uint8_t actual[SECTOR_SIZE * BATCH_SIZE];
+    ASSERT_EQ(pread(fd, actual, sizeof(actual), 0), (ssize_t)sizeof(actual), "");
+    for (uint16_t i = 0; i < BATCH_SIZE; i++) {
+        uint8_t expected[SECTOR_SIZE];
+        memset(expected, i + 1, SECTOR_SIZE);
+        ASSERT_EQ(memcmp(actual + i * SECTOR_SIZE, expected, SECTOR_SIZE), 0, "");
+    }
+
+    cnd_destroy(&state.cnd);
+    mtx_destroy(&state.mutex);
+    close(fd);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(block)
 RUN_TEST(null_block_device_empty_queue)
 RUN_TEST(null_block_device_bad_ring)
@@ -482,4 +596,5 @@ RUN_TEST(file_block_device_write)
 RUN_TEST(file_block_device_write_chain)
 RUN_TEST(file_block_device_flush)
 RUN_TEST(file_block_device_flush_data)
+RUN_TEST(block_async_write_batch)
 END_TEST_CASE(block)
@@ -16,8 +16,14 @@
 #include <magenta/syscalls.h>
 #include <magenta/syscalls/object.h>
 
+#include <mxio/loader-service.h>
 #include <mxio/util.h>
 
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
 #include <unittest/unittest.h>
 
 // argv[0]
@@ -33,6 +39,9 @@ static const char dynld_path[] = LIBPREFIX "ld.so.1";
 
 static const char test_inferior_child_name[] = "inferior";
 
+// Passed to a child copy of this program to make it exit right away.
+static const char exit_immediately_arg[] = "--exit-immediately";
+
 static bool launchpad_test(void)
 {
     BEGIN_TEST;
@@ -78,12 +87,112 @@ static bool launchpad_test(void)
     END_TEST;
 }
 
+// Loads every library afresh from the filesystem, as loader services did
+// before they kept a library cache.
+static mx_status_t uncached_load_object(void* arg, uint32_t load_op,
+                                        mx_handle_t request_handle,
+                                        const char* fn, mx_handle_t* out)
+{
+    if (request_handle != MX_HANDLE_INVALID)
+        mx_handle_close(request_handle);
+
+    switch (load_op) {
+    case LOADER_SVC_OP_LOAD_OBJECT: {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), LIBPREFIX "%s", fn);
+        return launchpad_vmo_from_file(path, out);
+    }
+    case LOADER_SVC_OP_CONFIG:
+    case LOADER_SVC_OP_DEBUG_PRINT:
+        // LIBPREFIX already picks the library variant
+        return MX_OK;
+    default:
+        return MX_ERR_NOT_SUPPORTED;
+    }
+}
+
+// Launches a copy of this program that exits right away, and waits for
+// it.  If |loader_svc| is valid, the new process loads its libraries
+// through it rather than through the system loader service.
+static mx_status_t launch_and_wait(mx_handle_t loader_svc)
+{
+    launchpad_t* lp;
+    launchpad_create(0, test_inferior_child_name, &lp);
+    launchpad_clone(lp, LP_CLONE_MXIO_STDIO | LP_CLONE_DEFAULT_JOB);
+    if (loader_svc != MX_HANDLE_INVALID) {
+        mx_handle_t svc;
+        if (mx_handle_duplicate(loader_svc, MX_RIGHT_SAME_RIGHTS, &svc) == MX_OK) {
+            mx_handle_t old = launchpad_use_loader_service(lp, svc);
+            if (old != MX_HANDLE_INVALID)
+                mx_handle_close(old);
+        }
+    }
+    const char* args[] = { program_path, exit_immediately_arg };
+    launchpad_set_args(lp, countof(args), args);
+    launchpad_load_from_file(lp, program_path);
+
+    mx_handle_t proc;
+    const char* errmsg;
+    mx_status_t status = launchpad_go(lp, &proc, &errmsg);
+    if (status != MX_OK) {
+        unittest_printf("launchpad_go failed: %s\n", errmsg);
+        return status;
+    }
+    status = mx_object_wait_one(proc, MX_PROCESS_TERMINATED,
+                                MX_TIME_INFINITE, NULL);
+    mx_handle_close(proc);
+    return status;
+}
+
+// Launch the same binary many times.  Every launch after the first asks
+// the loader service for libraries it has already handed out, which
+// should be served from its library cache.  The same launches through a
+// loader service without a cache are the baseline.
+static bool launch_latency_test(void)
+{
+    BEGIN_TEST;
+
+    const int kIterations = 100;
+
+    mx_handle_t uncached_svc;
+    ASSERT_EQ(mxio_loader_service(uncached_load_object, NULL, &uncached_svc),
+              MX_OK, "uncached loader service");
+
+    mx_time_t start = mx_time_get(MX_CLOCK_MONOTONIC);
+    for (int i = 0; i < kIterations; ++i) {
+        ASSERT_EQ(launch_and_wait(uncached_svc), MX_OK, "uncached launch");
+    }
+    mx_time_t uncached = (mx_time_get(MX_CLOCK_MONOTONIC) - start) / kIterations;
+    mx_handle_close(uncached_svc);
+
+    start = mx_time_get(MX_CLOCK_MONOTONIC);
+    ASSERT_EQ(launch_and_wait(MX_HANDLE_INVALID), MX_OK, "first launch");
+    mx_time_t first = mx_time_get(MX_CLOCK_MONOTONIC) - start;
+
+    start = mx_time_get(MX_CLOCK_MONOTONIC);
+    for (int i = 0; i < kIterations; ++i) {
+        ASSERT_EQ(launch_and_wait(MX_HANDLE_INVALID), MX_OK, "repeat launch");
+    }
+    mx_time_t repeat = (mx_time_get(MX_CLOCK_MONOTONIC) - start) / kIterations;
+
+    unittest_printf("launch latency: uncached average %" PRIu64 " us,"
+                    " cached first %" PRIu64 " us,"
+                    " cached average %" PRIu64 " us over %d launches\n",
+                    uncached / 1000, first / 1000, repeat / 1000, kIterations);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(launchpad_tests)
 RUN_TEST(launchpad_test);
+RUN_TEST_PERFORMANCE(launch_latency_test);
 END_TEST_CASE(launchpad_tests)
 
 int main(int argc, char **argv)
 {
+    if (argc > 1 && !strcmp(argv[1], exit_immediately_arg))
+        return 0;
+
     program_path = argv[0];
 
     bool success = unittest_run_all_tests(argc, argv);
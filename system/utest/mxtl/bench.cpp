@@ -0,0 +1,119 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <magenta/compiler.h>
+#include <magenta/syscalls.h>
+#include <mxalloc/new.h>
+#include <mxtl/intrusive_hash_table.h>
+#include <mxtl/intrusive_resizable_hash_table.h>
+#include <mxtl/intrusive_single_list.h>
+#include <mxtl/unique_ptr.h>
+
+#include "bench.h"
+
+namespace {
+
+// An element which can be in both kinds of table at once, keyed like a minfs
+// vnode by a dense inode number.
+struct BenchObj : public mxtl::SinglyLinkedListable<BenchObj*>,
+                  public mxtl::ResizableHashTableable<BenchObj*> {
+    uint32_t GetKey() const { return key_; }
+    static size_t GetHash(uint32_t key) { return key; }
+
+    uint32_t key_ = 0;
+};
+
+using FixedTable = mxtl::HashTable<uint32_t, BenchObj*>;
+using ResizableTable = mxtl::ResizableHashTable<uint32_t, BenchObj*>;
+
+// spin the cpu a bit to make sure the frequency is cranked to the top
+void spin(mx_time_t nanosecs) {
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+
+    while (mx_time_get(MX_CLOCK_MONOTONIC) - t < nanosecs)
+        ;
+}
+
+template <typename T>
+inline mx_time_t time_it(T func) {
+    spin(MX_MSEC(10));
+
+    mx_time_t t = mx_time_get(MX_CLOCK_MONOTONIC);
+    func();
+    return mx_time_get(MX_CLOCK_MONOTONIC) - t;
+}
+
+void report(const char* table, const char* op, mx_time_t t, size_t count) {
+    printf("\t%-20s %-12s %10" PRIu64 " nsecs, %6" PRIu64 " nsecs/op\n",
+           table, op, t, t / count);
+}
+
+template <typename TableType>
+void bench_table(const char* name, BenchObj* objs, size_t count) {
+    TableType table;
+    mx_time_t t;
+
+    t = time_it([&]() {
+        for (size_t i = 0; i < count; i++) {
+            table.insert(&objs[i]);
+        }
+    });
+    report(name, "insert", t, count);
+
+    // Look up every key present, then as many which are not.
+    size_t found = 0;
+    t = time_it([&]() {
+        for (uint32_t i = 0; i < count; i++) {
+            found += table.find(i).IsValid();
+        }
+    });
+    report(name, "lookup hit", t, count);
+
+    t = time_it([&]() {
+        for (uint32_t i = 0; i < count; i++) {
+            found += table.find(static_cast<uint32_t>(count + i)).IsValid();
+        }
+    });
+    report(name, "lookup miss", t, count);
+
+    t = time_it([&]() {
+        for (size_t i = 0; i < count; i++) {
+            table.erase(objs[i]);
+        }
+    });
+    report(name, "erase", t, count);
+
+    if (found != count) {
+        printf("\tfound %zu of %zu elements!\n", found, count);
+    }
+}
+
+} // namespace
+
+int mxtl_run_benchmark() {
+    static const size_t kCounts[] = { 100, 10000, 100000 };
+
+    printf("starting hash table benchmark\n");
+
+    for (size_t count : kCounts) {
+        AllocChecker ac;
+        mxtl::unique_ptr<BenchObj[]> objs(new (&ac) BenchObj[count]);
+        if (!ac.check()) {
+            printf("failed to allocate %zu elements\n", count);
+            return -1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            objs[i].key_ = static_cast<uint32_t>(i);
+        }
+
+        printf("%zu elements:\n", count);
+        bench_table<FixedTable>("HashTable", objs.get(), count);
+        bench_table<ResizableTable>("ResizableHashTable", objs.get(), count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <unittest/unittest.h>
+#include <mxtl/intrusive_resizable_hash_table.h>
+#include <mxtl/ref_counted.h>
+#include <mxtl/ref_ptr.h>
+#include <mxtl/unique_ptr.h>
+
+namespace mxtl {
+namespace tests {
+namespace {
+
+// Keys hash to themselves, so that dense keys exercise every bucket the table
+// splits into.
+using KeyType = uint32_t;
+
+template <typename PtrType>
+struct TestObj : public ResizableHashTableable<PtrType> {
+    explicit TestObj(KeyType key) : key_(key) { ++live_obj_count_; }
+    ~TestObj() { --live_obj_count_; }
+
+    KeyType GetKey() const { return key_; }
+    static size_t GetHash(KeyType key) { return key; }
+
+    KeyType key_;
+    static size_t live_obj_count_;
+};
+
+template <typename PtrType>
+size_t TestObj<PtrType>::live_obj_count_ = 0;
+
+// Traits to create elements for each of the supported pointer types.
+struct UnmanagedTraits {
+    struct ObjType;
+    using PtrType = ObjType*;
+    struct ObjType : public TestObj<PtrType> {
+        explicit ObjType(KeyType key) : TestObj<PtrType>(key) { }
+    };
+    static PtrType Create(KeyType key) {
+        AllocChecker ac;
+        PtrType ptr = new (&ac) ObjType(key);
+        return ac.check() ? ptr : nullptr;
+    }
+    static void Destroy(PtrType&& ptr) { delete ptr; }
+    static size_t live_obj_count() { return ObjType::live_obj_count_; }
+};
+
+struct UniquePtrTraits {
+    struct ObjType;
+    using PtrType = unique_ptr<ObjType>;
+    struct ObjType : public TestObj<PtrType> {
+        explicit ObjType(KeyType key) : TestObj<PtrType>(key) { }
+    };
+    static PtrType Create(KeyType key) {
+        AllocChecker ac;
+        PtrType ptr(new (&ac) ObjType(key));
+        return ac.check() ? mxtl::move(ptr) : nullptr;
+    }
+    static void Destroy(PtrType&& ptr) { ptr.reset(); }
+    static size_t live_obj_count() { return ObjType::live_obj_count_; }
+};
+
+struct RefPtrTraits {
+    struct ObjType;
+    using PtrType = RefPtr<ObjType>;
+    struct ObjType : public TestObj<PtrType>, public RefCounted<ObjType> {
+        explicit ObjType(KeyType key) : TestObj<PtrType>(key) { }
+    };
+    static PtrType Create(KeyType key) {
+        AllocChecker ac;
+        PtrType ptr = AdoptRef(new (&ac) ObjType(key));
+        return ac.check() ? mxtl::move(ptr) : nullptr;
+    }
+    static void Destroy(PtrType&& ptr) { ptr.reset(); }
+    static size_t live_obj_count() { return ObjType::live_obj_count_; }
+};
+
+template <typename Traits>
+using TableType = ResizableHashTable<KeyType, typename Traits::PtrType>;
+
+// Removes every element from the table, destroying unmanaged ones.
+template <typename Traits>
+void DrainTable(TableType<Traits>* table) {
+    while (!table->is_empty()) {
+        Traits::Destroy(table->erase(table->begin()));
+    }
+}
+
+template <typename Traits, size_t kCount>
+bool insert_find_erase_test() {
+    BEGIN_TEST;
+
+    TableType<Traits> table;
+    EXPECT_TRUE(table.is_empty(), "");
+    EXPECT_EQ(TableType<Traits>::kMinBuckets, table.bucket_count(), "");
+
+    for (KeyType i = 0; i < kCount; ++i) {
+        auto ptr = Traits::Create(i);
+        ASSERT_NONNULL(ptr, "");
+        table.insert(mxtl::move(ptr));
+        EXPECT_EQ(i + 1u, table.size(), "");
+        // The average bucket holds at most one element.
+        EXPECT_LE(table.size(), table.bucket_count(), "");
+    }
+
+    for (KeyType i = 0; i < kCount; ++i) {
+        auto iter = table.find(i);
+        ASSERT_TRUE(iter.IsValid(), "");
+        EXPECT_EQ(i, iter->GetKey(), "");
+        EXPECT_TRUE(iter->InContainer(), "");
+    }
+    EXPECT_FALSE(table.find(static_cast<KeyType>(kCount)).IsValid(), "");
+
+    // Erase every other element by key, then the rest by reference.
+    for (KeyType i = 0; i < kCount; i += 2) {
+        auto ptr = table.erase(i);
+        ASSERT_NONNULL(ptr, "");
+        EXPECT_EQ(i, ptr->GetKey(), "");
+        EXPECT_FALSE(ptr->InContainer(), "");
+        Traits::Destroy(mxtl::move(ptr));
+    }
+    EXPECT_NULL(table.erase(static_cast<KeyType>(0)), "");
+    EXPECT_EQ(kCount / 2, table.size(), "");
+
+    for (KeyType i = 1; i < kCount; i += 2) {
+        EXPECT_FALSE(table.find(i - 1).IsValid(), "");
+        auto iter = table.find(i);
+        ASSERT_TRUE(iter.IsValid(), "");
+        Traits::Destroy(table.erase(*iter));
+    }
+
+    EXPECT_TRUE(table.is_empty(), "");
+    EXPECT_EQ(TableType<Traits>::kMinBuckets, table.bucket_count(), "");
+    EXPECT_EQ(0u, Traits::live_obj_count(), "");
+
+    END_TEST;
+}
+
+template <typename Traits, size_t kCount>
+bool iterate_test() {
+    BEGIN_TEST;
+
+    TableType<Traits> table;
+    EXPECT_FALSE(table.begin().IsValid(), "");
+    EXPECT_TRUE(table.begin() == table.end(), "");
+
+    for (KeyType i = 0; i < kCount; ++i) {
+        auto ptr = Traits::Create(i);
+        ASSERT_NONNULL(ptr, "");
+        table.insert(mxtl::move(ptr));
+    }
+
+    // Every element is visited exactly once.
+    bool seen[kCount] = { };
+    size_t visited = 0;
+    for (const auto& obj : table) {
+        ASSERT_LT(obj.GetKey(), kCount, "");
+        EXPECT_FALSE(seen[obj.GetKey()], "");
+        seen[obj.GetKey()] = true;
+        ++visited;
+    }
+    EXPECT_EQ(kCount, visited, "");
+
+    auto iter = table.find_if([](const typename Traits::ObjType& obj) {
+        return obj.GetKey() == kCount / 2;
+    });
+    ASSERT_TRUE(iter.IsValid(), "");
+    EXPECT_EQ(kCount / 2, iter->GetKey(), "");
+
+    auto ptr = table.erase_if([](const typename Traits::ObjType& obj) {
+        return obj.GetKey() == kCount - 1;
+    });
+    ASSERT_NONNULL(ptr, "");
+    EXPECT_EQ(kCount - 1, ptr->GetKey(), "");
+    Traits::Destroy(mxtl::move(ptr));
+
+    DrainTable<Traits>(&table);
+    EXPECT_EQ(0u, Traits::live_obj_count(), "");
+
+    END_TEST;
+}
+
+template <typename Traits, size_t kCount>
+bool insert_or_find_test() {
+    BEGIN_TEST;
+
+    TableType<Traits> table;
+    for (KeyType i = 0; i < kCount; ++i) {
+        auto ptr = Traits::Create(i);
+        ASSERT_NONNULL(ptr, "");
+        typename TableType<Traits>::iterator iter;
+        EXPECT_TRUE(table.insert_or_find(mxtl::move(ptr), &iter), "");
+        ASSERT_TRUE(iter.IsValid(), "");
+        EXPECT_EQ(i, iter->GetKey(), "");
+    }
+
+    for (KeyType i = 0; i < kCount; ++i) {
+        auto ptr = Traits::Create(i);
+        ASSERT_NONNULL(ptr, "");
+        auto raw = &*ptr;
+        typename TableType<Traits>::iterator iter;
+        // Managed pointers are only moved from on success, so the duplicate
+        // is still ours.
+        EXPECT_FALSE(table.insert_or_find(mxtl::move(ptr), &iter), "");
+        ASSERT_TRUE(iter.IsValid(), "");
+        EXPECT_EQ(i, iter->GetKey(), "");
+        EXPECT_NEQ(raw, &*iter, "");
+        EXPECT_FALSE(raw->InContainer(), "");
+        Traits::Destroy(mxtl::move(ptr));
+    }
+    EXPECT_EQ(kCount, table.size(), "");
+
+    DrainTable<Traits>(&table);
+    EXPECT_EQ(0u, Traits::live_obj_count(), "");
+
+    END_TEST;
+}
+
+// Growing and shrinking the table repeatedly keeps every element reachable.
+template <typename Traits, size_t kCount>
+bool grow_shrink_test() {
+    BEGIN_TEST;
+
+    TableType<Traits> table;
+    for (size_t round = 0; round < 3; ++round) {
+        for (KeyType i = 0; i < kCount; ++i) {
+            auto ptr = Traits::Create(i * 7919u);
+            ASSERT_NONNULL(ptr, "");
+            table.insert(mxtl::move(ptr));
+        }
+        size_t grown = table.bucket_count();
+        EXPECT_LE(kCount, grown, "");
+
+        // Shrink to a quarter, checking the rest are still there.
+        for (KeyType i = 0; i < kCount; ++i) {
+            if (i % 4 == 0)
+                continue;
+            Traits::Destroy(table.erase(i * 7919u));
+        }
+        if (grown > TableType<Traits>::kMinBuckets) {
+            EXPECT_LT(table.bucket_count(), grown, "");
+        }
+        for (KeyType i = 0; i < kCount; i += 4) {
+            EXPECT_TRUE(table.find(i * 7919u).IsValid(), "");
+        }
+
+        DrainTable<Traits>(&table);
+        EXPECT_EQ(TableType<Traits>::kMinBuckets, table.bucket_count(), "");
+    }
+    EXPECT_EQ(0u, Traits::live_obj_count(), "");
+
+    END_TEST;
+}
+
+template <typename Traits, size_t kCount>
+bool clear_test() {
+    BEGIN_TEST;
+
+    {
+        TableType<Traits> table;
+        for (KeyType i = 0; i < kCount; ++i) {
+            auto ptr = Traits::Create(i);
+            ASSERT_NONNULL(ptr, "");
+            table.insert(mxtl::move(ptr));
+        }
+
+        if (TableType<Traits>::PtrTraits::IsManaged) {
+            // Managed tables release their elements when cleared or
+            // destroyed.
+            table.clear();
+            EXPECT_EQ(0u, Traits::live_obj_count(), "");
+            EXPECT_EQ(TableType<Traits>::kMinBuckets, table.bucket_count(), "");
+        } else {
+            DrainTable<Traits>(&table);
+        }
+    }
+    EXPECT_EQ(0u, Traits::live_obj_count(), "");
+
+    END_TEST;
+}
+
+}  // namespace
+
+#define RUN_FOR_ALL_TRAITS(test_base, count)                 \
+        RUN_TEST((test_base<UnmanagedTraits, count>))        \
+        RUN_TEST((test_base<UniquePtrTraits, count>))        \
+        RUN_TEST((test_base<RefPtrTraits, count>))
+
+#define RUN_FOR_ALL(test_base)             \
+        RUN_FOR_ALL_TRAITS(test_base, 1)   \
+        RUN_FOR_ALL_TRAITS(test_base, 16)  \
+        RUN_FOR_ALL_TRAITS(test_base, 17)  \
+        RUN_FOR_ALL_TRAITS(test_base, 100) \
+        RUN_FOR_ALL_TRAITS(test_base, 5000)
+
+BEGIN_TEST_CASE(resizable_hash_table_tests)
+RUN_FOR_ALL(insert_find_erase_test)
+RUN_FOR_ALL(iterate_test)
+RUN_FOR_ALL(insert_or_find_test)
+RUN_FOR_ALL(grow_shrink_test)
+RUN_FOR_ALL(clear_test)
+END_TEST_CASE(resizable_hash_table_tests)
+
+}  // namespace tests
+}  // namespace mxtl
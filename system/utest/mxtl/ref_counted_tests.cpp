@@ -65,6 +65,35 @@ static bool ref_counted_test() {
     END_TEST;
 }
 
+static bool upgrade_from_raw_test() {
+    BEGIN_TEST;
+
+    bool destroyed = false;
+    AllocChecker ac;
+    mxtl::RefPtr<DestructionTracker> ptr =
+        mxtl::AdoptRef(new (&ac) DestructionTracker(&destroyed));
+    EXPECT_TRUE(ac.check(), "");
+
+    // A live object can be upgraded.
+    {
+        mxtl::RefPtr<DestructionTracker> upgraded =
+            mxtl::MakeRefPtrUpgradeFromRaw(ptr.get());
+        EXPECT_TRUE(upgraded == ptr, "");
+    }
+    EXPECT_FALSE(destroyed, "");
+
+    // Once the last reference is released, it cannot.
+    DestructionTracker* raw = ptr.leak_ref();
+    EXPECT_TRUE(raw->Release(), "");
+    mxtl::RefPtr<DestructionTracker> upgraded = mxtl::MakeRefPtrUpgradeFromRaw(raw);
+    EXPECT_NULL(upgraded, "");
+
+    delete raw;
+    EXPECT_TRUE(destroyed, "");
+
+    END_TEST;
+}
+
 static bool wrap_dead_pointer_asserts() {
     BEGIN_TEST;
     if (!RUN_DEATH_TESTS) {
@@ -192,6 +221,7 @@ static bool unadopted_release_asserts() {
 
 BEGIN_TEST_CASE(ref_counted_tests)
 RUN_NAMED_TEST("Ref Counted", ref_counted_test)
+RUN_NAMED_TEST("Upgrade from raw pointer", upgrade_from_raw_test)
 RUN_NAMED_TEST("Wrapping dead pointer should assert", wrap_dead_pointer_asserts)
 RUN_NAMED_TEST("Extra release should assert", extra_release_asserts)
 RUN_NAMED_TEST("Wrapping zero-count pointer should assert",
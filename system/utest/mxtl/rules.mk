@@ -15,11 +15,13 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/array_tests.cpp \
     $(LOCAL_DIR)/atomic_tests.cpp \
     $(LOCAL_DIR)/auto_call_tests.cpp \
+    $(LOCAL_DIR)/bench.cpp \
     $(LOCAL_DIR)/forward_tests.cpp \
     $(LOCAL_DIR)/intrusive_container_tests.cpp \
     $(LOCAL_DIR)/intrusive_doubly_linked_list_tests.cpp \
     $(LOCAL_DIR)/intrusive_hash_table_dll_tests.cpp \
     $(LOCAL_DIR)/intrusive_hash_table_sll_tests.cpp \
+    $(LOCAL_DIR)/intrusive_resizable_hash_table_tests.cpp \
     $(LOCAL_DIR)/intrusive_singly_linked_list_tests.cpp \
     $(LOCAL_DIR)/intrusive_wavl_tree_tests.cpp \
     $(LOCAL_DIR)/main.c \
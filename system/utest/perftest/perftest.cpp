@@ -0,0 +1,96 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <perftest/perftest.h>
+
+#include <unittest/unittest.h>
+
+// These unit tests are for the runner support in ulib/perftest, not for the
+// performance of anything.
+
+namespace {
+
+bool repeat_state_runs() {
+    BEGIN_TEST;
+
+    uint64_t timestamps[4] = {};
+    perftest::RepeatState state(3, timestamps);
+    uint32_t runs = 0;
+    while (state.KeepRunning())
+        runs++;
+
+    EXPECT_EQ(runs, 3u, "wrong number of runs");
+    EXPECT_TRUE(state.finished(), "not finished");
+    for (int i = 1; i < 4; i++) {
+        EXPECT_GE(timestamps[i], timestamps[i - 1], "timestamps out of order");
+    }
+
+    // Calling KeepRunning() again must not write past the end.
+    EXPECT_FALSE(state.KeepRunning(), "ran again");
+
+    END_TEST;
+}
+
+bool repeat_state_unfinished() {
+    BEGIN_TEST;
+
+    uint64_t timestamps[4] = {};
+    perftest::RepeatState state(3, timestamps);
+    EXPECT_TRUE(state.KeepRunning(), "");
+    EXPECT_TRUE(state.KeepRunning(), "");
+    EXPECT_FALSE(state.finished(), "finished early");
+
+    END_TEST;
+}
+
+bool summarize() {
+    BEGIN_TEST;
+
+    // 1..100 in reverse order.
+    uint64_t times[100];
+    for (uint32_t i = 0; i < 100; i++)
+        times[i] = 100 - i;
+
+    perftest::Summary summary;
+    perftest::Summarize(times, 100, &summary);
+    EXPECT_EQ(summary.runs, 100u, "");
+    EXPECT_EQ(summary.min, 1u, "");
+    EXPECT_EQ(summary.p50, 50u, "");
+    EXPECT_EQ(summary.p90, 90u, "");
+    EXPECT_EQ(summary.p99, 99u, "");
+    EXPECT_EQ(summary.max, 100u, "");
+    EXPECT_TRUE(summary.mean == 50.5, "wrong mean");
+    // The population standard deviation of 1..100 is sqrt(833.25).
+    EXPECT_TRUE(summary.std_dev > 28.86 && summary.std_dev < 28.87, "wrong std dev");
+
+    END_TEST;
+}
+
+bool summarize_one() {
+    BEGIN_TEST;
+
+    uint64_t time = 42;
+    perftest::Summary summary;
+    perftest::Summarize(&time, 1, &summary);
+    EXPECT_EQ(summary.min, 42u, "");
+    EXPECT_EQ(summary.p50, 42u, "");
+    EXPECT_EQ(summary.p99, 42u, "");
+    EXPECT_EQ(summary.max, 42u, "");
+    EXPECT_TRUE(summary.std_dev == 0, "wrong std dev");
+
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(perftest_tests)
+RUN_TEST(repeat_state_runs)
+RUN_TEST(repeat_state_unfinished)
+RUN_TEST(summarize)
+RUN_TEST(summarize_one)
+END_TEST_CASE(perftest_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
@@ -0,0 +1,28 @@
+# Copyright 2017 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := usertest
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/perftest.cpp \
+
+MODULE_NAME := perftest-test
+
+MODULE_LIBS := \
+    system/ulib/unittest \
+    system/ulib/magenta \
+    system/ulib/c \
+    system/ulib/mxio \
+
+MODULE_STATIC_LIBS := \
+    system/ulib/perftest \
+    system/ulib/mxalloc \
+    system/ulib/mxcpp \
+    system/ulib/mxtl \
+
+include make/module.mk
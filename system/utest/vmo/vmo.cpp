@@ -1074,6 +1074,91 @@ bool vmo_clone_test_4() {
     END_TEST;
 }
 
+static uint32_t vmo_chain_depth(mx_handle_t vmo) {
+    mx_info_vmo_chain_t info = {};
+    if (mx_object_get_info(vmo, MX_INFO_VMO_CHAIN, &info, sizeof(info), NULL, NULL) != MX_OK)
+        return UINT32_MAX;
+    return info.depth;
+}
+
+static uint64_t vmo_read_u64(mx_handle_t vmo, uint64_t offset) {
+    uint64_t val = UINT64_MAX;
+    size_t bytes_handled;
+    mx_vmo_read(vmo, &val, offset, sizeof(val), &bytes_handled);
+    return val;
+}
+
+bool vmo_clone_chain_collapse_test() {
+    BEGIN_TEST;
+
+    mx_handle_t vmo;
+    mx_handle_t clone1;
+    mx_handle_t clone2;
+    mx_handle_t clone3;
+    size_t bytes_handled;
+
+    // create a vmo with the page number at the start of each page
+    const size_t size = PAGE_SIZE * 4;
+    ASSERT_EQ(MX_OK, mx_vmo_create(size, 0, &vmo), "vm_object_create");
+    for (uint64_t page = 0; page < 4; page++) {
+        mx_vmo_write(vmo, &page, page * PAGE_SIZE, sizeof(page), &bytes_handled);
+    }
+    EXPECT_EQ(0u, vmo_chain_depth(vmo), "original depth");
+
+    // a chain of clones, each writing one page; the first does not cover the last page
+    uint64_t val = 100;
+    ASSERT_EQ(MX_OK, mx_vmo_clone(vmo, MX_VMO_CLONE_COPY_ON_WRITE, 0, PAGE_SIZE * 3, &clone1), "vm_clone");
+    mx_vmo_write(clone1, &val, PAGE_SIZE, sizeof(val), &bytes_handled);
+    val = 200;
+    ASSERT_EQ(MX_OK, mx_vmo_clone(clone1, MX_VMO_CLONE_COPY_ON_WRITE, 0, size, &clone2), "vm_clone");
+    mx_vmo_write(clone2, &val, PAGE_SIZE * 2, sizeof(val), &bytes_handled);
+    ASSERT_EQ(MX_OK, mx_vmo_clone(clone2, MX_VMO_CLONE_COPY_ON_WRITE, 0, size, &clone3), "vm_clone");
+    EXPECT_EQ(3u, vmo_chain_depth(clone3), "depth before collapse");
+
+    // nothing but clone3 can see the intermediate clones once their handles are closed
+    EXPECT_EQ(MX_OK, mx_handle_close(clone1), "");
+    EXPECT_EQ(MX_OK, mx_handle_close(clone2), "");
+    EXPECT_EQ(1u, vmo_chain_depth(clone3), "depth after collapse");
+
+    // the collapsed clone reads back the same
+    EXPECT_EQ(0u, vmo_read_u64(clone3, 0), "page from the original");
+    EXPECT_EQ(100u, vmo_read_u64(clone3, PAGE_SIZE), "page from the first clone");
+    EXPECT_EQ(200u, vmo_read_u64(clone3, PAGE_SIZE * 2), "page from the second clone");
+    EXPECT_EQ(0u, vmo_read_u64(clone3, PAGE_SIZE * 3), "page outside the first clone");
+
+    // and still sees changes to the original, within the range it could before
+    val = 300;
+    mx_vmo_write(vmo, &val, 0, sizeof(val), &bytes_handled);
+    mx_vmo_write(vmo, &val, PAGE_SIZE * 3, sizeof(val), &bytes_handled);
+    EXPECT_EQ(300u, vmo_read_u64(clone3, 0), "write to the original");
+    EXPECT_EQ(0u, vmo_read_u64(clone3, PAGE_SIZE * 3), "write outside the first clone");
+    EXPECT_EQ(MX_OK, mx_handle_close(clone3), "");
+
+    // collapse again into a clone of an already collapsed clone, which holds a
+    // page of its own past the range it sees of the original
+    ASSERT_EQ(MX_OK, mx_vmo_clone(vmo, MX_VMO_CLONE_COPY_ON_WRITE, 0, PAGE_SIZE * 3, &clone1), "vm_clone");
+    ASSERT_EQ(MX_OK, mx_vmo_clone(clone1, MX_VMO_CLONE_COPY_ON_WRITE, 0, size, &clone2), "vm_clone");
+    EXPECT_EQ(MX_OK, mx_handle_close(clone1), "");
+    EXPECT_EQ(1u, vmo_chain_depth(clone2), "depth after first collapse");
+    val = 400;
+    mx_vmo_write(clone2, &val, PAGE_SIZE * 3, sizeof(val), &bytes_handled);
+    ASSERT_EQ(MX_OK, mx_vmo_clone(clone2, MX_VMO_CLONE_COPY_ON_WRITE, 0, size, &clone3), "vm_clone");
+    EXPECT_EQ(MX_OK, mx_handle_close(clone2), "");
+    EXPECT_EQ(1u, vmo_chain_depth(clone3), "depth after second collapse");
+    EXPECT_EQ(300u, vmo_read_u64(clone3, 0), "page from the original");
+    EXPECT_EQ(400u, vmo_read_u64(clone3, PAGE_SIZE * 3), "page from the collapsed clone");
+
+    // the original is still hidden past the first clone's range
+    val = 500;
+    mx_vmo_write(vmo, &val, PAGE_SIZE * 3, sizeof(val), &bytes_handled);
+    EXPECT_EQ(400u, vmo_read_u64(clone3, PAGE_SIZE * 3), "write outside the first clone");
+
+    EXPECT_EQ(MX_OK, mx_handle_close(clone3), "");
+    EXPECT_EQ(MX_OK, mx_handle_close(vmo), "");
+
+    END_TEST;
+}
+
 bool vmo_clone_rights_test() {
     BEGIN_TEST;
 
@@ -1149,6 +1234,7 @@ RUN_TEST(vmo_clone_test_3);
 RUN_TEST(vmo_clone_test_4);
 RUN_TEST(vmo_clone_decommit_test);
 RUN_TEST(vmo_clone_commit_test);
+RUN_TEST(vmo_clone_chain_collapse_test);
 RUN_TEST(vmo_clone_rights_test);
 END_TEST_CASE(vmo_tests)
 